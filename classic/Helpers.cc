@@ -14,20 +14,214 @@
  * limitations under the License.
 */
 #include <filesystem>
+#include <iterator>
+#include <regex>
+#include <vector>
 
-#include <gazebo/common/Console.hh>
 #include <gazebo/transport/Node.hh>
 
 #include <simslides/common/Common.hh>
+#include <simslides/common/Log.hh>
 
 #include "Helpers.hh"
 
+namespace
+{
+  /// \brief An element in a world's text.
+  struct Span
+  {
+    /// \brief Start of its opening tag.
+    std::size_t begin{0};
+
+    /// \brief Past its closing tag, or past the opening tag if it's empty.
+    std::size_t end{0};
+
+    /// \brief Page of the slide it refers to, -1 if none.
+    int page{-1};
+  };
+
+  /// \brief Get the page number of a slide model name.
+  /// \param[in] _name Model name, such as "prefix-3".
+  /// \param[in] _prefix Model name prefix.
+  /// \return Page number, -1 if it's not a slide of this prefix.
+  int SlidePage(const std::string &_name, const std::string &_prefix)
+  {
+    if (_name.size() <= _prefix.size() + 1 ||
+        _name.compare(0, _prefix.size(), _prefix) != 0 ||
+        _name[_prefix.size()] != '-')
+    {
+      return -1;
+    }
+
+    auto number = _name.substr(_prefix.size() + 1);
+    if (number.size() > 9 ||
+        number.find_first_not_of("0123456789") != std::string::npos)
+    {
+      return -1;
+    }
+
+    return std::stoi(number);
+  }
+
+  /// \brief Find an attribute in an opening tag.
+  /// \param[in] _tag Tag text.
+  /// \param[in] _name Attribute name.
+  /// \param[out] _pos Position of its value in the tag.
+  /// \return Value, empty if not set.
+  std::string Attribute(const std::string &_tag, const std::string &_name,
+      std::size_t &_pos)
+  {
+    std::regex re("\\b" + _name + "\\s*=\\s*(['\"])([^'\"]*)\\1");
+    std::smatch match;
+    if (!std::regex_search(_tag, match, re))
+      return std::string();
+
+    _pos = match.position(2);
+    return match.str(2);
+  }
+
+  /// \brief Find every element with a given name in part of a world.
+  /// \param[in] _world World SDF.
+  /// \param[in] _name Element name.
+  /// \param[in] _from Where to start looking.
+  /// \param[in] _to Where to stop looking.
+  /// \return Elements, without their page set.
+  std::vector<Span> Elements(const std::string &_world,
+      const std::string &_name, std::size_t _from, std::size_t _to)
+  {
+    std::vector<Span> spans;
+    std::regex re("<" + _name + "\\b[^>]*>");
+    auto close = "</" + _name + ">";
+    for (std::sregex_iterator it(_world.begin() + _from,
+        _world.begin() + _to, re), end; it != end; ++it)
+    {
+      Span span;
+      span.begin = _from + it->position(0);
+      span.end = span.begin + it->length(0);
+
+      auto tag = it->str(0);
+      if (tag[tag.size() - 2] != '/')
+      {
+        auto closePos = _world.find(close, span.end);
+        if (closePos == std::string::npos || closePos >= _to)
+          continue;
+        span.end = closePos + close.size();
+      }
+
+      // Skip elements nested in the previous one
+      if (!spans.empty() && span.begin < spans.back().end)
+        continue;
+
+      spans.push_back(span);
+    }
+    return spans;
+  }
+
+  /// \brief Find the SimSlides plugin in a world.
+  /// \param[in] _world World SDF.
+  /// \param[out] _span Plugin element.
+  /// \return False if there's none.
+  bool FindPlugin(const std::string &_world, Span &_span)
+  {
+    for (const auto &span : Elements(_world, "plugin", 0, _world.size()))
+    {
+      auto tagEnd = _world.find('>', span.begin) + 1;
+      std::size_t pos;
+      if (Attribute(_world.substr(span.begin, tagEnd - span.begin),
+          "filename", pos) == "libSimSlidesClassic.so")
+      {
+        _span = span;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  /// \brief Start of the line a position is on, if there's only whitespace
+  /// before it on that line.
+  /// \param[in] _world World SDF.
+  /// \param[in] _pos Position.
+  /// \return Start of the line, or _pos.
+  std::size_t LineStart(const std::string &_world, std::size_t _pos)
+  {
+    auto start = _world.find_last_not_of(" \t", _pos == 0 ? 0 : _pos - 1);
+    if (_pos == 0 || start == std::string::npos)
+      return 0;
+    return _world[start] == '\n' ? start + 1 : _pos;
+  }
+
+  /// \brief Whitespace a line starts with.
+  /// \param[in] _world World SDF.
+  /// \param[in] _pos Position on the line.
+  /// \return Indentation.
+  std::string Indent(const std::string &_world, std::size_t _pos)
+  {
+    auto start = _world.rfind('\n', _pos == 0 ? 0 : _pos - 1);
+    start = start == std::string::npos ? 0 : start + 1;
+    auto end = _world.find_first_not_of(" \t", start);
+    return _world.substr(start, end - start);
+  }
+
+  /// \brief Extend an element over its whole line, if it's alone on it, so
+  /// removing it doesn't leave a blank line.
+  /// \param[in] _world World SDF.
+  /// \param[in] _span Element.
+  /// \return Range to remove.
+  std::pair<std::size_t, std::size_t> WholeLine(const std::string &_world,
+      const Span &_span)
+  {
+    auto begin = LineStart(_world, _span.begin);
+    auto end = _world.find_first_not_of(" \t", _span.end);
+    if (begin != _span.begin && end != std::string::npos && _world[end] == '\n')
+      return {begin, end + 1};
+    return {_span.begin, _span.end};
+  }
+
+  /// \brief LOOKAT and STACK keyframes in the plugin, with the slide they
+  /// look at.
+  /// \param[in] _world World SDF.
+  /// \param[in] _plugin SimSlides plugin.
+  /// \param[in] _prefix Model name prefix.
+  /// \param[out] _types Type of each keyframe.
+  /// \return Keyframes, with the page set for slides of this prefix.
+  std::vector<Span> Keyframes(const std::string &_world, const Span &_plugin,
+      const std::string &_prefix, std::vector<std::string> &_types)
+  {
+    auto keyframes = Elements(_world, "keyframe", _plugin.begin + 1,
+        _plugin.end);
+    _types.clear();
+    for (auto &keyframe : keyframes)
+    {
+      auto tag = _world.substr(keyframe.begin,
+          _world.find('>', keyframe.begin) + 1 - keyframe.begin);
+      std::size_t pos;
+      _types.push_back(Attribute(tag, "type", pos));
+      if (_types.back() == "lookat" || _types.back() == "stack")
+        keyframe.page = SlidePage(Attribute(tag, "visual", pos), _prefix);
+    }
+    return keyframes;
+  }
+
+  /// \brief Text of an element's child, such as an include's <name>.
+  /// \param[in] _element Element text.
+  /// \param[in] _name Child name.
+  /// \return Trimmed text, empty if there's no such child.
+  std::string ChildText(const std::string &_element, const std::string &_name)
+  {
+    std::regex re("<" + _name + ">\\s*([^<]*?)\\s*</" + _name + ">");
+    std::smatch match;
+    if (!std::regex_search(_element, match, re))
+      return std::string();
+    return match.str(1);
+  }
+}
+
 /////////////////////////////////////////////////
 void simslides::SpawnSlides()
 {
   if (Common::Instance()->slidePath.empty())
   {
-    gzerr << "Missing slide path." << std::endl;
+    sserr << "Missing slide path." << std::endl;
     return;
   }
 
@@ -42,8 +236,12 @@ void simslides::SpawnSlides()
   for (const auto & dir : std::filesystem::directory_iterator(
       Common::Instance()->slidePath))
   {
-    if (!dir.is_directory())
+    // Skip hidden folders, such as an import's temp folder
+    if (!dir.is_directory() ||
+        dir.path().filename().u8string().rfind(".", 0) == 0)
+    {
       continue;
+    }
 
     gazebo::msgs::Factory msg;
 
@@ -69,3 +267,221 @@ void simslides::SpawnSlides()
   factoryPub.reset();
   node->Fini();
 }
+
+/////////////////////////////////////////////////
+std::string simslides::MergeSlides(const std::string &_world,
+    const std::string &_prefix, const std::map<int, std::string> &_slides)
+{
+  std::smatch match;
+  static const std::regex worldRe("<world\\b[^>]*>");
+  if (!std::regex_search(_world, match, worldRe))
+    return std::string();
+
+  auto world = _world;
+  Span plugin;
+  if (!FindPlugin(world, plugin))
+  {
+    auto worldIndent = Indent(world, match.position(0));
+    auto indent = worldIndent + "    ";
+    std::string pluginStr =
+        indent + "<plugin name='simslides' "
+        "filename='libSimSlidesClassic.so'>\n" +
+        indent + "</plugin>\n" +
+        indent + "<plugin name='keyboard' "
+        "filename='libKeyboardGUIPlugin.so'>\n" +
+        indent + "</plugin>\n";
+
+    static const std::regex guiRe("<gui\\b[^>/]*>");
+    std::smatch guiMatch;
+    if (std::regex_search(world, guiMatch, guiRe))
+    {
+      world.insert(guiMatch.position(0) + guiMatch.length(0),
+          "\n" + pluginStr.substr(0, pluginStr.size() - 1));
+    }
+    else
+    {
+      world.insert(match.position(0) + match.length(0),
+          "\n" + worldIndent + "  <gui>\n" + pluginStr + worldIndent +
+          "  </gui>");
+    }
+    FindPlugin(world, plugin);
+  }
+  else if (world[plugin.end - 2] == '/')
+  {
+    // Make room for keyframes
+    auto close = ">\n" + Indent(world, plugin.begin) + "</plugin>";
+    world.replace(plugin.end - 2, 2, close);
+    plugin.end += close.size() - 2;
+  }
+
+  // Edits are applied from the end so positions stay valid. Insertions at
+  // the same position keep their order.
+  std::map<std::size_t, std::pair<std::size_t, std::string>> edits;
+  auto remove = [&](const Span &_span)
+  {
+    auto range = WholeLine(world, _span);
+    edits[range.first].first = range.second - range.first;
+  };
+
+  // Keyframes
+  std::vector<std::string> types;
+  auto keyframes = Keyframes(world, plugin, _prefix, types);
+
+  std::map<int, std::size_t> first;
+  std::map<int, std::size_t> last;
+  for (std::size_t i = 0; i < keyframes.size(); ++i)
+  {
+    auto page = keyframes[i].page;
+    if (page < 0)
+      continue;
+
+    if (_slides.find(page) == _slides.end())
+    {
+      remove(keyframes[i]);
+      continue;
+    }
+
+    last[page] = i;
+    if (first.find(page) != first.end())
+      continue;
+    first[page] = i;
+
+    auto type = _slides.at(page);
+    if (types[i] != type)
+    {
+      auto tag = world.substr(keyframes[i].begin,
+          world.find('>', keyframes[i].begin) + 1 - keyframes[i].begin);
+      std::size_t pos{0};
+      Attribute(tag, "type", pos);
+      edits[keyframes[i].begin + pos] = {types[i].size(), type};
+    }
+  }
+
+  // New keyframes go after the previous slide's, or before the next one's
+  auto pluginClose = plugin.end - std::string("</plugin>").size();
+  auto keyframeIndent = keyframes.empty() ?
+      Indent(world, plugin.begin) + "  " :
+      Indent(world, keyframes.front().begin);
+
+  // Where each slide's new keyframes are inserted, and whether they go
+  // after that position
+  std::map<int, std::pair<std::size_t, bool>> anchors;
+  for (const auto &[page, index] : last)
+    anchors[page] = {keyframes[index].end, true};
+
+  for (const auto &[page, type] : _slides)
+  {
+    if (first.find(page) != first.end())
+      continue;
+
+    std::pair<std::size_t, bool> anchor;
+    auto next = anchors.lower_bound(page);
+    if (next != anchors.begin())
+    {
+      anchor = std::prev(next)->second;
+    }
+    else if (next != anchors.end())
+    {
+      auto nextFirst = first.find(next->first);
+      anchor = nextFirst != first.end() ?
+          std::make_pair(LineStart(world, keyframes[nextFirst->second].begin),
+          false) : next->second;
+    }
+    else
+    {
+      anchor = {LineStart(world, pluginClose), false};
+    }
+    anchors[page] = anchor;
+
+    auto tag = "<keyframe type='" + type + "' visual='" + _prefix + "-" +
+        std::to_string(page) + "'/>";
+    auto &edit = edits[anchor.first];
+    edit.second += anchor.second ?
+        "\n" + keyframeIndent + tag : keyframeIndent + tag + "\n";
+  }
+
+  // Includes
+  static const std::regex worldCloseRe("</world>");
+  std::smatch closeMatch;
+  if (!std::regex_search(world, closeMatch, worldCloseRe))
+    return std::string();
+  auto worldClose = static_cast<std::size_t>(closeMatch.position(0));
+
+  std::map<int, bool> included;
+  for (auto &include : Elements(world, "include", 0, worldClose))
+  {
+    if (include.begin > plugin.begin && include.begin < plugin.end)
+      continue;
+
+    auto text = world.substr(include.begin, include.end - include.begin);
+    auto name = ChildText(text, "name");
+    if (name.empty())
+    {
+      name = ChildText(text, "uri");
+      if (name.compare(0, 8, "model://") == 0)
+        name = name.substr(8);
+    }
+
+    auto page = SlidePage(name, _prefix);
+    if (page < 0)
+      continue;
+
+    if (_slides.find(page) == _slides.end())
+      remove(include);
+    else
+      included[page] = true;
+  }
+
+  auto closeIndent = Indent(world, worldClose);
+  auto includeIndent = closeIndent + "  ";
+  auto &includeEdit = edits[LineStart(world, worldClose)];
+  for (const auto &slide : _slides)
+  {
+    if (included.find(slide.first) != included.end())
+      continue;
+
+    auto modelName = _prefix + "-" + std::to_string(slide.first);
+    includeEdit.second +=
+        includeIndent + "<include>\n" +
+        includeIndent + "  <name>" + modelName + "</name>\n" +
+        includeIndent + "  <pose>" + std::to_string(slide.first) +
+        "0 0 0 0 0 0</pose>\n" +
+        includeIndent + "  <uri>model://" + modelName + "</uri>\n" +
+        includeIndent + "</include>\n";
+  }
+
+  for (auto it = edits.rbegin(); it != edits.rend(); ++it)
+    world.replace(it->first, it->second.first, it->second.second);
+
+  return world;
+}
+
+/////////////////////////////////////////////////
+std::map<int, std::string> simslides::SlideKeyframeTypes(
+    const std::string &_world, const std::string &_prefix)
+{
+  std::map<int, std::string> result;
+
+  Span plugin;
+  if (!FindPlugin(_world, plugin))
+    return result;
+
+  std::vector<std::string> types;
+  auto keyframes = Keyframes(_world, plugin, _prefix, types);
+  for (std::size_t i = 0; i < keyframes.size(); ++i)
+  {
+    if (keyframes[i].page >= 0)
+      result.emplace(keyframes[i].page, types[i]);
+  }
+  return result;
+}
+
+/////////////////////////////////////////////////
+std::string simslides::SlidesPlugin(const std::string &_world)
+{
+  Span plugin;
+  if (!FindPlugin(_world, plugin))
+    return std::string();
+
+  return _world.substr(plugin.begin, plugin.end - plugin.begin);
+}
@@ -16,12 +16,47 @@
 #ifndef SIMSLIDES_CLASSIC_HELPERS_HH_
 #define SIMSLIDES_CLASSIC_HELPERS_HH_
 
+#include <map>
+#include <string>
+
 namespace simslides
 {
   /// \brief Spawn slide models into the world based on simslides::Common::slidePath.
   /// This is used after slides are generated and if the option to load slides
   /// is chosen, but not if slides are loaded from a world.
   void SpawnSlides();
+
+  /// \brief Merge the slides of an import into a world's SDF. Everything
+  /// else in the world is left as it was, including keyframes and includes
+  /// of slides which are still there, so edits made to the world after it
+  /// was first generated are kept:
+  /// * Slides which aren't in the world yet get an <include> and a keyframe,
+  ///   placed after the keyframes of the previous slides.
+  /// * Keyframes and includes of slides which were removed are removed.
+  /// * The first LOOKAT or STACK keyframe of each slide gets its type.
+  /// * A <gui> with the SimSlides plugin is added if there isn't one.
+  /// \param[in] _world World SDF, such as the contents of an existing
+  /// world file.
+  /// \param[in] _prefix Model name prefix, slides are named
+  /// "<prefix>-<page>".
+  /// \param[in] _slides Keyframe type of each imported slide, "lookat" or
+  /// "stack", by page number.
+  /// \return Merged SDF, empty if _world has no <world>.
+  std::string MergeSlides(const std::string &_world,
+      const std::string &_prefix, const std::map<int, std::string> &_slides);
+
+  /// \brief Get the type of each slide's first LOOKAT or STACK keyframe in a
+  /// world's SimSlides plugin.
+  /// \param[in] _world World SDF.
+  /// \param[in] _prefix Model name prefix, see MergeSlides.
+  /// \return Keyframe type by page number.
+  std::map<int, std::string> SlideKeyframeTypes(const std::string &_world,
+      const std::string &_prefix);
+
+  /// \brief Get the SimSlides plugin element of a world's SDF.
+  /// \param[in] _world World SDF.
+  /// \return The <plugin> element's text, empty if there's none.
+  std::string SlidesPlugin(const std::string &_world);
 }
 
 #endif
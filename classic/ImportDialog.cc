@@ -13,28 +13,49 @@
  * See the License for the specific language governing permissions and
  * limitations under the License.
 */
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <unordered_map>
+
 #include <gazebo/common/CommonIface.hh>
-#include <gazebo/common/Console.hh>
 #include <gazebo/common/SystemPaths.hh>
 #include <gazebo/gui/SaveEntityDialog.hh>
+#include <QCryptographicHash>
 #include <sdf/Root.hh>
 #include <simslides/common/Common.hh>
+#include <simslides/common/Log.hh>
+#include <simslides/common/TextureCache.hh>
+#include <simslides/common/TextureEncoder.hh>
 #include "Helpers.hh"
 #include "ImportDialog.hh"
+#include "PdfRasterizer.hh"
 
 using namespace simslides;
 
 class simslides::ImportDialogPrivate
 {
-  /// \brief Temp folder to keep slides while models are being generated
-  public: QString tmpDir = "/tmp/simslides_tmp";
+  /// \brief Temp folder to keep pages until they're moved into their
+  /// models. It's inside the save folder so moving is just a rename.
+  public: QString tmpDir;
 
   /// \brief Holds the path to the PDF file
   public: QLabel * pdfLabel;
 
-  /// \brief Wait message
+  /// \brief Progress message
   public: QLabel * waitLabel;
 
+  /// \brief Pages done out of the total
+  public: QProgressBar * progressBar;
+
+  /// \brief Cancels the import, or resumes it once cancelled
+  public: QPushButton * cancelButton;
+
   /// \brief Directory to save models
   public: QLineEdit * dirEdit;
 
@@ -44,9 +65,6 @@ class simslides::ImportDialogPrivate
   /// \brief Next button #1
   public: QPushButton * next1Button;
 
-  /// \brief Button to generate slides
-  public: QPushButton * generateButton;
-
   /// \brief Sping boxes for slide size
   public: QDoubleSpinBox * scaleXSpin;
   public: QDoubleSpinBox * scaleYSpin;
@@ -55,17 +73,86 @@ class simslides::ImportDialogPrivate
   /// \brief Stacked layout to hold steps
   public: QStackedLayout * stackedStepLayout;
 
+  /// \brief Step 2 layout, which holds slidesWidget
+  public: QVBoxLayout * step2Layout;
+
+  /// \brief Holds one row per slide in step 2. It's replaced every time a
+  /// conversion finishes, and owns the button groups.
+  public: QWidget * slidesWidget;
+
   /// \brief Vector holding one button group per slide
   public: std::vector<QButtonGroup *> buttonGroups;
 
-  /// \brief Total number of slides
-  public: int count;
+  /// \brief Pages which have a model, in order. Each gets a button group,
+  /// a keyframe and an <include> in the world.
+  public: std::vector<int> slides;
 
   /// \brief Prefix to be used for all generated models
   public: std::string modelPrefix;
 
-  /// \brief External process to convert PDF into images
-  public: QProcess * convertProcess{nullptr};
+  /// \brief Converts the PDF into images
+  public: PdfRasterizer rasterizer;
+
+  /// \brief Writes model.config files and adds the save folder to the
+  /// model paths
+  public: gazebo::gui::SaveEntityDialog * saveDialog{nullptr};
+
+  /// \brief Number of pages in the PDF, 0 until known
+  public: int pageCount{0};
+
+  /// \brief Pages being imported, empty if the page count isn't known
+  public: std::vector<int> selection;
+
+  /// \brief First page to import, counting from 0
+  public: int firstPage{0};
+
+  /// \brief Last page to import, counting from 0, or -1 for the end
+  public: int lastPage{-1};
+
+  /// \brief Fingerprint of each page's model when it was imported, by
+  /// page, empty if there's no model
+  public: std::vector<QString> manifest;
+
+  /// \brief Fingerprint of each page in the PDF being imported, empty
+  /// until fingerprinted
+  public: std::vector<QString> hashes;
+
+  /// \brief Textures shared by all imports
+  public: TextureCache cache;
+
+  /// \brief Pages waiting for a texture which is being rendered for
+  /// another page, by cache key. Includes the page being rendered.
+  public: std::unordered_map<std::string, std::vector<int>> pending;
+
+  /// \brief Whether pages are being fingerprinted, otherwise converted
+  public: bool hashing{false};
+
+  /// \brief Number of selected pages which are done
+  public: int doneCount{0};
+
+  /// \brief Number of pages done since the import was last started or
+  /// resumed, to estimate the time left
+  public: int runCount{0};
+
+  /// \brief When the import was last started or resumed
+  public: std::chrono::steady_clock::time_point runStart;
+
+  /// \brief File with the fingerprint of each imported page, so only
+  /// pages which changed are imported again
+  public: std::string manifestFile;
+
+  /// \brief First page to import, from 1
+  public: QSpinBox * firstPageSpin;
+
+  /// \brief Last page to import, from 1, or 0 for the last page
+  public: QSpinBox * lastPageSpin;
+
+  /// \brief Whether to generate compressed textures
+  public: QCheckBox * compressCheck;
+
+  /// \brief Whether slides get compressed, mipmapped DDS textures
+  /// instead of PNGs
+  public: bool compress{false};
 };
 
 /////////////////////////////////////////////////
@@ -89,37 +176,10 @@ ImportDialog::ImportDialog()
   auto browseButton = new QPushButton(tr("Browse"));
   this->connect(browseButton, SIGNAL(clicked()), this, SLOT(OnBrowsePDF()));
 
-  // Next 1
-  this->dataPtr->next1Button = new QPushButton(tr("Next"));
-  this->dataPtr->next1Button->setEnabled(false);
-  this->connect(this->dataPtr->next1Button, SIGNAL(clicked()), this,
-      SLOT(OnLoadPDF()));
-
-  // Step 1 layout
-  auto step1Layout = new QGridLayout;
-  step1Layout->setSpacing(0);
-  step1Layout->addWidget(step1Label, 0, 0, 1, 3);
-  step1Layout->addWidget(new QLabel("PDF file:"), 1, 0);
-  step1Layout->addWidget(this->dataPtr->pdfLabel, 1, 1);
-  step1Layout->addWidget(browseButton, 1, 2);
-  step1Layout->addWidget(this->dataPtr->next1Button, 2, 0, 1, 3);
-
-  auto step1Widget = new QWidget();
-  step1Widget->setLayout(step1Layout);
-
-  ////////////
-  // Step 2 //
-  ////////////
-
-  // Step 2 layout (created and inserted later)
-
-  ////////////
-  // Step 3 //
-  ////////////
-  auto step3Label = new QLabel(tr("<b>Step 3: Generate world and models</b>"));
-
   // Save dir
   this->dataPtr->dirEdit = new QLineEdit();
+  this->connect(this->dataPtr->dirEdit, SIGNAL(textChanged(QString)), this,
+      SLOT(CheckReady(QString)));
 
   auto saveDirButton = new QPushButton(tr("Browse"));
   this->connect(saveDirButton, SIGNAL(clicked()), this, SLOT(OnBrowseDir()));
@@ -163,40 +223,102 @@ ImportDialog::ImportDialog()
   scaleZLayout->addWidget(this->dataPtr->scaleZSpin);
   scaleZLayout->addWidget(new QLabel("m"));
 
-  // Generate
-  this->dataPtr->generateButton = new QPushButton(tr("Generate"));
-  this->dataPtr->generateButton->setEnabled(false);
-  this->connect(this->dataPtr->generateButton, SIGNAL(clicked()), this,
-      SLOT(OnGenerate()));
+  // Pages, all by default
+  this->dataPtr->firstPageSpin = new QSpinBox();
+  this->dataPtr->firstPageSpin->setRange(1, 99999);
+
+  this->dataPtr->lastPageSpin = new QSpinBox();
+  this->dataPtr->lastPageSpin->setRange(0, 99999);
+  this->dataPtr->lastPageSpin->setSpecialValueText(tr("last"));
+
+  auto pagesLayout = new QHBoxLayout();
+  pagesLayout->addWidget(this->dataPtr->firstPageSpin);
+  pagesLayout->addWidget(new QLabel("to"));
+  pagesLayout->addWidget(this->dataPtr->lastPageSpin);
+
+  // Textures, PNG by default
+  this->dataPtr->compressCheck = new QCheckBox(
+      tr("Compressed, mipmapped (DDS)"));
+  this->dataPtr->compressCheck->setToolTip(tr("Smaller in GPU memory and "
+      "faster to load, but larger on disk than PNG."));
+
+  // Next 1
+  this->dataPtr->next1Button = new QPushButton(tr("Import"));
+  this->dataPtr->next1Button->setEnabled(false);
+  this->connect(this->dataPtr->next1Button, SIGNAL(clicked()), this,
+      SLOT(OnLoadPDF()));
 
-  // Step 3 layout
+  // Step 1 layout
+  // Models are written as soon as each page is converted, so where they go
+  // is chosen up front.
   // TODO(louise): Add tooltips and consider renaming fields to be more user
   // friendly
   // (not clear what's prefix)
-  auto step3Layout = new QGridLayout;
-  step3Layout->setSpacing(0);
-  step3Layout->addWidget(step3Label, 0, 0, 1, 3);
-  step3Layout->addWidget(new QLabel("Save folder:"), 1, 0);
-  step3Layout->addWidget(this->dataPtr->dirEdit, 1, 1);
-  step3Layout->addWidget(saveDirButton, 1, 2);
-  step3Layout->addWidget(new QLabel("Prefix:"), 2, 0);
-  step3Layout->addWidget(this->dataPtr->nameEdit, 2, 1, 1, 2);
-  step3Layout->addWidget(new QLabel("Model scale:"), 3, 0);
-  step3Layout->addLayout(scaleXLayout, 3, 1, 1, 2);
-  step3Layout->addLayout(scaleYLayout, 4, 1, 1, 2);
-  step3Layout->addLayout(scaleZLayout, 5, 1, 1, 2);
-  step3Layout->addWidget(this->dataPtr->generateButton, 6, 0, 1, 3);
-
-  auto step3Widget = new QWidget();
-  step3Widget->setLayout(step3Layout);
-
-  // Wait
-  // TODO(louise): Show progress gif while loading
-  this->dataPtr->waitLabel = new QLabel(
-      "   Transforming PDF into PNG, this may take a while...\n\
-           Believe me, just wait.");
-
-  // TODO(louise): Handle importing a new PDF better.
+  auto step1Layout = new QGridLayout;
+  step1Layout->setSpacing(0);
+  step1Layout->addWidget(step1Label, 0, 0, 1, 3);
+  step1Layout->addWidget(new QLabel("PDF file:"), 1, 0);
+  step1Layout->addWidget(this->dataPtr->pdfLabel, 1, 1);
+  step1Layout->addWidget(browseButton, 1, 2);
+  step1Layout->addWidget(new QLabel("Save folder:"), 2, 0);
+  step1Layout->addWidget(this->dataPtr->dirEdit, 2, 1);
+  step1Layout->addWidget(saveDirButton, 2, 2);
+  step1Layout->addWidget(new QLabel("Prefix:"), 3, 0);
+  step1Layout->addWidget(this->dataPtr->nameEdit, 3, 1, 1, 2);
+  step1Layout->addWidget(new QLabel("Model scale:"), 4, 0);
+  step1Layout->addLayout(scaleXLayout, 4, 1, 1, 2);
+  step1Layout->addLayout(scaleYLayout, 5, 1, 1, 2);
+  step1Layout->addLayout(scaleZLayout, 6, 1, 1, 2);
+  step1Layout->addWidget(new QLabel("Pages:"), 7, 0);
+  step1Layout->addLayout(pagesLayout, 7, 1, 1, 2);
+  step1Layout->addWidget(new QLabel("Textures:"), 8, 0);
+  step1Layout->addWidget(this->dataPtr->compressCheck, 8, 1, 1, 2);
+  step1Layout->addWidget(this->dataPtr->next1Button, 9, 0, 1, 3);
+
+  auto step1Widget = new QWidget();
+  step1Widget->setLayout(step1Layout);
+
+  //////////////
+  // Progress //
+  //////////////
+  this->dataPtr->waitLabel = new QLabel(tr("Transforming PDF into PNG..."));
+
+  this->dataPtr->progressBar = new QProgressBar();
+  this->dataPtr->progressBar->setMinimumWidth(300);
+
+  this->dataPtr->cancelButton = new QPushButton(tr("Cancel"));
+  this->connect(this->dataPtr->cancelButton, SIGNAL(clicked()), this,
+      SLOT(OnCancel()));
+
+  auto progressLayout = new QVBoxLayout;
+  progressLayout->addWidget(this->dataPtr->waitLabel);
+  progressLayout->addWidget(this->dataPtr->progressBar);
+  progressLayout->addWidget(this->dataPtr->cancelButton);
+
+  auto progressWidget = new QWidget();
+  progressWidget->setLayout(progressLayout);
+
+  ////////////
+  // Step 2 //
+  ////////////
+
+  auto step2Label = new QLabel(tr("<b>Step 2: Keyframes</b>"));
+
+  // Slides (filled in once pages are converted)
+  this->dataPtr->slidesWidget = new QWidget();
+
+  // Generate
+  auto generateButton = new QPushButton(tr("Generate"));
+  this->connect(generateButton, SIGNAL(clicked()), this, SLOT(OnGenerate()));
+
+  this->dataPtr->step2Layout = new QVBoxLayout;
+  this->dataPtr->step2Layout->setSpacing(0);
+  this->dataPtr->step2Layout->addWidget(step2Label);
+  this->dataPtr->step2Layout->addWidget(this->dataPtr->slidesWidget);
+  this->dataPtr->step2Layout->addWidget(generateButton);
+
+  auto step2Widget = new QWidget();
+  step2Widget->setLayout(this->dataPtr->step2Layout);
 
   //////////
   // Main //
@@ -205,15 +327,23 @@ ImportDialog::ImportDialog()
   // Stacked layout
   this->dataPtr->stackedStepLayout = new QStackedLayout;
   this->dataPtr->stackedStepLayout->addWidget(step1Widget);
-  this->dataPtr->stackedStepLayout->addWidget(this->dataPtr->waitLabel);
-  this->dataPtr->stackedStepLayout->addWidget(step3Widget);
+  this->dataPtr->stackedStepLayout->addWidget(progressWidget);
+  this->dataPtr->stackedStepLayout->addWidget(step2Widget);
 
   this->setLayout(this->dataPtr->stackedStepLayout);
+
+  this->connect(&this->dataPtr->rasterizer, SIGNAL(PageHashed(int, QString)),
+      this, SLOT(OnPageHashed(int, QString)));
+  this->connect(&this->dataPtr->rasterizer, SIGNAL(PageReady(int, QString)),
+      this, SLOT(OnPageReady(int, QString)));
+  this->connect(&this->dataPtr->rasterizer, SIGNAL(Finished(int, QString)),
+      this, SLOT(OnConversionFinished(int, QString)));
 }
 
 /////////////////////////////////////////////////
 ImportDialog::~ImportDialog()
 {
+  delete this->dataPtr->saveDialog;
 }
 
 /////////////////////////////////////////////////
@@ -235,13 +365,13 @@ void ImportDialog::OnBrowsePDF()
 
   this->dataPtr->pdfLabel->setText(fileDialog.selectedFiles()[0]);
 
-  this->dataPtr->next1Button->setEnabled(true);
+  this->CheckReady();
 }
 
 /////////////////////////////////////////////////
 void ImportDialog::OnBrowseDir()
 {
-  this->dataPtr->generateButton->setEnabled(false);
+  this->dataPtr->next1Button->setEnabled(false);
   QCoreApplication::processEvents();
 
   QFileDialog fileDialog(this, tr("Choose directory to save models"),
@@ -261,7 +391,7 @@ void ImportDialog::OnBrowseDir()
 /////////////////////////////////////////////////
 void ImportDialog::CheckReady(QString)
 {
-  this->dataPtr->generateButton->setEnabled(
+  this->dataPtr->next1Button->setEnabled(
       !this->dataPtr->pdfLabel->text().isEmpty() &&
       !this->dataPtr->nameEdit->text().isEmpty() &&
       this->dataPtr->scaleXSpin->value() != 0 &&
@@ -278,104 +408,513 @@ void ImportDialog::OnLoadPDF()
   this->dataPtr->stackedStepLayout->setCurrentIndex(1);
   QCoreApplication::processEvents();
 
+  Common::Instance()->slidePath = this->dataPtr->dirEdit->text().toStdString();
+  this->dataPtr->manifestFile = Common::Instance()->slidePath + "/" +
+      this->dataPtr->modelPrefix + ".manifest";
+
   // Create / clear temp folder to hold images
+  this->dataPtr->tmpDir = this->dataPtr->dirEdit->text() + "/.simslides_tmp";
+  QDir(this->dataPtr->tmpDir).removeRecursively();
+  if (!QDir().mkpath(this->dataPtr->tmpDir))
+  {
+    std::string error = "Failed to create temp dir [" +
+        this->dataPtr->tmpDir.toStdString() + "]";
+    this->dataPtr->waitLabel->setText(QString::fromStdString(error));
+    sserr << error << std::endl;
+    return;
+  }
+
+  // Pages are numbered from 1 on the dialog, like on PDF viewers
+  this->dataPtr->firstPage = this->dataPtr->firstPageSpin->value() - 1;
+  this->dataPtr->lastPage = this->dataPtr->lastPageSpin->value() - 1;
+
+  this->dataPtr->compress = this->dataPtr->compressCheck->isChecked();
+  this->dataPtr->rasterizer.SetCompress(this->dataPtr->compress);
+
+  this->dataPtr->pageCount =
+      PdfRasterizer::CountPages(this->dataPtr->pdfLabel->text());
+  this->dataPtr->selection.clear();
+  for (int i = 0; i < this->dataPtr->pageCount; ++i)
+  {
+    if (this->InRange(i))
+      this->dataPtr->selection.push_back(i);
+  }
+
+  this->LoadManifest();
+
+  if (!this->dataPtr->cache.Enabled())
+  {
+    this->dataPtr->cache.Open(TextureCache::DefaultDirectory(),
+        TextureCache::DefaultMaxSize());
+  }
+
+  // Find which pages changed before converting any
+  this->dataPtr->hashes.assign(this->dataPtr->pageCount, QString());
+  if (PdfRasterizer::InProcess())
+    this->StartHashing();
+  else
+    this->StartConversion();
+}
+
+/////////////////////////////////////////////////
+bool ImportDialog::InRange(int _page) const
+{
+  return _page >= this->dataPtr->firstPage &&
+      (this->dataPtr->lastPage < 0 || _page <= this->dataPtr->lastPage);
+}
+
+/////////////////////////////////////////////////
+bool ImportDialog::FullImport() const
+{
+  return this->dataPtr->firstPage <= 0 && this->dataPtr->lastPage < 0;
+}
+
+/////////////////////////////////////////////////
+void ImportDialog::StartHashing()
+{
+  std::vector<int> pages;
+  for (auto page : this->dataPtr->selection)
+  {
+    if (this->dataPtr->hashes[page].isEmpty())
+      pages.push_back(page);
+  }
+
+  this->dataPtr->hashing = true;
+  this->dataPtr->doneCount = this->dataPtr->selection.size() - pages.size();
+  this->dataPtr->runCount = 0;
+  this->dataPtr->runStart = std::chrono::steady_clock::now();
+  this->dataPtr->cancelButton->setText(tr("Cancel"));
+  this->UpdateProgress();
+
+  if (pages.empty())
+  {
+    this->OnConversionFinished(0, QString());
+    return;
+  }
+
+  this->dataPtr->rasterizer.StartHashing(this->dataPtr->pdfLabel->text(),
+      pages);
+}
+
+/////////////////////////////////////////////////
+void ImportDialog::StartConversion()
+{
+  // Only pages which changed since they were last imported. Without
+  // fingerprints, all pages are converted and unchanged ones are skipped as
+  // they come.
+  std::vector<int> changed;
+  for (auto page : this->dataPtr->selection)
   {
-    if (!gazebo::common::exists(this->dataPtr->tmpDir.toStdString()))
+    if (this->Changed(page))
+      changed.push_back(page);
+  }
+
+  this->dataPtr->hashing = false;
+  this->dataPtr->doneCount = this->dataPtr->selection.size() - changed.size();
+  this->dataPtr->runCount = 0;
+  this->dataPtr->cancelButton->setText(tr("Cancel"));
+
+  // Pages in the texture cache aren't rendered, and identical pages are
+  // only rendered once
+  this->dataPtr->pending.clear();
+  std::vector<int> pages;
+  for (auto page : changed)
+  {
+    if (this->dataPtr->hashes[page].isEmpty())
     {
-      gzmsg << "Creating temp dir [" << this->dataPtr->tmpDir.toStdString()
-            << "]" << std::endl;
-      QProcess p;
-      p.setProcessChannelMode(QProcess::ForwardedChannels);
-      p.start("mkdir", QStringList() << this->dataPtr->tmpDir);
-      p.waitForFinished();
+      pages.push_back(page);
+      continue;
     }
-    else
+
+    auto key = this->CacheKey(this->dataPtr->hashes[page]);
+    std::filesystem::path cached;
+    if (this->dataPtr->cache.Find(key, cached) &&
+        this->WriteSlide(page, QString::fromStdString(cached.string())))
     {
-      gzmsg << "Cleaning temp dir [" << this->dataPtr->tmpDir.toStdString()
-            << "]" << std::endl;
-      QProcess p;
-      p.setProcessChannelMode(QProcess::ForwardedChannels);
-      p.start("rm", QStringList() << "-rf" << QString(
-          this->dataPtr->tmpDir + "/*"));
-      p.waitForFinished();
+      this->RecordPage(page, this->dataPtr->hashes[page]);
+      ++this->dataPtr->doneCount;
+      this->UpdateProgress();
+      QCoreApplication::processEvents();
+      continue;
     }
+
+    auto &waiting = this->dataPtr->pending[key];
+    if (waiting.empty())
+      pages.push_back(page);
+    waiting.push_back(page);
   }
-  QCoreApplication::processEvents();
 
-  // Convert PDF to pngs
+  this->dataPtr->runStart = std::chrono::steady_clock::now();
+  this->UpdateProgress();
+
+  if (this->dataPtr->pageCount > 0 && pages.empty())
   {
-    if (!this->dataPtr->convertProcess)
-    {
-      this->dataPtr->convertProcess = new QProcess();
+    this->OnConversionFinished(0, QString());
+    return;
+  }
+
+  ssmsg << "Importing PDF [" << this->dataPtr->pdfLabel->text().toStdString()
+        << "] into [" << Common::Instance()->slidePath << "]" << std::endl;
+  this->dataPtr->rasterizer.Start(this->dataPtr->pdfLabel->text(),
+      this->dataPtr->tmpDir, "tmpPng", pages);
+}
+
+/////////////////////////////////////////////////
+bool ImportDialog::Changed(int _page) const
+{
+  if (_page >= static_cast<int>(this->dataPtr->manifest.size()) ||
+      this->dataPtr->manifest[_page].isEmpty())
+  {
+    return true;
+  }
+
+  return _page < static_cast<int>(this->dataPtr->hashes.size()) &&
+      this->dataPtr->manifest[_page] != this->dataPtr->hashes[_page];
+}
 
-      this->dataPtr->convertProcess->setProcessChannelMode(
-          QProcess::ForwardedChannels);
+/////////////////////////////////////////////////
+void ImportDialog::OnCancel()
+{
+  if (this->dataPtr->rasterizer.Running())
+  {
+    this->dataPtr->cancelButton->setEnabled(false);
+    this->dataPtr->rasterizer.Cancel();
+    return;
+  }
 
-      this->connect(this->dataPtr->convertProcess,
-          SIGNAL(finished(int, QProcess::ExitStatus)),
-          this, SLOT(OnConversionFinished(int, QProcess::ExitStatus)));
+  // Resume from the pages which are done
+  if (this->dataPtr->hashing)
+    this->StartHashing();
+  else
+    this->StartConversion();
+}
+
+/////////////////////////////////////////////////
+void ImportDialog::OnPageHashed(int _page, QString _hash)
+{
+  this->dataPtr->hashes[_page] = _hash;
+  ++this->dataPtr->doneCount;
+  ++this->dataPtr->runCount;
+  this->UpdateProgress();
+}
+
+/////////////////////////////////////////////////
+void ImportDialog::OnPageReady(int _page, QString _file)
+{
+  if (!this->InRange(_page))
+  {
+    QFile::remove(_file);
+    return;
+  }
+
+  // Without a fingerprint, the image itself tells whether the page changed.
+  // Its pixels are hashed rather than the file, which has a timestamp.
+  QString hash;
+  QImage image;
+  if (_page < static_cast<int>(this->dataPtr->hashes.size()))
+    hash = this->dataPtr->hashes[_page];
+  if (hash.isEmpty() && image.load(_file))
+  {
+    image = image.convertToFormat(QImage::Format_ARGB32);
+
+    QCryptographicHash imageHash(QCryptographicHash::Sha1);
+    imageHash.addData(QByteArray::number(image.width()) + " " +
+        QByteArray::number(image.height()) + "\n");
+    for (int y = 0; y < image.height(); ++y)
+    {
+      imageHash.addData(reinterpret_cast<const char *>(image.constScanLine(y)),
+          image.width() * 4);
     }
+    hash = imageHash.result().toHex();
+  }
 
-    gzmsg << "Converting PDF [" << this->dataPtr->pdfLabel->text().toStdString()
-          << "] to images" << std::endl;
-    this->dataPtr->convertProcess->start("convert", QStringList() <<
-        "-density" << "150" <<
-        "-quality" << "100" <<
-        "-sharpen" << "0x1.0" <<
-        this->dataPtr->pdfLabel->text() <<
-        QString(this->dataPtr->tmpDir + "/tmpPng.png"));
+  // Pages converted with ImageMagick are encoded here
+  auto file = _file;
+  if (this->dataPtr->compress)
+  {
+    file.replace(file.size() - 4, 4, TextureEncoder::kExtension);
+    if (image.isNull())
+      image.load(_file);
+    if (!QFile::exists(file) && !PdfRasterizer::Compress(image, file))
+    {
+      sserr << "Failed to encode [" << _file.toStdString() << "]"
+            << std::endl;
+      QFile::remove(_file);
+      this->dataPtr->rasterizer.Cancel();
+      return;
+    }
+  }
 
-    this->dataPtr->convertProcess->waitForStarted(1000);
+  // Other pages identical to this one share its texture
+  auto key = this->CacheKey(hash);
+  std::vector<int> pages{_page};
+  auto it = this->dataPtr->pending.find(key);
+  if (it != this->dataPtr->pending.end())
+  {
+    pages = it->second;
+    this->dataPtr->pending.erase(it);
+  }
+
+  // Models link to the cached texture, so identical pages, even across
+  // presentations, share one file
+  std::filesystem::path cached;
+  auto texture = file;
+  if (!hash.isEmpty() && (this->dataPtr->cache.Find(key, cached) ||
+      this->dataPtr->cache.Store(key, file.toStdString(), cached)))
+  {
+    texture = QString::fromStdString(cached.string());
+  }
 
-    if (this->dataPtr->convertProcess->error() == QProcess::FailedToStart)
+  for (auto page : pages)
+  {
+    auto unchanged = page < static_cast<int>(this->dataPtr->manifest.size()) &&
+        this->dataPtr->manifest[page] == hash;
+    if (!unchanged)
     {
-      std::string error{
-          "Failed to convert PDF. Have you installed ImageMagick?\n\
-           sudo apt-get install imagemagick"};
+      if (!this->WriteSlide(page, texture))
+      {
+        QFile::remove(_file);
+        QFile::remove(file);
+        this->dataPtr->rasterizer.Cancel();
+        return;
+      }
+      this->RecordPage(page, hash);
+    }
 
-      this->dataPtr->waitLabel->setText(QString::fromStdString(error));
-      gzerr << error << std::endl;
+    ++this->dataPtr->doneCount;
+    ++this->dataPtr->runCount;
+  }
 
-      return;
+  QFile::remove(_file);
+  QFile::remove(file);
+  this->UpdateProgress();
+}
+
+/////////////////////////////////////////////////
+std::string ImportDialog::CacheKey(const QString &_hash) const
+{
+  // Textures are only shared if they're rendered and encoded the same way
+  QCryptographicHash key(QCryptographicHash::Sha1);
+  key.addData(QByteArray(PdfRasterizer::InProcess() ? "poppler" :
+      "imagemagick") + " " + QByteArray::number(PdfRasterizer::kDefaultDensity)
+      + " " + (this->dataPtr->compress ? "dds " : "") + _hash.toUtf8());
+  return key.result().toHex().toStdString();
+}
+
+/////////////////////////////////////////////////
+void ImportDialog::UpdateProgress()
+{
+  auto total = static_cast<int>(this->dataPtr->selection.size());
+  if (total == 0)
+  {
+    // Busy indicator
+    this->dataPtr->progressBar->setRange(0, 0);
+    this->dataPtr->waitLabel->setText(QString(
+        "Transforming PDF into PNG, %1 pages done...").arg(
+        this->dataPtr->doneCount));
+    return;
+  }
+
+  this->dataPtr->progressBar->setRange(0, total);
+  this->dataPtr->progressBar->setValue(this->dataPtr->doneCount);
+
+  auto text = QString(this->dataPtr->hashing ? "Checking page %1 of %2" :
+      "Page %1 of %2").arg(this->dataPtr->doneCount).arg(total);
+  if (this->dataPtr->runCount > 0)
+  {
+    auto elapsed = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - this->dataPtr->runStart).count();
+    auto left = elapsed / this->dataPtr->runCount *
+        (total - this->dataPtr->doneCount);
+    text += QString(", about %1 s left").arg(
+        static_cast<int>(std::ceil(left)));
+  }
+  this->dataPtr->waitLabel->setText(text);
+}
+
+/////////////////////////////////////////////////
+std::string ImportDialog::ManifestHeader() const
+{
+  std::ostringstream header;
+  header << "simslides_manifest 1\n"
+         << "fingerprint "
+         << (PdfRasterizer::InProcess() ? "thumbnail" : "png") << "\n"
+         << "density " << PdfRasterizer::kDefaultDensity << "\n"
+         << "texture " << (this->dataPtr->compress ? "dds" : "png") << "\n"
+         << "scale " << this->dataPtr->scaleXSpin->value() << " "
+         << this->dataPtr->scaleYSpin->value() << " "
+         << this->dataPtr->scaleZSpin->value() << "\n";
+  return header.str();
+}
+
+/////////////////////////////////////////////////
+void ImportDialog::LoadManifest()
+{
+  this->dataPtr->manifest.clear();
+
+  // Models only count as imported if they were made with the same
+  // settings, and their texture, which is written last, is there
+  auto header = this->ManifestHeader();
+
+  std::ifstream in(this->dataPtr->manifestFile);
+  std::string line;
+  std::string previous;
+  auto lines = std::count(header.begin(), header.end(), '\n');
+  for (int i = 0; i < lines && std::getline(in, line); ++i)
+    previous += line + "\n";
+
+  if (previous != header)
+  {
+    this->SaveManifest();
+    return;
+  }
+
+  // Later lines replace earlier ones for the same page
+  int page;
+  std::string hash;
+  while (in >> line >> page >> hash)
+  {
+    if (line != "page" || page < 0)
+      break;
+
+    if (page >= static_cast<int>(this->dataPtr->manifest.size()))
+      this->dataPtr->manifest.resize(page + 1);
+    this->dataPtr->manifest[page] = QString::fromStdString(hash);
+  }
+
+  int imported{0};
+  for (std::size_t i = 0; i < this->dataPtr->manifest.size(); ++i)
+  {
+    if (this->dataPtr->manifest[i].isEmpty())
+      continue;
+
+    if (!QFile::exists(QString::fromStdString(this->TexturePath(i))))
+      this->dataPtr->manifest[i].clear();
+    else
+      ++imported;
+  }
+
+  ssmsg << "Found [" << imported << "] pages imported before" << std::endl;
+}
+
+/////////////////////////////////////////////////
+void ImportDialog::SaveManifest()
+{
+  auto &manifest = this->dataPtr->manifest;
+  while (!manifest.empty() && manifest.back().isEmpty())
+    manifest.pop_back();
+
+  auto tmpFile = this->dataPtr->manifestFile + ".tmp";
+  {
+    std::ofstream out(tmpFile, std::ios::trunc);
+    out << this->ManifestHeader();
+    for (std::size_t i = 0; i < manifest.size(); ++i)
+    {
+      if (!manifest[i].isEmpty())
+        out << "page " << i << " " << manifest[i].toStdString() << "\n";
     }
   }
+  std::rename(tmpFile.c_str(), this->dataPtr->manifestFile.c_str());
+}
+
+/////////////////////////////////////////////////
+void ImportDialog::RecordPage(int _page, const QString &_hash)
+{
+  if (_page >= static_cast<int>(this->dataPtr->manifest.size()))
+    this->dataPtr->manifest.resize(_page + 1);
+  this->dataPtr->manifest[_page] = _hash;
+
+  // Appended right away, so an import can be resumed even if it crashes
+  std::ofstream out(this->dataPtr->manifestFile, std::ios::app);
+  out << "page " << _page << " " << _hash.toStdString() << std::endl;
+}
+
+/////////////////////////////////////////////////
+void ImportDialog::RemovePages(int _first)
+{
+  for (int i = _first;
+      i < static_cast<int>(this->dataPtr->manifest.size()); ++i)
+  {
+    if (this->dataPtr->manifest[i].isEmpty())
+      continue;
+
+    auto modelPath = Common::Instance()->slidePath + "/" +
+        this->dataPtr->modelPrefix + "-" + std::to_string(i);
+    ssmsg << "Removing model of deleted page [" << modelPath << "]"
+          << std::endl;
+    QDir(QString::fromStdString(modelPath)).removeRecursively();
+    this->dataPtr->manifest[i].clear();
+  }
 }
 
 /////////////////////////////////////////////////
-void ImportDialog::OnConversionFinished(int _exitCode,
-    QProcess::ExitStatus _exitStatus)
+std::string ImportDialog::TexturePath(int _page) const
 {
-  if (_exitCode != 0 || _exitStatus != QProcess::NormalExit)
+  std::string modelName(this->dataPtr->modelPrefix + "-" +
+      std::to_string(_page));
+  return Common::Instance()->slidePath + "/" + modelName +
+      "/materials/textures/" + modelName +
+      (this->dataPtr->compress ? TextureEncoder::kExtension : ".png");
+}
+
+/////////////////////////////////////////////////
+void ImportDialog::OnConversionFinished(int, QString _error)
+{
+  this->dataPtr->cancelButton->setEnabled(true);
+
+  if (!_error.isEmpty())
   {
-    std::string error = "Failed to convert PDF, exit code: " +
-        std::to_string(_exitCode) +
-        ", exit status:" + std::to_string(_exitStatus);
+    // Pages done so far are kept, so the import can be resumed
+    this->dataPtr->waitLabel->setText(_error + QString(
+        "\n%1 pages are done.").arg(this->dataPtr->doneCount));
+    this->dataPtr->cancelButton->setText(tr("Resume"));
+    sserr << _error.toStdString() << std::endl;
 
-    this->dataPtr->waitLabel->setText(QString::fromStdString(error));
-    gzerr << error << std::endl;
+    return;
+  }
 
+  if (this->dataPtr->hashing)
+  {
+    this->StartConversion();
     return;
   }
 
-  // Generate step 2 widgets
+  // Pages which were removed from the PDF
+  auto pageCount = this->dataPtr->rasterizer.PageCount();
+  if (this->FullImport() && pageCount > 0)
+    this->RemovePages(pageCount);
+  this->SaveManifest();
 
-  // Find number of images in temp path
-  // TODO(louise): Use QDir
-  this->dataPtr->count = QDir(this->dataPtr->tmpDir).entryList(QStringList("*"),
-     QDir::Files | QDir::NoSymLinks).size();
-  QCoreApplication::processEvents();
+  // Generate step 2 widgets, only for pages which have a model
+  this->dataPtr->slides.clear();
+  for (std::size_t i = 0; i < this->dataPtr->manifest.size(); ++i)
+  {
+    if (!this->dataPtr->manifest[i].isEmpty())
+      this->dataPtr->slides.push_back(static_cast<int>(i));
+  }
+  this->dataPtr->buttonGroups.clear();
+
+  // Slides already in the world start with the type they have there
+  auto types = SlideKeyframeTypes(this->ReadWorld(),
+      this->dataPtr->modelPrefix);
 
   // TODO(louise): Support other keyframes
-  auto slidesLayout = new QVBoxLayout();
-  for (int i = 0; i < this->dataPtr->count; ++i)
+  auto slidesWidget = new QWidget();
+  auto slidesLayout = new QVBoxLayout(slidesWidget);
+  slidesLayout->setContentsMargins(0, 0, 0, 0);
+  for (auto page : this->dataPtr->slides)
   {
-    auto number = new QLabel("Slide " + QVariant(i).toString());
+    auto number = new QLabel("Slide " + QVariant(page).toString());
 
     auto lookat = new QRadioButton("Look at");
-    lookat->setChecked(true);
     auto stack = new QRadioButton("Stack");
+    auto type = types.find(page);
+    if (type != types.end() && type->second == "stack")
+      stack->setChecked(true);
+    else
+      lookat->setChecked(true);
 
-    auto group = new QButtonGroup();
+    auto group = new QButtonGroup(slidesWidget);
     group->addButton(lookat, 0);
     group->addButton(stack, 1);
     this->dataPtr->buttonGroups.push_back(group);
@@ -388,91 +927,39 @@ void ImportDialog::OnConversionFinished(int _exitCode,
     slidesLayout->addLayout(slideLayout);
   }
 
-  auto step2Label = new QLabel(tr("<b>Step 2: Keyframes</b>"));
-
-  // Next 2
-  auto next2Button = new QPushButton(tr("Next"));
-  this->connect(next2Button, SIGNAL(clicked()), this, SLOT(OnNext2()));
-
-  auto step2Layout = new QVBoxLayout;
-  step2Layout->setSpacing(0);
-  step2Layout->addWidget(step2Label);
-  step2Layout->addLayout(slidesLayout);
-  step2Layout->addWidget(next2Button);
+  // Replace the slides of a previous conversion, together with their
+  // button groups
+  delete this->dataPtr->step2Layout->replaceWidget(
+      this->dataPtr->slidesWidget, slidesWidget);
+  this->dataPtr->slidesWidget->deleteLater();
+  this->dataPtr->slidesWidget = slidesWidget;
 
-  auto step2Widget = new QWidget();
-  step2Widget->setLayout(step2Layout);
-
-  this->dataPtr->stackedStepLayout->insertWidget(2, step2Widget);
   this->dataPtr->stackedStepLayout->setCurrentIndex(2);
 }
 
-/////////////////////////////////////////////////
-void ImportDialog::OnNext2()
-{
-  this->dataPtr->stackedStepLayout->setCurrentIndex(3);
-}
-
 /////////////////////////////////////////////////
 void ImportDialog::OnGenerate()
 {
-  // Generate and save world and models, load Common::Instance()->keyframes
+  // Generate and save world, load Common::Instance()->keyframes
   this->GenerateWorld();
 
   // Insert models
   simslides::SpawnSlides();
 
   // Close dialog
-  this->dataPtr->stackedStepLayout->removeItem(
-      this->dataPtr->stackedStepLayout->itemAt(2));
   this->close();
 }
 
 /////////////////////////////////////////////////
-void ImportDialog::AddGUI(std::string & _worldSdf)
+void ImportDialog::LoadKeyframes(const std::string &_worldSdf)
 {
-  // TODO(louise): Use libsdformat
-
-  // <plugin>
-  std::string pluginStr = "\
-      <plugin name='simslides' filename='libSimSlidesClassic.so'>\n";
-
-  if (this->dataPtr->buttonGroups.size() != this->dataPtr->count)
-  {
-    gzerr << "Number of slides [" << this->dataPtr->count <<
-         "] doesn't match number of button groups [" <<
-         this->dataPtr->buttonGroups.size() << "]" << std::endl;
-    return;
-  }
-
-  for (int i = 0; i < this->dataPtr->count; ++i)
-  {
-    auto visualName = this->dataPtr->modelPrefix + "-" + std::to_string(i);
-    if (this->dataPtr->buttonGroups[i]->checkedId() == 0)
-    {
-      pluginStr +=
-        "        <keyframe type='lookat' visual='" + visualName + "'/>\n";
-    }
-    else if (this->dataPtr->buttonGroups[i]->checkedId() == 1)
-    {
-      pluginStr +=
-          "        <keyframe type='stack' visual='" + visualName + "'/>\n";
-    }
-    else
-      gzerr << "Invalid button [" << i << "]" << std::endl;
-  }
-  pluginStr +="\
-    </plugin>\n\
-      <plugin name='keyboard' filename='libKeyboardGUIPlugin.so'>\n\
-      </plugin>\n";
-
   // Load plugin so keyframes are generated
   // Hack: put it inside <world> because that can be a root SDF
   // TODO(louise): Instead, create Keyframe obejcts above.
   std::string sdfStr = "\
     <sdf version ='1.6'>\n\
       <world name='dummy'>\n" +
-        pluginStr +
+        SlidesPlugin(_worldSdf) +
       "</world>\n\
     </sdf>\n";
 
@@ -480,19 +967,10 @@ void ImportDialog::AddGUI(std::string & _worldSdf)
   pluginSdf->SetFromString(sdfStr);
   auto pluginElem = pluginSdf->Root()->GetElement("world")->GetElement("plugin");
   Common::Instance()->LoadPluginSDF(pluginElem);
-
-  // <gui>
-  std::string guiStr = "\
-    <gui>\n" +
-      pluginStr +
-    "</gui>\n";
-
-  // Add to world
-  _worldSdf += guiStr;
 }
 
 /////////////////////////////////////////////////
-void ImportDialog::AddSlides(std::string & _worldSdf)
+bool ImportDialog::WriteSlide(int _page, const QString &_image)
 {
   // Scale
   auto scaleX = std::to_string(this->dataPtr->scaleXSpin->value());
@@ -500,134 +978,135 @@ void ImportDialog::AddSlides(std::string & _worldSdf)
   auto scaleZ = std::to_string(this->dataPtr->scaleZSpin->value());
   auto height = std::to_string(this->dataPtr->scaleZSpin->value() * 0.5);
 
-  // Save each model and add it to the world
-  Common::Instance()->slidePath = this->dataPtr->dirEdit->text().toStdString();
-  auto saveDialog = new gazebo::gui::SaveEntityDialog(
-      gazebo::gui::SaveEntityDialog::MODEL);
-
-  for (int i = 0; i < this->dataPtr->count; ++i)
+  if (!this->dataPtr->saveDialog)
   {
-    std::string modelName(this->dataPtr->modelPrefix + "-" + std::to_string(i));
-    saveDialog->SetModelName(modelName);
-    saveDialog->SetSaveLocation(Common::Instance()->slidePath + "/" + modelName);
-
-    // TODO(louise) Use QDir
-    // Create dir
-    {
-      boost::filesystem::path path;
-      path = path / (Common::Instance()->slidePath + "/" + modelName);
-
-      if (!boost::filesystem::create_directories(path))
-        gzerr << "Couldn't create folder [" << path << "]" << std::endl;
-    }
-
-    // Save model.config
-    saveDialog->GenerateConfig();
-    saveDialog->SaveToConfig();
-
-    // Save model.sdf
-    sdf::ElementPtr sdf(new sdf::Element());
-    sdf::initFile("model.sdf", sdf);
-
-    sdf::readString(
-        "<?xml version='1.0' ?>\
-        <sdf version='" SDF_VERSION "'>\
-          <model name='" + modelName + "'>\
-            <static>true</static>\
-            <link name='link'>\
-              <pose>0 0 " + height + " 0 0 0</pose>\
-              <visual name='visual'>\
-                <cast_shadows>false</cast_shadows>\
-                <transparency>1</transparency>\
-                <geometry>\
-                  <box>\
-                    <size>" + scaleX + " " + scaleY + " " + scaleZ + "</size>\
-                  </box>\
-                </geometry>\
-                <material>\
-                  <script>\
-                    <uri>model://" + modelName + "/materials/scripts</uri>\
-                    <uri>model://" + modelName + "/materials/textures</uri>\
-                    <name>Slides/" + this->dataPtr->modelPrefix + "_" + std::to_string(i) + "</name>\
-                  </script>\
-                </material>\
-              </visual>\
-            </link>\
-          </model>\
-        </sdf>", sdf);
-
-    sdf::SDFPtr modelSDF;
-    modelSDF.reset(new sdf::SDF);
-    modelSDF->Root(sdf);
-
-    saveDialog->SaveToSDF(modelSDF);
-
-    // Create materials dirs
-    {
-      boost::filesystem::path path;
-      path = path / (Common::Instance()->slidePath + "/" + modelName + "/materials/scripts");
-
-      if (!boost::filesystem::create_directories(path))
-        gzerr << "Couldn't create folder [" << path << "]" << std::endl;
-    }
+    this->dataPtr->saveDialog = new gazebo::gui::SaveEntityDialog(
+        gazebo::gui::SaveEntityDialog::MODEL);
+  }
+  auto saveDialog = this->dataPtr->saveDialog;
+
+  std::string modelName(this->dataPtr->modelPrefix + "-" +
+      std::to_string(_page));
+  std::string modelPath(Common::Instance()->slidePath + "/" + modelName);
+  auto texture = std::filesystem::path(this->TexturePath(_page)).filename()
+      .string();
+  saveDialog->SetModelName(modelName);
+  saveDialog->SetSaveLocation(modelPath);
+
+  // Create dirs, which may be there from an import which didn't finish
+  for (const auto &dir : {modelPath + "/materials/scripts",
+      modelPath + "/materials/textures"})
+  {
+    boost::filesystem::path path(dir);
+    if (!boost::filesystem::create_directories(path) &&
+        !boost::filesystem::is_directory(path))
     {
-      boost::filesystem::path path;
-      path = path / (Common::Instance()->slidePath + "/" + modelName + "/materials/textures");
-
-      if (!boost::filesystem::create_directories(path))
-        gzerr << "Couldn't create folder [" << path << "]" << std::endl;
+      sserr << "Couldn't create folder [" << path << "]" << std::endl;
+      return false;
     }
+  }
 
-    // Save material script
-    std::ofstream materialFile(Common::Instance()->slidePath + "/" + modelName +
-        "/materials/scripts/script.material");
-    if (materialFile.is_open())
-    {
-      materialFile <<
-        "material Slides/" + this->dataPtr->modelPrefix + "_" << std::to_string(i) << "\n\
+  // Save model.config
+  saveDialog->GenerateConfig();
+  saveDialog->SaveToConfig();
+
+  // Save model.sdf
+  sdf::ElementPtr sdf(new sdf::Element());
+  sdf::initFile("model.sdf", sdf);
+
+  sdf::readString(
+      "<?xml version='1.0' ?>\
+      <sdf version='" SDF_VERSION "'>\
+        <model name='" + modelName + "'>\
+          <static>true</static>\
+          <link name='link'>\
+            <pose>0 0 " + height + " 0 0 0</pose>\
+            <visual name='visual'>\
+              <cast_shadows>false</cast_shadows>\
+              <transparency>1</transparency>\
+              <geometry>\
+                <box>\
+                  <size>" + scaleX + " " + scaleY + " " + scaleZ + "</size>\
+                </box>\
+              </geometry>\
+              <material>\
+                <script>\
+                  <uri>model://" + modelName + "/materials/scripts</uri>\
+                  <uri>model://" + modelName + "/materials/textures</uri>\
+                  <name>Slides/" + this->dataPtr->modelPrefix + "_" + std::to_string(_page) + "</name>\
+                </script>\
+                <diffuse>1 1 1 1</diffuse>\
+                <emissive>0.5 0.5 0.5 1</emissive>\
+                <pbr>\
+                  <metal>\
+                    <albedo_map>model://" + modelName + "/materials/textures/" + texture + "</albedo_map>\
+                    <emissive_map>model://" + modelName + "/materials/textures/" + texture + "</emissive_map>\
+                  </metal>\
+                </pbr>\
+              </material>\
+            </visual>\
+          </link>\
+        </model>\
+      </sdf>", sdf);
+
+  sdf::SDFPtr modelSDF;
+  modelSDF.reset(new sdf::SDF);
+  modelSDF->Root(sdf);
+
+  saveDialog->SaveToSDF(modelSDF);
+
+  // Save material script
+  std::ofstream materialFile(modelPath + "/materials/scripts/script.material");
+  if (materialFile.is_open())
+  {
+    materialFile <<
+      "material Slides/" + this->dataPtr->modelPrefix + "_" << std::to_string(_page) << "\n\
+      {\n\
+        receive_shadows off\n\
+        technique\n\
         {\n\
-          receive_shadows off\n\
-          technique\n\
+          pass\n\
           {\n\
-            pass\n\
+            lighting off\n\
+            scene_blend alpha_blend\n\
+            depth_check on\n\
+            texture_unit\n\
             {\n\
-              lighting off\n\
-              scene_blend alpha_blend\n\
-              depth_check on\n\
-              texture_unit\n\
-              {\n\
-                texture " + modelName + ".png\n\
-                filtering anistropic\n\
-                max_anisotropy 16\n\
-              }\n\
+              texture " + texture + "\n\
+              filtering anisotropic\n\
+              max_anisotropy 16\n\
             }\n\
           }\n\
-        }";
-      materialFile.close();
-    }
-    else
-      gzerr << "Unable to open file" << std::endl;
-
-    // Move image to dir
-    gazebo::common::moveFile(
-      this->dataPtr->tmpDir.toStdString() +
-      "/tmpPng-" +
-      std::to_string(i) +
-      ".png",
-      Common::Instance()->slidePath +
-      "/" + modelName + "/materials/textures/" + modelName + ".png");
-
-    // Add model to world
-    _worldSdf+=
-      "<include>\n\
-        <name>" + modelName + "</name>\n\
-        <pose>" + std::to_string(i) + "0 0 0 0 0 0</pose>\n\
-        <uri>model://" + modelName + "</uri>\n\
-      </include>";
+        }\n\
+      }";
+    materialFile.close();
+  }
+  else
+  {
+    sserr << "Unable to open file" << std::endl;
+    return false;
+  }
+
+  // Link image into dir last, so the model is only considered done once
+  // everything else is in place
+  if (!TextureCache::LinkOrCopy(_image.toStdString(), this->TexturePath(_page)))
+    return false;
+
+  return true;
+}
+
+/////////////////////////////////////////////////
+void ImportDialog::AddModelPath()
+{
+  if (!this->dataPtr->saveDialog)
+  {
+    this->dataPtr->saveDialog = new gazebo::gui::SaveEntityDialog(
+        gazebo::gui::SaveEntityDialog::MODEL);
   }
 
   // Add to path and wait to be added
-  saveDialog->AddDirToModelPaths(Common::Instance()->slidePath + "/" + "dummy");
+  this->dataPtr->saveDialog->AddDirToModelPaths(
+      Common::Instance()->slidePath + "/" + "dummy");
   bool found = false;
   while (!found)
   {
@@ -645,34 +1124,79 @@ void ImportDialog::AddSlides(std::string & _worldSdf)
 }
 
 /////////////////////////////////////////////////
-void ImportDialog::GenerateWorld()
+std::string ImportDialog::WorldFile() const
+{
+  return Common::Instance()->slidePath + "/" + this->dataPtr->modelPrefix +
+      ".world";
+}
+
+/////////////////////////////////////////////////
+std::string ImportDialog::ReadWorld() const
 {
-  // Start world
-  std::string worldSdf = "<?xml version='1.0' ?>\n\
-    <sdf version='1.5'>\n\
-    <world name='default'>\n";
+  std::ifstream in(this->WorldFile());
+  if (!in)
+    return std::string();
+
+  std::ostringstream buffer;
+  buffer << in.rdbuf();
+  return buffer.str();
+}
 
-  this->AddGUI(worldSdf);
+/////////////////////////////////////////////////
+void ImportDialog::GenerateWorld()
+{
+  // Keyframe type of each slide
+  std::map<int, std::string> slides;
+  for (std::size_t i = 0; i < this->dataPtr->slides.size(); ++i)
+  {
+    auto page = this->dataPtr->slides[i];
+    auto id = this->dataPtr->buttonGroups[i]->checkedId();
+    if (id == 0)
+      slides[page] = "lookat";
+    else if (id == 1)
+      slides[page] = "stack";
+    else
+      sserr << "Invalid button [" << page << "]" << std::endl;
+  }
 
-  // Continue world
-  worldSdf += "\
+  // Start from the world generated before, if any, so changes made to it
+  // since are kept
+  auto worldFile = this->WorldFile();
+  auto worldSdf = this->ReadWorld();
+  if (worldSdf.empty())
+  {
+    worldSdf = "<?xml version='1.0' ?>\n\
+<sdf version='1.5'>\n\
+  <world name='default'>\n\
     <include>\n\
       <uri>model://sun</uri>\n\
     </include>\n\
     <include>\n\
       <uri>model://ground_plane</uri>\n\
-    </include>";
+    </include>\n\
+  </world>\n\
+</sdf>\n";
+  }
 
-  this->AddSlides(worldSdf);
+  auto merged = MergeSlides(worldSdf, this->dataPtr->modelPrefix, slides);
+  if (merged.empty())
+  {
+    QMessageBox msgBox;
+    std::string str = "Unable to add slides to " + worldFile;
+    str += ".\nIt doesn't have a <world>.";
+    msgBox.setText(str.c_str());
+    msgBox.exec();
+    return;
+  }
 
-  // Save world
-  worldSdf+= "</world>\n\
-    </sdf>";
-  std::string worldFile =
-      Common::Instance()->slidePath + "/" + this->dataPtr->modelPrefix + ".world";
-  std::ofstream saveWorld(worldFile, std::ios::out);
-  if (!saveWorld)
+  // Save world, replacing it atomically
+  auto tmpFile = worldFile + ".tmp";
+  std::ofstream saveWorld(tmpFile, std::ios::out | std::ios::trunc);
+  saveWorld << merged;
+  saveWorld.close();
+  if (!saveWorld || std::rename(tmpFile.c_str(), worldFile.c_str()) != 0)
   {
+    std::remove(tmpFile.c_str());
     QMessageBox msgBox;
     std::string str = "Unable to open file: " + worldFile;
     str += ".\nCheck file permissions.";
@@ -680,17 +1204,14 @@ void ImportDialog::GenerateWorld()
     msgBox.exec();
   }
   else
-    saveWorld << worldSdf;
-  saveWorld.close();
+  {
+    ssdbg << "Saved world file to " << worldFile << std::endl;
+  }
 
-  gzdbg << "Saved world file to " << worldFile << std::endl;
+  this->LoadKeyframes(merged);
+  this->AddModelPath();
 
   // Clear temp path
-  {
-    QProcess p;
-    p.setProcessChannelMode(QProcess::ForwardedChannels);
-    p.start("rm", QStringList() << "-rf" << this->dataPtr->tmpDir);
-    p.waitForFinished();
-  }
+  QDir(this->dataPtr->tmpDir).removeRecursively();
 }
 
@@ -37,19 +37,95 @@ namespace simslides
     public: ~ImportDialog();
 
     /// \brief Do the following:
-    /// * Generate and save a .world file
-    /// * Generate and save a model for each PNG, including material
+    /// * Generate and save a .world file, or merge the slides into it if
+    ///   it was generated before, see MergeSlides
     /// * Load keyframes
     /// * Load models
+    ///
+    /// Slide models are saved beforehand, as pages are converted.
     private: void GenerateWorld();
 
-    /// \brief Add <gui> to world SDF.
-    /// \param[out] _worldSdf
-    private: void AddGUI(std::string & _worldSdf);
-
-    /// \brief Add all slide models to SDF.
-    /// \param[out] _worldSdf
-    private: void AddSlides(std::string & _worldSdf);
+    /// \brief Path of the world file generated for the presentation.
+    /// \return Path.
+    private: std::string WorldFile() const;
+
+    /// \brief Read the world file generated before, if any.
+    /// \return World SDF, empty if there's no world file yet.
+    private: std::string ReadWorld() const;
+
+    /// \brief Load the keyframes of a world's SimSlides plugin.
+    /// \param[in] _worldSdf World SDF.
+    private: void LoadKeyframes(const std::string &_worldSdf);
+
+    /// \brief Add the save folder to the model paths, and wait until it's
+    /// there, so slides can be spawned.
+    private: void AddModelPath();
+
+    /// \brief Save the model of a page, including its material, and link
+    /// the page image into it as its texture.
+    /// \param[in] _page Page number, counting from 0.
+    /// \param[in] _image Path to the page texture, PNG or DDS, which is
+    /// linked or copied.
+    /// \return False if the model couldn't be saved.
+    private: bool WriteSlide(int _page, const QString &_image);
+
+    /// \brief Key of a page's texture in the texture cache.
+    /// \param[in] _hash Page fingerprint.
+    /// \return Hex key, which also covers the render settings and texture
+    /// format.
+    private: std::string CacheKey(const QString &_hash) const;
+
+    /// \brief Path to the texture of a page's model.
+    /// \param[in] _page Page number, counting from 0.
+    /// \return Texture path.
+    private: std::string TexturePath(int _page) const;
+
+    /// \brief Whether a page is in the selected range.
+    /// \param[in] _page Page number, counting from 0.
+    /// \return True if it should be imported.
+    private: bool InRange(int _page) const;
+
+    /// \brief Whether all pages are selected, so models of pages which
+    /// aren't in the PDF anymore can be removed.
+    /// \return True if importing the whole PDF.
+    private: bool FullImport() const;
+
+    /// \brief Whether a page needs to be imported, because it has no
+    /// model or its fingerprint changed.
+    /// \param[in] _page Page number, counting from 0.
+    /// \return True if it needs to be converted.
+    private: bool Changed(int _page) const;
+
+    /// \brief First lines of the manifest, with the settings models are
+    /// generated with.
+    /// \return Header, one setting per line.
+    private: std::string ManifestHeader() const;
+
+    /// \brief Read the fingerprints of the pages imported before with the
+    /// same settings, or start a new manifest.
+    private: void LoadManifest();
+
+    /// \brief Rewrite the manifest with one line per imported page.
+    private: void SaveManifest();
+
+    /// \brief Add a page to the manifest once its model is saved.
+    /// \param[in] _page Page number, counting from 0.
+    /// \param[in] _hash Page fingerprint.
+    private: void RecordPage(int _page, const QString &_hash);
+
+    /// \brief Remove the models of pages which aren't in the PDF anymore.
+    /// \param[in] _first First page to remove, counting from 0.
+    private: void RemovePages(int _first);
+
+    /// \brief Start fingerprinting the selected pages which don't have a
+    /// fingerprint yet.
+    private: void StartHashing();
+
+    /// \brief Start converting the selected pages which changed.
+    private: void StartConversion();
+
+    /// \brief Update the progress bar, page count and time left.
+    private: void UpdateProgress();
 
     /// \brief Callback to choose PDF file to be loaded.
     private slots: void OnBrowsePDF();
@@ -57,11 +133,12 @@ namespace simslides
     /// \brief Callback to choose directory to save models.
     private slots: void OnBrowseDir();
 
-    /// \brief Callback to load chosen PDF file.
+    /// \brief Callback to import chosen PDF file.
     private slots: void OnLoadPDF();
 
-    /// \brief Callback to go to next step after step 2.
-    private slots: void OnNext2();
+    /// \brief Callback to cancel the import, or to resume it once
+    /// cancelled.
+    private slots: void OnCancel();
 
     /// \brief Callback to generate models.
     private slots: void OnGenerate();
@@ -69,8 +146,22 @@ namespace simslides
     /// \brief Check if buttons should be enabled.
     private slots: void CheckReady(QString _str = QString());
 
-    /// \brief Callback when conversion from PDF to images is completed.
-    private slots: void OnConversionFinished(int, QProcess::ExitStatus);
+    /// \brief Callback when a page has been fingerprinted.
+    /// \param[in] _page Page number.
+    /// \param[in] _hash Page fingerprint.
+    private slots: void OnPageHashed(int _page, QString _hash);
+
+    /// \brief Callback when a page has been converted to an image, which
+    /// saves its model right away.
+    /// \param[in] _page Page number.
+    /// \param[in] _file Path to the image.
+    private slots: void OnPageReady(int _page, QString _file);
+
+    /// \brief Callback when fingerprinting or conversion from PDF to images
+    /// is completed or cancelled.
+    /// \param[in] _count Number of pages converted.
+    /// \param[in] _error Empty on success.
+    private slots: void OnConversionFinished(int _count, QString _error);
 
     /// \internal
     /// \brief Pointer to private data.
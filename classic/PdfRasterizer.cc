@@ -0,0 +1,531 @@
+/*
+ * Copyright 2017 Louise Poubel
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifdef HAVE_POPPLER_QT5
+#include <poppler-qt5.h>
+#endif
+
+#include <QCryptographicHash>
+#include <simslides/common/Log.hh>
+#include <simslides/common/TextureEncoder.hh>
+
+#include "PdfRasterizer.hh"
+
+using namespace simslides;
+
+class simslides::PdfRasterizerPrivate
+{
+  /// \brief Render pages on worker threads, then report back to the
+  /// owner's thread. Runs on its own thread.
+  /// \param[in] _owner Rasterizer to report to.
+  /// \param[in] _threads Number of workers.
+  public: void Run(PdfRasterizer *_owner, int _threads);
+
+  /// \brief Reset the state for a new conversion.
+  /// \param[in] _pdf Path to the PDF file.
+  /// \param[in] _pages Pages to convert, empty for all.
+  public: void Reset(const QString &_pdf, const std::vector<int> &_pages);
+
+  /// \brief Open the PDF, keep only the pages it has and start the
+  /// workers. Only available with poppler-qt5.
+  /// \param[in] _owner Rasterizer to report to.
+  /// \param[in] _threads Number of workers, 0 for one per core.
+  /// \return Empty on success, otherwise what went wrong.
+  public: QString Launch(PdfRasterizer *_owner, int _threads);
+
+  /// \brief Record the first error and stop all workers.
+  /// \param[in] _error What went wrong.
+  public: void Fail(const QString &_error);
+
+  /// \brief Path to the image of a page.
+  /// \param[in] _page Page number.
+  /// \return Image path.
+  public: QString File(int _page) const;
+
+  /// \brief PDF being converted.
+  public: QString pdf;
+
+  /// \brief Directory images are written to.
+  public: QString directory;
+
+  /// \brief Image file name prefix.
+  public: QString prefix;
+
+  /// \brief Number of pages in the PDF, 0 if unknown.
+  public: int pageCount{0};
+
+  /// \brief Pages to convert, empty for all.
+  public: std::vector<int> pages;
+
+  /// \brief Number of pages written so far.
+  public: int written{0};
+
+  /// \brief Whether pages are fingerprinted instead of written.
+  public: bool hashOnly{false};
+
+  /// \brief Whether written pages are also encoded into DDS textures.
+  public: bool compress{false};
+
+  /// \brief Whether a conversion is in progress.
+  public: bool running{false};
+
+  /// \brief Next page for a worker to render.
+  public: std::atomic<int> next{0};
+
+  /// \brief Set to stop the workers.
+  public: std::atomic<bool> cancel{false};
+
+  /// \brief First error reported by a worker, protected by mutex.
+  public: QString error;
+
+  /// \brief Protects error.
+  public: std::mutex mutex;
+
+  /// \brief Thread which starts and joins the workers.
+  public: std::thread runner;
+
+  /// \brief ImageMagick process, when not built with poppler-qt5.
+  public: QProcess *process{nullptr};
+};
+
+/////////////////////////////////////////////////
+QString PdfRasterizerPrivate::File(int _page) const
+{
+  return this->directory + "/" + this->prefix + "-" +
+      QString::number(_page) + ".png";
+}
+
+/////////////////////////////////////////////////
+void PdfRasterizerPrivate::Fail(const QString &_error)
+{
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    if (this->error.isEmpty())
+      this->error = _error;
+  }
+  this->cancel = true;
+}
+
+/////////////////////////////////////////////////
+void PdfRasterizerPrivate::Run(PdfRasterizer *_owner, int _threads)
+{
+#ifdef HAVE_POPPLER_QT5
+  auto work = [this, _owner]()
+  {
+    // Poppler documents aren't thread-safe, so each worker has its own
+    std::unique_ptr<Poppler::Document> document(
+        Poppler::Document::load(this->pdf));
+    if (!document || document->isLocked())
+    {
+      this->Fail("Failed to open PDF [" + this->pdf + "]");
+      return;
+    }
+    document->setRenderHint(Poppler::Document::Antialiasing);
+    document->setRenderHint(Poppler::Document::TextAntialiasing);
+
+    while (!this->cancel)
+    {
+      auto index = this->next++;
+      if (index >= static_cast<int>(this->pages.size()))
+        break;
+      auto page = this->pages[index];
+
+      std::unique_ptr<Poppler::Page> pdfPage(document->page(page));
+      auto density = this->hashOnly ? PdfRasterizer::kHashDensity :
+          PdfRasterizer::kDefaultDensity;
+      auto image = pdfPage ? pdfPage->renderToImage(density, density) :
+          QImage();
+      if (image.isNull())
+      {
+        this->Fail("Failed to render page [" + QString::number(page) + "]");
+        return;
+      }
+
+      if (this->hashOnly)
+      {
+        // The thumbnail catches changed graphics, and the text catches
+        // small edits which may not change any thumbnail pixel
+        QCryptographicHash hash(QCryptographicHash::Sha1);
+        auto size = pdfPage->pageSizeF();
+        hash.addData(QByteArray::number(size.width()) + " " +
+            QByteArray::number(size.height()) + "\n");
+        hash.addData(pdfPage->text(QRectF()).toUtf8());
+        image = image.convertToFormat(QImage::Format_ARGB32);
+        for (int y = 0; y < image.height(); ++y)
+        {
+          hash.addData(reinterpret_cast<const char *>(image.constScanLine(y)),
+              image.width() * 4);
+        }
+
+        QMetaObject::invokeMethod(_owner, "OnPageHashed",
+            Qt::QueuedConnection, Q_ARG(int, page),
+            Q_ARG(QString, QString(hash.result().toHex())));
+        continue;
+      }
+
+      auto file = this->File(page);
+      if (!image.save(file, "PNG"))
+      {
+        this->Fail("Failed to write [" + file + "]");
+        return;
+      }
+
+      // Encoding is CPU bound like rendering, so it runs on the workers too
+      if (this->compress)
+      {
+        auto dds = file;
+        dds.replace(dds.size() - 4, 4, TextureEncoder::kExtension);
+        if (!PdfRasterizer::Compress(image, dds))
+        {
+          this->Fail("Failed to write [" + dds + "]");
+          return;
+        }
+      }
+
+      QMetaObject::invokeMethod(_owner, "OnPageReady", Qt::QueuedConnection,
+          Q_ARG(int, page), Q_ARG(QString, file));
+    }
+  };
+
+  std::vector<std::thread> workers;
+  for (int t = 1; t < _threads; ++t)
+    workers.emplace_back(work);
+  work();
+  for (auto &worker : workers)
+    worker.join();
+#else
+  (void)_threads;
+#endif
+
+  QString error;
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    error = this->error;
+  }
+  QMetaObject::invokeMethod(_owner, "OnWorkersDone", Qt::QueuedConnection,
+      Q_ARG(QString, error));
+}
+
+/////////////////////////////////////////////////
+void PdfRasterizerPrivate::Reset(const QString &_pdf,
+    const std::vector<int> &_pages)
+{
+  // A previous conversion may have reported back but not returned yet
+  if (this->runner.joinable())
+    this->runner.join();
+
+  this->pdf = _pdf;
+  this->pageCount = 0;
+  this->pages = _pages;
+  this->written = 0;
+  this->next = 0;
+  this->cancel = false;
+  this->error.clear();
+}
+
+/////////////////////////////////////////////////
+QString PdfRasterizerPrivate::Launch(PdfRasterizer *_owner, int _threads)
+{
+#ifdef HAVE_POPPLER_QT5
+  std::unique_ptr<Poppler::Document> document(
+      Poppler::Document::load(this->pdf));
+  if (!document || document->isLocked())
+    return "Failed to open PDF [" + this->pdf + "]";
+
+  this->pageCount = document->numPages();
+  if (this->pages.empty())
+  {
+    for (int page = 0; page < this->pageCount; ++page)
+      this->pages.push_back(page);
+  }
+
+  // Pages out of range would only fail later, on a worker
+  this->pages.erase(std::remove_if(this->pages.begin(), this->pages.end(),
+      [&](int _page)
+      {
+        return _page < 0 || _page >= this->pageCount;
+      }), this->pages.end());
+
+  if (_threads <= 0)
+    _threads = std::max(1, QThread::idealThreadCount());
+  _threads = std::max(1, std::min(_threads,
+      static_cast<int>(this->pages.size())));
+
+  ssmsg << (this->hashOnly ? "Checking [" : "Rendering [")
+        << this->pages.size() << "] of [" << this->pageCount
+        << "] pages of PDF [" << this->pdf.toStdString() << "] with ["
+        << _threads << "] threads" << std::endl;
+
+  this->running = true;
+  this->runner = std::thread(&PdfRasterizerPrivate::Run, this, _owner,
+      _threads);
+  return QString();
+#else
+  (void)_owner;
+  (void)_threads;
+  return "Checking pages needs poppler-qt5";
+#endif
+}
+
+/////////////////////////////////////////////////
+PdfRasterizer::PdfRasterizer()
+  : dataPtr(new PdfRasterizerPrivate)
+{
+}
+
+/////////////////////////////////////////////////
+PdfRasterizer::~PdfRasterizer()
+{
+  this->dataPtr->cancel = true;
+  if (this->dataPtr->runner.joinable())
+    this->dataPtr->runner.join();
+
+  if (this->dataPtr->process)
+  {
+    this->dataPtr->process->disconnect(this);
+    this->dataPtr->process->kill();
+    this->dataPtr->process->waitForFinished();
+    delete this->dataPtr->process;
+  }
+}
+
+/////////////////////////////////////////////////
+bool PdfRasterizer::InProcess()
+{
+#ifdef HAVE_POPPLER_QT5
+  return true;
+#else
+  return false;
+#endif
+}
+
+/////////////////////////////////////////////////
+int PdfRasterizer::CountPages(const QString &_pdf)
+{
+#ifdef HAVE_POPPLER_QT5
+  std::unique_ptr<Poppler::Document> document(Poppler::Document::load(_pdf));
+  if (!document || document->isLocked())
+    return 0;
+  return document->numPages();
+#else
+  (void)_pdf;
+  return 0;
+#endif
+}
+
+/////////////////////////////////////////////////
+bool PdfRasterizer::Compress(const QImage &_image, const QString &_file)
+{
+  auto rgba = _image.convertToFormat(QImage::Format_RGBA8888);
+
+  RgbaImage image;
+  image.width = rgba.width();
+  image.height = rgba.height();
+  image.pixels.resize(4u * image.width * image.height);
+  for (uint32_t y = 0; y < image.height; ++y)
+  {
+    std::memcpy(&image.pixels[4u * y * image.width], rgba.constScanLine(y),
+        4u * image.width);
+  }
+
+  return TextureEncoder::Write(image, _file.toStdString());
+}
+
+/////////////////////////////////////////////////
+void PdfRasterizer::SetCompress(bool _compress)
+{
+  this->dataPtr->compress = _compress;
+}
+
+/////////////////////////////////////////////////
+bool PdfRasterizer::Start(const QString &_pdf, const QString &_directory,
+    const QString &_prefix, const std::vector<int> &_pages, int _threads)
+{
+  if (this->dataPtr->running)
+  {
+    this->Finished(0, "A conversion is already in progress");
+    return false;
+  }
+
+  this->dataPtr->Reset(_pdf, _pages);
+  this->dataPtr->directory = _directory;
+  this->dataPtr->prefix = _prefix;
+  this->dataPtr->hashOnly = false;
+
+#ifdef HAVE_POPPLER_QT5
+  auto error = this->dataPtr->Launch(this, _threads);
+  if (!error.isEmpty())
+  {
+    this->Finished(0, error);
+    return false;
+  }
+#else
+  if (!this->dataPtr->process)
+  {
+    this->dataPtr->process = new QProcess();
+    this->dataPtr->process->setProcessChannelMode(
+        QProcess::ForwardedChannels);
+    this->connect(this->dataPtr->process,
+        SIGNAL(finished(int, QProcess::ExitStatus)),
+        this, SLOT(OnProcessFinished(int, QProcess::ExitStatus)));
+  }
+
+  ssmsg << "Converting PDF [" << _pdf.toStdString()
+        << "] to images with ImageMagick" << std::endl;
+
+  // %d numbers pages even if there's only one. Timestamps are left out so
+  // the same page always makes the same file.
+  this->dataPtr->process->start("convert", QStringList() <<
+      "-density" << QString::number(kDefaultDensity) <<
+      "-quality" << "100" <<
+      "-sharpen" << "0x1.0" <<
+      "-define" << "png:exclude-chunks=date,time" <<
+      _pdf <<
+      QString(_directory + "/" + _prefix + "-%d.png"));
+
+  this->dataPtr->process->waitForStarted(1000);
+
+  if (this->dataPtr->process->error() == QProcess::FailedToStart)
+  {
+    this->Finished(0, "Failed to convert PDF. Have you installed "
+        "ImageMagick?\nsudo apt-get install imagemagick");
+    return false;
+  }
+
+  this->dataPtr->running = true;
+  (void)_threads;
+#endif
+
+  return true;
+}
+
+/////////////////////////////////////////////////
+bool PdfRasterizer::StartHashing(const QString &_pdf,
+    const std::vector<int> &_pages, int _threads)
+{
+  if (this->dataPtr->running)
+  {
+    this->Finished(0, "A conversion is already in progress");
+    return false;
+  }
+
+  this->dataPtr->Reset(_pdf, _pages);
+  this->dataPtr->hashOnly = true;
+
+  auto error = this->dataPtr->Launch(this, _threads);
+  if (!error.isEmpty())
+  {
+    this->Finished(0, error);
+    return false;
+  }
+
+  return true;
+}
+
+/////////////////////////////////////////////////
+void PdfRasterizer::Cancel()
+{
+  if (!this->dataPtr->running)
+    return;
+
+  this->dataPtr->Fail("Cancelled");
+
+  if (this->dataPtr->process)
+    this->dataPtr->process->kill();
+}
+
+/////////////////////////////////////////////////
+bool PdfRasterizer::Running() const
+{
+  return this->dataPtr->running;
+}
+
+/////////////////////////////////////////////////
+int PdfRasterizer::PageCount() const
+{
+  return this->dataPtr->pageCount;
+}
+
+/////////////////////////////////////////////////
+void PdfRasterizer::OnPageReady(int _page, QString _file)
+{
+  ++this->dataPtr->written;
+  this->PageReady(_page, _file);
+}
+
+/////////////////////////////////////////////////
+void PdfRasterizer::OnPageHashed(int _page, QString _hash)
+{
+  ++this->dataPtr->written;
+  this->PageHashed(_page, _hash);
+}
+
+/////////////////////////////////////////////////
+void PdfRasterizer::OnWorkersDone(QString _error)
+{
+  if (this->dataPtr->runner.joinable())
+    this->dataPtr->runner.join();
+
+  this->dataPtr->running = false;
+  this->Finished(this->dataPtr->written, _error);
+}
+
+/////////////////////////////////////////////////
+void PdfRasterizer::OnProcessFinished(int _exitCode,
+    QProcess::ExitStatus _exitStatus)
+{
+  this->dataPtr->running = false;
+
+  if (this->dataPtr->cancel)
+  {
+    this->Finished(0, "Cancelled");
+    return;
+  }
+
+  if (_exitCode != 0 || _exitStatus != QProcess::NormalExit)
+  {
+    this->Finished(0, "Failed to convert PDF, exit code: " +
+        QString::number(_exitCode) + ", exit status: " +
+        QString::number(_exitStatus));
+    return;
+  }
+
+  // ImageMagick doesn't report pages as it goes, so they're all ready now
+  while (QFile::exists(this->dataPtr->File(this->dataPtr->pageCount)))
+    ++this->dataPtr->pageCount;
+
+  if (this->dataPtr->pages.empty())
+  {
+    for (int page = 0; page < this->dataPtr->pageCount; ++page)
+      this->OnPageReady(page, this->dataPtr->File(page));
+  }
+  else
+  {
+    for (auto page : this->dataPtr->pages)
+    {
+      if (page >= 0 && page < this->dataPtr->pageCount)
+        this->OnPageReady(page, this->dataPtr->File(page));
+    }
+  }
+
+  this->Finished(this->dataPtr->written, QString());
+}
@@ -0,0 +1,173 @@
+/*
+ * Copyright 2017 Louise Poubel
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+#ifndef SIMSLIDES_PDFRASTERIZER_HH_
+#define SIMSLIDES_PDFRASTERIZER_HH_
+
+#include <memory>
+#include <vector>
+
+#include <gazebo/gui/qt.h>
+
+namespace simslides
+{
+  class PdfRasterizerPrivate;
+
+  /// \brief Renders the pages of a PDF into one PNG each.
+  ///
+  /// When built with poppler-qt5, pages are rendered in-process by a pool
+  /// of worker threads, one per core by default. Each worker opens its own
+  /// copy of the document, since a poppler document can't be rendered from
+  /// several threads at once, and takes the next unrendered page until
+  /// there are none left, so slow pages don't hold up a whole range.
+  ///
+  /// Otherwise, pages are converted by ImageMagick's `convert` in a
+  /// subprocess, which needs Ghostscript and a PDF policy that allows
+  /// reading.
+  ///
+  /// Page N is written to `<directory>/<prefix>-N.png`, counting from 0.
+  /// If compression is on, pages rendered in-process are also encoded into
+  /// `<directory>/<prefix>-N.dds` by the same worker, before PageReady.
+  /// Signals are emitted on the thread which owns the rasterizer.
+  class PdfRasterizer : public QObject
+  {
+    Q_OBJECT
+
+    /// \brief Resolution pages are rendered at, in dots per inch.
+    public: static constexpr int kDefaultDensity{150};
+
+    /// \brief Resolution of the thumbnails pages are fingerprinted with,
+    /// in dots per inch.
+    public: static constexpr int kHashDensity{18};
+
+    /// \brief Constructor.
+    public: PdfRasterizer();
+
+    /// \brief Destructor. Cancels the conversion in progress, if any, and
+    /// waits for it to stop.
+    public: ~PdfRasterizer();
+
+    /// \brief Whether pages are rendered in-process. False if they're
+    /// converted with ImageMagick.
+    /// \return True if built with poppler-qt5.
+    public: static bool InProcess();
+
+    /// \brief Count the pages of a PDF without rendering them.
+    /// \param[in] _pdf Path to the PDF file.
+    /// \return Number of pages, 0 if the PDF can't be opened or if pages
+    /// are converted with ImageMagick.
+    public: static int CountPages(const QString &_pdf);
+
+    /// \brief Encode an image into a compressed, mipmapped DDS texture.
+    /// Safe to call from any thread.
+    /// \param[in] _image Image.
+    /// \param[in] _file Path to write, replaced atomically.
+    /// \return False if the image is null or the file couldn't be written.
+    public: static bool Compress(const QImage &_image, const QString &_file);
+
+    /// \brief Set whether pages are also encoded into DDS textures. Only
+    /// applies to pages rendered in-process, and to conversions started
+    /// afterwards.
+    /// \param[in] _compress True to encode pages.
+    public: void SetCompress(bool _compress);
+
+    /// \brief Start converting a PDF. Returns right away, Finished is
+    /// emitted once all pages are written.
+    /// \param[in] _pdf Path to the PDF file.
+    /// \param[in] _directory Existing directory to write images to.
+    /// \param[in] _prefix Image file name prefix.
+    /// \param[in] _pages Pages to convert, counting from 0. Empty to convert
+    /// all of them. ImageMagick converts all pages regardless, but only the
+    /// ones listed are reported.
+    /// \param[in] _threads Number of worker threads, 0 for one per core.
+    /// Ignored when converting with ImageMagick.
+    /// \return False if the conversion couldn't be started, in which case
+    /// Finished is emitted with the error.
+    public: bool Start(const QString &_pdf, const QString &_directory,
+        const QString &_prefix, const std::vector<int> &_pages = {},
+        int _threads = 0);
+
+    /// \brief Start fingerprinting the pages of a PDF, to find which ones
+    /// changed since they were last converted. Returns right away,
+    /// PageHashed is emitted for each page and Finished once all are done.
+    ///
+    /// A fingerprint is a hash of the page's size, its text and a small
+    /// thumbnail of it, which is much cheaper than rendering the page.
+    /// Only available when pages are rendered in-process.
+    /// \param[in] _pdf Path to the PDF file.
+    /// \param[in] _pages Pages to fingerprint, counting from 0. Empty for
+    /// all of them.
+    /// \param[in] _threads Number of worker threads, 0 for one per core.
+    /// \return False if fingerprinting couldn't be started, in which case
+    /// Finished is emitted with the error.
+    public: bool StartHashing(const QString &_pdf,
+        const std::vector<int> &_pages = {}, int _threads = 0);
+
+    /// \brief Stop the conversion in progress, if any. Pages being
+    /// rendered are finished, and Finished is emitted with an error.
+    public: void Cancel();
+
+    /// \brief Whether a conversion is in progress.
+    /// \return True if converting.
+    public: bool Running() const;
+
+    /// \brief Number of pages in the PDF being converted.
+    /// \return Page count, 0 if not known until the conversion finishes.
+    public: int PageCount() const;
+
+    /// \brief Emitted every time a page is written.
+    /// \param[in] _page Page number, counting from 0. Pages may be written
+    /// out of order.
+    /// \param[in] _file Path to the image.
+    signals: void PageReady(int _page, QString _file);
+
+    /// \brief Emitted every time a page is fingerprinted.
+    /// \param[in] _page Page number, counting from 0.
+    /// \param[in] _hash Hex fingerprint.
+    signals: void PageHashed(int _page, QString _hash);
+
+    /// \brief Emitted when the conversion is over.
+    /// \param[in] _count Number of pages written or fingerprinted by this
+    /// conversion.
+    /// \param[in] _error Empty on success, otherwise what went wrong.
+    signals: void Finished(int _count, QString _error);
+
+    /// \brief Callback when a worker has written a page.
+    /// \param[in] _page Page number.
+    /// \param[in] _file Path to the image.
+    private slots: void OnPageReady(int _page, QString _file);
+
+    /// \brief Callback when a worker has fingerprinted a page.
+    /// \param[in] _page Page number.
+    /// \param[in] _hash Hex fingerprint.
+    private slots: void OnPageHashed(int _page, QString _hash);
+
+    /// \brief Callback when all workers are done.
+    /// \param[in] _error Empty on success.
+    private slots: void OnWorkersDone(QString _error);
+
+    /// \brief Callback when the ImageMagick process is done.
+    /// \param[in] _exitCode Process exit code.
+    /// \param[in] _exitStatus Whether the process crashed.
+    private slots: void OnProcessFinished(int _exitCode,
+        QProcess::ExitStatus _exitStatus);
+
+    /// \internal
+    /// \brief Pointer to private data.
+    private: std::unique_ptr<PdfRasterizerPrivate> dataPtr;
+  };
+}
+
+#endif
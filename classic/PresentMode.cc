@@ -13,6 +13,12 @@
  * See the License for the specific language governing permissions and
  * limitations under the License.
 */
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <unordered_map>
+
+#include <gazebo/common/Events.hh>
 #include <gazebo/rendering/UserCamera.hh>
 #include <gazebo/rendering/Scene.hh>
 
@@ -22,6 +28,7 @@
 #include <gazebo/transport/Subscriber.hh>
 
 #include <simslides/common/Common.hh>
+#include <simslides/common/Log.hh>
 #include "PresentMode.hh"
 
 using namespace simslides;
@@ -34,6 +41,15 @@ class simslides::PresentModePrivate
   /// \brief Subscribe to key click messages.
   public: gazebo::transport::SubscriberPtr keyboardSub;
 
+  /// \brief Subscribe to requests to go to a labeled keyframe.
+  public: gazebo::transport::SubscriberPtr gotoLabelSub;
+
+  /// \brief Subscribe to requests to go to a visual's keyframe.
+  public: gazebo::transport::SubscriberPtr gotoVisualSub;
+
+  /// \brief Subscribe to pose updates of moving entities.
+  public: gazebo::transport::SubscriberPtr posesSub;
+
   /// \brief Keep pointer to camera so we can move it.
   public: gazebo::rendering::UserCameraPtr camera;
 
@@ -43,51 +59,184 @@ class simslides::PresentModePrivate
   /// \brief Event based connections.
   public: std::vector<gazebo::event::ConnectionPtr> connections;
 
+  /// \brief Fires when an update deferred while coalescing input is due.
+  public: QTimer *coalesceTimer{nullptr};
+
   /// \brief Window mode, usually "simulation" or "LogPlayback"
   public: std::string windowMode = "simulation";
+
+  /// \brief Autoplay state last sent to the GUI.
+  public: bool autoplayPlaying{false};
+
+  /// \brief Autoplay loop last sent to the GUI.
+  public: bool autoplayLoop{false};
+
+  /// \brief Get a visual from its ID, looking it up by name in the scene
+  /// only the first time it's requested.
+  /// \param[in] _id Visual ID, see KeyframeTable::VisualName.
+  /// \return The visual, or null if it isn't in the scene.
+  public: gazebo::rendering::VisualPtr Visual(uint32_t _id);
+
+  /// \brief Visuals resolved so far, indexed by visual ID.
+  public: std::vector<gazebo::rendering::VisualPtr> visuals;
+
+  /// \brief Deck version the cached visuals belong to.
+  public: uint64_t visualsVersion{0};
+
+  /// \brief Drop resolved visuals if the deck changed since they were
+  /// resolved.
+  public: void CheckVisualsVersion();
+
+  /// \brief Look up keyframe visuals which weren't found in the scene yet,
+  /// so their poses are tracked even before they're visited. Visuals are
+  /// inserted as models are spawned, so this is retried once a second until
+  /// they're all found.
+  public: void ResolveVisuals();
+
+  /// \brief Keep track of a visual resolved in the scene, and drop its
+  /// compiled camera poses if it isn't where the deck expects it.
+  /// \param[in] _id Visual ID, see KeyframeTable::VisualName.
+  /// \param[in] _vis Visual in the scene.
+  public: void AddVisual(uint32_t _id, gazebo::rendering::VisualPtr _vis);
+
+  /// \brief Map from the Gazebo entity ID of each resolved model to its
+  /// visual ID, so pose updates of other entities are dropped without
+  /// looking at their names.
+  public: std::unordered_map<uint32_t, uint32_t> entityVisuals;
+
+  /// \brief Protects entityVisuals, which is read on a transport thread.
+  public: std::mutex entityMutex;
+
+  /// \brief Number of keyframe visuals not found in the scene yet.
+  public: std::size_t unresolvedVisuals{0};
+
+  /// \brief Last time ResolveVisuals looked up visuals in the scene.
+  public: std::chrono::steady_clock::time_point resolveTime;
 };
 
+/////////////////////////////////////////////////
+void PresentModePrivate::CheckVisualsVersion()
+{
+  const auto &keyframes = Common::Instance()->keyframes;
+  if (this->visualsVersion == keyframes.Version() &&
+      this->visuals.size() == keyframes.VisualCount())
+  {
+    return;
+  }
+
+  this->visuals.assign(keyframes.VisualCount(), nullptr);
+  this->visualsVersion = keyframes.Version();
+
+  // The empty visual, ID 0, is never resolved
+  this->unresolvedVisuals = this->visuals.empty() ? 0 :
+      this->visuals.size() - 1;
+  this->resolveTime = {};
+
+  std::lock_guard<std::mutex> lock(this->entityMutex);
+  this->entityVisuals.clear();
+}
+
+/////////////////////////////////////////////////
+void PresentModePrivate::AddVisual(uint32_t _id,
+    gazebo::rendering::VisualPtr _vis)
+{
+  this->visuals[_id] = _vis;
+  --this->unresolvedVisuals;
+
+  Common::Instance()->VisualResolved(_id, _vis->WorldPose());
+
+  // Model visuals share their model's entity ID, which is the ID in its
+  // pose updates
+  std::lock_guard<std::mutex> lock(this->entityMutex);
+  this->entityVisuals[_vis->GetId()] = _id;
+}
+
+/////////////////////////////////////////////////
+void PresentModePrivate::ResolveVisuals()
+{
+  this->CheckVisualsVersion();
+  if (this->unresolvedVisuals == 0)
+    return;
+
+  auto now = std::chrono::steady_clock::now();
+  if (now - this->resolveTime < std::chrono::seconds(1))
+    return;
+  this->resolveTime = now;
+
+  const auto &keyframes = Common::Instance()->keyframes;
+  auto scene = this->camera->GetScene();
+  for (uint32_t id = 1; id < this->visuals.size(); ++id)
+  {
+    if (this->visuals[id])
+      continue;
+
+    auto vis = scene->GetVisual(keyframes.VisualName(id));
+    if (!vis)
+      continue;
+
+    this->AddVisual(id, vis);
+  }
+}
+
+/////////////////////////////////////////////////
+gazebo::rendering::VisualPtr PresentModePrivate::Visual(uint32_t _id)
+{
+  this->CheckVisualsVersion();
+
+  if (_id >= this->visuals.size())
+    return nullptr;
+
+  if (this->visuals[_id])
+    return this->visuals[_id];
+
+  const auto &name = Common::Instance()->keyframes.VisualName(_id);
+  auto vis = this->camera->GetScene()->GetVisual(name);
+  if (!vis)
+  {
+    sserr << "Couldn't find visual [" << name << "]" << std::endl;
+    return nullptr;
+  }
+
+  if (_id != 0)
+    this->AddVisual(_id, vis);
+  return vis;
+}
+
 /////////////////////////////////////////////////
 PresentMode::PresentMode() : dataPtr(new PresentModePrivate)
 {
   // Keep pointer to the user camera
   this->dataPtr->camera = gazebo::gui::get_active_camera();
 
+  this->dataPtr->coalesceTimer = new QTimer(this);
+  this->dataPtr->coalesceTimer->setSingleShot(true);
+  this->dataPtr->coalesceTimer->setTimerType(Qt::PreciseTimer);
+  this->connect(this->dataPtr->coalesceTimer, SIGNAL(timeout()), this,
+      SLOT(OnCoalesceTimeout()));
+
   // Connections
   this->dataPtr->connections.push_back(
       gazebo::gui::Events::ConnectWindowMode(
       std::bind(&PresentMode::OnWindowMode, this, std::placeholders::_1)));
+  this->dataPtr->connections.push_back(
+      gazebo::event::Events::ConnectPreRender(
+      std::bind(&PresentMode::OnPreRender, this)));
 
-  simslides::Common::Instance()->MoveCamera =
-      std::bind(&PresentMode::OnMoveCamera, this, std::placeholders::_1);
-
-  simslides::Common::Instance()->SetVisualVisible =
-      std::bind(&PresentMode::OnSetVisualVisible, this, std::placeholders::_1,
-      std::placeholders::_2);
-
-  simslides::Common::Instance()->SeekLog =
-      std::bind(&PresentMode::OnSeekLog, this, std::placeholders::_1);
-
-  simslides::Common::Instance()->ResetCameraPose =
-      std::bind(&PresentMode::OnResetCameraPose, this);
-
-  simslides::Common::Instance()->VisualPose =
-      std::bind(&PresentMode::OnVisualPose, this, std::placeholders::_1);
-
-  simslides::Common::Instance()->SetText =
-      std::bind(&PresentMode::OnSetText, this, std::placeholders::_1);
+  Common::Instance()->SetBackend(this);
 
-  gzmsg << "Start presentation. Total of [" << Common::Instance()->keyframes.size()
+  ssmsg << "Start presentation. Total of [" << Common::Instance()->keyframes.Size()
         << "] slides" << std::endl;
 
   // Trigger first slide
-  Common::Instance()->currentKeyframe = 0;
-  this->ChangeKeyframe();
+  Common::Instance()->commands.Push({CMD_GOTO, 0});
+  this->ProcessCommands();
 }
 
 /////////////////////////////////////////////////
 PresentMode::~PresentMode()
 {
+  if (Common::Instance()->CurrentBackend() == this)
+    Common::Instance()->SetBackend(nullptr);
 }
 
 /////////////////////////////////////////////////
@@ -104,6 +253,18 @@ void PresentMode::InitTransport()
   this->dataPtr->keyboardSub =
       this->dataPtr->node->Subscribe("~/keyboard/keypress",
       &PresentMode::OnKeyPress, this, true);
+
+  this->dataPtr->gotoLabelSub =
+      this->dataPtr->node->Subscribe("~/simslides/goto_label",
+      &PresentMode::OnGoToLabel, this);
+
+  this->dataPtr->gotoVisualSub =
+      this->dataPtr->node->Subscribe("~/simslides/goto_visual",
+      &PresentMode::OnGoToVisual, this);
+
+  this->dataPtr->posesSub =
+      this->dataPtr->node->Subscribe("~/pose/info",
+      &PresentMode::OnPoses, this);
 }
 
 /////////////////////////////////////////////////
@@ -113,56 +274,179 @@ void PresentMode::OnWindowMode(const std::string &_mode)
 }
 
 /////////////////////////////////////////////////
-void PresentMode::OnKeyPress(ConstAnyPtr &_msg)
+void PresentMode::OnPreRender()
 {
-  if (Common::Instance()->HandleKeyPress(_msg->int_value()))
+  if (Common::Instance()->PollAutoplay())
     this->ChangeKeyframe();
+  this->CheckAutoplay();
+
+  Common::Instance()->StepCamera(*this);
+  this->CheckMetrics();
+  this->dataPtr->ResolveVisuals();
 }
 
 /////////////////////////////////////////////////
-void PresentMode::OnKeyframeChanged(int _keyframe)
+void PresentMode::CheckMetrics()
 {
-  Common::Instance()->ChangeKeyframe(_keyframe);
-  this->ChangeKeyframe();
+  std::string summary;
+  if (Common::Instance()->metricsExporter.TakeSummary(summary))
+    this->MetricsChanged(QString::fromStdString(summary));
 }
 
 /////////////////////////////////////////////////
-void PresentMode::ChangeKeyframe()
+void PresentMode::CheckAutoplay()
 {
-  gzmsg << "Change Slide: " << Common::Instance()->currentKeyframe << std::endl;
+  const auto &autoplay = Common::Instance()->autoplay;
+  if (autoplay.Playing() == this->dataPtr->autoplayPlaying &&
+      autoplay.Loop() == this->dataPtr->autoplayLoop)
+  {
+    return;
+  }
 
-  Common::Instance()->Common::Instance()->Update();
+  this->dataPtr->autoplayPlaying = autoplay.Playing();
+  this->dataPtr->autoplayLoop = autoplay.Loop();
+  this->AutoplayChanged(autoplay.Playing(), autoplay.Loop());
+}
 
-  this->KeyframeChanged(Common::Instance()->currentKeyframe,
-      Common::Instance()->keyframes.size()-1);
+/////////////////////////////////////////////////
+void PresentMode::OnKeyPress(ConstAnyPtr &_msg)
+{
+  // Apply the command on the GUI thread
+  if (Common::Instance()->PushKey(_msg->int_value()))
+    QMetaObject::invokeMethod(this, "ProcessCommands", Qt::QueuedConnection);
+}
+
+/////////////////////////////////////////////////
+void PresentMode::OnGoToLabel(ConstGzStringPtr &_msg)
+{
+  Common::Instance()->commands.Push({CMD_GOTO_LABEL, 0, _msg->data()});
+  QMetaObject::invokeMethod(this, "ProcessCommands", Qt::QueuedConnection);
+}
+
+/////////////////////////////////////////////////
+void PresentMode::OnGoToVisual(ConstGzStringPtr &_msg)
+{
+  Common::Instance()->commands.Push({CMD_GOTO_VISUAL, 0, _msg->data()});
+  QMetaObject::invokeMethod(this, "ProcessCommands", Qt::QueuedConnection);
 }
 
 /////////////////////////////////////////////////
-void PresentMode::OnMoveCamera(const ignition::math::Pose3d &_pose)
+void PresentMode::ProcessCommands()
 {
-  // Don't bother moving just a mm
-  if ((this->dataPtr->camera->WorldPose().Pos() - _pose.Pos()).Length() < 0.001)
+  if (Common::Instance()->ProcessCommands())
+    this->ChangeKeyframe();
+}
+
+/////////////////////////////////////////////////
+void PresentMode::OnPoses(ConstPosesStampedPtr &_msg)
+{
+  // Every moving entity is published here, only keyframe models matter.
+  // Their links are published too, but relative to the model.
+  std::lock_guard<std::mutex> lock(this->dataPtr->entityMutex);
+  if (this->dataPtr->entityVisuals.empty())
     return;
 
-  this->dataPtr->camera->MoveToPosition(_pose, 1);
+  for (int i = 0; i < _msg->pose_size(); ++i)
+  {
+    auto it = this->dataPtr->entityVisuals.find(_msg->pose(i).id());
+    if (it != this->dataPtr->entityVisuals.end())
+      Common::Instance()->VisualMoved(it->second);
+  }
 }
 
 /////////////////////////////////////////////////
-void PresentMode::OnSetVisualVisible(const std::string &_name, bool _visible)
+void PresentMode::OnKeyframeChanged(int _keyframe)
 {
-  auto vis = this->dataPtr->camera->GetScene()->GetVisual(_name);
+  Common::Instance()->commands.Push({CMD_GOTO, _keyframe});
+  this->ProcessCommands();
+}
 
-  if (!vis)
+/////////////////////////////////////////////////
+void PresentMode::OnPlay(bool _play)
+{
+  Common::Instance()->commands.Push({_play ? CMD_PLAY : CMD_PAUSE});
+  this->ProcessCommands();
+  this->CheckAutoplay();
+}
+
+/////////////////////////////////////////////////
+void PresentMode::OnLoop(bool _loop)
+{
+  Common::Instance()->commands.Push({_loop ? CMD_LOOP : CMD_NO_LOOP});
+  this->ProcessCommands();
+  this->CheckAutoplay();
+}
+
+/////////////////////////////////////////////////
+void PresentMode::ChangeKeyframe()
+{
+  if (Common::Instance()->RequestUpdate(*this))
   {
-    gzerr << "Couldn't find visual [" << _name << "]" << std::endl;
+    this->KeyframeUpdated();
     return;
   }
 
-  vis->SetVisible(_visible);
+  auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+      Common::Instance()->coalescer.Remaining(
+      std::chrono::steady_clock::now()));
+  this->dataPtr->coalesceTimer->start(static_cast<int>(remaining.count()));
+}
+
+/////////////////////////////////////////////////
+void PresentMode::OnCoalesceTimeout()
+{
+  if (Common::Instance()->PollUpdate(*this))
+  {
+    this->KeyframeUpdated();
+    return;
+  }
+
+  // Fired a little early
+  if (Common::Instance()->coalescer.Pending())
+  {
+    auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+        Common::Instance()->coalescer.Remaining(
+        std::chrono::steady_clock::now()));
+    this->dataPtr->coalesceTimer->start(
+        std::max(1, static_cast<int>(remaining.count())));
+  }
+}
+
+/////////////////////////////////////////////////
+void PresentMode::KeyframeUpdated()
+{
+  ssmsg << "Change Slide: " << Common::Instance()->currentKeyframe << std::endl;
+
+  this->KeyframeChanged(Common::Instance()->currentKeyframe,
+      Common::Instance()->keyframes.Size()-1);
+}
+
+/////////////////////////////////////////////////
+ignition::math::Pose3d PresentMode::CameraPose() const
+{
+  return this->dataPtr->camera->WorldPose();
+}
+
+/////////////////////////////////////////////////
+void PresentMode::SetCameraPose(const ignition::math::Pose3d &_pose)
+{
+  this->dataPtr->camera->SetWorldPose(_pose);
+}
+
+/////////////////////////////////////////////////
+void PresentMode::SetVisualsVisible(
+    const std::vector<VisibilityChange> &_changes)
+{
+  for (const auto &change : _changes)
+  {
+    auto vis = this->dataPtr->Visual(change.visual);
+    if (vis)
+      vis->SetVisible(change.visible);
+  }
 }
 
 /////////////////////////////////////////////////
-void PresentMode::OnSeekLog(std::chrono::steady_clock::duration _time)
+void PresentMode::SeekLog(std::chrono::steady_clock::duration _time)
 {
   // Advertise
   if (!this->dataPtr->logPlaybackControlPub &&
@@ -186,18 +470,17 @@ void PresentMode::OnSeekLog(std::chrono::steady_clock::duration _time)
 }
 
 /////////////////////////////////////////////////
-void PresentMode::OnResetCameraPose()
+void PresentMode::ResetCameraPose()
 {
-  this->OnMoveCamera(this->dataPtr->camera->InitialPose());
+  Common::Instance()->MoveCamera(*this, this->dataPtr->camera->InitialPose());
 }
 
 /////////////////////////////////////////////////
-ignition::math::Pose3d PresentMode::OnVisualPose(const std::string &_name)
+ignition::math::Pose3d PresentMode::VisualPose(uint32_t _id)
 {
-  auto vis = this->dataPtr->camera->GetScene()->GetVisual(_name);
+  auto vis = this->dataPtr->Visual(_id);
   if (!vis)
   {
-    gzerr << "Failed to find visual [" << _name << "]" << std::endl;
     return {
       std::numeric_limits<double>::quiet_NaN(),
       std::numeric_limits<double>::quiet_NaN(),
@@ -212,7 +495,7 @@ ignition::math::Pose3d PresentMode::OnVisualPose(const std::string &_name)
 }
 
 /////////////////////////////////////////////////
-void PresentMode::OnSetText(const std::string &_text)
+void PresentMode::SetText(const std::string &_text)
 {
   this->TextChanged(QString::fromStdString(_text));
 }
@@ -20,22 +20,49 @@
 
 #include <gazebo/gui/gui.hh>
 #include <gazebo/msgs/any.pb.h>
+#include <gazebo/msgs/gz_string.pb.h>
+#include <gazebo/msgs/poses_stamped.pb.h>
+#include <simslides/common/Backend.hh>
+#include <simslides/common/Visibility.hh>
 
 namespace simslides
 {
   class PresentModePrivate;
 
   /// \brief Handles keyframes while presenting.
-  class PresentMode : public QObject
+  class PresentMode final : public QObject, public Backend
   {
     Q_OBJECT
 
-    /// \brief Constructor.
+    /// \brief Constructor. Sets itself as Common's backend.
     public: PresentMode();
 
-    /// \brief Destructor.
+    /// \brief Destructor. Unsets itself as Common's backend.
     public: ~PresentMode();
 
+    // Documentation inherited
+    public: ignition::math::Pose3d CameraPose() const override;
+
+    // Documentation inherited
+    public: void SetCameraPose(const ignition::math::Pose3d &_pose)
+        override;
+
+    // Documentation inherited
+    public: void SetVisualsVisible(
+        const std::vector<VisibilityChange> &_changes) override;
+
+    // Documentation inherited
+    public: void SeekLog(std::chrono::steady_clock::duration _time) override;
+
+    // Documentation inherited
+    public: void ResetCameraPose() override;
+
+    // Documentation inherited
+    public: ignition::math::Pose3d VisualPose(uint32_t _id) override;
+
+    // Documentation inherited
+    public: void SetText(const std::string &_text) override;
+
     /// \brief Subscribing to key presses from the constructor makes the
     /// Node::Subscribe function crash with
     ///
@@ -44,47 +71,69 @@ namespace simslides
     /// So we initialize it later
     public: void InitTransport();
 
-    /// \brief Callback when user presses a key.
+    /// \brief Callback when user presses a key. It runs on a transport
+    /// thread, so it only queues the command for the GUI thread.
     /// \param[in] _msg Message containing key.
     private: void OnKeyPress(ConstAnyPtr &_msg);
 
-    /// \brief Callback to move camera.
-    /// \param[in] _pose Pose to move to.
-    private: void OnMoveCamera(const ignition::math::Pose3d &_pose);
+    /// \brief Callback when a keyframe is requested by label. It runs on
+    /// a transport thread, so it only queues the command.
+    /// \param[in] _msg Message containing the label.
+    private: void OnGoToLabel(ConstGzStringPtr &_msg);
 
-    /// \brief Callback to show / hide a visual
-    /// \param[in] _name Visual's scoped name
-    /// \param[in] _visible True to show
-    private: void OnSetVisualVisible(const std::string &_name, bool _visible);
+    /// \brief Callback when the first keyframe attached to a visual is
+    /// requested. It runs on a transport thread, so it only queues the
+    /// command.
+    /// \param[in] _msg Message containing the visual name.
+    private: void OnGoToVisual(ConstGzStringPtr &_msg);
 
-    /// \brief Callback to seek a log file.
-    /// \param[in] _time Time to seek to.
-    private: void OnSeekLog(std::chrono::steady_clock::duration _time);
+    /// \brief Apply queued commands on the GUI thread.
+    private slots: void ProcessCommands();
 
-    /// \brief Callback to reset the camera pose.
-    private: void OnResetCameraPose();
+    /// \brief Callback when entities move, to recompute camera poses
+    /// looking at them.
+    /// \param[in] _msg Poses of the entities which moved.
+    private: void OnPoses(ConstPosesStampedPtr &_msg);
 
-    /// \brief Callback to get a visual's pose
-    /// \param[in] _name Visual's scoped name
-    /// \return Visual's pose in world frame
-    private: ignition::math::Pose3d OnVisualPose(const std::string &_name);
+    /// \brief Callback before every frame is rendered, to move the camera
+    /// along its transition and autoplay keyframes.
+    private: void OnPreRender();
 
-    /// \brief Callback to set the text on the dialog.
-    /// \param[in] _text Text to set.
-    private: void OnSetText(const std::string &_text);
+    /// \brief Notify the GUI if autoplay was paused, resumed or its loop
+    /// changed since the last call.
+    private: void CheckAutoplay();
+
+    /// \brief Notify the GUI if transition metrics changed since the last
+    /// call.
+    private: void CheckMetrics();
 
     /// \brief Callback when Gazebo says the window mode has changed.
     /// \param[in] _mode New mode, usually "simulation" or "LogPlayback".
     private: void OnWindowMode(const std::string &_mode);
 
     /// \brief Performs the slide change, based on the current index which was
-    /// previously set.
+    /// previously set. Changes in quick succession are coalesced into a
+    /// single update once the burst is over.
     private: void ChangeKeyframe();
 
+    /// \brief Notify the GUI after an update was applied.
+    private: void KeyframeUpdated();
+
+    /// \brief Apply an update deferred by ChangeKeyframe.
+    private slots: void OnCoalesceTimeout();
+
     /// \brief Callback when the user requested a new keyframe.
     /// \oaram[in] _slide New slide index.
     private slots: void OnKeyframeChanged(int _slide);
 
+    /// \brief Callback when the user plays or pauses autoplay.
+    /// \param[in] _play True to play, false to pause.
+    private slots: void OnPlay(bool _play);
+
+    /// \brief Callback when the user turns looping on or off.
+    /// \param[in] _loop True to loop.
+    private slots: void OnLoop(bool _loop);
+
     /// \brief Notifies that the slide index has changed,
     /// \param[in] _currentIndex Current keyframe index.
     /// \param[in] _slideCount Total number of keyframes.
@@ -94,6 +143,16 @@ namespace simslides
     /// \param[in] _text Slide text.
     signals: void TextChanged(QString _text);
 
+    /// \brief Notifies that autoplay was paused, resumed or its loop
+    /// changed, including when it pauses on the last keyframe.
+    /// \param[in] _playing Whether autoplay is playing.
+    /// \param[in] _loop Whether autoplay loops.
+    signals: void AutoplayChanged(bool _playing, bool _loop);
+
+    /// \brief Notifies that transition metrics changed.
+    /// \param[in] _summary Summary table, see TransitionMetrics::Summary.
+    signals: void MetricsChanged(QString _summary);
+
     /// \internal
     /// \brief Pointer to private data.
     private: std::unique_ptr<PresentModePrivate> dataPtr;
@@ -17,6 +17,7 @@
 #include <sstream>
 #include <gazebo/rendering/UserCamera.hh>
 #include <simslides/common/Common.hh>
+#include <simslides/common/Log.hh>
 
 #include "ImportDialog.hh"
 #include "InsertActorDialog.hh"
@@ -129,6 +130,42 @@ SimSlides::SimSlides()
   textButton->setIconSize(QSize(100, 100));
   this->connect(textButton, SIGNAL(clicked()), textDialog, SLOT(show()));
 
+  // Autoplay, takes effect while presenting
+  this->playButton = new QToolButton();
+  this->playButton->setText(QString::fromUtf8("\u23EF"));
+  this->playButton->setToolTip(tr("Play / pause autoplay"));
+  this->playButton->setCheckable(true);
+  this->playButton->setEnabled(false);
+
+  this->loopButton = new QToolButton();
+  this->loopButton->setText(QString::fromUtf8("\u21BB"));
+  this->loopButton->setToolTip(tr("Loop autoplay"));
+  this->loopButton->setCheckable(true);
+  this->loopButton->setEnabled(false);
+
+  // Transition latency
+  this->metrics = new QTextBrowser();
+  this->metrics->setReadOnly(true);
+  this->metrics->setLineWrapMode(QTextEdit::NoWrap);
+  this->metrics->setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+  this->metrics->setPlainText(tr("No transitions yet"));
+
+  auto metricsLayout = new QVBoxLayout();
+  metricsLayout->addWidget(this->metrics);
+
+  auto metricsDialog = new QDialog(this);
+  metricsDialog->setWindowFlags(Qt::Window | Qt::WindowCloseButtonHint |
+      Qt::WindowStaysOnTopHint | Qt::CustomizeWindowHint);
+  metricsDialog->setWindowTitle("SimSlides Transition Latency");
+  metricsDialog->setLayout(metricsLayout);
+  metricsDialog->resize(500, 300);
+
+  auto metricsButton = new QToolButton();
+  metricsButton->setText(QString::fromUtf8("\u23F1"));
+  metricsButton->setToolTip(tr("Transition latency"));
+  this->connect(metricsButton, SIGNAL(clicked()), metricsDialog,
+      SLOT(show()));
+
   // Create the layout that sits inside the frame
   auto frameLayout = new QHBoxLayout();
   frameLayout->addWidget(currentSpin);
@@ -136,6 +173,9 @@ SimSlides::SimSlides()
   frameLayout->addWidget(totalLabel);
   frameLayout->addWidget(presentButton);
   frameLayout->addWidget(textButton);
+  frameLayout->addWidget(this->playButton);
+  frameLayout->addWidget(this->loopButton);
+  frameLayout->addWidget(metricsButton);
 
   // Create the frame to hold all the widgets
   auto mainFrame = new QFrame();
@@ -168,7 +208,7 @@ void SimSlides::Load(const sdf::ElementPtr _sdf)
     auto camera = gazebo::gui::get_active_camera();
     if (nullptr == camera)
     {
-      gzwarn << "No user camera, can't set near and far clip distances"
+      sswarn << "No user camera, can't set near and far clip distances"
              << std::endl;
     }
     else
@@ -215,9 +255,39 @@ void SimSlides::OnPresent()
       SLOT(OnTextChanged(QString)));
   this->connect(this, SIGNAL(CurrentChanged(int)), presentMode,
       SLOT(OnKeyframeChanged(int)));
+  this->connect(presentMode, SIGNAL(AutoplayChanged(bool, bool)), this,
+      SLOT(OnAutoplayChanged(bool, bool)));
+  this->connect(this->playButton, SIGNAL(toggled(bool)), presentMode,
+      SLOT(OnPlay(bool)));
+  this->connect(this->loopButton, SIGNAL(toggled(bool)), presentMode,
+      SLOT(OnLoop(bool)));
+  this->connect(presentMode, SIGNAL(MetricsChanged(QString)), this,
+      SLOT(OnMetricsChanged(QString)));
 
   this->presentMode->InitTransport();
   this->OnKeyframeChanged(Common::Instance()->currentKeyframe,
-      Common::Instance()->keyframes.size()-1);
+      Common::Instance()->keyframes.Size()-1);
+  this->OnAutoplayChanged(Common::Instance()->autoplay.Playing(),
+      Common::Instance()->autoplay.Loop());
+  this->playButton->setEnabled(true);
+  this->loopButton->setEnabled(true);
+}
+
+/////////////////////////////////////////////////
+void SimSlides::OnMetricsChanged(QString _summary)
+{
+  this->metrics->setPlainText(_summary);
+}
+
+/////////////////////////////////////////////////
+void SimSlides::OnAutoplayChanged(bool _playing, bool _loop)
+{
+  this->playButton->blockSignals(true);
+  this->playButton->setChecked(_playing);
+  this->playButton->blockSignals(false);
+
+  this->loopButton->blockSignals(true);
+  this->loopButton->setChecked(_loop);
+  this->loopButton->blockSignals(false);
 }
 
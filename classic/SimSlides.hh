@@ -48,6 +48,16 @@ namespace simslides
     /// \brief Callback when the user starts presenting.
     private slots: void OnPresent();
 
+    /// \brief Callback when autoplay is paused, resumed or its loop
+    /// changes, to update the buttons.
+    /// \param[in] _playing Whether autoplay is playing.
+    /// \param[in] _loop Whether autoplay loops.
+    private slots: void OnAutoplayChanged(bool _playing, bool _loop);
+
+    /// \brief Callback when transition metrics change.
+    /// \param[in] _summary Summary table.
+    private slots: void OnMetricsChanged(QString _summary);
+
     /// \brief Notifies that the keyframe spin has changed
     /// \param[in] _current Number of current keyframe.
     Q_SIGNALS: void CurrentChanged(const int _current);
@@ -62,6 +72,15 @@ namespace simslides
     /// \brief Holds text for keyframes.
     private: QTextBrowser * text{nullptr};
 
+    /// \brief Plays and pauses autoplay, checked while playing.
+    private: QToolButton * playButton{nullptr};
+
+    /// \brief Turns autoplay looping on and off.
+    private: QToolButton * loopButton{nullptr};
+
+    /// \brief Holds the transition metrics summary.
+    private: QTextBrowser * metrics{nullptr};
+
     /// \brief Present mode helper
     private: PresentMode * presentMode{nullptr};
   };
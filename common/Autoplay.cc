@@ -0,0 +1,121 @@
+/*
+ * Copyright 2017 Louise Poubel
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+#include <algorithm>
+
+#include "include/simslides/common/Autoplay.hh"
+
+using namespace simslides;
+
+/////////////////////////////////////////////////
+void Autoplay::Reset()
+{
+  this->keyframe = kNone;
+  this->remaining = Clock::duration::zero();
+  this->playing = false;
+}
+
+/////////////////////////////////////////////////
+void Autoplay::Play(Clock::time_point _now)
+{
+  if (this->playing)
+    return;
+
+  this->deadline = _now + this->remaining;
+  this->playing = true;
+}
+
+/////////////////////////////////////////////////
+void Autoplay::Pause(Clock::time_point _now)
+{
+  if (!this->playing)
+    return;
+
+  this->remaining = std::max(Clock::duration::zero(), this->deadline - _now);
+  this->playing = false;
+}
+
+/////////////////////////////////////////////////
+bool Autoplay::Playing() const
+{
+  return this->playing;
+}
+
+/////////////////////////////////////////////////
+void Autoplay::SetLoop(bool _loop)
+{
+  this->loop = _loop;
+}
+
+/////////////////////////////////////////////////
+bool Autoplay::Loop() const
+{
+  return this->loop;
+}
+
+/////////////////////////////////////////////////
+void Autoplay::SetDefaultDwell(Clock::duration _dwell)
+{
+  this->defaultDwell = _dwell;
+}
+
+/////////////////////////////////////////////////
+Autoplay::Clock::duration Autoplay::DefaultDwell() const
+{
+  return this->defaultDwell;
+}
+
+/////////////////////////////////////////////////
+void Autoplay::Show(int _keyframe, Clock::duration _dwell,
+    Clock::time_point _now)
+{
+  if (_keyframe == this->keyframe)
+    return;
+
+  this->keyframe = _keyframe;
+  this->deadline = _now + _dwell;
+  this->remaining = _dwell;
+}
+
+/////////////////////////////////////////////////
+void Autoplay::Advance(int _keyframe, Clock::duration _dwell,
+    Clock::time_point _now)
+{
+  this->keyframe = _keyframe;
+  this->remaining = _dwell;
+
+  // Fell behind by a whole dwell, start over from now
+  this->deadline += _dwell;
+  if (this->deadline <= _now)
+    this->deadline = _now + _dwell;
+}
+
+/////////////////////////////////////////////////
+bool Autoplay::Due(Clock::time_point _now) const
+{
+  return this->playing && this->keyframe != kNone && _now >= this->deadline;
+}
+
+/////////////////////////////////////////////////
+Autoplay::Clock::duration Autoplay::Remaining(Clock::time_point _now) const
+{
+  if (this->keyframe == kNone)
+    return Clock::duration::zero();
+
+  if (!this->playing)
+    return this->remaining;
+
+  return std::max(Clock::duration::zero(), this->deadline - _now);
+}
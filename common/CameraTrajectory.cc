@@ -0,0 +1,254 @@
+/*
+ * Copyright 2017 Louise Poubel
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+#include <algorithm>
+#include <cmath>
+
+#include "include/simslides/common/CameraTrajectory.hh"
+
+using namespace simslides;
+
+namespace
+{
+  /// \brief Distance to the Bezier control points, as a fraction of the
+  /// distance between start and goal.
+  constexpr double kPullBack{0.3};
+
+  /// \brief Poses closer than this are considered the same, in meters.
+  constexpr double kMinDistance{0.001};
+
+  /// \brief Orientations closer than this are considered the same, in
+  /// radians.
+  constexpr double kMinAngle{0.001};
+
+  /// \brief Direction a camera looks at.
+  /// \param[in] _pose Camera pose.
+  /// \return Unit vector along the camera's X axis.
+  ignition::math::Vector3d Forward(const ignition::math::Pose3d &_pose)
+  {
+    return _pose.Rot().RotateVector(ignition::math::Vector3d(1, 0, 0));
+  }
+
+  /// \brief Angle between two orientations.
+  /// \param[in] _a First orientation.
+  /// \param[in] _b Second orientation.
+  /// \return Angle in radians, between 0 and pi.
+  double Angle(const ignition::math::Quaterniond &_a,
+      const ignition::math::Quaterniond &_b)
+  {
+    auto dot = std::min(1.0, std::abs(_a.W() * _b.W() + _a.X() * _b.X() +
+        _a.Y() * _b.Y() + _a.Z() * _b.Z()));
+    return 2.0 * std::acos(dot);
+  }
+
+  /// \brief Velocities slower than this are considered at rest, in m/s.
+  constexpr double kMinSpeed{0.001};
+
+  /// \brief Progress along the curve, easing out to zero velocity and
+  /// acceleration at the end. At the start, acceleration is zero and the
+  /// rate of progress is _rate, so 0 eases in from rest.
+  /// This is a quintic Hermite curve.
+  /// \param[in] _u Normalized time, from 0 to 1.
+  /// \param[in] _rate Rate of progress at the start.
+  /// \return Normalized progress, from 0 to 1.
+  double Progress(double _u, double _rate)
+  {
+    auto u2 = _u * _u;
+    auto u3 = u2 * _u;
+    return _rate * (_u - 6.0 * u3 + 8.0 * u3 * _u - 3.0 * u3 * u2) +
+        u3 * (_u * (_u * 6.0 - 15.0) + 10.0);
+  }
+
+  /// \brief Derivative of Progress with respect to normalized time.
+  /// \param[in] _u Normalized time, from 0 to 1.
+  /// \param[in] _rate Rate of progress at the start.
+  /// \return Rate of progress.
+  double ProgressRate(double _u, double _rate)
+  {
+    auto u2 = _u * _u;
+    auto v = 1.0 - _u;
+    return _rate * (1.0 - 18.0 * u2 + 32.0 * u2 * _u - 15.0 * u2 * u2) +
+        30.0 * u2 * v * v;
+  }
+}
+
+/////////////////////////////////////////////////
+void CameraTrajectory::SetSpeed(double _linear, double _angular)
+{
+  this->speed = _linear;
+  this->angularSpeed = _angular;
+}
+
+/////////////////////////////////////////////////
+void CameraTrajectory::SetDurationLimits(Clock::duration _min,
+    Clock::duration _max)
+{
+  this->minDuration = _min;
+  this->maxDuration = std::max(_min, _max);
+}
+
+/////////////////////////////////////////////////
+CameraTrajectory::Clock::duration CameraTrajectory::Duration(
+    const ignition::math::Pose3d &_start,
+    const ignition::math::Pose3d &_goal) const
+{
+  auto distance = _start.Pos().Distance(_goal.Pos());
+  auto angle = Angle(_start.Rot(), _goal.Rot());
+  if (!std::isfinite(distance) || !std::isfinite(angle) ||
+      (distance < kMinDistance && angle < kMinAngle))
+  {
+    return Clock::duration::zero();
+  }
+
+  auto seconds = std::max(distance / this->speed, angle / this->angularSpeed);
+  auto duration = std::chrono::duration_cast<Clock::duration>(
+      std::chrono::duration<double>(seconds));
+  return std::clamp(duration, this->minDuration, this->maxDuration);
+}
+
+/////////////////////////////////////////////////
+void CameraTrajectory::Plan(const ignition::math::Pose3d &_start,
+    const ignition::math::Pose3d &_goal, Clock::time_point _now,
+    Clock::duration _duration, const ignition::math::Vector3d &_velocity)
+{
+  auto pullBack = kPullBack * _start.Pos().Distance(_goal.Pos());
+
+  this->points[0] = _start.Pos();
+  this->points[2] = _goal.Pos() - Forward(_goal) * pullBack;
+  this->points[3] = _goal.Pos();
+
+  // When moving, the first control point is placed so the curve leaves
+  // with the current velocity: B'(0) = 3 (p1 - p0), scaled by the start
+  // rate over the duration.
+  if (_velocity.Length() < kMinSpeed)
+  {
+    this->startRate = 0.0;
+    this->points[1] = _start.Pos() - Forward(_start) * pullBack;
+  }
+  else
+  {
+    this->startRate = 1.0;
+    this->points[1] = _start.Pos() + _velocity *
+        (std::chrono::duration<double>(_duration).count() / 3.0);
+  }
+
+  this->start = _start;
+  this->goal = _goal;
+  this->startTime = _now;
+  this->duration = _duration;
+  this->active = true;
+}
+
+/////////////////////////////////////////////////
+bool CameraTrajectory::Sample(Clock::time_point _now,
+    ignition::math::Pose3d &_pose)
+{
+  if (!this->active)
+    return false;
+
+  auto elapsed = _now - this->startTime;
+  if (elapsed >= this->duration)
+  {
+    _pose = this->goal;
+    this->active = false;
+    return true;
+  }
+
+  ignition::math::Vector3d velocity;
+  this->Evaluate(std::chrono::duration<double>(elapsed).count() /
+      std::chrono::duration<double>(this->duration).count(), _pose,
+      velocity);
+  return true;
+}
+
+/////////////////////////////////////////////////
+bool CameraTrajectory::State(Clock::time_point _now,
+    ignition::math::Pose3d &_pose, ignition::math::Vector3d &_velocity) const
+{
+  if (!this->active)
+    return false;
+
+  auto elapsed = _now - this->startTime;
+  if (elapsed >= this->duration)
+  {
+    _pose = this->goal;
+    _velocity = ignition::math::Vector3d::Zero;
+    return true;
+  }
+
+  this->Evaluate(std::chrono::duration<double>(elapsed).count() /
+      std::chrono::duration<double>(this->duration).count(), _pose,
+      _velocity);
+  return true;
+}
+
+/////////////////////////////////////////////////
+bool CameraTrajectory::HeadingTo(const ignition::math::Pose3d &_goal) const
+{
+  return this->active &&
+      this->goal.Pos().Distance(_goal.Pos()) < kMinDistance &&
+      Angle(this->goal.Rot(), _goal.Rot()) < kMinAngle;
+}
+
+/////////////////////////////////////////////////
+void CameraTrajectory::Evaluate(double _u, ignition::math::Pose3d &_pose,
+    ignition::math::Vector3d &_velocity) const
+{
+  _u = std::clamp(_u, 0.0, 1.0);
+  auto s = Progress(_u, this->startRate);
+  auto r = 1.0 - s;
+
+  const auto *p = this->points;
+  auto pos = p[0] * (r * r * r) + p[1] * (3.0 * r * r * s) +
+      p[2] * (3.0 * r * s * s) + p[3] * (s * s * s);
+  auto rot = ignition::math::Quaterniond::Slerp(s, this->start.Rot(),
+      this->goal.Rot(), true);
+  _pose = ignition::math::Pose3d(pos, rot);
+
+  // Chain rule: curve tangent times rate of progress over the duration
+  auto tangent = (p[1] - p[0]) * (3.0 * r * r) +
+      (p[2] - p[1]) * (6.0 * r * s) + (p[3] - p[2]) * (3.0 * s * s);
+  _velocity = tangent * (ProgressRate(_u, this->startRate) /
+      std::chrono::duration<double>(this->duration).count());
+}
+
+/////////////////////////////////////////////////
+void CameraTrajectory::Stop()
+{
+  this->active = false;
+}
+
+/////////////////////////////////////////////////
+bool CameraTrajectory::Finish(ignition::math::Pose3d &_pose)
+{
+  if (!this->active)
+    return false;
+
+  _pose = this->goal;
+  this->active = false;
+  return true;
+}
+
+/////////////////////////////////////////////////
+bool CameraTrajectory::Active() const
+{
+  return this->active;
+}
+
+/////////////////////////////////////////////////
+const ignition::math::Pose3d &CameraTrajectory::Goal() const
+{
+  return this->goal;
+}
@@ -0,0 +1,68 @@
+/*
+ * Copyright 2017 Louise Poubel
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+#include <utility>
+
+#include "include/simslides/common/CommandQueue.hh"
+
+using namespace simslides;
+
+/////////////////////////////////////////////////
+CommandQueue::CommandQueue()
+{
+  // The queue always holds one node, whose command was already consumed
+  auto stub = new Node;
+  this->head.store(stub, std::memory_order_relaxed);
+  this->tail = stub;
+}
+
+/////////////////////////////////////////////////
+CommandQueue::~CommandQueue()
+{
+  while (this->tail)
+  {
+    auto next = this->tail->next.load(std::memory_order_relaxed);
+    delete this->tail;
+    this->tail = next;
+  }
+}
+
+/////////////////////////////////////////////////
+void CommandQueue::Push(const Command &_command)
+{
+  auto node = new Node;
+  node->command = _command;
+  if (node->command.received == std::chrono::steady_clock::time_point())
+    node->command.received = std::chrono::steady_clock::now();
+
+  // Publish the node, then link it from the previous head. The release on
+  // the link makes the command visible to the consumer.
+  auto prev = this->head.exchange(node, std::memory_order_acq_rel);
+  prev->next.store(node, std::memory_order_release);
+}
+
+/////////////////////////////////////////////////
+bool CommandQueue::Pop(Command &_command)
+{
+  auto next = this->tail->next.load(std::memory_order_acquire);
+  if (nullptr == next)
+    return false;
+
+  // The next node becomes the stub, so its command can be moved out
+  _command = std::move(next->command);
+  delete this->tail;
+  this->tail = next;
+  return true;
+}
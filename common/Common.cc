@@ -14,9 +14,14 @@
  * limitations under the License.
 */
 
+#include <filesystem>
 #include <limits>
 
+#include <sdf/parser.hh>
+
 #include "include/simslides/common/Common.hh"
+#include "include/simslides/common/DeckFile.hh"
+#include "include/simslides/common/Log.hh"
 
 simslides::Common *simslides::Common::instance = nullptr;
 
@@ -34,50 +39,143 @@ void simslides::Common::LoadPluginSDF(const sdf::ElementPtr _sdf)
     this->nearClip = std::nan("");
   }
 
-  if (_sdf->HasElement("keyframe"))
+  if (_sdf->HasElement("log_level"))
+  {
+    auto levelStr = _sdf->Get<std::string>("log_level");
+    LogLevel level;
+    if (StrToLogLevel(levelStr, level))
+      Logger::Instance()->SetLevel(level);
+    else
+      sswarn << "Unknown log level [" << levelStr << "]" << std::endl;
+  }
+
+  if (_sdf->HasElement("coalesce_window"))
+  {
+    this->coalescer.SetWindow(std::chrono::duration_cast<
+        std::chrono::steady_clock::duration>(std::chrono::duration<double>(
+        _sdf->Get<double>("coalesce_window"))));
+  }
+  else
+  {
+    this->coalescer.SetWindow(kCoalesceWindow);
+  }
+
+  auto seconds = [&](const std::string &_name,
+      CameraTrajectory::Clock::duration _default)
+  {
+    if (!_sdf->HasElement(_name))
+      return _default;
+    return std::chrono::duration_cast<CameraTrajectory::Clock::duration>(
+        std::chrono::duration<double>(_sdf->Get<double>(_name)));
+  };
+  this->trajectory.SetSpeed(
+      _sdf->HasElement("transition_speed") ?
+      _sdf->Get<double>("transition_speed") :
+      CameraTrajectory::kDefaultSpeed,
+      _sdf->HasElement("transition_angular_speed") ?
+      _sdf->Get<double>("transition_angular_speed") :
+      CameraTrajectory::kDefaultAngularSpeed);
+  this->trajectory.SetDurationLimits(
+      seconds("transition_min", CameraTrajectory::kDefaultMinDuration),
+      seconds("transition_max", CameraTrajectory::kDefaultMaxDuration));
+  this->trajectory.Stop();
+
+  this->autoplay.Reset();
+  this->autoplay.SetDefaultDwell(
+      seconds("autoplay_dwell", Autoplay::kDefaultDwell));
+  this->autoplay.SetLoop(_sdf->HasElement("autoplay_loop") &&
+      _sdf->Get<bool>("autoplay_loop"));
+  if (_sdf->HasElement("autoplay") && _sdf->Get<bool>("autoplay"))
+    this->autoplay.Play(Autoplay::Clock::now());
+
+  this->metricsFile = _sdf->HasElement("metrics_file") ?
+      _sdf->Get<std::string>("metrics_file") : std::string();
+  this->metrics.Clear();
+
+  this->keyframes.Clear();
+
+  if (_sdf->HasElement("deck_file"))
+  {
+    auto deckFile = _sdf->Get<std::string>("deck_file");
+    if (!std::filesystem::exists(deckFile))
+    {
+      auto found = sdf::findFile(deckFile);
+      if (!found.empty())
+        deckFile = found;
+    }
+
+    if (_sdf->HasElement("keyframe"))
+    {
+      sswarn << "Both <deck_file> and <keyframe> were given, ignoring "
+             << "<keyframe>s." << std::endl;
+    }
+
+    std::string error;
+    if (!DeckFile::Load(deckFile, this->keyframes, error))
+    {
+      sserr << "Failed to load <deck_file> [" << deckFile << "]: " << error
+            << std::endl;
+    }
+    this->keyframes.SetDirectory(
+        std::filesystem::path(deckFile).parent_path().string());
+  }
+  else if (_sdf->HasElement("keyframe"))
   {
-    auto keyframeElem = _sdf->GetElement("keyframe");
-    while (keyframeElem)
+    // Empty if the SDF didn't come from a file
+    this->keyframes.SetDirectory(
+        std::filesystem::path(_sdf->FilePath()).parent_path().string());
+
+    std::vector<std::string> errors;
+    if (!this->keyframes.AddAll(_sdf, errors))
     {
-      this->keyframes.push_back(new Keyframe(keyframeElem));
-      keyframeElem = keyframeElem->GetNextElement("keyframe");
+      sserr << "Found [" << errors.size() << "] invalid keyframes:"
+            << std::endl;
+      for (const auto &error : errors)
+        sserr << "  " << error << std::endl;
     }
   }
 
-  if (this->keyframes.size() == 0)
+  if (this->keyframes.Empty())
+  {
+    sswarn << "No keyframes were loaded." << std::endl;
+  }
+  else
   {
-    std::cerr << "No keyframes were loaded." << std::endl;
+    ssmsg << "Loaded [" << this->keyframes.Size() << "] keyframes."
+          << std::endl;
   }
+
+  this->visibility.Build(this->keyframes);
+  this->visibleKeyframe = -1;
+  this->eyePoses.Build(this->keyframes);
 }
 
 /////////////////////////////////////////////////
 bool simslides::Common::HandleKeyPress(int _key)
 {
-  if (this->keyframes.empty())
+  Command command;
+  if (!KeyToCommand(_key, command))
     return false;
 
+  command.received = std::chrono::steady_clock::now();
+  return this->Apply(command);
+}
+
+/////////////////////////////////////////////////
+bool simslides::Common::KeyToCommand(int _key, Command &_command)
+{
   // Next (right arrow on keyboard or presenter)
-  if ((_key == 16777236 || _key == 16777239) &&
-      this->currentKeyframe + 1 < this->keyframes.size())
-  {
-    this->currentKeyframe++;
-  }
+  if (_key == 16777236 || _key == 16777239)
+    _command = {CMD_NEXT, 0};
   // Previous (left arrow on keyboard or presenter)
-  else if ((_key == 16777234 || _key == 16777238) &&
-      this->currentKeyframe >= 1)
-  {
-    this->currentKeyframe--;
-  }
+  else if (_key == 16777234 || _key == 16777238)
+    _command = {CMD_PREVIOUS, 0};
   // Current (F1)
   else if (_key == 16777264 || _key == 16777304)
-  {
-    // replay current frame
-  }
+    _command = {CMD_REPLAY, 0};
   // Home (F6)
   else if (_key == 16777269 || _key == 16777422)
-  {
-    this->currentKeyframe = -1;
-  }
+    _command = {CMD_HOME, 0};
   else
     return false;
 
@@ -85,107 +183,267 @@ bool simslides::Common::HandleKeyPress(int _key)
 }
 
 /////////////////////////////////////////////////
-void simslides::Common::ChangeKeyframe(int _keyframe)
+bool simslides::Common::PushKey(int _key)
 {
-  if (this->keyframes.empty())
-    return;
+  Command command;
+  if (!KeyToCommand(_key, command))
+    return false;
 
-  if (_keyframe > this->keyframes.size())
-    this->currentKeyframe = this->keyframes.size() - 1;
-  else
-    this->currentKeyframe = _keyframe;
+  this->commands.Push(command);
+  return true;
 }
 
 /////////////////////////////////////////////////
-void simslides::Common::Update()
+bool simslides::Common::ProcessCommands()
 {
-  // Reset presentation
-  if (this->currentKeyframe < 0)
+  bool applied{false};
+  Command command;
+  while (this->commands.Pop(command))
   {
-    this->Common::Instance()->ResetCameraPose();
-    return;
+    if (this->Apply(command))
+      applied = true;
   }
+  return applied;
+}
+
+/////////////////////////////////////////////////
+bool simslides::Common::Apply(const Command &_command)
+{
+  if (this->keyframes.Empty())
+    return false;
 
-  // Do nothing
-  if (this->currentKeyframe >= this->keyframes.size())
+  switch (_command.type)
   {
-    return;
+    case CMD_NEXT:
+      if (this->currentKeyframe + 1 >= this->keyframes.Size())
+        return false;
+      this->currentKeyframe++;
+      break;
+    case CMD_PREVIOUS:
+      if (this->currentKeyframe < 1)
+        return false;
+      this->currentKeyframe--;
+      break;
+    case CMD_GOTO:
+      this->ChangeKeyframe(_command.keyframe);
+      break;
+    case CMD_HOME:
+      this->currentKeyframe = -1;
+      break;
+    case CMD_REPLAY:
+      break;
+    case CMD_GOTO_LABEL:
+    {
+      std::size_t index;
+      if (!this->keyframes.FindLabel(_command.target, index))
+      {
+        sswarn << "No keyframe with label [" << _command.target << "]"
+               << std::endl;
+        return false;
+      }
+      this->currentKeyframe = static_cast<int>(index);
+      break;
+    }
+    case CMD_GOTO_VISUAL:
+    {
+      std::size_t index;
+      if (!this->keyframes.FindVisual(_command.target, index))
+      {
+        sswarn << "No keyframe with visual [" << _command.target << "]"
+               << std::endl;
+        return false;
+      }
+      this->currentKeyframe = static_cast<int>(index);
+      break;
+    }
+    case CMD_PLAY:
+      this->autoplay.Play(Autoplay::Clock::now());
+      return false;
+    case CMD_PAUSE:
+      this->autoplay.Pause(Autoplay::Clock::now());
+      return false;
+    case CMD_LOOP:
+      this->autoplay.SetLoop(true);
+      return false;
+    case CMD_NO_LOOP:
+      this->autoplay.SetLoop(false);
+      return false;
   }
 
-  auto keyframe = this->keyframes[this->currentKeyframe];
+  if (_command.received != std::chrono::steady_clock::time_point())
+    this->metrics.Received(_command.received);
+
+  return true;
+}
 
-  // Set text
-  this->Common::Instance()->SetText(keyframe->Text());
+/////////////////////////////////////////////////
+bool simslides::Common::PollAutoplay()
+{
+  auto now = Autoplay::Clock::now();
+  if (!this->autoplay.Due(now) || this->keyframes.Empty())
+    return false;
 
-  // Log seek
-  if (keyframe->GetType() == KeyframeType::LOG_SEEK)
+  auto next = this->currentKeyframe + 1;
+  if (next >= static_cast<int>(this->keyframes.Size()))
   {
-    this->Common::Instance()->MoveCamera(keyframe->CamPose());
-    this->Common::Instance()->SeekLog(keyframe->LogSeek());
-    return;
+    if (!this->autoplay.Loop())
+    {
+      this->autoplay.Pause(now);
+      return false;
+    }
+    next = 0;
   }
 
-  // Cam pose
-  if (keyframe->GetType() == KeyframeType::CAM_POSE)
+  this->currentKeyframe = next;
+  this->autoplay.Advance(next, this->Dwell(next), now);
+  return true;
+}
+
+/////////////////////////////////////////////////
+simslides::Autoplay::Clock::duration simslides::Common::Dwell(
+    int _keyframe) const
+{
+  if (_keyframe < 0 || _keyframe >= static_cast<int>(this->keyframes.Size()))
+    return this->autoplay.DefaultDwell();
+
+  auto dwell = this->keyframes.Dwell(_keyframe);
+  if (std::isnan(dwell))
+    return this->autoplay.DefaultDwell();
+
+  return std::chrono::duration_cast<Autoplay::Clock::duration>(
+      std::chrono::duration<double>(dwell));
+}
+
+/////////////////////////////////////////////////
+void simslides::Common::ChangeKeyframe(int _keyframe)
+{
+  if (this->keyframes.Empty())
+    return;
+
+  if (_keyframe > this->keyframes.Size())
+    this->currentKeyframe = this->keyframes.Size() - 1;
+  else
+    this->currentKeyframe = _keyframe;
+}
+
+/////////////////////////////////////////////////
+bool simslides::Common::RequestUpdate()
+{
+  if (!this->coalescer.Request(std::chrono::steady_clock::now()))
+    return false;
+
+  this->Update();
+  return true;
+}
+
+/////////////////////////////////////////////////
+bool simslides::Common::PollUpdate()
+{
+  if (!this->coalescer.Poll(std::chrono::steady_clock::now()))
+    return false;
+
+  this->Update();
+  return true;
+}
+
+/////////////////////////////////////////////////
+void simslides::Common::Update()
+{
+  if (nullptr == this->backend)
   {
-    this->Common::Instance()->MoveCamera(keyframe->CamPose());
+    sserr << "No backend set, can't update the presentation." << std::endl;
     return;
   }
 
-  // Look at
-  if (keyframe->GetType() == KeyframeType::LOOKAT ||
-      keyframe->GetType() == KeyframeType::STACK)
-  {
-    // Target in world frame
-    auto origin = this->Common::Instance()->VisualPose(keyframe->Visual());
+  this->Update(*this->backend);
+}
+
+/////////////////////////////////////////////////
+void simslides::Common::ExportMetrics(bool _force)
+{
+  if (this->metricsWritten == this->metrics.Version())
+    return;
 
-    auto bbPos = origin.Pos() + ignition::math::Vector3d(0, 0, 0.5);
-    auto targetWorld = ignition::math::Matrix4d(ignition::math::Pose3d(
-        bbPos, origin.Rot()));
+  auto now = TransitionMetrics::Clock::now();
+  if (!_force && now - this->metricsWriteTime < kMetricsInterval)
+    return;
 
-    // Eye in target frame
-    auto offset = keyframe->EyeOffset();
-    if (offset == ignition::math::Pose3d::Zero)
-    {
-      offset = this->kEyeOffset;
-    }
-    ignition::math::Matrix4d eyeTarget(offset);
+  // Don't retry every frame if the file can't be written
+  this->metricsWritten = this->metrics.Version();
+  this->metricsWriteTime = now;
+  this->metricsExporter.Submit(this->metrics, this->metricsFile);
+}
 
-    // Eye in world frame
-    auto eyeWorld = targetWorld * eyeTarget;
+/////////////////////////////////////////////////
+void simslides::Common::SetBackend(Backend *_backend)
+{
+  this->backend = _backend;
+}
 
-    // Look At
-    auto mat = ignition::math::Matrix4d::LookAt(eyeWorld.Translation(),
-        targetWorld.Translation());
+/////////////////////////////////////////////////
+simslides::Backend *simslides::Common::CurrentBackend() const
+{
+  return this->backend;
+}
 
-    this->MoveCamera(mat.Pose());
-  }
+/////////////////////////////////////////////////
+ignition::math::Pose3d simslides::Common::EyePose(
+    const ignition::math::Pose3d &_target,
+    const ignition::math::Pose3d &_eyeOffset) const
+{
+  auto bbPos = _target.Pos() + ignition::math::Vector3d(0, 0, 0.5);
+  auto targetWorld = ignition::math::Matrix4d(ignition::math::Pose3d(
+      bbPos, _target.Rot()));
 
-  // Set stack visibility
-  if (keyframe->GetType() == KeyframeType::STACK)
+  // Eye in target frame
+  auto offset = _eyeOffset;
+  if (offset == ignition::math::Pose3d::Zero)
   {
-    auto frontKeyframe = this->currentKeyframe;
-    while (frontKeyframe > 0 &&
-        this->keyframes[frontKeyframe-1]->GetType() == KeyframeType::STACK)
-    {
-      frontKeyframe--;
-    }
+    offset = this->kEyeOffset;
+  }
+  ignition::math::Matrix4d eyeTarget(offset);
 
-    auto backKeyframe = this->currentKeyframe;
-    while (backKeyframe + 1 < this->keyframes.size() &&
-        this->keyframes[backKeyframe+1]->GetType() == KeyframeType::STACK)
-    {
-      backKeyframe++;
-    }
+  // Eye in world frame
+  auto eyeWorld = targetWorld * eyeTarget;
+
+  // Look At
+  auto mat = ignition::math::Matrix4d::LookAt(eyeWorld.Translation(),
+      targetWorld.Translation());
+  return mat.Pose();
+}
+
+/////////////////////////////////////////////////
+void simslides::Common::VisualMoved(const std::string &_name)
+{
+  this->eyePoses.Invalidate(_name);
+}
+
+/////////////////////////////////////////////////
+void simslides::Common::VisualMoved(uint32_t _id)
+{
+  this->eyePoses.Invalidate(_id);
+}
 
-    std::cout << "Stack front [" << frontKeyframe << "], back [" << backKeyframe
-              << "]" << std::endl;
+/////////////////////////////////////////////////
+void simslides::Common::VisualResolved(uint32_t _id,
+    const ignition::math::Pose3d &_pose)
+{
+  if (_id == 0 || _id >= this->keyframes.VisualCount())
+    return;
+
+  // The visual may have moved before it was found, so check its compiled
+  // poses against where it actually is
+  const auto &name = this->keyframes.VisualName(_id);
+  for (auto index : this->keyframes.VisualKeyframes(name))
+  {
+    ignition::math::Pose3d compiled;
+    if (!this->keyframes.EyePose(index, compiled))
+      continue;
 
-    for (int i = frontKeyframe; i <= backKeyframe; ++i)
+    if (compiled != this->EyePose(_pose, this->keyframes.EyeOffset(index)))
     {
-      auto name = this->keyframes[i]->Visual();
-      this->SetVisualVisible(name, name == keyframe->Visual());
+      this->VisualMoved(_id);
+      return;
     }
   }
-
 }
@@ -0,0 +1,155 @@
+/*
+ * Copyright 2017 Louise Poubel
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+#include <filesystem>
+#include <iostream>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <sdf/parser.hh>
+#include <sdf/SDFImpl.hh>
+
+#include "include/simslides/common/Common.hh"
+#include "include/simslides/common/DeckFile.hh"
+#include "include/simslides/common/KeyframeTable.hh"
+#include "include/simslides/common/World.hh"
+
+using namespace simslides;
+
+/////////////////////////////////////////////////
+int main(int argc, char **argv)
+{
+  if (argc < 3)
+  {
+    std::cerr << "Usage: simslides_compile <world file> <output deck> "
+              << "[plugin name or filename]" << std::endl << std::endl
+              << "Compile the keyframes of a SimSlides GUI plugin into a "
+              << "binary deck, which" << std::endl
+              << "can be loaded with <deck_file>. Camera poses looking at "
+              << "static models are" << std::endl
+              << "precomputed from the world file, so they don't need to be "
+              << "looked up in the" << std::endl
+              << "scene while presenting." << std::endl;
+    return 1;
+  }
+
+  std::string worldFile(argv[1]);
+  std::string deckFile(argv[2]);
+  std::string plugin(argc > 3 ? argv[3] : "");
+
+  auto sdfParsed = std::make_shared<sdf::SDF>();
+  sdf::init(sdfParsed);
+  if (!sdf::readFile(worldFile, sdfParsed))
+  {
+    std::cerr << "Failed to parse [" << worldFile << "]" << std::endl;
+    return 1;
+  }
+
+  auto pluginElem = FindPlugin(sdfParsed->Root(), plugin);
+  if (nullptr == pluginElem)
+  {
+    std::cerr << "No GUI plugin with keyframes found in [" << worldFile
+              << "]" << std::endl;
+    return 1;
+  }
+
+  // Recompile an existing deck, or parse <keyframe>s
+  KeyframeTable keyframes;
+  if (pluginElem->HasElement("deck_file"))
+  {
+    auto inputDeck = pluginElem->Get<std::string>("deck_file");
+    if (!std::filesystem::exists(inputDeck))
+    {
+      auto found = sdf::findFile(inputDeck);
+      if (!found.empty())
+        inputDeck = found;
+    }
+
+    // The output is written in place, and the input deck is read from its
+    // mapping unless a camera pose was precomputed, which copies it
+    std::error_code ec;
+    if (std::filesystem::equivalent(inputDeck, deckFile, ec))
+    {
+      std::cerr << "Output deck must be different from the input deck ["
+                << inputDeck << "]" << std::endl;
+      return 1;
+    }
+
+    std::string error;
+    if (!DeckFile::Load(inputDeck, keyframes, error))
+    {
+      std::cerr << "Failed to load deck [" << inputDeck << "]: " << error
+                << std::endl;
+      return 1;
+    }
+  }
+  else
+  {
+    std::vector<std::string> errors;
+    if (!keyframes.AddAll(pluginElem, errors))
+    {
+      for (const auto &error : errors)
+        std::cerr << error << std::endl;
+    }
+  }
+
+  // Only static models are resolved, others may move while presenting
+  std::set<std::string> unresolved;
+  auto poses = EntityPoses(sdfParsed->Root(), true, unresolved);
+  for (const auto &name : unresolved)
+  {
+    std::cerr << "Pose of [" << name << "] is relative to another frame, "
+              << "which isn't supported. It will be looked up while "
+              << "presenting." << std::endl;
+  }
+
+  std::size_t resolved{0};
+  std::set<std::string> live;
+  for (std::size_t i = 0; i < keyframes.Size(); ++i)
+  {
+    auto type = keyframes.Type(i);
+    if (type != KeyframeType::LOOKAT && type != KeyframeType::STACK)
+      continue;
+
+    auto it = poses.find(keyframes.Visual(i));
+    if (it == poses.end())
+    {
+      live.insert(keyframes.Visual(i));
+      continue;
+    }
+
+    keyframes.SetEyePose(i,
+        Common::Instance()->EyePose(it->second, keyframes.EyeOffset(i)));
+    ++resolved;
+  }
+
+  if (!DeckFile::Save(keyframes, deckFile))
+    return 1;
+
+  std::cout << "Compiled [" << keyframes.Size() << "] keyframes to ["
+            << deckFile << "], precomputed [" << resolved
+            << "] camera poses." << std::endl;
+
+  if (!live.empty())
+  {
+    std::cout << "These visuals aren't static models in the world, and "
+              << "will be looked up while presenting:" << std::endl;
+    for (const auto &name : live)
+      std::cout << "  " << name << std::endl;
+  }
+
+  return 0;
+}
@@ -0,0 +1,260 @@
+/*
+ * Copyright 2017 Louise Poubel
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+#include <png.h>
+
+#include <algorithm>
+#include <atomic>
+#include <csetjmp>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "include/simslides/common/TextureEncoder.hh"
+
+using namespace simslides;
+
+namespace
+{
+  /// \brief Load a PNG as 8-bit RGBA, whatever its bit depth and color
+  /// type.
+  /// \param[in] _path PNG file.
+  /// \param[out] _image Pixels.
+  /// \return False if the file can't be read or isn't a PNG.
+  bool LoadPng(const std::filesystem::path &_path, RgbaImage &_image)
+  {
+    auto file = std::fopen(_path.c_str(), "rb");
+    if (!file)
+      return false;
+
+    auto png = png_create_read_struct(PNG_LIBPNG_VER_STRING, nullptr,
+        nullptr, nullptr);
+    auto info = png ? png_create_info_struct(png) : nullptr;
+    std::vector<png_bytep> rows;
+    if (!info || setjmp(png_jmpbuf(png)))
+    {
+      png_destroy_read_struct(&png, &info, nullptr);
+      std::fclose(file);
+      return false;
+    }
+
+    png_init_io(png, file);
+    png_read_info(png, info);
+
+    png_set_strip_16(png);
+    png_set_packing(png);
+    png_set_palette_to_rgb(png);
+    png_set_expand_gray_1_2_4_to_8(png);
+    png_set_tRNS_to_alpha(png);
+    png_set_gray_to_rgb(png);
+    png_set_add_alpha(png, 0xFF, PNG_FILLER_AFTER);
+    png_set_interlace_handling(png);
+    png_read_update_info(png, info);
+
+    _image.width = png_get_image_width(png, info);
+    _image.height = png_get_image_height(png, info);
+    _image.pixels.resize(4u * _image.width * _image.height);
+
+    rows.resize(_image.height);
+    for (uint32_t y = 0; y < _image.height; ++y)
+      rows[y] = &_image.pixels[4u * y * _image.width];
+    png_read_image(png, rows.data());
+    png_read_end(png, nullptr);
+
+    png_destroy_read_struct(&png, &info, nullptr);
+    std::fclose(file);
+    return true;
+  }
+
+  /// \brief Point material scripts and SDF files at the DDS textures
+  /// instead of the PNGs.
+  /// \param[in] _path File to update, replaced atomically.
+  /// \param[in] _textures Texture file names, without extension.
+  /// \return False if the file couldn't be rewritten.
+  bool Retarget(const std::filesystem::path &_path,
+      const std::vector<std::string> &_textures)
+  {
+    std::string text;
+    {
+      std::ifstream in(_path);
+      std::ostringstream buffer;
+      buffer << in.rdbuf();
+      text = buffer.str();
+    }
+
+    auto original = text;
+    auto replace = [&](const std::string &_from, const std::string &_to)
+    {
+      for (auto pos = text.find(_from); pos != std::string::npos;
+          pos = text.find(_from, pos + _to.size()))
+      {
+        text.replace(pos, _from.size(), _to);
+      }
+    };
+
+    for (const auto &texture : _textures)
+      replace(texture + ".png", texture + TextureEncoder::kExtension);
+
+    // Older importers misspelled this, so Ogre ignored it
+    replace("filtering anistropic", "filtering anisotropic");
+
+    if (text == original)
+      return true;
+
+    auto tmp = _path;
+    tmp += ".tmp";
+    {
+      std::ofstream out(tmp, std::ios::trunc);
+      out << text;
+      if (!out)
+        return false;
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tmp, _path, ec);
+    return !ec;
+  }
+}
+
+/////////////////////////////////////////////////
+int main(int argc, char **argv)
+{
+  if (argc < 2)
+  {
+    std::cerr << "Usage: simslides_compress_textures <model directory>..."
+              << std::endl << std::endl
+              << "Encode the PNG textures of slide models into compressed, "
+              << "mipmapped DDS" << std::endl
+              << "files, and point the models' materials at them. PNGs are "
+              << "kept. Models" << std::endl
+              << "compressed before are only updated if their PNGs changed."
+              << std::endl;
+    return 1;
+  }
+
+  // Textures to encode, and the models they belong to
+  std::vector<std::filesystem::path> models;
+  std::vector<std::filesystem::path> textures;
+  for (int i = 1; i < argc; ++i)
+  {
+    std::filesystem::path model(argv[i]);
+    auto dir = model / "materials" / "textures";
+    std::error_code ec;
+    if (!std::filesystem::is_directory(dir, ec))
+    {
+      std::cerr << "No textures in [" << model << "], skipping" << std::endl;
+      continue;
+    }
+
+    models.push_back(model);
+    for (std::filesystem::directory_iterator it(dir, ec), end;
+        !ec && it != end; it.increment(ec))
+    {
+      if (it->path().extension() == ".png")
+        textures.push_back(it->path());
+    }
+  }
+
+  // Textures are independent, so they're encoded one per core
+  std::atomic<std::size_t> next{0};
+  std::atomic<int> failed{0};
+  std::atomic<int> encoded{0};
+  std::mutex outMutex;
+  auto worker = [&]
+  {
+    for (auto i = next++; i < textures.size(); i = next++)
+    {
+      const auto &png = textures[i];
+      auto dds = png;
+      dds.replace_extension(TextureEncoder::kExtension);
+
+      std::error_code ec;
+      if (std::filesystem::exists(dds, ec) &&
+          std::filesystem::last_write_time(dds, ec) >=
+          std::filesystem::last_write_time(png, ec) && !ec)
+      {
+        continue;
+      }
+
+      RgbaImage image;
+      if (!LoadPng(png, image) || !TextureEncoder::Write(image, dds))
+      {
+        std::lock_guard<std::mutex> lock(outMutex);
+        std::cerr << "Failed to encode [" << png << "]" << std::endl;
+        ++failed;
+        continue;
+      }
+
+      ++encoded;
+      std::lock_guard<std::mutex> lock(outMutex);
+      std::cout << "Encoded [" << dds << "]" << std::endl;
+    }
+  };
+
+  std::vector<std::thread> workers;
+  auto threadCount = std::max(1u, std::thread::hardware_concurrency());
+  for (unsigned int i = 0; i < threadCount; ++i)
+    workers.emplace_back(worker);
+  for (auto &thread : workers)
+    thread.join();
+
+  // Only point materials at textures which were encoded
+  for (const auto &model : models)
+  {
+    std::vector<std::string> names;
+    std::error_code ec;
+    for (std::filesystem::directory_iterator
+        it(model / "materials" / "textures", ec), end;
+        !ec && it != end; it.increment(ec))
+    {
+      if (it->path().extension() != ".png")
+        continue;
+
+      auto dds = it->path();
+      dds.replace_extension(TextureEncoder::kExtension);
+      std::error_code existsEc;
+      if (std::filesystem::exists(dds, existsEc))
+        names.push_back(it->path().stem().string());
+    }
+
+    std::vector<std::filesystem::path> files{model / "model.sdf"};
+    for (std::filesystem::directory_iterator
+        it(model / "materials" / "scripts", ec), end;
+        !ec && it != end; it.increment(ec))
+    {
+      if (it->path().extension() == ".material")
+        files.push_back(it->path());
+    }
+
+    for (const auto &file : files)
+    {
+      if (std::filesystem::exists(file) && !Retarget(file, names))
+      {
+        std::cerr << "Failed to update [" << file << "]" << std::endl;
+        ++failed;
+      }
+    }
+  }
+
+  std::cout << "Encoded [" << encoded << "] of [" << textures.size()
+            << "] textures in [" << models.size() << "] models" << std::endl;
+  return failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,382 @@
+/*
+ * Copyright 2017 Louise Poubel
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#include "include/simslides/common/DeckFile.hh"
+#include "include/simslides/common/Log.hh"
+
+using namespace simslides;
+
+namespace
+{
+  /// \brief Value used to detect files written with another byte order.
+  constexpr uint32_t kByteOrderMark{0x01020304};
+
+  /// \brief Fixed header at the start of every deck file.
+  struct Header
+  {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint64_t keyframeCount;
+    uint64_t stackCount;
+    uint64_t visualCount;
+    uint64_t textCount;
+    uint64_t textFileCount;
+    uint64_t labelCount;
+    uint64_t stringBytes;
+  };
+
+  /// \brief Byte offset of each section, derived from the header counts.
+  struct Layout
+  {
+    uint64_t types;
+    uint64_t slideNumbers;
+    uint64_t visuals;
+    uint64_t texts;
+    uint64_t textFiles;
+    uint64_t labels;
+    uint64_t eyeOffsets;
+    uint64_t camPoses;
+    uint64_t eyePoses;
+    uint64_t logSeeks;
+    uint64_t transitions;
+    uint64_t dwells;
+    uint64_t stackIds;
+    uint64_t stacks;
+    uint64_t visualOffsets;
+    uint64_t textOffsets;
+    uint64_t textFileOffsets;
+    uint64_t labelOffsets;
+    uint64_t strings;
+    uint64_t end;
+  };
+
+  /// \brief Round up to the next multiple of 8.
+  uint64_t Align(uint64_t _offset)
+  {
+    return (_offset + 7) & ~uint64_t{7};
+  }
+
+  /// \brief Compute where each section starts.
+  Layout ComputeLayout(const Header &_header)
+  {
+    auto n = _header.keyframeCount;
+    auto poses = n * KeyframeTable::kPoseSize * sizeof(double);
+
+    Layout layout;
+    layout.types = Align(sizeof(Header));
+    layout.slideNumbers = Align(layout.types + n * sizeof(uint8_t));
+    layout.visuals = Align(layout.slideNumbers + n * sizeof(int32_t));
+    layout.texts = Align(layout.visuals + n * sizeof(uint32_t));
+    layout.textFiles = Align(layout.texts + n * sizeof(uint32_t));
+    layout.labels = Align(layout.textFiles + n * sizeof(uint32_t));
+    layout.eyeOffsets = Align(layout.labels + n * sizeof(uint32_t));
+    layout.camPoses = Align(layout.eyeOffsets + poses);
+    layout.eyePoses = Align(layout.camPoses + poses);
+    layout.logSeeks = Align(layout.eyePoses + poses);
+    layout.transitions = Align(layout.logSeeks + n * sizeof(int64_t));
+    layout.dwells = Align(layout.transitions + n * sizeof(double));
+    layout.stackIds = Align(layout.dwells + n * sizeof(double));
+    layout.stacks = Align(layout.stackIds + n * sizeof(uint32_t));
+    layout.visualOffsets = Align(layout.stacks +
+        _header.stackCount * sizeof(StackRange));
+    layout.textOffsets = Align(layout.visualOffsets +
+        (_header.visualCount + 1) * sizeof(uint64_t));
+    layout.textFileOffsets = Align(layout.textOffsets +
+        (_header.textCount + 1) * sizeof(uint64_t));
+    layout.labelOffsets = Align(layout.textFileOffsets +
+        (_header.textFileCount + 1) * sizeof(uint64_t));
+    layout.strings = Align(layout.labelOffsets +
+        (_header.labelCount + 1) * sizeof(uint64_t));
+    layout.end = layout.strings + _header.stringBytes;
+    return layout;
+  }
+
+  /// \brief Write an array at a given offset, zero-padding up to it.
+  void WriteAt(std::ofstream &_out, uint64_t _offset, const void *_data,
+      uint64_t _bytes)
+  {
+    static const char zeros[8] = {0};
+    auto pos = static_cast<uint64_t>(_out.tellp());
+    if (pos < _offset)
+      _out.write(zeros, static_cast<std::streamsize>(_offset - pos));
+    if (_bytes > 0)
+      _out.write(static_cast<const char *>(_data),
+          static_cast<std::streamsize>(_bytes));
+  }
+
+  /// \brief Write a string pool's offsets, and append its strings to a blob.
+  std::vector<uint64_t> PoolOffsets(const std::vector<std::string> &_pool,
+      std::string &_blob)
+  {
+    std::vector<uint64_t> offsets;
+    offsets.reserve(_pool.size() + 1);
+    for (const auto &str : _pool)
+    {
+      offsets.push_back(_blob.size());
+      _blob += str;
+    }
+    offsets.push_back(_blob.size());
+    return offsets;
+  }
+
+  /// \brief Read a string pool from its offsets into the blob.
+  bool ReadPool(const uint64_t *_offsets, uint64_t _count,
+      const char *_blob, uint64_t _blobSize, std::vector<std::string> &_pool)
+  {
+    _pool.clear();
+    _pool.reserve(_count);
+    for (uint64_t i = 0; i < _count; ++i)
+    {
+      if (_offsets[i] > _offsets[i + 1] || _offsets[i + 1] > _blobSize)
+        return false;
+      _pool.emplace_back(_blob + _offsets[i], _offsets[i + 1] - _offsets[i]);
+    }
+    return _count > 0 && _pool[0].empty();
+  }
+}
+
+/////////////////////////////////////////////////
+bool DeckFile::Save(const KeyframeTable &_keyframes, const std::string &_path)
+{
+  const auto &view = _keyframes.view;
+
+  std::string blob;
+  auto visualOffsets = PoolOffsets(_keyframes.visualNames, blob);
+  auto textOffsets = PoolOffsets(_keyframes.textPool, blob);
+  auto textFileOffsets = PoolOffsets(_keyframes.textFileNames, blob);
+  auto labelOffsets = PoolOffsets(_keyframes.labelNames, blob);
+
+  Header header;
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kVersion;
+  header.byteOrder = kByteOrderMark;
+  header.keyframeCount = view.size;
+  header.stackCount = view.stackCount;
+  header.visualCount = _keyframes.visualNames.size();
+  header.textCount = _keyframes.textPool.size();
+  header.textFileCount = _keyframes.textFileNames.size();
+  header.labelCount = _keyframes.labelNames.size();
+  header.stringBytes = blob.size();
+
+  auto layout = ComputeLayout(header);
+  auto n = header.keyframeCount;
+  auto poses = n * KeyframeTable::kPoseSize * sizeof(double);
+
+  std::ofstream out(_path, std::ios::out | std::ios::binary |
+      std::ios::trunc);
+  if (!out)
+  {
+    sserr << "Failed to open deck file [" << _path << "] for writing"
+          << std::endl;
+    return false;
+  }
+
+  WriteAt(out, 0, &header, sizeof(header));
+  WriteAt(out, layout.types, view.types, n * sizeof(uint8_t));
+  WriteAt(out, layout.slideNumbers, view.slideNumbers, n * sizeof(int32_t));
+  WriteAt(out, layout.visuals, view.visuals, n * sizeof(uint32_t));
+  WriteAt(out, layout.texts, view.texts, n * sizeof(uint32_t));
+  WriteAt(out, layout.textFiles, view.textFiles, n * sizeof(uint32_t));
+  WriteAt(out, layout.labels, view.labels, n * sizeof(uint32_t));
+  WriteAt(out, layout.eyeOffsets, view.eyeOffsets, poses);
+  WriteAt(out, layout.camPoses, view.camPoses, poses);
+  WriteAt(out, layout.eyePoses, view.eyePoses, poses);
+  WriteAt(out, layout.logSeeks, view.logSeeks, n * sizeof(int64_t));
+  WriteAt(out, layout.transitions, view.transitions, n * sizeof(double));
+  WriteAt(out, layout.dwells, view.dwells, n * sizeof(double));
+  WriteAt(out, layout.stackIds, view.stackIds, n * sizeof(uint32_t));
+  WriteAt(out, layout.stacks, view.stacks,
+      header.stackCount * sizeof(StackRange));
+  WriteAt(out, layout.visualOffsets, visualOffsets.data(),
+      visualOffsets.size() * sizeof(uint64_t));
+  WriteAt(out, layout.textOffsets, textOffsets.data(),
+      textOffsets.size() * sizeof(uint64_t));
+  WriteAt(out, layout.textFileOffsets, textFileOffsets.data(),
+      textFileOffsets.size() * sizeof(uint64_t));
+  WriteAt(out, layout.labelOffsets, labelOffsets.data(),
+      labelOffsets.size() * sizeof(uint64_t));
+  WriteAt(out, layout.strings, blob.data(), blob.size());
+
+  if (!out)
+  {
+    sserr << "Failed to write deck file [" << _path << "]" << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+/////////////////////////////////////////////////
+bool DeckFile::Load(const std::string &_path, KeyframeTable &_keyframes,
+    std::string &_error)
+{
+  _keyframes.Clear();
+
+  int fd = open(_path.c_str(), O_RDONLY);
+  if (fd < 0)
+  {
+    _error = std::string("can't open it: ") + std::strerror(errno);
+    return false;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 ||
+      static_cast<uint64_t>(st.st_size) < sizeof(Header))
+  {
+    _error = "it's too small to be a deck file";
+    close(fd);
+    return false;
+  }
+
+  auto size = static_cast<std::size_t>(st.st_size);
+  void *addr = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (addr == MAP_FAILED)
+  {
+    _error = "can't map it into memory";
+    return false;
+  }
+
+  std::shared_ptr<const void> mapping(addr, [size](const void *_addr)
+  {
+    munmap(const_cast<void *>(_addr), size);
+  });
+
+  const auto *base = static_cast<const char *>(addr);
+  Header header;
+  std::memcpy(&header, base, sizeof(header));
+
+  if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 ||
+      header.byteOrder != kByteOrderMark)
+  {
+    _error = "it's not a deck file, or was written on a machine with a "
+        "different byte order";
+    return false;
+  }
+
+  if (header.version != kVersion)
+  {
+    _error = "it has version [" + std::to_string(header.version) +
+        "], expected [" + std::to_string(kVersion) + "]. Export it again.";
+    return false;
+  }
+
+  // Counts can't exceed the file size, which also keeps the layout from
+  // overflowing
+  if (header.keyframeCount > size || header.stackCount > size ||
+      header.visualCount > size || header.textCount > size ||
+      header.textFileCount > size || header.labelCount > size ||
+      header.stringBytes > size)
+  {
+    _error = "its header is corrupt";
+    return false;
+  }
+
+  auto layout = ComputeLayout(header);
+  if (layout.end != size || header.visualCount == 0 ||
+      header.textCount == 0 || header.textFileCount == 0 ||
+      header.labelCount == 0)
+  {
+    _error = "its size doesn't match its header";
+    return false;
+  }
+
+  // Strings are the only data copied out of the file
+  if (!ReadPool(reinterpret_cast<const uint64_t *>(base + layout.visualOffsets),
+        header.visualCount, base + layout.strings, header.stringBytes,
+        _keyframes.visualNames) ||
+      !ReadPool(reinterpret_cast<const uint64_t *>(base + layout.textOffsets),
+        header.textCount, base + layout.strings, header.stringBytes,
+        _keyframes.textPool) ||
+      !ReadPool(
+        reinterpret_cast<const uint64_t *>(base + layout.textFileOffsets),
+        header.textFileCount, base + layout.strings, header.stringBytes,
+        _keyframes.textFileNames) ||
+      !ReadPool(
+        reinterpret_cast<const uint64_t *>(base + layout.labelOffsets),
+        header.labelCount, base + layout.strings, header.stringBytes,
+        _keyframes.labelNames))
+  {
+    _error = "it has corrupt strings";
+    _keyframes.Clear();
+    return false;
+  }
+
+  auto &view = _keyframes.view;
+  view.types = reinterpret_cast<const uint8_t *>(base + layout.types);
+  view.slideNumbers =
+      reinterpret_cast<const int32_t *>(base + layout.slideNumbers);
+  view.visuals = reinterpret_cast<const uint32_t *>(base + layout.visuals);
+  view.texts = reinterpret_cast<const uint32_t *>(base + layout.texts);
+  view.textFiles = reinterpret_cast<const uint32_t *>(base + layout.textFiles);
+  view.labels = reinterpret_cast<const uint32_t *>(base + layout.labels);
+  view.eyeOffsets = reinterpret_cast<const double *>(base + layout.eyeOffsets);
+  view.camPoses = reinterpret_cast<const double *>(base + layout.camPoses);
+  view.eyePoses = reinterpret_cast<const double *>(base + layout.eyePoses);
+  view.logSeeks = reinterpret_cast<const int64_t *>(base + layout.logSeeks);
+  view.transitions =
+      reinterpret_cast<const double *>(base + layout.transitions);
+  view.dwells = reinterpret_cast<const double *>(base + layout.dwells);
+  view.stackIds = reinterpret_cast<const uint32_t *>(base + layout.stackIds);
+  view.stacks = reinterpret_cast<const StackRange *>(base + layout.stacks);
+  view.size = header.keyframeCount;
+  view.stackCount = header.stackCount;
+
+  // Validate indices once, so lookups never go out of bounds
+  bool valid = true;
+  for (std::size_t i = 0; i < view.size && valid; ++i)
+  {
+    valid = view.types[i] <= static_cast<uint8_t>(KeyframeType::CAM_POSE) &&
+        view.visuals[i] < header.visualCount &&
+        view.texts[i] < header.textCount &&
+        view.textFiles[i] < header.textFileCount &&
+        view.labels[i] < header.labelCount &&
+        (view.stackIds[i] == KeyframeTable::kNoStack ||
+         view.stackIds[i] < header.stackCount);
+  }
+  for (std::size_t s = 0; s < view.stackCount && valid; ++s)
+  {
+    valid = view.stacks[s].front <= view.stacks[s].back &&
+        view.stacks[s].back < view.size;
+  }
+
+  if (!valid)
+  {
+    _error = "it has corrupt keyframes";
+    _keyframes.Clear();
+    return false;
+  }
+
+  // Lookups by label and visual must stay constant time, so only the text
+  // pools are left without maps
+  _keyframes.textIds.clear();
+  _keyframes.textFileIds.clear();
+  _keyframes.BuildIndexes();
+  _keyframes.mapping = mapping;
+  ++_keyframes.version;
+
+  return true;
+}
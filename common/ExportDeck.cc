@@ -0,0 +1,76 @@
+/*
+ * Copyright 2017 Louise Poubel
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <sdf/parser.hh>
+#include <sdf/SDFImpl.hh>
+
+#include "include/simslides/common/DeckFile.hh"
+#include "include/simslides/common/KeyframeTable.hh"
+#include "include/simslides/common/World.hh"
+
+using namespace simslides;
+
+/////////////////////////////////////////////////
+int main(int argc, char **argv)
+{
+  if (argc < 3)
+  {
+    std::cerr << "Usage: simslides_export_deck <world file> <output deck> "
+              << "[plugin name or filename]" << std::endl << std::endl
+              << "Compile the <keyframe>s of a SimSlides GUI plugin into a "
+              << "binary deck, which" << std::endl
+              << "can be loaded with <deck_file>." << std::endl;
+    return 1;
+  }
+
+  std::string worldFile(argv[1]);
+  std::string deckFile(argv[2]);
+  std::string plugin(argc > 3 ? argv[3] : "");
+
+  auto sdfParsed = std::make_shared<sdf::SDF>();
+  sdf::init(sdfParsed);
+  if (!sdf::readFile(worldFile, sdfParsed))
+  {
+    std::cerr << "Failed to parse [" << worldFile << "]" << std::endl;
+    return 1;
+  }
+
+  auto pluginElem = FindPlugin(sdfParsed->Root(), plugin);
+  if (nullptr == pluginElem)
+  {
+    std::cerr << "No GUI plugin with keyframes found in [" << worldFile
+              << "]" << std::endl;
+    return 1;
+  }
+
+  KeyframeTable keyframes;
+  std::vector<std::string> errors;
+  if (!keyframes.AddAll(pluginElem, errors))
+  {
+    for (const auto &error : errors)
+      std::cerr << error << std::endl;
+  }
+
+  if (!DeckFile::Save(keyframes, deckFile))
+    return 1;
+
+  std::cout << "Exported [" << keyframes.Size() << "] keyframes to ["
+            << deckFile << "]" << std::endl;
+  return 0;
+}
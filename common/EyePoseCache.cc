@@ -0,0 +1,118 @@
+/*
+ * Copyright 2017 Louise Poubel
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+#include "include/simslides/common/EyePoseCache.hh"
+
+using namespace simslides;
+
+/////////////////////////////////////////////////
+void EyePoseCache::Build(const KeyframeTable &_keyframes)
+{
+  std::lock_guard<std::mutex> lock(this->mutex);
+
+  this->size = _keyframes.Size();
+  this->stamps.reset();
+  this->poses.reset();
+
+  this->visualCount = _keyframes.VisualCount();
+  this->visualStamps.reset(new std::atomic<uint64_t>[this->visualCount]);
+  this->visualIds.clear();
+  for (uint32_t id = 0; id < this->visualCount; ++id)
+  {
+    this->visualStamps[id].store(kInitialStamp, std::memory_order_relaxed);
+    this->visualIds[_keyframes.VisualName(id)] = id;
+  }
+}
+
+/////////////////////////////////////////////////
+bool EyePoseCache::Find(const KeyframeTable &_keyframes, std::size_t _index,
+    ignition::math::Pose3d &_pose, uint64_t &_stamp) const
+{
+  _stamp = 0;
+
+  if (_index >= this->size)
+    return false;
+
+  auto visual = _keyframes.VisualId(_index);
+  if (visual >= this->visualCount)
+    return false;
+
+  _stamp = this->visualStamps[visual].load(std::memory_order_acquire);
+  if (!this->stamps || this->stamps[_index] != _stamp)
+  {
+    // Until the visual moves, it's where the world file put it
+    return _stamp == kInitialStamp && _keyframes.EyePose(_index, _pose);
+  }
+
+  const double *p = &this->poses[_index * KeyframeTable::kPoseSize];
+  _pose = ignition::math::Pose3d(p[0], p[1], p[2], p[3], p[4], p[5], p[6]);
+  return true;
+}
+
+/////////////////////////////////////////////////
+void EyePoseCache::Store(std::size_t _index, uint64_t _stamp,
+    const ignition::math::Pose3d &_pose)
+{
+  if (_index >= this->size || _stamp == 0)
+    return;
+
+  if (!this->stamps)
+  {
+    this->stamps.reset(new uint64_t[this->size]());
+    this->poses.reset(new double[this->size * KeyframeTable::kPoseSize]);
+  }
+
+  double *p = &this->poses[_index * KeyframeTable::kPoseSize];
+  p[0] = _pose.Pos().X();
+  p[1] = _pose.Pos().Y();
+  p[2] = _pose.Pos().Z();
+  p[3] = _pose.Rot().W();
+  p[4] = _pose.Rot().X();
+  p[5] = _pose.Rot().Y();
+  p[6] = _pose.Rot().Z();
+  this->stamps[_index] = _stamp;
+}
+
+/////////////////////////////////////////////////
+void EyePoseCache::Invalidate(const std::string &_name)
+{
+  std::lock_guard<std::mutex> lock(this->mutex);
+
+  auto it = this->visualIds.find(_name);
+  if (it == this->visualIds.end())
+    return;
+
+  this->visualStamps[it->second].fetch_add(1, std::memory_order_release);
+}
+
+/////////////////////////////////////////////////
+void EyePoseCache::Invalidate(uint32_t _id)
+{
+  std::lock_guard<std::mutex> lock(this->mutex);
+
+  if (_id >= this->visualCount)
+    return;
+
+  this->visualStamps[_id].fetch_add(1, std::memory_order_release);
+}
+
+/////////////////////////////////////////////////
+void EyePoseCache::InvalidateAll()
+{
+  std::lock_guard<std::mutex> lock(this->mutex);
+
+  for (std::size_t id = 0; id < this->visualCount; ++id)
+    this->visualStamps[id].fetch_add(1, std::memory_order_release);
+}
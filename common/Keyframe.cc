@@ -13,193 +13,129 @@
  * See the License for the specific language governing permissions and
  * limitations under the License.
 */
-#include <iostream>
-#include <regex>
 #include <string>
 
 #include "include/simslides/common/Keyframe.hh"
+#include "include/simslides/common/KeyframeTable.hh"
 
 using namespace simslides;
 
-class simslides::KeyframePrivate
+/////////////////////////////////////////////////
+std::string simslides::KeyframeTypeToStr(KeyframeType _type)
 {
-  /// \brief Print keyframe info
-  public: void Print() const;
-
-  /// \brief Get type as string
-  public: std::string TypeToStr(KeyframeType _type) const;
+  if (_type == KeyframeType::LOOKAT)
+    return "lookat";
 
-  /// \brief Get type as enum
-  public: KeyframeType StrToType(const std::string &_type) const;
+  if (_type == KeyframeType::STACK)
+    return "stack";
 
-  /// \brief Type of this keyframe
-  public: KeyframeType type;
+  if (_type == KeyframeType::LOG_SEEK)
+    return "log_seek";
 
-  /// \brief Number of slide model
-  public: int slideNumber = -1;
+  if (_type == KeyframeType::CAM_POSE)
+    return "cam_pose";
 
-  /// \brief Name of visual that this keyframe is attached to
-  public: std::string visual;
+  return std::string();
+}
 
-  /// \brief Camera offset in LOOKAT slide frame
-  public: ignition::math::Pose3d eyeOffset;
+/////////////////////////////////////////////////
+KeyframeType simslides::StrToKeyframeType(const std::string &_type)
+{
+  if (_type == "lookat")
+    return KeyframeType::LOOKAT;
 
-  /// \brief Camera pose in world frame
-  public: ignition::math::Pose3d camPose;
+  if (_type == "stack")
+    return KeyframeType::STACK;
 
-  /// \brief Log time to seek to
-  public: std::chrono::steady_clock::duration logSeek;
+  if (_type == "log_seek")
+    return KeyframeType::LOG_SEEK;
 
-  /// \brief Text to display on dialog
-  public: std::string text;
-};
+  if (_type == "cam_pose")
+    return KeyframeType::CAM_POSE;
 
-/////////////////////////////////////////////////
-Keyframe::Keyframe(sdf::ElementPtr _sdf) : dataPtr(new KeyframePrivate)
-{
-  if (!_sdf)
-    return;
-
-  auto type = _sdf->Get<std::string>("type");
-  this->dataPtr->type = this->dataPtr->StrToType(type);
-
-  if (_sdf->HasAttribute("eye_offset"))
-  {
-    this->dataPtr->eyeOffset = _sdf->Get<ignition::math::Pose3d>("eye_offset");
-  }
-  if (_sdf->HasAttribute("text"))
-  {
-    this->dataPtr->text = _sdf->Get<std::string>("text");
-
-    // When the user wants special characters like <> to be printed in
-    // QTextBrowser, we need these characters to be encoded. But SDF / TinyXml
-    // decodes them. Thus the need for an intermediate encoding :]
-    this->dataPtr->text = std::regex_replace(this->dataPtr->text,
-        std::regex("<<"), "&lt;");
-    this->dataPtr->text = std::regex_replace(this->dataPtr->text,
-        std::regex(">>"), "&gt;");
-  }
-  if (type == "stack")
-  {
-    this->dataPtr->slideNumber = _sdf->Get<int>("number");
-    this->dataPtr->visual = _sdf->Get<std::string>("visual");
-  }
-  else if (type == "lookat")
-  {
-    this->dataPtr->slideNumber = _sdf->Get<int>("number");
-    this->dataPtr->visual = _sdf->Get<std::string>("visual");
-  }
-  else if (type == "log_seek")
-  {
-    this->dataPtr->camPose = _sdf->Get<ignition::math::Pose3d>("cam_pose");
-    auto logSeek = _sdf->Get<sdf::Time>("time");
-    this->dataPtr->logSeek = std::chrono::seconds(logSeek.sec) +
-       std::chrono::nanoseconds(logSeek.nsec);
-  }
-  else if (type == "cam_pose")
-  {
-    this->dataPtr->camPose = _sdf->Get<ignition::math::Pose3d>("pose");
-  }
-  else
-  {
-    std::cerr << "Unsupported type [" << type << "]" << std::endl;
-  }
-
-  this->dataPtr->Print();
+  return KeyframeType::NONE;
 }
 
 /////////////////////////////////////////////////
-Keyframe::~Keyframe()
+Keyframe::Keyframe(const KeyframeTable &_table, std::size_t _index)
+  : table(&_table), index(_index)
 {
 }
 
 //////////////////////////////////////////////////
 KeyframeType Keyframe::GetType() const
 {
-  return this->dataPtr->type;
+  return this->table->Type(this->index);
 }
 
 //////////////////////////////////////////////////
 unsigned int Keyframe::SlideNumber() const
 {
-  return this->dataPtr->slideNumber;
+  return this->table->SlideNumber(this->index);
 }
 
 //////////////////////////////////////////////////
-std::string Keyframe::Visual() const
+const std::string &Keyframe::Visual() const
 {
-  return this->dataPtr->visual;
+  return this->table->Visual(this->index);
+}
+
+//////////////////////////////////////////////////
+uint32_t Keyframe::VisualId() const
+{
+  return this->table->VisualId(this->index);
 }
 
 //////////////////////////////////////////////////
 ignition::math::Pose3d Keyframe::CamPose() const
 {
-  return this->dataPtr->camPose;
+  return this->table->CamPose(this->index);
 }
 
 //////////////////////////////////////////////////
 ignition::math::Pose3d Keyframe::EyeOffset() const
 {
-  return this->dataPtr->eyeOffset;
+  return this->table->EyeOffset(this->index);
 }
 
 //////////////////////////////////////////////////
-std::chrono::steady_clock::duration Keyframe::LogSeek() const
+double Keyframe::Transition() const
 {
-  return this->dataPtr->logSeek;
+  return this->table->Transition(this->index);
 }
 
 //////////////////////////////////////////////////
-std::string Keyframe::Text() const
+double Keyframe::Dwell() const
 {
-  return this->dataPtr->text;
+  return this->table->Dwell(this->index);
 }
 
-/////////////////////////////////////////////////
-void KeyframePrivate::Print() const
+//////////////////////////////////////////////////
+std::chrono::steady_clock::duration Keyframe::LogSeek() const
 {
-  std::cout << "- Keyframe " << std::endl;
-  std::cout << "    Type : " << this->TypeToStr(this->type) << std::endl;
-  std::cout << "    Visual : " << this->visual << std::endl;
-  std::cout << "    Eye offset : " << this->eyeOffset << std::endl;
-  std::cout << "    Cam pose : " << this->camPose << std::endl;
-  std::cout << "    Log seek : " << this->logSeek.count() << std::endl;
-  std::cout << "    Text : " << this->text << std::endl;
+  return this->table->LogSeek(this->index);
 }
 
-/////////////////////////////////////////////////
-std::string KeyframePrivate::TypeToStr(KeyframeType _type) const
+//////////////////////////////////////////////////
+const std::string &Keyframe::Text() const
 {
-  if (_type == KeyframeType::LOOKAT)
-    return "lookat";
-
-  if (_type == KeyframeType::STACK)
-    return "stack";
-
-  if (_type == KeyframeType::LOG_SEEK)
-    return "log_seek";
-
-  if (_type == KeyframeType::CAM_POSE)
-    return "cam_pose";
-
-  return std::string();
+  return this->table->Text(this->index);
 }
 
-/////////////////////////////////////////////////
-KeyframeType KeyframePrivate::StrToType(const std::string &_type) const
+//////////////////////////////////////////////////
+const std::string &Keyframe::TextFile() const
 {
-  if (_type == "lookat")
-    return KeyframeType::LOOKAT;
-
-  if (_type == "stack")
-    return KeyframeType::STACK;
-
-  if (_type == "log_seek")
-    return KeyframeType::LOG_SEEK;
-
-  if (_type == "cam_pose")
-    return KeyframeType::CAM_POSE;
+  return this->table->TextFile(this->index);
+}
 
-  return KeyframeType::NONE;
+//////////////////////////////////////////////////
+const std::string &Keyframe::Label() const
+{
+  return this->table->Label(this->index);
 }
 
+//////////////////////////////////////////////////
+std::size_t Keyframe::Index() const
+{
+  return this->index;
+}
@@ -0,0 +1,851 @@
+/*
+ * Copyright 2017 Louise Poubel
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include <sdf/parser.hh>
+
+#include "include/simslides/common/KeyframeTable.hh"
+#include "include/simslides/common/Log.hh"
+
+using namespace simslides;
+
+namespace
+{
+  /// \brief Fields of a single keyframe, parsed from SDF but not yet
+  /// interned into a table.
+  struct ParsedKeyframe
+  {
+    KeyframeType type{KeyframeType::NONE};
+    int slideNumber{-1};
+    std::string visual;
+    ignition::math::Pose3d eyeOffset;
+    ignition::math::Pose3d camPose;
+    std::chrono::steady_clock::duration logSeek{0};
+    std::string text;
+    std::string textFile;
+    std::string label;
+    double transition{std::numeric_limits<double>::quiet_NaN()};
+    double dwell{std::numeric_limits<double>::quiet_NaN()};
+
+    /// \brief Parse error, empty if the keyframe is valid.
+    std::string error;
+  };
+
+  /// \brief When the user wants special characters like <> to be printed in
+  /// QTextBrowser, we need these characters to be encoded. But SDF / TinyXml
+  /// decodes them. Thus the need for an intermediate encoding :]
+  ///
+  /// Replaces "<<" with "&lt;" and ">>" with "&gt;" in a single pass.
+  /// \param[in] _text Text as read from SDF.
+  /// \return Encoded text.
+  std::string EncodeText(const std::string &_text)
+  {
+    if (_text.find("<<") == std::string::npos &&
+        _text.find(">>") == std::string::npos)
+    {
+      return _text;
+    }
+
+    std::string encoded;
+    encoded.reserve(_text.size() + _text.size() / 2);
+    for (std::size_t i = 0; i < _text.size(); ++i)
+    {
+      auto c = _text[i];
+      if ((c == '<' || c == '>') && i + 1 < _text.size() && _text[i + 1] == c)
+      {
+        encoded += c == '<' ? "&lt;" : "&gt;";
+        ++i;
+      }
+      else
+      {
+        encoded += c;
+      }
+    }
+    return encoded;
+  }
+
+  /// \brief Values of a <keyframe> element's attributes, copied out of the
+  /// SDF tree. Empty if not set.
+  struct KeyframeStrings
+  {
+    KeyframeType type{KeyframeType::NONE};
+    std::string typeStr;
+    std::string eyeOffset;
+    std::string text;
+    std::string textFile;
+    std::string label;
+    std::string transition;
+    std::string dwell;
+    std::string number;
+    std::string visual;
+    std::string camPose;
+    std::string time;
+    std::string pose;
+  };
+
+  /// \brief Copy the attributes of a <keyframe> element which its type
+  /// uses. sdformat doesn't document elements as safe to read from several
+  /// threads, so this must be called serially.
+  /// \param[in] _sdf Keyframe element.
+  /// \param[out] _strings Attribute values.
+  void Read(const sdf::ElementPtr _sdf, KeyframeStrings &_strings)
+  {
+    if (!_sdf)
+      return;
+
+    _strings.typeStr = _sdf->Get<std::string>("type");
+    _strings.type = StrToKeyframeType(_strings.typeStr);
+
+    for (auto attr : {std::make_pair("eye_offset", &_strings.eyeOffset),
+                      std::make_pair("text", &_strings.text),
+                      std::make_pair("text_file", &_strings.textFile),
+                      std::make_pair("label", &_strings.label),
+                      std::make_pair("transition", &_strings.transition),
+                      std::make_pair("dwell", &_strings.dwell)})
+    {
+      if (_sdf->HasAttribute(attr.first))
+        *attr.second = _sdf->Get<std::string>(attr.first);
+    }
+
+    if (_strings.type == KeyframeType::STACK ||
+        _strings.type == KeyframeType::LOOKAT)
+    {
+      _strings.number = _sdf->Get<std::string>("number");
+      _strings.visual = _sdf->Get<std::string>("visual");
+    }
+    else if (_strings.type == KeyframeType::LOG_SEEK)
+    {
+      _strings.camPose = _sdf->Get<std::string>("cam_pose");
+      _strings.time = _sdf->Get<std::string>("time");
+    }
+    else if (_strings.type == KeyframeType::CAM_POSE)
+    {
+      _strings.pose = _sdf->Get<std::string>("pose");
+    }
+  }
+
+  /// \brief Convert an attribute value through a stream, like sdformat does.
+  /// \param[in] _name Attribute name, for the error message.
+  /// \param[in] _str Attribute value, left unconverted if empty.
+  /// \param[out] _value Converted value, left unchanged on failure.
+  /// \param[out] _error Set if the value can't be converted.
+  template<typename T>
+  void Convert(const char *_name, const std::string &_str, T &_value,
+      std::string &_error)
+  {
+    if (_str.empty())
+      return;
+
+    std::istringstream stream(_str);
+    T value;
+    stream >> value;
+    if (stream.fail())
+      _error = std::string("Invalid ") + _name + " [" + _str + "]";
+    else
+      _value = value;
+  }
+
+  /// \brief Parse the attribute values of a <keyframe> element. This doesn't
+  /// touch the SDF tree, so different keyframes can be parsed concurrently.
+  /// \param[in] _strings Attribute values, see Read.
+  /// \param[out] _keyframe Parsed fields.
+  void Parse(const KeyframeStrings &_strings, ParsedKeyframe &_keyframe)
+  {
+    _keyframe.type = _strings.type;
+
+    Convert("eye_offset", _strings.eyeOffset, _keyframe.eyeOffset,
+        _keyframe.error);
+    _keyframe.text = EncodeText(_strings.text);
+    _keyframe.textFile = _strings.textFile;
+    _keyframe.label = _strings.label;
+
+    Convert("transition", _strings.transition, _keyframe.transition,
+        _keyframe.error);
+    if (_keyframe.transition < 0)
+    {
+      _keyframe.error = "Negative transition [" +
+          std::to_string(_keyframe.transition) + "]";
+      _keyframe.transition = std::numeric_limits<double>::quiet_NaN();
+    }
+
+    Convert("dwell", _strings.dwell, _keyframe.dwell, _keyframe.error);
+    if (_keyframe.dwell < 0)
+    {
+      _keyframe.error = "Negative dwell [" +
+          std::to_string(_keyframe.dwell) + "]";
+      _keyframe.dwell = std::numeric_limits<double>::quiet_NaN();
+    }
+
+    if (_keyframe.type == KeyframeType::STACK ||
+        _keyframe.type == KeyframeType::LOOKAT)
+    {
+      _keyframe.slideNumber = 0;
+      Convert("number", _strings.number, _keyframe.slideNumber,
+          _keyframe.error);
+      _keyframe.visual = _strings.visual;
+      if (_keyframe.visual.empty())
+      {
+        _keyframe.error = "Missing visual for [" + _strings.typeStr +
+            "] keyframe";
+      }
+    }
+    else if (_keyframe.type == KeyframeType::LOG_SEEK)
+    {
+      Convert("cam_pose", _strings.camPose, _keyframe.camPose,
+          _keyframe.error);
+
+      // Seconds and nanoseconds, like sdf::Time
+      std::istringstream stream(_strings.time);
+      int32_t sec{0};
+      int32_t nsec{0};
+      stream >> sec >> nsec;
+      _keyframe.logSeek = std::chrono::seconds(sec) +
+         std::chrono::nanoseconds(nsec);
+    }
+    else if (_keyframe.type == KeyframeType::CAM_POSE)
+    {
+      Convert("pose", _strings.pose, _keyframe.camPose, _keyframe.error);
+    }
+    else
+    {
+      _keyframe.error = "Unsupported type [" + _strings.typeStr + "]";
+    }
+  }
+}
+
+/////////////////////////////////////////////////
+void KeyframeTable::Add(const sdf::ElementPtr _sdf)
+{
+  KeyframeStrings strings;
+  Read(_sdf, strings);
+
+  ParsedKeyframe keyframe;
+  Parse(strings, keyframe);
+
+  if (!keyframe.error.empty())
+    sserr << keyframe.error << std::endl;
+
+  this->Detach();
+  if (!this->Append(keyframe.type, keyframe.slideNumber, keyframe.visual,
+      keyframe.eyeOffset, keyframe.camPose, keyframe.logSeek, keyframe.text,
+      keyframe.textFile, keyframe.label, keyframe.transition,
+      keyframe.dwell))
+  {
+    sserr << "Label [" << keyframe.label << "] is already used" << std::endl;
+  }
+  this->UpdateView();
+  ++this->version;
+
+  this->Print(this->Size() - 1);
+}
+
+/////////////////////////////////////////////////
+bool KeyframeTable::AddAll(const sdf::ElementPtr _parent,
+    std::vector<std::string> &_errors, unsigned int _threads)
+{
+  _errors.clear();
+  if (!_parent || !_parent->HasElement("keyframe"))
+    return true;
+
+  // Copy attribute values out of the SDF tree first. Walking it is
+  // inherently sequential, and sdformat doesn't document reading it from
+  // several threads as safe.
+  std::vector<KeyframeStrings> elems;
+  auto keyframeElem = _parent->GetElement("keyframe");
+  while (keyframeElem)
+  {
+    elems.emplace_back();
+    Read(keyframeElem, elems.back());
+    keyframeElem = keyframeElem->GetNextElement("keyframe");
+  }
+
+  // Parse contiguous chunks in parallel. Each thread writes only to its own
+  // slots, so no locking is needed and order is preserved.
+  std::vector<ParsedKeyframe> parsed(elems.size());
+
+  if (_threads == 0)
+    _threads = std::max(1u, std::thread::hardware_concurrency());
+  auto chunks = std::min<std::size_t>(_threads,
+      (elems.size() + kMinKeyframesPerThread - 1) / kMinKeyframesPerThread);
+  auto chunkSize = (elems.size() + chunks - 1) / chunks;
+
+  auto parseChunk = [&](std::size_t _begin, std::size_t _end)
+  {
+    for (auto i = _begin; i < _end; ++i)
+      Parse(elems[i], parsed[i]);
+  };
+
+  std::vector<std::thread> workers;
+  for (std::size_t c = 1; c < chunks; ++c)
+  {
+    workers.emplace_back(parseChunk, c * chunkSize,
+        std::min(elems.size(), (c + 1) * chunkSize));
+  }
+  parseChunk(0, std::min(elems.size(), chunkSize));
+  for (auto &worker : workers)
+    worker.join();
+
+  // Merge in deck order. Interning and the stack index depend on previous
+  // keyframes, and are cheap compared to parsing.
+  this->Reserve(this->Size() + parsed.size());
+  auto first = this->Size();
+  for (std::size_t i = 0; i < parsed.size(); ++i)
+  {
+    const auto &keyframe = parsed[i];
+    if (!keyframe.error.empty())
+    {
+      _errors.push_back("Keyframe [" + std::to_string(first + i) + "]: " +
+          keyframe.error);
+    }
+
+    if (!this->Append(keyframe.type, keyframe.slideNumber, keyframe.visual,
+        keyframe.eyeOffset, keyframe.camPose, keyframe.logSeek, keyframe.text,
+        keyframe.textFile, keyframe.label, keyframe.transition,
+        keyframe.dwell))
+    {
+      _errors.push_back("Keyframe [" + std::to_string(first + i) +
+          "]: Label [" + keyframe.label + "] is already used");
+    }
+  }
+  this->UpdateView();
+  ++this->version;
+
+  if (Logger::Instance()->Enabled(LOG_VERBOSE))
+  {
+    for (auto i = first; i < this->Size(); ++i)
+      this->Print(i);
+  }
+
+  return _errors.empty();
+}
+
+/////////////////////////////////////////////////
+bool KeyframeTable::Append(KeyframeType _type, int _slideNumber,
+    const std::string &_visual, const ignition::math::Pose3d &_eyeOffset,
+    const ignition::math::Pose3d &_camPose,
+    std::chrono::steady_clock::duration _logSeek, const std::string &_text,
+    const std::string &_textFile, const std::string &_label,
+    double _transition, double _dwell)
+{
+  auto index = this->types.size();
+
+  this->types.push_back(static_cast<uint8_t>(_type));
+  this->slideNumbers.push_back(_slideNumber);
+  this->visuals.push_back(
+      Intern(_visual, this->visualNames, this->visualIds));
+  this->texts.push_back(Intern(_text, this->textPool, this->textIds));
+  this->textFiles.push_back(
+      Intern(_textFile, this->textFileNames, this->textFileIds));
+  this->labels.push_back(Intern(_label, this->labelNames, this->labelIds));
+  AppendPose(_eyeOffset, this->eyeOffsets);
+  AppendPose(_camPose, this->camPoses);
+  this->eyePoses.insert(this->eyePoses.end(), kPoseSize,
+      std::numeric_limits<double>::quiet_NaN());
+  this->logSeeks.push_back(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(_logSeek).count());
+  this->transitions.push_back(_transition);
+  this->dwells.push_back(_dwell);
+
+  // Extend the stack index. Consecutive STACK keyframes form a single stack.
+  if (_type != KeyframeType::STACK)
+  {
+    this->stackIds.push_back(kNoStack);
+  }
+  else if (index > 0 && this->types[index - 1] ==
+      static_cast<uint8_t>(KeyframeType::STACK))
+  {
+    this->stacks.back().back = index;
+    this->stackIds.push_back(this->stackIds[index - 1]);
+  }
+  else
+  {
+    this->stacks.push_back({index, index});
+    this->stackIds.push_back(static_cast<uint32_t>(this->stacks.size() - 1));
+  }
+
+  // Extend the lookup indexes. The empty visual and label aren't indexed.
+  auto visual = this->visuals.back();
+  if (visual >= this->visualKeyframes.size())
+    this->visualKeyframes.resize(visual + 1);
+  if (visual != 0)
+    this->visualKeyframes[visual].push_back(index);
+
+  auto label = this->labels.back();
+  if (label < this->labelKeyframes.size())
+    return label == 0;
+
+  this->labelKeyframes.push_back(index);
+  return true;
+}
+
+/////////////////////////////////////////////////
+void KeyframeTable::Clear()
+{
+  this->mapping.reset();
+
+  this->types.clear();
+  this->slideNumbers.clear();
+  this->visuals.clear();
+  this->texts.clear();
+  this->textFiles.clear();
+  this->labels.clear();
+  this->eyeOffsets.clear();
+  this->camPoses.clear();
+  this->eyePoses.clear();
+  this->logSeeks.clear();
+  this->transitions.clear();
+  this->dwells.clear();
+  this->stackIds.clear();
+  this->stacks.clear();
+
+  this->visualNames.assign(1, std::string());
+  this->visualIds = {{"", 0}};
+  this->textPool.assign(1, std::string());
+  this->textIds = {{"", 0}};
+  this->textFileNames.assign(1, std::string());
+  this->textFileIds = {{"", 0}};
+  this->visualKeyframes.assign(1, {});
+  this->labelNames.assign(1, std::string());
+  this->labelIds = {{"", 0}};
+  this->labelKeyframes.assign(1, 0);
+
+  this->UpdateView();
+  ++this->version;
+}
+
+/////////////////////////////////////////////////
+void KeyframeTable::SetDirectory(const std::string &_directory)
+{
+  std::lock_guard<std::mutex> lock(this->textFileMutex);
+  this->directory = _directory;
+  this->textFileCache.clear();
+}
+
+/////////////////////////////////////////////////
+void KeyframeTable::Reserve(std::size_t _count)
+{
+  this->Detach();
+
+  this->types.reserve(_count);
+  this->slideNumbers.reserve(_count);
+  this->visuals.reserve(_count);
+  this->texts.reserve(_count);
+  this->textFiles.reserve(_count);
+  this->labels.reserve(_count);
+  this->eyeOffsets.reserve(_count * kPoseSize);
+  this->camPoses.reserve(_count * kPoseSize);
+  this->eyePoses.reserve(_count * kPoseSize);
+  this->logSeeks.reserve(_count);
+  this->transitions.reserve(_count);
+  this->dwells.reserve(_count);
+  this->stackIds.reserve(_count);
+  this->UpdateView();
+}
+
+/////////////////////////////////////////////////
+std::size_t KeyframeTable::Size() const
+{
+  return this->view.size;
+}
+
+/////////////////////////////////////////////////
+bool KeyframeTable::Empty() const
+{
+  return this->view.size == 0;
+}
+
+/////////////////////////////////////////////////
+uint64_t KeyframeTable::Version() const
+{
+  return this->version;
+}
+
+/////////////////////////////////////////////////
+Keyframe KeyframeTable::operator[](std::size_t _index) const
+{
+  return Keyframe(*this, _index);
+}
+
+/////////////////////////////////////////////////
+KeyframeType KeyframeTable::Type(std::size_t _index) const
+{
+  return static_cast<KeyframeType>(this->view.types[_index]);
+}
+
+/////////////////////////////////////////////////
+int KeyframeTable::SlideNumber(std::size_t _index) const
+{
+  return this->view.slideNumbers[_index];
+}
+
+/////////////////////////////////////////////////
+const std::string &KeyframeTable::Visual(std::size_t _index) const
+{
+  return this->visualNames[this->view.visuals[_index]];
+}
+
+/////////////////////////////////////////////////
+const std::string &KeyframeTable::Label(std::size_t _index) const
+{
+  return this->labelNames[this->view.labels[_index]];
+}
+
+/////////////////////////////////////////////////
+bool KeyframeTable::FindLabel(const std::string &_label,
+    std::size_t &_index) const
+{
+  auto it = this->labelIds.find(_label);
+  if (it == this->labelIds.end() || it->second == 0 ||
+      this->labelKeyframes[it->second] >= this->view.size)
+  {
+    return false;
+  }
+
+  _index = this->labelKeyframes[it->second];
+  return true;
+}
+
+/////////////////////////////////////////////////
+bool KeyframeTable::FindVisual(const std::string &_visual,
+    std::size_t &_index) const
+{
+  const auto &indices = this->VisualKeyframes(_visual);
+  if (indices.empty())
+    return false;
+
+  _index = indices.front();
+  return true;
+}
+
+/////////////////////////////////////////////////
+const std::vector<uint64_t> &KeyframeTable::VisualKeyframes(
+    const std::string &_visual) const
+{
+  auto it = this->visualIds.find(_visual);
+  if (it == this->visualIds.end())
+    return this->visualKeyframes[0];
+
+  return this->visualKeyframes[it->second];
+}
+
+/////////////////////////////////////////////////
+uint32_t KeyframeTable::VisualId(std::size_t _index) const
+{
+  return this->view.visuals[_index];
+}
+
+/////////////////////////////////////////////////
+std::size_t KeyframeTable::VisualCount() const
+{
+  return this->visualNames.size();
+}
+
+/////////////////////////////////////////////////
+const std::string &KeyframeTable::VisualName(uint32_t _id) const
+{
+  return this->visualNames[_id];
+}
+
+/////////////////////////////////////////////////
+ignition::math::Pose3d KeyframeTable::EyeOffset(std::size_t _index) const
+{
+  return ReadPose(this->view.eyeOffsets, _index);
+}
+
+/////////////////////////////////////////////////
+ignition::math::Pose3d KeyframeTable::CamPose(std::size_t _index) const
+{
+  return ReadPose(this->view.camPoses, _index);
+}
+
+/////////////////////////////////////////////////
+bool KeyframeTable::EyePose(std::size_t _index,
+    ignition::math::Pose3d &_pose) const
+{
+  if (std::isnan(this->view.eyePoses[_index * kPoseSize]))
+    return false;
+
+  _pose = ReadPose(this->view.eyePoses, _index);
+  return true;
+}
+
+/////////////////////////////////////////////////
+void KeyframeTable::SetEyePose(std::size_t _index,
+    const ignition::math::Pose3d &_pose)
+{
+  this->Detach();
+
+  double *p = &this->eyePoses[_index * kPoseSize];
+  p[0] = _pose.Pos().X();
+  p[1] = _pose.Pos().Y();
+  p[2] = _pose.Pos().Z();
+  p[3] = _pose.Rot().W();
+  p[4] = _pose.Rot().X();
+  p[5] = _pose.Rot().Y();
+  p[6] = _pose.Rot().Z();
+}
+
+/////////////////////////////////////////////////
+double KeyframeTable::Transition(std::size_t _index) const
+{
+  return this->view.transitions[_index];
+}
+
+/////////////////////////////////////////////////
+double KeyframeTable::Dwell(std::size_t _index) const
+{
+  return this->view.dwells[_index];
+}
+
+/////////////////////////////////////////////////
+std::chrono::steady_clock::duration KeyframeTable::LogSeek(
+    std::size_t _index) const
+{
+  return std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+      std::chrono::nanoseconds(this->view.logSeeks[_index]));
+}
+
+/////////////////////////////////////////////////
+const std::string &KeyframeTable::Text(std::size_t _index) const
+{
+  auto file = this->view.textFiles[_index];
+  if (file == 0)
+    return this->textPool[this->view.texts[_index]];
+
+  return this->LoadTextFile(file);
+}
+
+/////////////////////////////////////////////////
+const std::string &KeyframeTable::TextFile(std::size_t _index) const
+{
+  return this->textFileNames[this->view.textFiles[_index]];
+}
+
+/////////////////////////////////////////////////
+const std::string &KeyframeTable::LoadTextFile(uint32_t _id) const
+{
+  std::lock_guard<std::mutex> lock(this->textFileMutex);
+
+  if (this->textFileCacheVersion != this->version ||
+      this->textFileCache.size() != this->textFileNames.size())
+  {
+    this->textFileCache.clear();
+    this->textFileCache.resize(this->textFileNames.size());
+    this->textFileCacheVersion = this->version;
+  }
+
+  auto &cached = this->textFileCache[_id];
+  if (cached)
+    return *cached;
+
+  cached = std::make_unique<std::string>();
+
+  // Relative to the world or deck first, so they don't depend on where
+  // the simulator was started from
+  auto path = this->textFileNames[_id];
+  auto relative = std::filesystem::path(this->directory) / path;
+  if (!this->directory.empty() && std::filesystem::path(path).is_relative() &&
+      std::filesystem::exists(relative))
+  {
+    path = relative.string();
+  }
+  else if (!std::filesystem::exists(path))
+  {
+    auto found = sdf::findFile(path);
+    if (!found.empty())
+      path = found;
+  }
+
+  std::ifstream file(path, std::ios::in | std::ios::binary);
+  if (!file)
+  {
+    sserr << "Failed to read text file [" << path << "]" << std::endl;
+    return *cached;
+  }
+
+  // Files are read as-is, they don't go through TinyXml so they don't need
+  // the << >> encoding.
+  cached->assign(std::istreambuf_iterator<char>(file),
+      std::istreambuf_iterator<char>());
+  return *cached;
+}
+
+/////////////////////////////////////////////////
+uint32_t KeyframeTable::StackId(std::size_t _index) const
+{
+  return this->view.stackIds[_index];
+}
+
+/////////////////////////////////////////////////
+std::size_t KeyframeTable::StackCount() const
+{
+  return this->view.stackCount;
+}
+
+/////////////////////////////////////////////////
+const StackRange &KeyframeTable::Stack(uint32_t _id) const
+{
+  return this->view.stacks[_id];
+}
+
+/////////////////////////////////////////////////
+void KeyframeTable::Print(std::size_t _index) const
+{
+  ssverbose << "- Keyframe " << std::endl
+            << "    Type : " << KeyframeTypeToStr(this->Type(_index))
+            << std::endl
+            << "    Visual : " << this->Visual(_index) << std::endl
+            << "    Label : " << this->Label(_index) << std::endl
+            << "    Eye offset : " << this->EyeOffset(_index) << std::endl
+            << "    Cam pose : " << this->CamPose(_index) << std::endl
+            << "    Log seek : " << this->LogSeek(_index).count() << std::endl
+            << "    Transition : " << this->Transition(_index) << std::endl
+            << "    Dwell : " << this->Dwell(_index) << std::endl
+            << (this->view.textFiles[_index] != 0 ?
+                "    Text file : " + this->TextFile(_index) :
+                "    Text : " + this->Text(_index)) << std::endl;
+}
+
+/////////////////////////////////////////////////
+uint32_t KeyframeTable::Intern(const std::string &_str,
+    std::vector<std::string> &_pool,
+    std::unordered_map<std::string, uint32_t> &_ids)
+{
+  auto it = _ids.find(_str);
+  if (it != _ids.end())
+    return it->second;
+
+  auto id = static_cast<uint32_t>(_pool.size());
+  _pool.push_back(_str);
+  _ids.emplace(_str, id);
+  return id;
+}
+
+/////////////////////////////////////////////////
+void KeyframeTable::AppendPose(const ignition::math::Pose3d &_pose,
+    std::vector<double> &_array)
+{
+  _array.insert(_array.end(), {
+      _pose.Pos().X(), _pose.Pos().Y(), _pose.Pos().Z(),
+      _pose.Rot().W(), _pose.Rot().X(), _pose.Rot().Y(), _pose.Rot().Z()});
+}
+
+/////////////////////////////////////////////////
+ignition::math::Pose3d KeyframeTable::ReadPose(const double *_array,
+    std::size_t _index)
+{
+  const double *p = _array + _index * kPoseSize;
+  return ignition::math::Pose3d(p[0], p[1], p[2], p[3], p[4], p[5], p[6]);
+}
+
+/////////////////////////////////////////////////
+void KeyframeTable::Detach()
+{
+  if (!this->mapping)
+    return;
+
+  auto size = this->view.size;
+  auto stackCount = this->view.stackCount;
+
+  this->types.assign(this->view.types, this->view.types + size);
+  this->slideNumbers.assign(this->view.slideNumbers,
+      this->view.slideNumbers + size);
+  this->visuals.assign(this->view.visuals, this->view.visuals + size);
+  this->texts.assign(this->view.texts, this->view.texts + size);
+  this->textFiles.assign(this->view.textFiles, this->view.textFiles + size);
+  this->labels.assign(this->view.labels, this->view.labels + size);
+  this->eyeOffsets.assign(this->view.eyeOffsets,
+      this->view.eyeOffsets + size * kPoseSize);
+  this->camPoses.assign(this->view.camPoses,
+      this->view.camPoses + size * kPoseSize);
+  this->eyePoses.assign(this->view.eyePoses,
+      this->view.eyePoses + size * kPoseSize);
+  this->logSeeks.assign(this->view.logSeeks, this->view.logSeeks + size);
+  this->transitions.assign(this->view.transitions,
+      this->view.transitions + size);
+  this->dwells.assign(this->view.dwells, this->view.dwells + size);
+  this->stackIds.assign(this->view.stackIds, this->view.stackIds + size);
+  this->stacks.assign(this->view.stacks, this->view.stacks + stackCount);
+
+  // Mapped decks only keep lookup maps for visuals and labels, see
+  // BuildIndexes
+  this->textIds.clear();
+  for (std::size_t i = 0; i < this->textPool.size(); ++i)
+    this->textIds.emplace(this->textPool[i], static_cast<uint32_t>(i));
+  this->textFileIds.clear();
+  for (std::size_t i = 0; i < this->textFileNames.size(); ++i)
+  {
+    this->textFileIds.emplace(this->textFileNames[i],
+        static_cast<uint32_t>(i));
+  }
+
+  this->mapping.reset();
+  this->UpdateView();
+}
+
+/////////////////////////////////////////////////
+void KeyframeTable::BuildIndexes()
+{
+  this->visualIds.clear();
+  for (std::size_t i = 0; i < this->visualNames.size(); ++i)
+    this->visualIds.emplace(this->visualNames[i], static_cast<uint32_t>(i));
+
+  this->labelIds.clear();
+  for (std::size_t i = 0; i < this->labelNames.size(); ++i)
+    this->labelIds.emplace(this->labelNames[i], static_cast<uint32_t>(i));
+
+  this->visualKeyframes.assign(this->visualNames.size(), {});
+  this->labelKeyframes.assign(this->labelNames.size(), this->view.size);
+  for (std::size_t i = 0; i < this->view.size; ++i)
+  {
+    auto visual = this->view.visuals[i];
+    if (visual != 0)
+      this->visualKeyframes[visual].push_back(i);
+
+    auto label = this->view.labels[i];
+    if (this->labelKeyframes[label] == this->view.size)
+      this->labelKeyframes[label] = i;
+  }
+  this->labelKeyframes[0] = 0;
+}
+
+/////////////////////////////////////////////////
+void KeyframeTable::UpdateView()
+{
+  this->view.types = this->types.data();
+  this->view.slideNumbers = this->slideNumbers.data();
+  this->view.visuals = this->visuals.data();
+  this->view.texts = this->texts.data();
+  this->view.textFiles = this->textFiles.data();
+  this->view.labels = this->labels.data();
+  this->view.eyeOffsets = this->eyeOffsets.data();
+  this->view.camPoses = this->camPoses.data();
+  this->view.eyePoses = this->eyePoses.data();
+  this->view.logSeeks = this->logSeeks.data();
+  this->view.transitions = this->transitions.data();
+  this->view.dwells = this->dwells.data();
+  this->view.stackIds = this->stackIds.data();
+  this->view.stacks = this->stacks.data();
+  this->view.size = this->types.size();
+  this->view.stackCount = this->stacks.size();
+}
@@ -0,0 +1,115 @@
+/*
+ * Copyright 2017 Louise Poubel
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+#include <algorithm>
+#include <cmath>
+
+#include "include/simslides/common/LatencyHistogram.hh"
+
+using namespace simslides;
+
+/////////////////////////////////////////////////
+void LatencyHistogram::Record(Clock::duration _duration)
+{
+  _duration = std::max(Clock::duration::zero(), _duration);
+
+  // Bucket i > 0 holds (2^((i-1)/2), 2^(i/2)] microseconds
+  auto us = std::chrono::duration<double, std::micro>(_duration).count();
+  std::size_t index{0};
+  if (us > 1.0)
+  {
+    index = std::min(kBucketCount - 1,
+        static_cast<std::size_t>(std::ceil(2.0 * std::log2(us))));
+
+    // Bounds are rounded to the clock's resolution, so the logarithm may be
+    // off by one right at a bound
+    if (index > 0 && _duration <= UpperBound(index - 1))
+      --index;
+    else if (_duration > UpperBound(index))
+      ++index;
+  }
+
+  ++this->buckets[index];
+  ++this->count;
+  this->sum += _duration;
+  this->max = std::max(this->max, _duration);
+}
+
+/////////////////////////////////////////////////
+void LatencyHistogram::Clear()
+{
+  this->buckets.fill(0);
+  this->count = 0;
+  this->sum = Clock::duration::zero();
+  this->max = Clock::duration::zero();
+}
+
+/////////////////////////////////////////////////
+uint64_t LatencyHistogram::Count() const
+{
+  return this->count;
+}
+
+/////////////////////////////////////////////////
+LatencyHistogram::Clock::duration LatencyHistogram::Sum() const
+{
+  return this->sum;
+}
+
+/////////////////////////////////////////////////
+LatencyHistogram::Clock::duration LatencyHistogram::Max() const
+{
+  return this->max;
+}
+
+/////////////////////////////////////////////////
+uint64_t LatencyHistogram::Bucket(std::size_t _index) const
+{
+  return this->buckets[_index];
+}
+
+/////////////////////////////////////////////////
+LatencyHistogram::Clock::duration LatencyHistogram::UpperBound(
+    std::size_t _index)
+{
+  if (_index + 1 >= kBucketCount)
+    return Clock::duration::max();
+
+  return std::chrono::duration_cast<Clock::duration>(
+      std::chrono::duration<double, std::micro>(
+      std::exp2(static_cast<double>(_index) / 2.0)));
+}
+
+/////////////////////////////////////////////////
+LatencyHistogram::Clock::duration LatencyHistogram::Percentile(
+    double _fraction) const
+{
+  if (this->count == 0)
+    return Clock::duration::zero();
+
+  auto rank = static_cast<uint64_t>(std::ceil(
+      std::clamp(_fraction, 0.0, 1.0) * static_cast<double>(this->count)));
+  rank = std::max<uint64_t>(rank, 1);
+
+  uint64_t cumulative{0};
+  for (std::size_t i = 0; i < kBucketCount; ++i)
+  {
+    cumulative += this->buckets[i];
+    if (cumulative >= rank)
+      return std::min(UpperBound(i), this->max);
+  }
+
+  return this->max;
+}
@@ -0,0 +1,184 @@
+/*
+ * Copyright 2017 Louise Poubel
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include "include/simslides/common/Log.hh"
+
+using namespace simslides;
+
+/////////////////////////////////////////////////
+bool simslides::StrToLogLevel(const std::string &_name, LogLevel &_level)
+{
+  if (_name == "verbose")
+    _level = LOG_VERBOSE;
+  else if (_name == "debug")
+    _level = LOG_DEBUG;
+  else if (_name == "info")
+    _level = LOG_INFO;
+  else if (_name == "warning")
+    _level = LOG_WARNING;
+  else if (_name == "error")
+    _level = LOG_ERROR;
+  else if (_name == "none")
+    _level = LOG_NONE;
+  else
+    return false;
+
+  return true;
+}
+
+/////////////////////////////////////////////////
+Logger::Logger() : level(LOG_INFO)
+{
+  auto env = std::getenv("SIMSLIDES_LOG_LEVEL");
+  LogLevel envLevel;
+  if (env && StrToLogLevel(env, envLevel))
+    this->level = envLevel;
+
+  this->thread = std::thread(&Logger::Run, this);
+}
+
+/////////////////////////////////////////////////
+Logger::~Logger()
+{
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->stop = true;
+  }
+  this->queued.notify_one();
+  this->thread.join();
+}
+
+/////////////////////////////////////////////////
+Logger *Logger::Instance()
+{
+  static Logger logger;
+  return &logger;
+}
+
+/////////////////////////////////////////////////
+LogLevel Logger::Level() const
+{
+  return static_cast<LogLevel>(this->level.load(std::memory_order_relaxed));
+}
+
+/////////////////////////////////////////////////
+void Logger::SetLevel(LogLevel _level)
+{
+  this->level.store(_level, std::memory_order_relaxed);
+}
+
+/////////////////////////////////////////////////
+bool Logger::Enabled(LogLevel _level) const
+{
+  return _level != LOG_NONE &&
+      _level >= this->level.load(std::memory_order_relaxed);
+}
+
+/////////////////////////////////////////////////
+void Logger::Write(LogLevel _level, std::string _message)
+{
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->queue.emplace_back(_level, std::move(_message));
+  }
+  this->queued.notify_one();
+}
+
+/////////////////////////////////////////////////
+void Logger::Flush()
+{
+  std::unique_lock<std::mutex> lock(this->mutex);
+  this->written.wait(lock, [this]
+  {
+    return this->queue.empty() && this->writing == 0;
+  });
+}
+
+/////////////////////////////////////////////////
+void Logger::Run()
+{
+  std::vector<std::pair<LogLevel, std::string>> batch;
+
+  std::unique_lock<std::mutex> lock(this->mutex);
+  while (true)
+  {
+    this->queued.wait(lock, [this]
+    {
+      return this->stop || !this->queue.empty();
+    });
+
+    if (this->queue.empty() && this->stop)
+      break;
+
+    batch.assign(std::make_move_iterator(this->queue.begin()),
+        std::make_move_iterator(this->queue.end()));
+    this->queue.clear();
+    this->writing = batch.size();
+
+    // Write without holding the lock, so producers never wait on the
+    // terminal
+    lock.unlock();
+
+    bool out{false};
+    bool err{false};
+    for (const auto &message : batch)
+    {
+      if (message.first >= LOG_WARNING)
+      {
+        std::cerr << message.second;
+        err = true;
+      }
+      else
+      {
+        std::cout << message.second;
+        out = true;
+      }
+    }
+
+    // Flush once per batch instead of once per line
+    if (out)
+      std::cout.flush();
+    if (err)
+      std::cerr.flush();
+
+    batch.clear();
+
+    lock.lock();
+    this->writing = 0;
+    this->written.notify_all();
+  }
+}
+
+/////////////////////////////////////////////////
+LogStream::LogStream(LogLevel _level) : level(_level)
+{
+}
+
+/////////////////////////////////////////////////
+LogStream::~LogStream()
+{
+  Logger::Instance()->Write(this->level, this->stream.str());
+}
+
+/////////////////////////////////////////////////
+LogStream &LogStream::operator<<(std::ostream &(*_manip)(std::ostream &))
+{
+  _manip(this->stream);
+  return *this;
+}
@@ -0,0 +1,106 @@
+/*
+ * Copyright 2017 Louise Poubel
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+#include "include/simslides/common/MetricsExporter.hh"
+
+using namespace simslides;
+
+/////////////////////////////////////////////////
+MetricsExporter::~MetricsExporter()
+{
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->stop = true;
+  }
+  this->submitted.notify_one();
+  if (this->thread.joinable())
+    this->thread.join();
+}
+
+/////////////////////////////////////////////////
+void MetricsExporter::Submit(const TransitionMetrics &_metrics,
+    const std::string &_path)
+{
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->pending = _metrics;
+    this->pendingPath = _path;
+    this->hasPending = true;
+
+    if (!this->thread.joinable())
+      this->thread = std::thread(&MetricsExporter::Run, this);
+  }
+  this->submitted.notify_one();
+}
+
+/////////////////////////////////////////////////
+void MetricsExporter::Flush()
+{
+  std::unique_lock<std::mutex> lock(this->mutex);
+  this->written.wait(lock, [this]
+  {
+    return !this->hasPending && !this->writing;
+  });
+}
+
+/////////////////////////////////////////////////
+bool MetricsExporter::TakeSummary(std::string &_summary)
+{
+  std::lock_guard<std::mutex> lock(this->mutex);
+  if (!this->hasSummary)
+    return false;
+
+  _summary = this->summary;
+  this->hasSummary = false;
+  return true;
+}
+
+/////////////////////////////////////////////////
+void MetricsExporter::Run()
+{
+  TransitionMetrics metrics;
+  std::string path;
+
+  std::unique_lock<std::mutex> lock(this->mutex);
+  while (true)
+  {
+    this->submitted.wait(lock, [this]
+    {
+      return this->stop || this->hasPending;
+    });
+
+    if (!this->hasPending && this->stop)
+      break;
+
+    metrics = this->pending;
+    path.swap(this->pendingPath);
+    this->hasPending = false;
+    this->writing = true;
+
+    // Format and write without holding the lock, so Submit never waits on
+    // the disk
+    lock.unlock();
+
+    auto text = metrics.Summary();
+    if (!path.empty())
+      metrics.Write(path);
+
+    lock.lock();
+    this->summary.swap(text);
+    this->hasSummary = true;
+    this->writing = false;
+    this->written.notify_all();
+  }
+}
@@ -0,0 +1,256 @@
+/*
+ * Copyright 2017 Louise Poubel
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+#include <algorithm>
+#include <cstdlib>
+#include <limits>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include "include/simslides/common/Log.hh"
+#include "include/simslides/common/TextureCache.hh"
+
+using namespace simslides;
+
+/////////////////////////////////////////////////
+std::filesystem::path TextureCache::DefaultDirectory()
+{
+  auto xdg = std::getenv("XDG_CACHE_HOME");
+  if (xdg && *xdg)
+    return std::filesystem::path(xdg) / "simslides" / "textures";
+
+  auto home = std::getenv("HOME");
+  if (home && *home)
+    return std::filesystem::path(home) / ".cache" / "simslides" / "textures";
+
+  return {};
+}
+
+/////////////////////////////////////////////////
+uint64_t TextureCache::DefaultMaxSize()
+{
+  auto env = std::getenv("SIMSLIDES_TEXTURE_CACHE_SIZE");
+  if (!env || !*env)
+    return kDefaultMaxSize;
+
+  char *end;
+  auto mib = std::strtoull(env, &end, 10);
+  if (*end != '\0' || mib > std::numeric_limits<uint64_t>::max() >> 20)
+  {
+    sswarn << "Invalid SIMSLIDES_TEXTURE_CACHE_SIZE [" << env
+           << "], using the default" << std::endl;
+    return kDefaultMaxSize;
+  }
+
+  return mib << 20;
+}
+
+/////////////////////////////////////////////////
+bool TextureCache::LinkOrCopy(const std::filesystem::path &_from,
+    const std::filesystem::path &_to)
+{
+  auto tmp = _to;
+  tmp += ".tmp";
+
+  std::error_code ec;
+  std::filesystem::remove(tmp, ec);
+  std::filesystem::create_hard_link(_from, tmp, ec);
+  if (ec)
+  {
+    ec.clear();
+    std::filesystem::copy_file(_from, tmp, ec);
+    if (ec)
+    {
+      sserr << "Failed to copy [" << _from << "] to [" << tmp << "]: "
+            << ec.message() << std::endl;
+      return false;
+    }
+  }
+
+  std::filesystem::rename(tmp, _to, ec);
+  if (ec)
+  {
+    sserr << "Failed to rename [" << tmp << "] to [" << _to << "]: "
+          << ec.message() << std::endl;
+    std::filesystem::remove(tmp, ec);
+    return false;
+  }
+
+  return true;
+}
+
+/////////////////////////////////////////////////
+bool TextureCache::Open(const std::filesystem::path &_directory,
+    uint64_t _maxSize)
+{
+  this->entries.clear();
+  this->directory.clear();
+  this->size = 0;
+  this->maxSize = _maxSize;
+
+  if (_directory.empty() || _maxSize == 0)
+    return false;
+
+  std::error_code ec;
+  std::filesystem::create_directories(_directory, ec);
+  if (ec)
+  {
+    sserr << "Failed to create texture cache [" << _directory << "]: "
+          << ec.message() << std::endl;
+    return false;
+  }
+  this->directory = _directory;
+
+  // Index what previous imports left
+  for (std::filesystem::recursive_directory_iterator it(_directory, ec), end;
+      !ec && it != end; it.increment(ec))
+  {
+    if (!it->is_regular_file(ec) || it->path().extension() == ".tmp")
+      continue;
+
+    Entry entry;
+    entry.extension = it->path().extension().string();
+    entry.size = it->file_size(ec);
+    entry.used = it->last_write_time(ec);
+    if (ec)
+    {
+      ec.clear();
+      continue;
+    }
+
+    this->entries[it->path().stem().string()] = entry;
+    this->size += entry.size;
+  }
+
+  ssdbg << "Texture cache [" << _directory << "] has ["
+        << this->entries.size() << "] textures, [" << (this->size >> 20)
+        << "] of [" << (this->maxSize >> 20) << "] MiB" << std::endl;
+
+  this->Evict(std::string());
+  return true;
+}
+
+/////////////////////////////////////////////////
+bool TextureCache::Enabled() const
+{
+  return !this->directory.empty();
+}
+
+/////////////////////////////////////////////////
+bool TextureCache::Find(const std::string &_key,
+    std::filesystem::path &_path)
+{
+  auto it = this->entries.find(_key);
+  if (it == this->entries.end())
+    return false;
+
+  // Another process may have evicted it
+  auto path = this->Path(_key, it->second.extension);
+  std::error_code ec;
+  auto now = std::filesystem::file_time_type::clock::now();
+  std::filesystem::last_write_time(path, now, ec);
+  if (ec)
+  {
+    this->size -= it->second.size;
+    this->entries.erase(it);
+    return false;
+  }
+
+  it->second.used = now;
+  _path = path;
+  return true;
+}
+
+/////////////////////////////////////////////////
+bool TextureCache::Store(const std::string &_key,
+    const std::filesystem::path &_file, std::filesystem::path &_path)
+{
+  if (!this->Enabled())
+    return false;
+
+  auto path = this->Path(_key, _file.extension().string());
+  std::error_code ec;
+  std::filesystem::create_directories(path.parent_path(), ec);
+  if (ec || !LinkOrCopy(_file, path))
+    return false;
+
+  auto &entry = this->entries[_key];
+  if (!entry.extension.empty() && entry.extension != path.extension())
+    std::filesystem::remove(this->Path(_key, entry.extension), ec);
+  entry.extension = path.extension().string();
+  this->size -= entry.size;
+  auto size = std::filesystem::file_size(path, ec);
+  if (ec)
+  {
+    // Its size can't be accounted for, so don't keep it
+    sserr << "Failed to get the size of [" << path << "]: " << ec.message()
+          << std::endl;
+    std::filesystem::remove(path, ec);
+    this->entries.erase(_key);
+    return false;
+  }
+  entry.size = size;
+  entry.used = std::filesystem::file_time_type::clock::now();
+  std::filesystem::last_write_time(path, entry.used, ec);
+  this->size += entry.size;
+
+  this->Evict(_key);
+
+  _path = path;
+  return true;
+}
+
+/////////////////////////////////////////////////
+uint64_t TextureCache::Size() const
+{
+  return this->size;
+}
+
+/////////////////////////////////////////////////
+void TextureCache::Evict(const std::string &_keep)
+{
+  if (this->size <= this->maxSize)
+    return;
+
+  std::vector<std::pair<std::filesystem::file_time_type, std::string>> lru;
+  lru.reserve(this->entries.size());
+  for (const auto &[key, entry] : this->entries)
+  {
+    if (key != _keep)
+      lru.emplace_back(entry.used, key);
+  }
+  std::sort(lru.begin(), lru.end());
+
+  for (const auto &[used, key] : lru)
+  {
+    if (this->size <= this->maxSize)
+      break;
+
+    std::error_code ec;
+    auto it = this->entries.find(key);
+    std::filesystem::remove(this->Path(key, it->second.extension), ec);
+
+    this->size -= it->second.size;
+    this->entries.erase(it);
+  }
+}
+
+/////////////////////////////////////////////////
+std::filesystem::path TextureCache::Path(const std::string &_key,
+    const std::string &_extension) const
+{
+  return this->directory / _key.substr(0, 2) / (_key + _extension);
+}
@@ -0,0 +1,581 @@
+/*
+ * Copyright 2017 Louise Poubel
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <utility>
+
+#include "include/simslides/common/Log.hh"
+#include "include/simslides/common/TextureEncoder.hh"
+
+using namespace simslides;
+
+namespace
+{
+  /// \brief Pixels in a 4x4 block, RGBA.
+  using Block = std::array<std::array<uint8_t, 4>, 16>;
+
+  /// \brief A color with float channels.
+  using Color = std::array<float, 3>;
+
+  /// \brief Number of entries in the linear to sRGB table.
+  constexpr int kLinearSteps{4096};
+
+  /// \brief sRGB value to linear light, from 0 to 1.
+  /// \param[in] _value 8-bit sRGB value.
+  /// \return Linear value.
+  float ToLinear(uint8_t _value)
+  {
+    static const auto table = []
+    {
+      std::array<float, 256> result;
+      for (int i = 0; i < 256; ++i)
+      {
+        double c = i / 255.0;
+        result[i] = static_cast<float>(c <= 0.04045 ? c / 12.92 :
+            std::pow((c + 0.055) / 1.055, 2.4));
+      }
+      return result;
+    }();
+    return table[_value];
+  }
+
+  /// \brief Linear light to sRGB.
+  /// \param[in] _value Linear value, from 0 to 1.
+  /// \return 8-bit sRGB value.
+  uint8_t ToSrgb(float _value)
+  {
+    static const auto table = []
+    {
+      std::array<uint8_t, kLinearSteps + 1> result;
+      for (int i = 0; i <= kLinearSteps; ++i)
+      {
+        double l = static_cast<double>(i) / kLinearSteps;
+        double c = l <= 0.0031308 ? l * 12.92 :
+            1.055 * std::pow(l, 1 / 2.4) - 0.055;
+        result[i] = static_cast<uint8_t>(std::lround(c * 255));
+      }
+      return result;
+    }();
+    auto index = std::lround(std::clamp(_value, 0.0f, 1.0f) * kLinearSteps);
+    return table[index];
+  }
+
+  /// \brief Quantize a color to RGB 565.
+  /// \param[in] _color Color, channels from 0 to 255.
+  /// \return Packed color.
+  uint16_t To565(const Color &_color)
+  {
+    auto r = std::lround(std::clamp(_color[0], 0.0f, 255.0f) * 31 / 255);
+    auto g = std::lround(std::clamp(_color[1], 0.0f, 255.0f) * 63 / 255);
+    auto b = std::lround(std::clamp(_color[2], 0.0f, 255.0f) * 31 / 255);
+    return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+  }
+
+  /// \brief Expand an RGB 565 color, the way GPUs do.
+  /// \param[in] _packed Packed color.
+  /// \return Channels from 0 to 255.
+  std::array<int, 3> From565(uint16_t _packed)
+  {
+    int r = (_packed >> 11) & 31;
+    int g = (_packed >> 5) & 63;
+    int b = _packed & 31;
+    return {(r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2)};
+  }
+
+  /// \brief Pick the nearest of the 4 colors a pair of endpoints
+  /// interpolates for each pixel.
+  /// \param[in] _block Pixels.
+  /// \param[in] _c0 First endpoint, greater than _c1 for 4 colors.
+  /// \param[in] _c1 Second endpoint.
+  /// \param[out] _indices Palette index of each pixel.
+  /// \return Sum of squared errors.
+  int Fit(const Block &_block, uint16_t _c0, uint16_t _c1,
+      std::array<uint8_t, 16> &_indices)
+  {
+    auto e0 = From565(_c0);
+    auto e1 = From565(_c1);
+    std::array<std::array<int, 3>, 4> palette{e0, e1, e0, e0};
+    for (int c = 0; c < 3; ++c)
+    {
+      palette[2][c] = (2 * e0[c] + e1[c]) / 3;
+      palette[3][c] = (e0[c] + 2 * e1[c]) / 3;
+    }
+
+    int total{0};
+    for (int i = 0; i < 16; ++i)
+    {
+      int best{0};
+      int bestError{INT32_MAX};
+      for (int p = 0; p < 4; ++p)
+      {
+        int error{0};
+        for (int c = 0; c < 3; ++c)
+        {
+          int d = _block[i][c] - palette[p][c];
+          error += d * d;
+        }
+        if (error < bestError)
+        {
+          best = p;
+          bestError = error;
+        }
+      }
+      _indices[i] = static_cast<uint8_t>(best);
+      total += bestError;
+    }
+    return total;
+  }
+
+  /// \brief Solve for the endpoints which best reproduce the pixels, given
+  /// the palette index of each pixel.
+  /// \param[in] _block Pixels.
+  /// \param[in] _indices Palette index of each pixel.
+  /// \param[out] _e0 First endpoint.
+  /// \param[out] _e1 Second endpoint.
+  /// \return False if all pixels use the same weights, so the endpoints
+  /// can't be told apart.
+  bool LeastSquares(const Block &_block,
+      const std::array<uint8_t, 16> &_indices, Color &_e0, Color &_e1)
+  {
+    // Weight of the first endpoint for each palette entry
+    constexpr float kWeights[4]{1.0f, 0.0f, 2.0f / 3, 1.0f / 3};
+
+    float aa{0}, ab{0}, bb{0};
+    Color ap{0, 0, 0}, bp{0, 0, 0};
+    for (int i = 0; i < 16; ++i)
+    {
+      float a = kWeights[_indices[i]];
+      float b = 1 - a;
+      aa += a * a;
+      ab += a * b;
+      bb += b * b;
+      for (int c = 0; c < 3; ++c)
+      {
+        ap[c] += a * _block[i][c];
+        bp[c] += b * _block[i][c];
+      }
+    }
+
+    float det = aa * bb - ab * ab;
+    if (std::abs(det) < 1e-6f)
+      return false;
+
+    for (int c = 0; c < 3; ++c)
+    {
+      _e0[c] = (bb * ap[c] - ab * bp[c]) / det;
+      _e1[c] = (aa * bp[c] - ab * ap[c]) / det;
+    }
+    return true;
+  }
+
+  /// \brief Compress the colors of a block into 4-color BC1.
+  /// \param[in] _block Pixels, alpha is ignored.
+  /// \param[out] _out 8 bytes.
+  void CompressColor(const Block &_block, uint8_t *_out)
+  {
+    uint16_t c0{0};
+    uint16_t c1{0};
+    std::array<uint8_t, 16> indices{};
+
+    bool solid = std::all_of(_block.begin(), _block.end(),
+        [&](const std::array<uint8_t, 4> &_pixel)
+        {
+          return std::equal(_pixel.begin(), _pixel.begin() + 3,
+              _block[0].begin());
+        });
+
+    if (solid)
+    {
+      // Common on slides, such as backgrounds
+      c0 = c1 = To565({static_cast<float>(_block[0][0]),
+          static_cast<float>(_block[0][1]), static_cast<float>(_block[0][2])});
+    }
+    else
+    {
+      // Principal axis of the colors
+      Color mean{0, 0, 0};
+      for (const auto &pixel : _block)
+      {
+        for (int c = 0; c < 3; ++c)
+          mean[c] += pixel[c] / 16.0f;
+      }
+
+      float cov[6]{0, 0, 0, 0, 0, 0};
+      for (const auto &pixel : _block)
+      {
+        float r = pixel[0] - mean[0];
+        float g = pixel[1] - mean[1];
+        float b = pixel[2] - mean[2];
+        cov[0] += r * r;
+        cov[1] += r * g;
+        cov[2] += r * b;
+        cov[3] += g * g;
+        cov[4] += g * b;
+        cov[5] += b * b;
+      }
+
+      Color axis{1, 1, 1};
+      for (int iter = 0; iter < 8; ++iter)
+      {
+        Color next{
+            cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2],
+            cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2],
+            cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2]};
+        float norm = std::max({std::abs(next[0]), std::abs(next[1]),
+            std::abs(next[2])});
+        if (norm < 1e-6f)
+          break;
+        for (int c = 0; c < 3; ++c)
+          axis[c] = next[c] / norm;
+      }
+
+      // Endpoints span the colors along the axis
+      float minProj{1e9f};
+      float maxProj{-1e9f};
+      float length = axis[0] * axis[0] + axis[1] * axis[1] +
+          axis[2] * axis[2];
+      for (const auto &pixel : _block)
+      {
+        float proj = ((pixel[0] - mean[0]) * axis[0] +
+            (pixel[1] - mean[1]) * axis[1] +
+            (pixel[2] - mean[2]) * axis[2]) / length;
+        minProj = std::min(minProj, proj);
+        maxProj = std::max(maxProj, proj);
+      }
+
+      Color e0, e1;
+      for (int c = 0; c < 3; ++c)
+      {
+        e0[c] = mean[c] + axis[c] * maxProj;
+        e1[c] = mean[c] + axis[c] * minProj;
+      }
+
+      c0 = To565(e0);
+      c1 = To565(e1);
+      int error = Fit(_block, c0, c1, indices);
+
+      // Refit the endpoints to the chosen indices while it helps
+      for (int iter = 0; iter < 2 && error > 0; ++iter)
+      {
+        if (!LeastSquares(_block, indices, e0, e1))
+          break;
+
+        std::array<uint8_t, 16> newIndices;
+        auto n0 = To565(e0);
+        auto n1 = To565(e1);
+        int newError = Fit(_block, n0, n1, newIndices);
+        if (newError >= error)
+          break;
+
+        c0 = n0;
+        c1 = n1;
+        indices = newIndices;
+        error = newError;
+      }
+    }
+
+    // The first endpoint must be greater for 4 colors
+    if (c0 == c1)
+    {
+      indices.fill(0);
+    }
+    else if (c0 < c1)
+    {
+      std::swap(c0, c1);
+      for (auto &index : indices)
+        index ^= 1;
+    }
+
+    uint32_t bits{0};
+    for (int i = 0; i < 16; ++i)
+      bits |= static_cast<uint32_t>(indices[i]) << (2 * i);
+
+    _out[0] = c0 & 0xFF;
+    _out[1] = c0 >> 8;
+    _out[2] = c1 & 0xFF;
+    _out[3] = c1 >> 8;
+    for (int i = 0; i < 4; ++i)
+      _out[4 + i] = (bits >> (8 * i)) & 0xFF;
+  }
+
+  /// \brief Compress the alpha of a block into an 8-value BC3 alpha block.
+  /// \param[in] _block Pixels.
+  /// \param[out] _out 8 bytes.
+  void CompressAlpha(const Block &_block, uint8_t *_out)
+  {
+    int a0{0};
+    int a1{255};
+    for (const auto &pixel : _block)
+    {
+      a0 = std::max<int>(a0, pixel[3]);
+      a1 = std::min<int>(a1, pixel[3]);
+    }
+
+    // Index 0 is a0, 1 is a1 and 2 to 7 blend from a0 to a1
+    std::array<int, 8> palette{a0, a1};
+    for (int i = 1; i < 7; ++i)
+      palette[i + 1] = ((7 - i) * a0 + i * a1) / 7;
+
+    uint64_t bits{0};
+    if (a0 != a1)
+    {
+      for (int i = 0; i < 16; ++i)
+      {
+        int best{0};
+        int bestError{INT32_MAX};
+        for (int p = 0; p < 8; ++p)
+        {
+          int error = std::abs(_block[i][3] - palette[p]);
+          if (error < bestError)
+          {
+            best = p;
+            bestError = error;
+          }
+        }
+        bits |= static_cast<uint64_t>(best) << (3 * i);
+      }
+    }
+
+    _out[0] = static_cast<uint8_t>(a0);
+    _out[1] = static_cast<uint8_t>(a1);
+    for (int i = 0; i < 6; ++i)
+      _out[2 + i] = (bits >> (8 * i)) & 0xFF;
+  }
+
+  /// \brief Append a little-endian 32-bit value.
+  /// \param[in] _value Value.
+  /// \param[out] _out Buffer.
+  void Put32(uint32_t _value, std::vector<uint8_t> &_out)
+  {
+    for (int i = 0; i < 4; ++i)
+      _out.push_back((_value >> (8 * i)) & 0xFF);
+  }
+}
+
+/////////////////////////////////////////////////
+BlockFormat TextureEncoder::Format(const RgbaImage &_image)
+{
+  for (std::size_t i = 3; i < _image.pixels.size(); i += 4)
+  {
+    if (_image.pixels[i] != 255)
+      return BLOCK_BC3;
+  }
+  return BLOCK_BC1;
+}
+
+/////////////////////////////////////////////////
+RgbaImage TextureEncoder::Downsample(const RgbaImage &_image)
+{
+  RgbaImage result;
+  result.width = std::max(1u, _image.width / 2);
+  result.height = std::max(1u, _image.height / 2);
+  result.pixels.resize(4 * result.width * result.height);
+
+  auto pixel = [&](uint32_t _x, uint32_t _y)
+  {
+    _x = std::min(_x, _image.width - 1);
+    _y = std::min(_y, _image.height - 1);
+    return &_image.pixels[4 * (_y * _image.width + _x)];
+  };
+
+  for (uint32_t y = 0; y < result.height; ++y)
+  {
+    for (uint32_t x = 0; x < result.width; ++x)
+    {
+      const uint8_t *source[4]{pixel(2 * x, 2 * y), pixel(2 * x + 1, 2 * y),
+          pixel(2 * x, 2 * y + 1), pixel(2 * x + 1, 2 * y + 1)};
+
+      // Colors are weighted by alpha, so transparent pixels, whatever
+      // their color, don't bleed into visible ones
+      int alpha{0};
+      float color[3]{0, 0, 0};
+      for (auto p : source)
+      {
+        alpha += p[3];
+        for (int c = 0; c < 3; ++c)
+          color[c] += ToLinear(p[c]) * p[3];
+      }
+
+      auto out = &result.pixels[4 * (y * result.width + x)];
+      for (int c = 0; c < 3; ++c)
+      {
+        if (alpha > 0)
+        {
+          out[c] = ToSrgb(color[c] / alpha);
+        }
+        else
+        {
+          float sum{0};
+          for (auto p : source)
+            sum += ToLinear(p[c]);
+          out[c] = ToSrgb(sum / 4);
+        }
+      }
+      out[3] = static_cast<uint8_t>((alpha + 2) / 4);
+    }
+  }
+
+  return result;
+}
+
+/////////////////////////////////////////////////
+void TextureEncoder::Compress(const RgbaImage &_image, BlockFormat _format,
+    std::vector<uint8_t> &_blocks)
+{
+  if (_image.width == 0 || _image.height == 0)
+    return;
+
+  uint32_t blocksX = (_image.width + 3) / 4;
+  uint32_t blocksY = (_image.height + 3) / 4;
+  std::size_t blockSize = _format == BLOCK_BC1 ? 8 : 16;
+
+  auto offset = _blocks.size();
+  _blocks.resize(offset + blockSize * blocksX * blocksY);
+  auto out = _blocks.data() + offset;
+
+  Block block;
+  for (uint32_t by = 0; by < blocksY; ++by)
+  {
+    for (uint32_t bx = 0; bx < blocksX; ++bx)
+    {
+      for (uint32_t i = 0; i < 16; ++i)
+      {
+        auto x = std::min(4 * bx + i % 4, _image.width - 1);
+        auto y = std::min(4 * by + i / 4, _image.height - 1);
+        std::memcpy(block[i].data(),
+            &_image.pixels[4 * (y * _image.width + x)], 4);
+      }
+
+      if (_format == BLOCK_BC3)
+      {
+        CompressAlpha(block, out);
+        out += 8;
+      }
+      CompressColor(block, out);
+      out += 8;
+    }
+  }
+}
+
+/////////////////////////////////////////////////
+bool TextureEncoder::Encode(const RgbaImage &_image,
+    std::vector<uint8_t> &_dds)
+{
+  if (_image.width == 0 || _image.height == 0 ||
+      _image.pixels.size() != 4u * _image.width * _image.height)
+  {
+    return false;
+  }
+
+  auto format = Format(_image);
+  std::size_t blockSize = format == BLOCK_BC1 ? 8 : 16;
+
+  uint32_t levels{1};
+  for (auto size = std::max(_image.width, _image.height); size > 1;
+      size /= 2)
+  {
+    ++levels;
+  }
+
+  // Legacy header, see DDS_HEADER and DDS_PIXELFORMAT
+  constexpr uint32_t kCaps{0x1};
+  constexpr uint32_t kHeight{0x2};
+  constexpr uint32_t kWidth{0x4};
+  constexpr uint32_t kPixelFormat{0x1000};
+  constexpr uint32_t kMipmapCount{0x20000};
+  constexpr uint32_t kLinearSize{0x80000};
+  constexpr uint32_t kFourCC{0x4};
+  constexpr uint32_t kComplex{0x8};
+  constexpr uint32_t kTexture{0x1000};
+  constexpr uint32_t kMipmap{0x400000};
+
+  _dds.clear();
+  _dds.insert(_dds.end(), {'D', 'D', 'S', ' '});
+  Put32(124, _dds);
+  Put32(kCaps | kHeight | kWidth | kPixelFormat | kMipmapCount | kLinearSize,
+      _dds);
+  Put32(_image.height, _dds);
+  Put32(_image.width, _dds);
+  Put32(static_cast<uint32_t>(blockSize * ((_image.width + 3) / 4) *
+      ((_image.height + 3) / 4)), _dds);
+  Put32(0, _dds);
+  Put32(levels, _dds);
+  for (int i = 0; i < 11; ++i)
+    Put32(0, _dds);
+
+  Put32(32, _dds);
+  Put32(kFourCC, _dds);
+  _dds.insert(_dds.end(), {'D', 'X', 'T',
+      static_cast<uint8_t>(format == BLOCK_BC1 ? '1' : '5')});
+  for (int i = 0; i < 5; ++i)
+    Put32(0, _dds);
+
+  Put32(kTexture | kComplex | kMipmap, _dds);
+  for (int i = 0; i < 4; ++i)
+    Put32(0, _dds);
+
+  // Levels from largest to 1x1
+  Compress(_image, format, _dds);
+  RgbaImage level;
+  const RgbaImage *previous = &_image;
+  for (uint32_t i = 1; i < levels; ++i)
+  {
+    level = Downsample(*previous);
+    Compress(level, format, _dds);
+    previous = &level;
+  }
+
+  return true;
+}
+
+/////////////////////////////////////////////////
+bool TextureEncoder::Write(const RgbaImage &_image,
+    const std::filesystem::path &_path)
+{
+  std::vector<uint8_t> dds;
+  if (!Encode(_image, dds))
+  {
+    sserr << "Can't encode empty image into [" << _path << "]" << std::endl;
+    return false;
+  }
+
+  auto tmp = _path;
+  tmp += ".tmp";
+  {
+    std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char *>(dds.data()), dds.size());
+    if (!out)
+    {
+      sserr << "Failed to write [" << tmp << "]" << std::endl;
+      return false;
+    }
+  }
+
+  std::error_code ec;
+  std::filesystem::rename(tmp, _path, ec);
+  if (ec)
+  {
+    sserr << "Failed to rename [" << tmp << "] to [" << _path << "]: "
+          << ec.message() << std::endl;
+    std::filesystem::remove(tmp, ec);
+    return false;
+  }
+
+  return true;
+}
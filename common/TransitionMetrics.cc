@@ -0,0 +1,263 @@
+/*
+ * Copyright 2017 Louise Poubel
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+#include "include/simslides/common/Log.hh"
+#include "include/simslides/common/TransitionMetrics.hh"
+
+using namespace simslides;
+
+namespace
+{
+  /// \brief Stage names, as used in the summary and the metric labels.
+  constexpr const char *kStageNames[] = {"input", "update", "camera", "total"};
+
+  /// \brief Name of a keyframe type, "home" for the initial pose.
+  /// \param[in] _type Keyframe type.
+  /// \return Name.
+  std::string TypeName(std::size_t _type)
+  {
+    if (_type == KeyframeType::NONE)
+      return "home";
+    return KeyframeTypeToStr(static_cast<KeyframeType>(_type));
+  }
+
+  /// \brief Convert a duration to milliseconds.
+  /// \param[in] _duration Duration.
+  /// \return Milliseconds.
+  double Ms(TransitionMetrics::Clock::duration _duration)
+  {
+    return std::chrono::duration<double, std::milli>(_duration).count();
+  }
+
+  /// \brief Convert a duration to seconds.
+  /// \param[in] _duration Duration.
+  /// \return Seconds.
+  double Seconds(TransitionMetrics::Clock::duration _duration)
+  {
+    return std::chrono::duration<double>(_duration).count();
+  }
+}
+
+/////////////////////////////////////////////////
+TransitionMetrics::TransitionMetrics()
+{
+  this->slowest.fill(-1);
+}
+
+/////////////////////////////////////////////////
+void TransitionMetrics::Clear()
+{
+  for (auto &stages : this->histograms)
+  {
+    for (auto &histogram : stages)
+      histogram.Clear();
+  }
+  this->slowest.fill(-1);
+  this->slowestTotal.fill(Clock::duration::zero());
+  this->hasReceived = false;
+  this->moving = false;
+  ++this->version;
+}
+
+/////////////////////////////////////////////////
+void TransitionMetrics::Received(Clock::time_point _time)
+{
+  if (!this->hasReceived || _time < this->received)
+    this->received = _time;
+  this->hasReceived = true;
+}
+
+/////////////////////////////////////////////////
+void TransitionMetrics::UpdateStarted(int _keyframe, KeyframeType _type,
+    Clock::time_point _time)
+{
+  // A transition still in flight was replaced
+  this->moving = false;
+
+  this->keyframe = _keyframe;
+  this->type = _type;
+  this->updateStart = _time;
+  this->start = this->hasReceived ? this->received : _time;
+}
+
+/////////////////////////////////////////////////
+void TransitionMetrics::UpdateEnded(Clock::time_point _time)
+{
+  auto &stages = this->histograms[this->type];
+  if (this->hasReceived)
+    stages[STAGE_INPUT].Record(this->updateStart - this->received);
+  stages[STAGE_UPDATE].Record(_time - this->updateStart);
+
+  this->hasReceived = false;
+  ++this->version;
+}
+
+/////////////////////////////////////////////////
+void TransitionMetrics::MoveIssued(Clock::time_point _time)
+{
+  this->moveIssued = _time;
+  this->moving = true;
+}
+
+/////////////////////////////////////////////////
+void TransitionMetrics::Settled(Clock::time_point _time)
+{
+  if (!this->moving)
+    return;
+  this->moving = false;
+
+  auto &stages = this->histograms[this->type];
+  stages[STAGE_CAMERA].Record(_time - this->moveIssued);
+
+  auto total = _time - this->start;
+  stages[STAGE_TOTAL].Record(total);
+  if (total > this->slowestTotal[this->type] || this->slowest[this->type] < 0)
+  {
+    this->slowestTotal[this->type] = total;
+    this->slowest[this->type] = this->keyframe;
+  }
+
+  ++this->version;
+}
+
+/////////////////////////////////////////////////
+const LatencyHistogram &TransitionMetrics::Histogram(KeyframeType _type,
+    TransitionStage _stage) const
+{
+  return this->histograms[_type][_stage];
+}
+
+/////////////////////////////////////////////////
+int TransitionMetrics::Slowest(KeyframeType _type) const
+{
+  return this->slowest[_type];
+}
+
+/////////////////////////////////////////////////
+uint64_t TransitionMetrics::Version() const
+{
+  return this->version;
+}
+
+/////////////////////////////////////////////////
+std::string TransitionMetrics::Summary() const
+{
+  std::ostringstream out;
+  out << std::fixed << std::setprecision(3)
+      << std::left << std::setw(10) << "type" << std::setw(8) << "stage"
+      << std::right << std::setw(7) << "count" << std::setw(11) << "p50 ms"
+      << std::setw(11) << "p95 ms" << std::setw(11) << "max ms" << std::endl;
+
+  for (std::size_t t = 0; t < kTypeCount; ++t)
+  {
+    if (this->histograms[t][STAGE_UPDATE].Count() == 0)
+      continue;
+
+    for (std::size_t s = 0; s < kStageCount; ++s)
+    {
+      const auto &histogram = this->histograms[t][s];
+      out << std::left << std::setw(10) << (s == 0 ? TypeName(t) : "")
+          << std::setw(8) << kStageNames[s] << std::right
+          << std::setw(7) << histogram.Count()
+          << std::setw(11) << Ms(histogram.Percentile(0.5))
+          << std::setw(11) << Ms(histogram.Percentile(0.95))
+          << std::setw(11) << Ms(histogram.Max()) << std::endl;
+    }
+
+    if (this->slowest[t] >= 0)
+    {
+      out << std::left << std::setw(10) << "" << "slowest keyframe ["
+          << this->slowest[t] << "], " << Ms(this->slowestTotal[t])
+          << " ms" << std::endl;
+    }
+  }
+
+  return out.str();
+}
+
+/////////////////////////////////////////////////
+bool TransitionMetrics::Write(const std::string &_path) const
+{
+  auto tmpPath = _path + ".tmp";
+  {
+    std::ofstream out(tmpPath, std::ios::trunc);
+    if (!out)
+    {
+      sserr << "Failed to open metrics file [" << tmpPath << "]"
+            << std::endl;
+      return false;
+    }
+
+    out << "# HELP simslides_transition_seconds Keyframe transition "
+        << "latency, by keyframe type and stage." << std::endl
+        << "# TYPE simslides_transition_seconds histogram" << std::endl;
+    out << std::setprecision(9);
+
+    for (std::size_t t = 0; t < kTypeCount; ++t)
+    {
+      for (std::size_t s = 0; s < kStageCount; ++s)
+      {
+        const auto &histogram = this->histograms[t][s];
+        auto labels = "type=\"" + TypeName(t) + "\",stage=\"" +
+            kStageNames[s] + "\"";
+
+        uint64_t cumulative{0};
+        for (std::size_t i = 0; i + 1 < LatencyHistogram::kBucketCount; ++i)
+        {
+          cumulative += histogram.Bucket(i);
+          out << "simslides_transition_seconds_bucket{" << labels
+              << ",le=\"" << Seconds(LatencyHistogram::UpperBound(i))
+              << "\"} " << cumulative << std::endl;
+        }
+        out << "simslides_transition_seconds_bucket{" << labels
+            << ",le=\"+Inf\"} " << histogram.Count() << std::endl
+            << "simslides_transition_seconds_sum{" << labels << "} "
+            << Seconds(histogram.Sum()) << std::endl
+            << "simslides_transition_seconds_count{" << labels << "} "
+            << histogram.Count() << std::endl;
+      }
+    }
+
+    out << "# HELP simslides_slowest_keyframe Keyframe with the longest "
+        << "total transition, by keyframe type." << std::endl
+        << "# TYPE simslides_slowest_keyframe gauge" << std::endl;
+    for (std::size_t t = 0; t < kTypeCount; ++t)
+    {
+      out << "simslides_slowest_keyframe{type=\"" << TypeName(t) << "\"} "
+          << this->slowest[t] << std::endl;
+    }
+
+    if (!out)
+    {
+      sserr << "Failed to write metrics file [" << tmpPath << "]"
+            << std::endl;
+      return false;
+    }
+  }
+
+  if (std::rename(tmpPath.c_str(), _path.c_str()) != 0)
+  {
+    sserr << "Failed to replace metrics file [" << _path << "]" << std::endl;
+    std::remove(tmpPath.c_str());
+    return false;
+  }
+
+  return true;
+}
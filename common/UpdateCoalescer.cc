@@ -0,0 +1,74 @@
+/*
+ * Copyright 2017 Louise Poubel
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+#include "include/simslides/common/UpdateCoalescer.hh"
+
+using namespace simslides;
+
+/////////////////////////////////////////////////
+void UpdateCoalescer::SetWindow(Clock::duration _window)
+{
+  this->window = _window;
+}
+
+/////////////////////////////////////////////////
+UpdateCoalescer::Clock::duration UpdateCoalescer::Window() const
+{
+  return this->window;
+}
+
+/////////////////////////////////////////////////
+bool UpdateCoalescer::Request(Clock::time_point _now)
+{
+  if (!this->pending && _now - this->lastUpdate >= this->window)
+  {
+    this->lastUpdate = _now;
+    return true;
+  }
+
+  this->pending = true;
+  return false;
+}
+
+/////////////////////////////////////////////////
+bool UpdateCoalescer::Poll(Clock::time_point _now)
+{
+  if (!this->pending || _now - this->lastUpdate < this->window)
+    return false;
+
+  this->pending = false;
+  this->lastUpdate = _now;
+  return true;
+}
+
+/////////////////////////////////////////////////
+bool UpdateCoalescer::Pending() const
+{
+  return this->pending;
+}
+
+/////////////////////////////////////////////////
+UpdateCoalescer::Clock::duration UpdateCoalescer::Remaining(
+    Clock::time_point _now) const
+{
+  if (!this->pending)
+    return Clock::duration::zero();
+
+  auto elapsed = _now - this->lastUpdate;
+  if (elapsed >= this->window)
+    return Clock::duration::zero();
+
+  return this->window - elapsed;
+}
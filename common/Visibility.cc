@@ -0,0 +1,141 @@
+/*
+ * Copyright 2017 Louise Poubel
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+#include <algorithm>
+
+#include "include/simslides/common/Visibility.hh"
+
+using namespace simslides;
+
+/////////////////////////////////////////////////
+void VisibilityIndex::Build(const KeyframeTable &_keyframes)
+{
+  this->words = (_keyframes.VisualCount() + 63) / 64;
+  this->checkpoints.clear();
+  this->fromBits.assign(this->words, 0);
+  this->toBits.assign(this->words, 0);
+
+  // All visuals start visible
+  std::vector<uint64_t> bits(this->words, ~uint64_t{0});
+
+  auto stackCount = _keyframes.StackCount();
+  this->checkpoints.reserve(
+      ((stackCount + kStride - 1) / kStride) * this->words);
+
+  for (std::size_t s = 0; s < stackCount; ++s)
+  {
+    if (s % kStride == 0)
+    {
+      this->checkpoints.insert(this->checkpoints.end(), bits.begin(),
+          bits.end());
+    }
+    ApplyStack(_keyframes, static_cast<uint32_t>(s),
+        _keyframes.Stack(static_cast<uint32_t>(s)).back, bits);
+  }
+}
+
+/////////////////////////////////////////////////
+void VisibilityIndex::Diff(const KeyframeTable &_keyframes, int _from,
+    int _to, std::vector<VisibilityChange> &_changes)
+{
+  _changes.clear();
+
+  if (_from == _to)
+    return;
+
+  this->State(_keyframes, _from, this->fromBits);
+  this->State(_keyframes, _to, this->toBits);
+
+  for (std::size_t w = 0; w < this->words; ++w)
+  {
+    auto changed = this->fromBits[w] ^ this->toBits[w];
+    while (changed)
+    {
+      auto bit = __builtin_ctzll(changed);
+      changed &= changed - 1;
+
+      // Keyframes without a visual have the empty visual, which isn't
+      // anything backends can show or hide
+      auto id = static_cast<uint32_t>(w * 64 + bit);
+      if (id == 0)
+        continue;
+
+      _changes.push_back({id, ((this->toBits[w] >> bit) & 1u) != 0});
+    }
+  }
+}
+
+/////////////////////////////////////////////////
+void VisibilityIndex::State(const KeyframeTable &_keyframes, int _keyframe,
+    std::vector<uint64_t> &_bits) const
+{
+  _bits.assign(this->words, ~uint64_t{0});
+
+  if (_keyframe < 0 || _keyframe >= static_cast<int>(_keyframes.Size()))
+    return;
+
+  auto index = static_cast<std::size_t>(_keyframe);
+
+  // Find the last stack which starts at or before the keyframe
+  auto stack = _keyframes.StackId(index);
+  if (stack == KeyframeTable::kNoStack)
+  {
+    std::size_t low = 0;
+    std::size_t high = _keyframes.StackCount();
+    while (low < high)
+    {
+      auto mid = (low + high) / 2;
+      if (_keyframes.Stack(static_cast<uint32_t>(mid)).front <= index)
+        low = mid + 1;
+      else
+        high = mid;
+    }
+
+    // No stacks yet, everything is still visible
+    if (low == 0)
+      return;
+
+    stack = static_cast<uint32_t>(low - 1);
+  }
+
+  // Start from the closest checkpoint and replay the stacks after it
+  auto checkpoint = stack / kStride;
+  std::copy_n(this->checkpoints.begin() + checkpoint * this->words,
+      this->words, _bits.begin());
+
+  for (auto s = static_cast<uint32_t>(checkpoint * kStride); s < stack; ++s)
+    ApplyStack(_keyframes, s, _keyframes.Stack(s).back, _bits);
+
+  // The keyframe is either inside the stack or past its end
+  const auto &range = _keyframes.Stack(stack);
+  ApplyStack(_keyframes, stack, std::min(index, range.back), _bits);
+}
+
+/////////////////////////////////////////////////
+void VisibilityIndex::ApplyStack(const KeyframeTable &_keyframes,
+    uint32_t _stack, std::size_t _shown, std::vector<uint64_t> &_bits)
+{
+  const auto &range = _keyframes.Stack(_stack);
+  for (auto i = range.front; i <= range.back; ++i)
+  {
+    auto id = _keyframes.VisualId(i);
+    if (id != 0)
+      _bits[id / 64] &= ~(uint64_t{1} << (id % 64));
+  }
+
+  auto id = _keyframes.VisualId(_shown);
+  if (id != 0)
+    _bits[id / 64] |= uint64_t{1} << (id % 64);
+}
@@ -0,0 +1,248 @@
+/*
+ * Copyright 2017 Louise Poubel
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+#include <ignition/math/Matrix4.hh>
+
+#include "include/simslides/common/World.hh"
+
+namespace
+{
+  /// \brief Pose of an element relative to its parent.
+  /// \param[in] _elem Model, link or visual element.
+  /// \return Pose, zero if not set.
+  ignition::math::Matrix4d LocalPose(const sdf::ElementPtr _elem)
+  {
+    if (!_elem->HasElement("pose"))
+      return ignition::math::Matrix4d::Identity;
+    return ignition::math::Matrix4d(
+        _elem->Get<ignition::math::Pose3d>("pose"));
+  }
+
+  /// \brief Check whether an element's pose is relative to its parent,
+  /// which is the only frame resolved here.
+  /// \param[in] _elem Model, link or visual element.
+  /// \param[in] _parentFrame Name which refers to the parent frame, such
+  /// as "world" or "__model__".
+  /// \return False if the pose is relative_to another frame.
+  bool RelativeToParent(const sdf::ElementPtr _elem,
+      const std::string &_parentFrame)
+  {
+    if (!_elem->HasElement("pose"))
+      return true;
+
+    auto poseElem = _elem->GetElement("pose");
+    if (!poseElem->HasAttribute("relative_to"))
+      return true;
+
+    auto frame = poseElem->GetAttribute("relative_to")->GetAsString();
+    return frame.empty() || frame == _parentFrame;
+  }
+
+  /// \brief Add the poses of a model, its links, visuals and nested models.
+  /// \param[in] _model Model element.
+  /// \param[in] _prefix Scoped name of the parent model followed by "::",
+  /// empty for top-level models.
+  /// \param[in] _parent Parent model's world pose.
+  /// \param[in] _parentStatic True if the parent model is static.
+  /// \param[in] _staticOnly Skip models which aren't static.
+  /// \param[in, out] _poses Map of entity name to world pose.
+  /// \param[in, out] _unresolved Entities with a pose relative_to another
+  /// frame.
+  void AddModelPoses(const sdf::ElementPtr _model, const std::string &_prefix,
+      const ignition::math::Matrix4d &_parent, bool _parentStatic,
+      bool _staticOnly, std::map<std::string, ignition::math::Pose3d> &_poses,
+      std::set<std::string> &_unresolved)
+  {
+    auto name = _prefix + _model->Get<std::string>("name");
+    bool isStatic = _parentStatic ||
+        (_model->HasElement("static") && _model->Get<bool>("static"));
+    bool add = !_staticOnly || isStatic;
+
+    // Nested models are left out too, their poses depend on this one's
+    if (!RelativeToParent(_model, _prefix.empty() ? "world" : "__model__"))
+    {
+      if (add)
+        _unresolved.insert(name);
+      return;
+    }
+
+    auto world = _parent * LocalPose(_model);
+
+    if (add)
+      _poses[name] = world.Pose();
+
+    if (add && _model->HasElement("link"))
+    {
+      auto linkElem = _model->GetElement("link");
+      while (linkElem)
+      {
+        auto linkName = name + "::" + linkElem->Get<std::string>("name");
+        if (!RelativeToParent(linkElem, "__model__"))
+        {
+          _unresolved.insert(linkName);
+          linkElem = linkElem->GetNextElement("link");
+          continue;
+        }
+
+        auto linkWorld = world * LocalPose(linkElem);
+        _poses[linkName] = linkWorld.Pose();
+
+        if (linkElem->HasElement("visual"))
+        {
+          auto visualElem = linkElem->GetElement("visual");
+          while (visualElem)
+          {
+            auto visualName =
+                linkName + "::" + visualElem->Get<std::string>("name");
+            if (RelativeToParent(visualElem,
+                linkElem->Get<std::string>("name")))
+            {
+              _poses[visualName] = (linkWorld * LocalPose(visualElem)).Pose();
+            }
+            else
+            {
+              _unresolved.insert(visualName);
+            }
+            visualElem = visualElem->GetNextElement("visual");
+          }
+        }
+
+        linkElem = linkElem->GetNextElement("link");
+      }
+    }
+
+    if (_model->HasElement("model"))
+    {
+      auto nestedElem = _model->GetElement("model");
+      while (nestedElem)
+      {
+        AddModelPoses(nestedElem, name + "::", world, isStatic, _staticOnly,
+            _poses, _unresolved);
+        nestedElem = nestedElem->GetNextElement("model");
+      }
+    }
+  }
+}
+
+/////////////////////////////////////////////////
+sdf::ElementPtr simslides::FindPlugin(const sdf::ElementPtr _root,
+    const std::string &_plugin)
+{
+  if (!_root || !_root->HasElement("world"))
+    return nullptr;
+
+  auto worldElem = _root->GetElement("world");
+  if (!worldElem->HasElement("gui"))
+    return nullptr;
+
+  auto guiElem = worldElem->GetElement("gui");
+  if (!guiElem->HasElement("plugin"))
+    return nullptr;
+
+  auto pluginElem = guiElem->GetElement("plugin");
+  while (pluginElem)
+  {
+    bool matches = _plugin.empty() ||
+        pluginElem->Get<std::string>("name") == _plugin ||
+        pluginElem->Get<std::string>("filename") == _plugin;
+
+    if (matches && (pluginElem->HasElement("keyframe") ||
+        pluginElem->HasElement("deck_file")))
+    {
+      return pluginElem;
+    }
+
+    pluginElem = pluginElem->GetNextElement("plugin");
+  }
+
+  return nullptr;
+}
+
+/////////////////////////////////////////////////
+std::map<std::string, ignition::math::Pose3d> simslides::ModelPoses(
+    const sdf::ElementPtr _root)
+{
+  std::map<std::string, ignition::math::Pose3d> poses;
+
+  if (!_root || !_root->HasElement("world"))
+    return poses;
+
+  auto worldElem = _root->GetElement("world");
+  if (!worldElem->HasElement("model"))
+    return poses;
+
+  auto modelElem = worldElem->GetElement("model");
+  while (modelElem)
+  {
+    ignition::math::Pose3d pose;
+    if (modelElem->HasElement("pose"))
+      pose = modelElem->Get<ignition::math::Pose3d>("pose");
+
+    poses[modelElem->Get<std::string>("name")] = pose;
+
+    modelElem = modelElem->GetNextElement("model");
+  }
+
+  return poses;
+}
+
+/////////////////////////////////////////////////
+std::map<std::string, ignition::math::Pose3d> simslides::EntityPoses(
+    const sdf::ElementPtr _root, bool _staticOnly,
+    std::set<std::string> &_unresolved)
+{
+  std::map<std::string, ignition::math::Pose3d> poses;
+  _unresolved.clear();
+
+  if (!_root || !_root->HasElement("world"))
+    return poses;
+
+  auto worldElem = _root->GetElement("world");
+  if (!worldElem->HasElement("model"))
+    return poses;
+
+  auto modelElem = worldElem->GetElement("model");
+  while (modelElem)
+  {
+    AddModelPoses(modelElem, "", ignition::math::Matrix4d::Identity, false,
+        _staticOnly, poses, _unresolved);
+    modelElem = modelElem->GetNextElement("model");
+  }
+
+  return poses;
+}
+
+/////////////////////////////////////////////////
+bool simslides::InitialCameraPose(const sdf::ElementPtr _root,
+    ignition::math::Pose3d &_pose)
+{
+  if (!_root || !_root->HasElement("world"))
+    return false;
+
+  auto worldElem = _root->GetElement("world");
+  if (!worldElem->HasElement("gui"))
+    return false;
+
+  auto guiElem = worldElem->GetElement("gui");
+  if (!guiElem->HasElement("camera"))
+    return false;
+
+  auto cameraElem = guiElem->GetElement("camera");
+  if (!cameraElem->HasElement("pose"))
+    return false;
+
+  _pose = cameraElem->Get<ignition::math::Pose3d>("pose");
+  return true;
+}
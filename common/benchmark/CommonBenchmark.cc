@@ -0,0 +1,600 @@
+/*
+ * Copyright 2017 Louise Poubel
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <sdf/parser.hh>
+#include <sdf/SDFImpl.hh>
+
+#include <simslides/common/Common.hh>
+#include <simslides/common/DeckFile.hh>
+#include <simslides/common/Log.hh>
+#include <simslides/common/TextureEncoder.hh>
+
+using namespace simslides;
+
+namespace
+{
+  /// \brief Number of distinct slides generated decks cycle through.
+  constexpr int kVisuals{1000};
+
+  /// \brief Right arrow key.
+  constexpr int kKeyNext{16777236};
+
+  /// \brief F6 key.
+  constexpr int kKeyHome{16777269};
+
+  /// \brief Type of the keyframe at a given index. Keyframes come in blocks
+  /// of 10, where the last _stackPercent / 10 are stacked.
+  /// \param[in] _index Keyframe index.
+  /// \param[in] _stackPercent Percentage of STACK keyframes, multiple of 10.
+  /// \return "lookat" or "stack".
+  const char *TypeAt(int64_t _index, int64_t _stackPercent)
+  {
+    return _index % 10 < 10 - _stackPercent / 10 ? "lookat" : "stack";
+  }
+
+  /// \brief Label of the keyframe at a given index.
+  /// \param[in] _index Keyframe index.
+  /// \return Label.
+  std::string LabelAt(int64_t _index)
+  {
+    return "keyframe-" + std::to_string(_index);
+  }
+
+  /// \brief XML for a single keyframe.
+  /// \param[in] _index Keyframe index.
+  /// \param[in] _stackPercent Percentage of STACK keyframes.
+  /// \param[in] _label Whether to add a label, which must be unique.
+  /// \return Keyframe element.
+  std::string KeyframeXml(int64_t _index, int64_t _stackPercent,
+      bool _label = false)
+  {
+    auto slide = _index % kVisuals;
+    std::ostringstream xml;
+    xml << "<keyframe type='" << TypeAt(_index, _stackPercent) << "'";
+    if (_label)
+      xml << " label='" << LabelAt(_index) << "'";
+    xml << " visual='slide-" << slide << "'"
+        << " number='" << slide << "'"
+        << " eye_offset='0 -3 0 0 0 1.5707'"
+        << " text='Slide &lt;&lt;b&gt;&gt;" << slide
+        << "&lt;&lt;/b&gt;&gt;'/>";
+    return xml.str();
+  }
+
+  /// \brief Parse a plugin element, the same way the Ignition plugin does.
+  /// \param[in] _body Plugin children.
+  /// \return Parsed SDF, which owns the plugin element.
+  sdf::SDFPtr ParsePlugin(const std::string &_body)
+  {
+    std::ostringstream xml;
+    xml << "<sdf version='" << SDF_VERSION << "'>"
+        << "<plugin filename='SimSlidesIgn' name='simslides'>"
+        << _body
+        << "</plugin></sdf>";
+
+    auto sdfParsed = std::make_shared<sdf::SDF>();
+    sdf::init(sdfParsed);
+    sdf::readString(xml.str(), sdfParsed);
+    return sdfParsed;
+  }
+
+  /// \brief Plugin element with _count keyframes. Cached, since parsing
+  /// large decks takes much longer than loading them.
+  /// \param[in] _count Number of keyframes.
+  /// \param[in] _stackPercent Percentage of STACK keyframes.
+  /// \return Plugin element.
+  sdf::ElementPtr PluginWithKeyframes(int64_t _count, int64_t _stackPercent)
+  {
+    static std::map<std::pair<int64_t, int64_t>, sdf::SDFPtr> cache;
+
+    auto &sdfParsed = cache[{_count, _stackPercent}];
+    if (!sdfParsed)
+    {
+      std::string body;
+      for (int64_t i = 0; i < _count; ++i)
+        body += KeyframeXml(i, _stackPercent, true);
+      sdfParsed = ParsePlugin(body);
+    }
+    return sdfParsed->Root()->GetElement("plugin");
+  }
+
+  /// \brief Path to a deck file with _count keyframes, written the first
+  /// time it's requested. Decks are built by adding keyframes one by one
+  /// from a pool of template elements, which scales to millions of
+  /// keyframes.
+  /// \param[in] _count Number of keyframes.
+  /// \param[in] _stackPercent Percentage of STACK keyframes.
+  /// \return Path to deck file.
+  std::string DeckWithKeyframes(int64_t _count, int64_t _stackPercent)
+  {
+    static std::map<std::pair<int64_t, int64_t>, std::string> cache;
+    static sdf::SDFPtr templatesSdf;
+    static std::vector<sdf::ElementPtr> templates;
+
+    auto &path = cache[{_count, _stackPercent}];
+    if (!path.empty())
+      return path;
+
+    // Templates for each visual: lookat followed by stack
+    if (templates.empty())
+    {
+      std::string body;
+      for (int i = 0; i < kVisuals; ++i)
+        body += KeyframeXml(i, 0) + KeyframeXml(i, 100);
+      templatesSdf = ParsePlugin(body);
+
+      auto elem = templatesSdf->Root()->GetElement("plugin")->GetElement(
+          "keyframe");
+      while (elem)
+      {
+        templates.push_back(elem);
+        elem = elem->GetNextElement("keyframe");
+      }
+    }
+
+    KeyframeTable table;
+    table.Reserve(_count);
+    for (int64_t i = 0; i < _count; ++i)
+    {
+      auto isStack = std::string(TypeAt(i, _stackPercent)) == "stack";
+      table.Add(templates[(i % kVisuals) * 2 + (isStack ? 1 : 0)]);
+    }
+
+    path = (std::filesystem::temp_directory_path() /
+        ("simslides_benchmark_" + std::to_string(_count) + "_" +
+        std::to_string(_stackPercent) + ".deck")).string();
+    DeckFile::Save(table, path);
+    return path;
+  }
+
+  /// \brief Plugin element pointing to a deck file.
+  /// \param[in] _count Number of keyframes.
+  /// \param[in] _stackPercent Percentage of STACK keyframes.
+  /// \return Plugin element.
+  sdf::ElementPtr PluginWithDeckFile(int64_t _count, int64_t _stackPercent)
+  {
+    static std::map<std::pair<int64_t, int64_t>, sdf::SDFPtr> cache;
+
+    auto &sdfParsed = cache[{_count, _stackPercent}];
+    if (!sdfParsed)
+    {
+      sdfParsed = ParsePlugin("<deck_file>" +
+          DeckWithKeyframes(_count, _stackPercent) + "</deck_file>");
+    }
+    return sdfParsed->Root()->GetElement("plugin");
+  }
+
+  /// \brief Backend which does nothing, so only Common is measured.
+  class NullBackend final : public Backend
+  {
+    // Documentation inherited
+    public: ignition::math::Pose3d CameraPose() const override
+    {
+      return this->cameraPose;
+    }
+
+    // Documentation inherited
+    public: void SetCameraPose(const ignition::math::Pose3d &_pose) override
+    {
+      this->cameraPose = _pose;
+    }
+
+    // Documentation inherited
+    public: void SetVisualsVisible(
+        const std::vector<VisibilityChange> &) override {}
+
+    // Documentation inherited
+    public: void SeekLog(std::chrono::steady_clock::duration) override {}
+
+    // Documentation inherited
+    public: void ResetCameraPose() override {}
+
+    // Documentation inherited
+    public: ignition::math::Pose3d VisualPose(uint32_t) override
+    {
+      return ignition::math::Pose3d(1, 2, 3, 0, 0, 0);
+    }
+
+    // Documentation inherited
+    public: void SetText(const std::string &) override {}
+
+    /// \brief Last pose set.
+    public: ignition::math::Pose3d cameraPose;
+  };
+
+  /// \brief Backend shared by all benchmarks.
+  NullBackend backend;
+
+  /// \brief Set a no-op backend and load a deck file into Common.
+  /// \param[in] _state Benchmark state, with count and stack percentage as
+  /// arguments.
+  void SetUpCommon(const benchmark::State &_state)
+  {
+    auto common = Common::Instance();
+    common->SetBackend(&backend);
+
+    common->LoadPluginSDF(PluginWithDeckFile(_state.range(0),
+        _state.range(1)));
+    common->currentKeyframe = -1;
+  }
+}
+
+/////////////////////////////////////////////////
+/// \brief Load <keyframe>s from SDF.
+static void BM_LoadPluginSDF(benchmark::State &_state)
+{
+  auto plugin = PluginWithKeyframes(_state.range(0), _state.range(1));
+  for (auto _ : _state)
+    Common::Instance()->LoadPluginSDF(plugin);
+
+  _state.SetItemsProcessed(_state.iterations() * _state.range(0));
+}
+
+/////////////////////////////////////////////////
+/// \brief Load a compiled <deck_file>.
+static void BM_LoadPluginSDFDeckFile(benchmark::State &_state)
+{
+  auto plugin = PluginWithDeckFile(_state.range(0), _state.range(1));
+  for (auto _ : _state)
+    Common::Instance()->LoadPluginSDF(plugin);
+
+  _state.SetItemsProcessed(_state.iterations() * _state.range(0));
+}
+
+/////////////////////////////////////////////////
+/// \brief Press next until the end of the deck, then home.
+static void BM_HandleKeyPress(benchmark::State &_state)
+{
+  SetUpCommon(_state);
+  auto common = Common::Instance();
+  auto last = static_cast<int>(common->keyframes.Size()) - 1;
+
+  for (auto _ : _state)
+  {
+    auto key = common->currentKeyframe < last ? kKeyNext : kKeyHome;
+    benchmark::DoNotOptimize(common->HandleKeyPress(key));
+  }
+}
+
+/////////////////////////////////////////////////
+/// \brief Jump to random keyframes.
+static void BM_ChangeKeyframe(benchmark::State &_state)
+{
+  SetUpCommon(_state);
+  auto common = Common::Instance();
+
+  std::mt19937 rng(0);
+  std::uniform_int_distribution<int> dist(0,
+      static_cast<int>(common->keyframes.Size()) - 1);
+
+  for (auto _ : _state)
+  {
+    common->ChangeKeyframe(dist(rng));
+    benchmark::DoNotOptimize(common->currentKeyframe);
+  }
+}
+
+/////////////////////////////////////////////////
+/// \brief Step through the deck one keyframe at a time, as when presenting.
+static void BM_UpdateNext(benchmark::State &_state)
+{
+  SetUpCommon(_state);
+  auto common = Common::Instance();
+  auto last = static_cast<int>(common->keyframes.Size()) - 1;
+
+  for (auto _ : _state)
+  {
+    common->currentKeyframe = common->currentKeyframe < last ?
+        common->currentKeyframe + 1 : 0;
+    common->Update(backend);
+  }
+}
+
+/////////////////////////////////////////////////
+/// \brief Step through the deck while every slide keeps moving, so no
+/// camera pose can be reused.
+static void BM_UpdateNextMoving(benchmark::State &_state)
+{
+  SetUpCommon(_state);
+  auto common = Common::Instance();
+  auto last = static_cast<int>(common->keyframes.Size()) - 1;
+
+  for (auto _ : _state)
+  {
+    common->currentKeyframe = common->currentKeyframe < last ?
+        common->currentKeyframe + 1 : 0;
+    common->VisualMoved(common->keyframes.Visual(common->currentKeyframe));
+    common->Update(backend);
+  }
+}
+
+/////////////////////////////////////////////////
+/// \brief Jump to random keyframes, which changes the visibility of more
+/// visuals at once.
+static void BM_UpdateJump(benchmark::State &_state)
+{
+  SetUpCommon(_state);
+  auto common = Common::Instance();
+
+  std::mt19937 rng(0);
+  std::uniform_int_distribution<int> dist(0,
+      static_cast<int>(common->keyframes.Size()) - 1);
+
+  for (auto _ : _state)
+  {
+    common->currentKeyframe = dist(rng);
+    common->Update(backend);
+  }
+}
+
+/////////////////////////////////////////////////
+/// \brief Sample a camera transition, as backends do every frame.
+static void BM_StepCamera(benchmark::State &_state)
+{
+  SetUpCommon(_state);
+  auto common = Common::Instance();
+  common->trajectory.SetDurationLimits(std::chrono::hours(1),
+      std::chrono::hours(1));
+  common->MoveCamera(backend, ignition::math::Pose3d(10, 20, 3, 0, 0.3, 2));
+
+  for (auto _ : _state)
+    benchmark::DoNotOptimize(common->StepCamera(backend));
+
+  common->trajectory.SetDurationLimits(
+      CameraTrajectory::kDefaultMinDuration,
+      CameraTrajectory::kDefaultMaxDuration);
+}
+
+/////////////////////////////////////////////////
+/// \brief Retarget a camera transition in flight, as when the presenter
+/// keeps pressing keys before the camera arrives.
+static void BM_RetargetCamera(benchmark::State &_state)
+{
+  SetUpCommon(_state);
+  auto common = Common::Instance();
+  common->trajectory.SetDurationLimits(std::chrono::hours(1),
+      std::chrono::hours(1));
+
+  const ignition::math::Pose3d goals[] = {
+      {10, 20, 3, 0, 0.3, 2}, {-10, 5, 1, 0, 0, -1}};
+  common->MoveCamera(backend, goals[0]);
+
+  std::size_t i{0};
+  for (auto _ : _state)
+    common->MoveCamera(backend, goals[++i % 2]);
+
+  common->trajectory.SetDurationLimits(
+      CameraTrajectory::kDefaultMinDuration,
+      CameraTrajectory::kDefaultMaxDuration);
+}
+
+/////////////////////////////////////////////////
+/// \brief Check whether autoplay is due, as backends do every frame. With
+/// a zero dwell, which is the third argument, every poll moves on to the
+/// next keyframe and updates.
+static void BM_PollAutoplay(benchmark::State &_state)
+{
+  SetUpCommon(_state);
+  auto common = Common::Instance();
+  common->autoplay.SetDefaultDwell(_state.range(2) != 0 ?
+      Autoplay::Clock::duration::zero() : std::chrono::hours(1));
+  common->autoplay.SetLoop(true);
+  common->autoplay.Play(Autoplay::Clock::now());
+  common->Update(backend);
+
+  for (auto _ : _state)
+  {
+    if (common->PollAutoplay())
+      common->Update(backend);
+  }
+
+  common->autoplay.Reset();
+  common->autoplay.SetDefaultDwell(Autoplay::kDefaultDwell);
+  common->autoplay.SetLoop(false);
+}
+
+/////////////////////////////////////////////////
+/// \brief Jump to random labeled keyframes.
+static void BM_GoToLabel(benchmark::State &_state)
+{
+  auto common = Common::Instance();
+  common->LoadPluginSDF(PluginWithKeyframes(_state.range(0),
+      _state.range(1)));
+
+  std::mt19937 rng(0);
+  std::uniform_int_distribution<int64_t> dist(0, _state.range(0) - 1);
+  std::vector<Command> commands;
+  for (int i = 0; i < 1024; ++i)
+    commands.push_back({CMD_GOTO_LABEL, 0, LabelAt(dist(rng))});
+
+  std::size_t i{0};
+  for (auto _ : _state)
+  {
+    benchmark::DoNotOptimize(common->Apply(commands[i++ % commands.size()]));
+  }
+}
+
+/////////////////////////////////////////////////
+/// \brief Jump to the first keyframe of random visuals.
+static void BM_GoToVisual(benchmark::State &_state)
+{
+  SetUpCommon(_state);
+  auto common = Common::Instance();
+
+  std::mt19937 rng(0);
+  std::uniform_int_distribution<int64_t> dist(0,
+      std::min<int64_t>(kVisuals, _state.range(0)) - 1);
+  std::vector<Command> commands;
+  for (int i = 0; i < 1024; ++i)
+  {
+    commands.push_back({CMD_GOTO_VISUAL, 0,
+        "slide-" + std::to_string(dist(rng))});
+  }
+
+  std::size_t i{0};
+  for (auto _ : _state)
+  {
+    benchmark::DoNotOptimize(common->Apply(commands[i++ % commands.size()]));
+  }
+}
+
+/////////////////////////////////////////////////
+/// \brief Queue key presses from several threads while the first thread
+/// also applies them, as the rendering thread does.
+static void BM_CommandQueue(benchmark::State &_state)
+{
+  static Common *common{nullptr};
+  if (_state.thread_index() == 0)
+  {
+    SetUpCommon(_state);
+    common = Common::Instance();
+  }
+
+  for (auto _ : _state)
+  {
+    common->PushKey(kKeyNext);
+    if (_state.thread_index() == 0)
+      benchmark::DoNotOptimize(common->ProcessCommands());
+  }
+
+  // All threads are done pushing once the loop ends
+  if (_state.thread_index() == 0)
+    common->ProcessCommands();
+}
+
+/////////////////////////////////////////////////
+/// \brief Encode a slide rendered at the import density into a mipmapped
+/// DDS: a white page with a title bar, lines of "text" and a photo.
+/// Argument 0 is 1 to add a translucent border, which selects BC3.
+static void BM_EncodeTexture(benchmark::State &_state)
+{
+  RgbaImage image;
+  image.width = 1500;
+  image.height = 844;
+  image.pixels.assign(4u * image.width * image.height, 255);
+
+  std::mt19937 random(1);
+  for (uint32_t y = 0; y < image.height; ++y)
+  {
+    for (uint32_t x = 0; x < image.width; ++x)
+    {
+      auto pixel = &image.pixels[4 * (y * image.width + x)];
+      if (y < 120)
+      {
+        pixel[0] = 30;
+        pixel[1] = 60;
+        pixel[2] = 140;
+      }
+      else if (x > 900 && y > 250 && y < 750)
+      {
+        for (int c = 0; c < 3; ++c)
+          pixel[c] = static_cast<uint8_t>(random());
+      }
+      else if (x > 100 && x < 850 && y % 60 > 20 && y % 60 < 40 &&
+          random() % 3 == 0)
+      {
+        pixel[0] = pixel[1] = pixel[2] = 0;
+      }
+
+      if (_state.range(0) && (x < 4 || y < 4))
+        pixel[3] = 128;
+    }
+  }
+
+  std::vector<uint8_t> dds;
+  for (auto _ : _state)
+  {
+    TextureEncoder::Encode(image, dds);
+    benchmark::DoNotOptimize(dds.data());
+  }
+
+  _state.SetBytesProcessed(_state.iterations() * image.pixels.size());
+}
+
+/////////////////////////////////////////////////
+/// \brief Deck sizes and stack percentages.
+/// \param[in] _bench Benchmark to add arguments to.
+/// \param[in] _maxCount Largest deck size.
+static void DeckArgs(benchmark::internal::Benchmark *_bench,
+    int64_t _maxCount)
+{
+  _bench->ArgNames({"keyframes", "stack_pct"});
+  for (int64_t count : {10, 1000, 100000, 1000000})
+  {
+    if (count > _maxCount)
+      continue;
+    for (int64_t stackPercent : {0, 50, 90})
+      _bench->Args({count, stackPercent});
+  }
+}
+
+/////////////////////////////////////////////////
+/// \brief All deck sizes.
+/// \param[in] _bench Benchmark to add arguments to.
+static void AllDecks(benchmark::internal::Benchmark *_bench)
+{
+  DeckArgs(_bench, 1000000);
+}
+
+/////////////////////////////////////////////////
+/// \brief Deck sizes which can be loaded from SDF in reasonable time.
+/// Walking the <keyframe> siblings of an SDF element is quadratic in
+/// sdformat, so this stops at 100k keyframes.
+/// \param[in] _bench Benchmark to add arguments to.
+static void SdfDecks(benchmark::internal::Benchmark *_bench)
+{
+  DeckArgs(_bench, 100000);
+}
+
+BENCHMARK(BM_LoadPluginSDF)->Apply(SdfDecks)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_LoadPluginSDFDeckFile)->Apply(AllDecks)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_HandleKeyPress)->Apply(AllDecks);
+BENCHMARK(BM_ChangeKeyframe)->Apply(AllDecks);
+BENCHMARK(BM_UpdateNext)->Apply(AllDecks);
+BENCHMARK(BM_UpdateNextMoving)->Apply(AllDecks);
+BENCHMARK(BM_UpdateJump)->Apply(AllDecks);
+BENCHMARK(BM_StepCamera)->Args({10, 0});
+BENCHMARK(BM_RetargetCamera)->Args({10, 0});
+BENCHMARK(BM_PollAutoplay)->Args({1000, 0, 0})->Args({1000, 0, 1});
+BENCHMARK(BM_GoToLabel)->Apply(SdfDecks);
+BENCHMARK(BM_GoToVisual)->Apply(AllDecks);
+BENCHMARK(BM_CommandQueue)->Args({1000, 50})->ThreadRange(1, 8);
+BENCHMARK(BM_EncodeTexture)->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
+
+/////////////////////////////////////////////////
+int main(int argc, char **argv)
+{
+  // Keep per-load messages out of the results
+  Logger::Instance()->SetLevel(LOG_WARNING);
+
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv))
+    return 1;
+  benchmark::RunSpecifiedBenchmarks();
+  return 0;
+}
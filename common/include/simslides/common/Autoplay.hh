@@ -0,0 +1,129 @@
+/*
+ * Copyright 2017 Louise Poubel
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+#ifndef SIMSLIDES_AUTOPLAY_HH_
+#define SIMSLIDES_AUTOPLAY_HH_
+
+#include <chrono>
+
+namespace simslides
+{
+  /// \brief Schedule for moving through keyframes on a timer, for
+  /// unattended presentations such as kiosks.
+  ///
+  /// Each keyframe is shown for its dwell time. Deadlines are kept on a
+  /// monotonic clock, and when autoplay moves on, the next deadline is
+  /// counted from the previous deadline instead of from the time it was
+  /// noticed, so frames which poll a little late don't add up to drift over
+  /// hours of looping. If polling stops for longer than a whole dwell, such
+  /// as while the machine sleeps, the schedule restarts from the current
+  /// time instead of rushing through the missed keyframes.
+  ///
+  /// There's no timer thread, the thread which updates calls Due every
+  /// frame.
+  class Autoplay
+  {
+    /// \brief Clock used for all time points.
+    public: using Clock = std::chrono::steady_clock;
+
+    /// \brief Default time each keyframe is shown.
+    public: static constexpr std::chrono::seconds kDefaultDwell{10};
+
+    /// \brief Keyframe index meaning that nothing is scheduled.
+    public: static constexpr int kNone{-2};
+
+    /// \brief Stop playing and forget the scheduled keyframe, such as when
+    /// a new deck is loaded. Loop and default dwell are kept.
+    public: void Reset();
+
+    /// \brief Start or resume playing. A keyframe paused in the middle of
+    /// its dwell is shown for the rest of it.
+    /// \param[in] _now Current time.
+    public: void Play(Clock::time_point _now);
+
+    /// \brief Pause, keeping the time left on the current keyframe.
+    /// \param[in] _now Current time.
+    public: void Pause(Clock::time_point _now);
+
+    /// \brief Whether autoplay is playing.
+    /// \return True if playing, false if paused.
+    public: bool Playing() const;
+
+    /// \brief Set whether to go back to the first keyframe after the last
+    /// one. Otherwise autoplay pauses on the last keyframe.
+    /// \param[in] _loop True to loop.
+    public: void SetLoop(bool _loop);
+
+    /// \brief Whether to go back to the first keyframe after the last one.
+    /// \return True if looping.
+    public: bool Loop() const;
+
+    /// \brief Set the time keyframes without a dwell of their own are shown.
+    /// \param[in] _dwell Dwell duration.
+    public: void SetDefaultDwell(Clock::duration _dwell);
+
+    /// \brief Get the time keyframes without a dwell of their own are shown.
+    /// \return Dwell duration.
+    public: Clock::duration DefaultDwell() const;
+
+    /// \brief Notify that a keyframe is being shown. A keyframe other than
+    /// the scheduled one, such as one picked by the presenter, is shown
+    /// for its whole dwell starting now. The scheduled keyframe is left as
+    /// is.
+    /// \param[in] _keyframe Keyframe index.
+    /// \param[in] _dwell Time to show it.
+    /// \param[in] _now Current time.
+    public: void Show(int _keyframe, Clock::duration _dwell,
+        Clock::time_point _now);
+
+    /// \brief Move the schedule on to the next keyframe once Due returns
+    /// true. Its dwell starts at the previous deadline.
+    /// \param[in] _keyframe Next keyframe index.
+    /// \param[in] _dwell Time to show it.
+    /// \param[in] _now Current time.
+    public: void Advance(int _keyframe, Clock::duration _dwell,
+        Clock::time_point _now);
+
+    /// \brief Whether the scheduled keyframe was shown for its whole dwell.
+    /// \param[in] _now Current time.
+    /// \return True if playing and it's time to move on.
+    public: bool Due(Clock::time_point _now) const;
+
+    /// \brief Time left on the scheduled keyframe.
+    /// \param[in] _now Current time.
+    /// \return Remaining time, zero if due or if nothing is scheduled.
+    public: Clock::duration Remaining(Clock::time_point _now) const;
+
+    /// \brief Keyframe being shown.
+    private: int keyframe{kNone};
+
+    /// \brief Time the keyframe's dwell ends, while playing.
+    private: Clock::time_point deadline;
+
+    /// \brief Time left on the keyframe, while paused.
+    private: Clock::duration remaining{0};
+
+    /// \brief Default dwell.
+    private: Clock::duration defaultDwell{kDefaultDwell};
+
+    /// \brief Whether playing.
+    private: bool playing{false};
+
+    /// \brief Whether to loop.
+    private: bool loop{false};
+  };
+}
+
+#endif
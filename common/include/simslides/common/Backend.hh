@@ -0,0 +1,78 @@
+/*
+ * Copyright 2017 Louise Poubel
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+#ifndef SIMSLIDES_BACKEND_HH_
+#define SIMSLIDES_BACKEND_HH_
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <ignition/math/Pose3.hh>
+
+#include "Visibility.hh"
+
+namespace simslides
+{
+  /// \brief Interface between the presentation logic in Common and the
+  /// simulator it drives.
+  ///
+  /// Common::Update is a template on the backend type. Backends declared
+  /// final which call Common::Update(*this) get all calls statically
+  /// dispatched. Common::Update() without arguments goes through the
+  /// backend registered with Common::SetBackend instead.
+  class Backend
+  {
+    /// \brief Destructor.
+    public: virtual ~Backend() = default;
+
+    /// \brief Get the camera pose, where transitions start from.
+    /// \return Camera pose in world frame.
+    public: virtual ignition::math::Pose3d CameraPose() const = 0;
+
+    /// \brief Set the camera pose right away. Transitions are planned by
+    /// Common, and backends call Common::StepCamera every rendered frame,
+    /// which calls this with the next pose.
+    /// \param[in] _pose Camera pose in world frame.
+    public: virtual void SetCameraPose(const ignition::math::Pose3d &_pose)
+        = 0;
+
+    /// \brief Show / hide visuals. It's called at most once per keyframe
+    /// change, with all the visuals which must change visibility.
+    /// \param[in] _changes Visuals to change and their new visibility.
+    public: virtual void SetVisualsVisible(
+        const std::vector<VisibilityChange> &_changes) = 0;
+
+    /// \brief Seek a log.
+    /// \param[in] _time Time to seek to.
+    public: virtual void SeekLog(std::chrono::steady_clock::duration _time)
+        = 0;
+
+    /// \brief Set the camera back to its initial pose.
+    public: virtual void ResetCameraPose() = 0;
+
+    /// \brief Get a visual's pose.
+    /// \param[in] _id Visual ID, see KeyframeTable::VisualName.
+    /// \return Visual's pose in world frame, NaN if it can't be found.
+    public: virtual ignition::math::Pose3d VisualPose(uint32_t _id) = 0;
+
+    /// \brief Set the text.
+    /// \param[in] _text Text to set.
+    public: virtual void SetText(const std::string &_text) = 0;
+  };
+}
+
+#endif
@@ -0,0 +1,174 @@
+/*
+ * Copyright 2017 Louise Poubel
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+#ifndef SIMSLIDES_CAMERATRAJECTORY_HH_
+#define SIMSLIDES_CAMERATRAJECTORY_HH_
+
+#include <chrono>
+
+#include <ignition/math/Helpers.hh>
+#include <ignition/math/Pose3.hh>
+#include <ignition/math/Vector3.hh>
+
+namespace simslides
+{
+  /// \brief Smooth camera motion from one pose to another, planned once
+  /// and sampled by the backend every rendered frame.
+  ///
+  /// The position follows a cubic Bezier curve which leaves the start
+  /// backwards along its view direction and reaches the goal moving forward
+  /// along the goal's view direction, so the camera pulls back and pushes
+  /// in instead of sliding sideways across the slides. The orientation is
+  /// slerped. Both are eased in and out, so the camera starts and stops
+  /// smoothly.
+  ///
+  /// Durations grow with the distance and angle travelled and are clamped,
+  /// so the time it takes to reach a keyframe is predictable.
+  ///
+  /// A trajectory can be replaced while it's running. The new one starts
+  /// from the pose and velocity the camera has at that moment, so it
+  /// curves towards the new goal without snapping or stopping first.
+  class CameraTrajectory
+  {
+    /// \brief Clock used for all time points.
+    public: using Clock = std::chrono::steady_clock;
+
+    /// \brief Default linear speed used to compute durations, in m/s.
+    public: static constexpr double kDefaultSpeed{4.0};
+
+    /// \brief Default angular speed used to compute durations, in rad/s.
+    public: static constexpr double kDefaultAngularSpeed{IGN_PI};
+
+    /// \brief Default shortest transition.
+    public: static constexpr std::chrono::milliseconds kDefaultMinDuration{
+        250};
+
+    /// \brief Default longest transition.
+    public: static constexpr std::chrono::milliseconds kDefaultMaxDuration{
+        1500};
+
+    /// \brief Set the speeds used to compute durations.
+    /// \param[in] _linear Linear speed in m/s, must be positive.
+    /// \param[in] _angular Angular speed in rad/s, must be positive.
+    public: void SetSpeed(double _linear, double _angular);
+
+    /// \brief Set the shortest and longest transitions.
+    /// \param[in] _min Shortest transition.
+    /// \param[in] _max Longest transition, not smaller than _min.
+    public: void SetDurationLimits(Clock::duration _min,
+        Clock::duration _max);
+
+    /// \brief Time to move between two poses, given the speeds and limits.
+    /// \param[in] _start Start pose.
+    /// \param[in] _goal Goal pose.
+    /// \return Duration, zero if the poses are practically the same.
+    public: Clock::duration Duration(const ignition::math::Pose3d &_start,
+        const ignition::math::Pose3d &_goal) const;
+
+    /// \brief Plan a new trajectory, replacing the current one.
+    /// \param[in] _start Start pose.
+    /// \param[in] _goal Goal pose.
+    /// \param[in] _now Time the trajectory starts.
+    /// \param[in] _duration Time to reach the goal, positive.
+    /// \param[in] _velocity Linear velocity at the start, in m/s. Pass the
+    /// velocity from State when retargeting a running trajectory.
+    public: void Plan(const ignition::math::Pose3d &_start,
+        const ignition::math::Pose3d &_goal, Clock::time_point _now,
+        Clock::duration _duration,
+        const ignition::math::Vector3d &_velocity =
+        ignition::math::Vector3d::Zero);
+
+    /// \brief Get the pose and velocity at a given time, without changing
+    /// the trajectory.
+    /// \param[in] _now Current time.
+    /// \param[out] _pose Camera pose, only set if active.
+    /// \param[out] _velocity Linear velocity in m/s, only set if active.
+    /// \return False if there's no active trajectory.
+    public: bool State(Clock::time_point _now, ignition::math::Pose3d &_pose,
+        ignition::math::Vector3d &_velocity) const;
+
+    /// \brief Whether the trajectory is in progress towards a given goal.
+    /// \param[in] _goal Goal pose.
+    /// \return True if active and the goal is practically the same.
+    public: bool HeadingTo(const ignition::math::Pose3d &_goal) const;
+
+    /// \brief Get the pose at a given time. Once the trajectory is over,
+    /// the goal is returned one last time and the trajectory stops.
+    /// \param[in] _now Current time.
+    /// \param[out] _pose Camera pose, only set if active.
+    /// \return False if there's no active trajectory.
+    public: bool Sample(Clock::time_point _now, ignition::math::Pose3d &_pose);
+
+    /// \brief Stop the trajectory where it is, such as when something else
+    /// moves the camera.
+    public: void Stop();
+
+    /// \brief Stop the trajectory and get its goal.
+    /// \param[out] _pose Goal, only set if active.
+    /// \return False if there's no active trajectory.
+    public: bool Finish(ignition::math::Pose3d &_pose);
+
+    /// \brief Whether a trajectory is in progress.
+    /// \return True if active.
+    public: bool Active() const;
+
+    /// \brief Goal of the current or last trajectory.
+    /// \return Goal pose.
+    public: const ignition::math::Pose3d &Goal() const;
+
+    /// \brief Evaluate the trajectory.
+    /// \param[in] _u Normalized time, from 0 to 1.
+    /// \param[out] _pose Camera pose.
+    /// \param[out] _velocity Linear velocity in m/s.
+    private: void Evaluate(double _u, ignition::math::Pose3d &_pose,
+        ignition::math::Vector3d &_velocity) const;
+
+    /// \brief Linear speed in m/s.
+    private: double speed{kDefaultSpeed};
+
+    /// \brief Angular speed in rad/s.
+    private: double angularSpeed{kDefaultAngularSpeed};
+
+    /// \brief Shortest transition.
+    private: Clock::duration minDuration{kDefaultMinDuration};
+
+    /// \brief Longest transition.
+    private: Clock::duration maxDuration{kDefaultMaxDuration};
+
+    /// \brief Bezier control points, from start to goal.
+    private: ignition::math::Vector3d points[4];
+
+    /// \brief Start pose.
+    private: ignition::math::Pose3d start;
+
+    /// \brief Goal pose.
+    private: ignition::math::Pose3d goal;
+
+    /// \brief Time the trajectory started.
+    private: Clock::time_point startTime;
+
+    /// \brief Time to reach the goal.
+    private: Clock::duration duration{0};
+
+    /// \brief Rate of progress along the curve at the start, relative to
+    /// the average. 0 starts from rest, 1 keeps the start velocity.
+    private: double startRate{0};
+
+    /// \brief Whether a trajectory is in progress.
+    private: bool active{false};
+  };
+}
+
+#endif
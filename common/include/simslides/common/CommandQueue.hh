@@ -0,0 +1,142 @@
+/*
+ * Copyright 2017 Louise Poubel
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+#ifndef SIMSLIDES_COMMANDQUEUE_HH_
+#define SIMSLIDES_COMMANDQUEUE_HH_
+
+#include <atomic>
+#include <chrono>
+#include <string>
+
+namespace simslides
+{
+  /// \brief Presentation command types
+  enum CommandType
+  {
+    /// \brief Go to the next keyframe
+    CMD_NEXT,
+
+    /// \brief Go to the previous keyframe
+    CMD_PREVIOUS,
+
+    /// \brief Go to a given keyframe
+    CMD_GOTO,
+
+    /// \brief Go back to the initial camera pose
+    CMD_HOME,
+
+    /// \brief Replay the current keyframe
+    CMD_REPLAY,
+
+    /// \brief Go to the keyframe with a given label
+    CMD_GOTO_LABEL,
+
+    /// \brief Go to the first keyframe attached to a given visual
+    CMD_GOTO_VISUAL,
+
+    /// \brief Start or resume autoplay
+    CMD_PLAY,
+
+    /// \brief Pause autoplay
+    CMD_PAUSE,
+
+    /// \brief Go back to the first keyframe after the last one while
+    /// autoplaying
+    CMD_LOOP,
+
+    /// \brief Pause autoplay on the last keyframe
+    CMD_NO_LOOP
+  };
+
+  /// \brief A command requested by the user.
+  struct Command
+  {
+    /// \brief Command type.
+    CommandType type;
+
+    /// \brief Keyframe index, only used by CMD_GOTO.
+    int keyframe{0};
+
+    /// \brief Label or visual name, only used by CMD_GOTO_LABEL and
+    /// CMD_GOTO_VISUAL. It's resolved when the command is applied, on the
+    /// thread which owns the keyframes.
+    std::string target;
+
+    /// \brief Time the command was received, used to measure transition
+    /// latency. CommandQueue::Push sets it if it's left at the epoch.
+    std::chrono::steady_clock::time_point received{};
+  };
+
+  /// \brief Unbounded multi-producer, single-consumer queue of commands.
+  ///
+  /// Based on Dmitry Vyukov's node-based MPSC queue. Producers on any
+  /// thread enqueue with a single atomic exchange and never wait on each
+  /// other or on the consumer. Only one thread, usually the render or GUI
+  /// thread, may call Pop.
+  ///
+  /// Commands are copied into their node before it's published, so the
+  /// consumer never sees a partially written command. A push which is in
+  /// progress while Pop runs may make Pop return false once; the command is
+  /// returned by a later Pop.
+  ///
+  /// Each Push allocates its node with new, which Pop deletes, so pushing
+  /// goes through the heap allocator. Commands come from user input and
+  /// remote clients at a few per second, so nodes aren't pooled.
+  class CommandQueue
+  {
+    /// \brief Constructor.
+    public: CommandQueue();
+
+    /// \brief Destructor, frees commands which were never popped.
+    public: ~CommandQueue();
+
+    /// \brief Not copyable.
+    public: CommandQueue(const CommandQueue &) = delete;
+
+    /// \brief Not copyable.
+    public: CommandQueue &operator=(const CommandQueue &) = delete;
+
+    /// \brief Add a command. Safe to call from any thread. Allocates one
+    /// node.
+    /// \param[in] _command Command to add. If it doesn't have a received
+    /// time, it's stamped with the current time.
+    public: void Push(const Command &_command);
+
+    /// \brief Take the oldest command. Must only be called from the
+    /// consumer thread.
+    /// \param[out] _command Oldest command, only set on success.
+    /// \return False if there are no commands ready.
+    public: bool Pop(Command &_command);
+
+    /// \brief Queue node.
+    private: struct Node
+    {
+      /// \brief Next node, towards the newest command.
+      std::atomic<Node *> next{nullptr};
+
+      /// \brief Command held by the node.
+      Command command{CMD_REPLAY, 0, std::string(), {}};
+    };
+
+    /// \brief Newest node, where producers push.
+    private: std::atomic<Node *> head;
+
+    /// \brief Oldest node, whose command has already been popped. Only
+    /// touched by the consumer.
+    private: Node *tail;
+  };
+}
+
+#endif
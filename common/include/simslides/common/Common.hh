@@ -16,10 +16,22 @@
 #ifndef SIMSLIDES_COMMON_HH_
 #define SIMSLIDES_COMMON_HH_
 
+#include <cmath>
+#include <limits>
 #include <memory>
 #include <string>
 
+#include "Autoplay.hh"
+#include "Backend.hh"
+#include "CameraTrajectory.hh"
+#include "CommandQueue.hh"
+#include "EyePoseCache.hh"
 #include "Keyframe.hh"
+#include "KeyframeTable.hh"
+#include "MetricsExporter.hh"
+#include "TransitionMetrics.hh"
+#include "UpdateCoalescer.hh"
+#include "Visibility.hh"
 
 namespace simslides
 {
@@ -37,49 +49,190 @@ namespace simslides
        return instance;
      }
 
-     /// \brief Update the state according to current keyframe.
+     /// \brief Update the state according to current keyframe, through the
+     /// backend set with SetBackend. Does nothing if there's no backend.
      public: void Update();
 
+     /// \brief Update the state according to current keyframe, calling a
+     /// given backend. Calls are statically dispatched if BackendT is a
+     /// final class.
+     /// \param[in] _backend Backend to call.
+     /// \tparam BackendT Backend type, with the same functions as Backend.
+     public: template<typename BackendT>
+     void Update(BackendT &_backend);
+
+     /// \brief Set the backend used by Update and the functions which call
+     /// it. The backend must outlive Common or unset itself.
+     /// \param[in] _backend Backend, null to unset.
+     public: void SetBackend(Backend *_backend);
+
+     /// \brief Get the current backend.
+     /// \return Backend, null if not set.
+     public: Backend *CurrentBackend() const;
+
+     /// \brief Update after the current keyframe changed in response to
+     /// user input. Bursts of changes, such as a held down key, are
+     /// coalesced into a single update, see UpdateCoalescer. If this
+     /// returns false, the backend must call PollUpdate until it returns
+     /// true.
+     /// \return True if Update was called, false if it was deferred.
+     public: bool RequestUpdate();
+
+     /// \brief Same as RequestUpdate(), calling a given backend.
+     /// \param[in] _backend Backend to call.
+     /// \tparam BackendT Backend type, with the same functions as Backend.
+     /// \return True if Update was called, false if it was deferred.
+     public: template<typename BackendT>
+     bool RequestUpdate(BackendT &_backend);
+
+     /// \brief Run a deferred update if it's due.
+     /// \return True if Update was called.
+     public: bool PollUpdate();
+
+     /// \brief Same as PollUpdate(), calling a given backend.
+     /// \param[in] _backend Backend to call.
+     /// \tparam BackendT Backend type, with the same functions as Backend.
+     /// \return True if Update was called.
+     public: template<typename BackendT>
+     bool PollUpdate(BackendT &_backend);
+
      /// \brief Load <gui><plugin> tag for libsimslides.
      /// \param[in] _sdf SDF element.
      public: void LoadPluginSDF(const sdf::ElementPtr _sdf);
 
-     /// \brief Handle an incoming key press from the user
+     /// \brief Handle an incoming key press from the user right away. Only
+     /// call it from the thread which updates, see PushKey otherwise.
      /// \param[in] _key Key as an integer
      /// \return True if key is handled, false if key should be ignored
      public: bool HandleKeyPress(int _key);
 
+     /// \brief Get the command bound to a key.
+     /// \param[in] _key Key as an integer
+     /// \param[out] _command Command, only set if the key is bound.
+     /// \return False if the key isn't bound to a command.
+     public: static bool KeyToCommand(int _key, Command &_command);
+
+     /// \brief Queue the command bound to a key, to be applied by
+     /// ProcessCommands. Safe to call from any thread, such as a transport
+     /// callback.
+     /// \param[in] _key Key as an integer
+     /// \return True if the key is bound to a command.
+     public: bool PushKey(int _key);
+
+     /// \brief Apply all queued commands, see the commands queue. Only the
+     /// thread which updates may call it.
+     /// \return True if any command changed the state, and an update must
+     /// be requested.
+     public: bool ProcessCommands();
+
+     /// \brief Apply a command to the current keyframe.
+     /// \param[in] _command Command to apply.
+     /// \return True if the command was applied, false if it should be
+     /// ignored, such as going past the last keyframe. Autoplay commands
+     /// don't need an update, so they always return false.
+     public: bool Apply(const Command &_command);
+
      /// \brief Change to the given keyframe.
      /// If -1, go back to initial pose.
      /// If larger than total of keyframes, go to last keyframe.
      /// \param[in] _keyframe Index of keyframe to go to.
      public: void ChangeKeyframe(int _keyframe);
 
-     /// \brief Function called to move camera, containing the target pose.
-     public: std::function<void(const ignition::math::Pose3d &)> MoveCamera;
+     /// \brief Move on to the next keyframe if autoplay is playing and the
+     /// current keyframe was shown for its whole dwell. Backends call it
+     /// every frame from the thread which updates, and request an update
+     /// when it returns true.
+     /// \return True if the current keyframe changed.
+     public: bool PollAutoplay();
+
+     /// \brief Time a keyframe is shown while autoplaying.
+     /// \param[in] _keyframe Keyframe index, -1 for the initial pose.
+     /// \return The keyframe's dwell, or the default one if it has none.
+     public: Autoplay::Clock::duration Dwell(int _keyframe) const;
 
-     /// \brief Function called to move camera, containing the target pose.
-     public: std::function<void(const std::string &, bool)> SetVisualVisible;
+     /// \brief Move the camera to a pose along a smooth trajectory, see
+     /// CameraTrajectory. The backend follows it by calling StepCamera
+     /// every frame. A trajectory in progress is retargeted from the
+     /// camera's current pose and velocity, unless it already heads to the
+     /// same pose.
+     /// \param[in] _backend Backend to call.
+     /// \param[in] _pose Goal in world frame.
+     /// \param[in] _transition Duration in seconds, 0 to cut straight to
+     /// the goal, NaN to compute it from the distance travelled.
+     /// \tparam BackendT Backend type, with the same functions as Backend.
+     public: template<typename BackendT>
+     void MoveCamera(BackendT &_backend, const ignition::math::Pose3d &_pose,
+         double _transition = std::numeric_limits<double>::quiet_NaN());
 
-     /// \brief Function called to seek a log, containing the target time.
-     public: std::function<void(std::chrono::steady_clock::duration)> SeekLog;
+     /// \brief Move the camera along the current trajectory. Backends call
+     /// it every rendered frame, from the thread which updates.
+     /// \param[in] _backend Backend to call.
+     /// \tparam BackendT Backend type, with the same functions as Backend.
+     /// \return True if the camera was moved.
+     public: template<typename BackendT>
+     bool StepCamera(BackendT &_backend);
 
-     /// \brief Function called to set the camera back to initial pose.
-     public: std::function<void()> ResetCameraPose;
+     /// \brief Move the camera to the end of the current trajectory right
+     /// away, for backends which don't render frames.
+     /// \param[in] _backend Backend to call.
+     /// \tparam BackendT Backend type, with the same functions as Backend.
+     /// \return True if the camera was moved.
+     public: template<typename BackendT>
+     bool FinishCamera(BackendT &_backend);
 
-     /// \brief Function called to get a visual's pose according to its scoped
-     /// name.
-     public: std::function<ignition::math::Pose3d(const std::string &)>
-         VisualPose;
+     /// \brief Hand a snapshot of the transition metrics to metricsExporter,
+     /// which summarizes them and writes them to <metrics_file>, if set, on
+     /// its own thread. Only done if they changed since the last snapshot,
+     /// and at most kMetricsInterval apart unless forced. StepCamera calls
+     /// it every frame.
+     /// \param[in] _force True to export without waiting for the interval.
+     public: void ExportMetrics(bool _force = false);
 
-     /// \brief Function called to set text, containing the the text.
-     public: std::function<void(const std::string &)> SetText;
+     /// \brief Camera pose for a LOOKAT or STACK keyframe.
+     /// \param[in] _target Target visual's pose in world frame.
+     /// \param[in] _eyeOffset Keyframe's eye offset in the target frame,
+     /// zero to use kEyeOffset.
+     /// \return Camera pose in world frame, looking at the target.
+     public: ignition::math::Pose3d EyePose(
+         const ignition::math::Pose3d &_target,
+         const ignition::math::Pose3d &_eyeOffset) const;
+
+     /// \brief Notify that a visual moved in the scene, so camera poses
+     /// looking at it are recomputed. Backends must call it whenever a
+     /// visual's world pose changes. Safe to call from any thread.
+     /// \param[in] _name Visual name.
+     public: void VisualMoved(const std::string &_name);
+
+     /// \brief Same as above, for backends which already know the visual's
+     /// ID, so the name doesn't need to be looked up. Safe to call from any
+     /// thread.
+     /// \param[in] _id Visual ID, see KeyframeTable::VisualName.
+     public: void VisualMoved(uint32_t _id);
+
+     /// \brief Notify that a visual was found in the scene. Backends must
+     /// call it once per visual, before computing camera poses from it. If
+     /// the visual isn't where the compiled deck expects it, its precomputed
+     /// camera poses are invalidated, otherwise they're kept.
+     /// \param[in] _id Visual ID, see KeyframeTable::VisualName.
+     /// \param[in] _pose Visual's pose in world frame.
+     public: void VisualResolved(uint32_t _id,
+         const ignition::math::Pose3d &_pose);
 
      /// \brief Path where to save / find slide models
      public: std::string slidePath;
 
-     /// \brief Vector of keyframes loaded for presentation
-     public: std::vector<Keyframe *> keyframes;
+     /// \brief Keyframes loaded for presentation
+     public: KeyframeTable keyframes;
+
+     /// \brief Visibility state of every keyframe in the deck.
+     public: VisibilityIndex visibility;
+
+     /// \brief Camera poses of LOOKAT and STACK keyframes computed so far.
+     public: EyePoseCache eyePoses;
+
+     /// \brief Keyframe whose visibility state is currently applied to the
+     /// scene. -1 means the initial state, with all visuals visible.
+     public: int visibleKeyframe{-1};
 
      /// \brief User camera far clip as set by the user.
      public: double farClip{std::numeric_limits<double>::quiet_NaN()};
@@ -99,9 +252,250 @@ namespace simslides
      public: const ignition::math::Pose3d kEyeOffset
          {0.0, -3.0, 0.0, 0.0, 0.0, IGN_PI_2};
 
+     /// \brief Default minimum time between updates requested by user
+     /// input, overridden by <coalesce_window>.
+     public: static constexpr std::chrono::milliseconds kCoalesceWindow{100};
+
+     /// \brief Commands from input threads, waiting to be applied by the
+     /// thread which updates.
+     public: CommandQueue commands;
+
+     /// \brief Coalesces updates requested by user input.
+     public: UpdateCoalescer coalescer;
+
+     /// \brief Camera motion towards the current keyframe.
+     public: CameraTrajectory trajectory;
+
+     /// \brief Timer moving through keyframes, only touched by the thread
+     /// which updates. Other threads push CMD_PLAY, CMD_PAUSE, CMD_LOOP and
+     /// CMD_NO_LOOP instead.
+     public: Autoplay autoplay;
+
+     /// \brief Latency of transitions, only touched by the thread which
+     /// updates.
+     public: TransitionMetrics metrics;
+
+     /// \brief File where metrics are exported, set with <metrics_file>.
+     /// Empty to not export them.
+     public: std::string metricsFile;
+
+     /// \brief Summarizes and writes metrics snapshots off the thread which
+     /// updates. Backends show its summaries.
+     public: MetricsExporter metricsExporter;
+
+     /// \brief Minimum time between metrics snapshots.
+     public: static constexpr std::chrono::seconds kMetricsInterval{1};
+
+     /// \brief Update the state according to current keyframe, without
+     /// measuring it, see Update.
+     /// \param[in] _backend Backend to call.
+     /// \tparam BackendT Backend type, with the same functions as Backend.
+     private: template<typename BackendT>
+     void UpdateKeyframe(BackendT &_backend);
+
+     /// \brief Metrics version of the last snapshot.
+     private: uint64_t metricsWritten{0};
+
+     /// \brief Time of the last metrics snapshot.
+     private: TransitionMetrics::Clock::time_point metricsWriteTime;
+
+     /// \brief Visibility changes computed on the last update, kept to
+     /// reuse its memory.
+     private: std::vector<VisibilityChange> visibilityChanges;
+
+     /// \brief Backend used by Update().
+     private: Backend *backend{nullptr};
+
      /// \brief Static instance
      private: static Common *instance;
   };
+
+  /////////////////////////////////////////////////
+  template<typename BackendT>
+  bool Common::RequestUpdate(BackendT &_backend)
+  {
+    if (!this->coalescer.Request(std::chrono::steady_clock::now()))
+      return false;
+
+    this->Update(_backend);
+    return true;
+  }
+
+  /////////////////////////////////////////////////
+  template<typename BackendT>
+  bool Common::PollUpdate(BackendT &_backend)
+  {
+    if (!this->coalescer.Poll(std::chrono::steady_clock::now()))
+      return false;
+
+    this->Update(_backend);
+    return true;
+  }
+
+  /////////////////////////////////////////////////
+  template<typename BackendT>
+  void Common::MoveCamera(BackendT &_backend,
+      const ignition::math::Pose3d &_pose, double _transition)
+  {
+    // Visuals which couldn't be found have NaN poses
+    if (!_pose.Pos().IsFinite())
+      return;
+
+    // Already flying there, such as when the same keyframe is replayed
+    if (this->trajectory.HeadingTo(_pose))
+      return;
+
+    // Retarget from wherever the camera is in flight, keeping its velocity
+    auto now = CameraTrajectory::Clock::now();
+    ignition::math::Pose3d start;
+    ignition::math::Vector3d velocity;
+    if (!this->trajectory.State(now, start, velocity))
+      start = _backend.CameraPose();
+
+    CameraTrajectory::Clock::duration duration;
+    if (std::isnan(_transition))
+    {
+      duration = this->trajectory.Duration(start, _pose);
+    }
+    else
+    {
+      duration = std::chrono::duration_cast<CameraTrajectory::Clock::duration>(
+          std::chrono::duration<double>(_transition));
+    }
+
+    this->metrics.MoveIssued(now);
+    if (duration <= CameraTrajectory::Clock::duration::zero())
+    {
+      this->trajectory.Stop();
+      _backend.SetCameraPose(_pose);
+      this->metrics.Settled(CameraTrajectory::Clock::now());
+      return;
+    }
+
+    this->trajectory.Plan(start, _pose, now, duration, velocity);
+  }
+
+  /////////////////////////////////////////////////
+  template<typename BackendT>
+  bool Common::StepCamera(BackendT &_backend)
+  {
+    this->ExportMetrics();
+
+    ignition::math::Pose3d pose;
+    if (!this->trajectory.Sample(CameraTrajectory::Clock::now(), pose))
+      return false;
+
+    _backend.SetCameraPose(pose);
+    if (!this->trajectory.Active())
+      this->metrics.Settled(CameraTrajectory::Clock::now());
+    return true;
+  }
+
+  /////////////////////////////////////////////////
+  template<typename BackendT>
+  bool Common::FinishCamera(BackendT &_backend)
+  {
+    ignition::math::Pose3d pose;
+    if (!this->trajectory.Finish(pose))
+      return false;
+
+    _backend.SetCameraPose(pose);
+    this->metrics.Settled(CameraTrajectory::Clock::now());
+    return true;
+  }
+
+  /////////////////////////////////////////////////
+  template<typename BackendT>
+  void Common::Update(BackendT &_backend)
+  {
+    auto type = KeyframeType::NONE;
+    if (this->currentKeyframe >= 0 &&
+        this->currentKeyframe < static_cast<int>(this->keyframes.Size()))
+    {
+      type = this->keyframes.Type(this->currentKeyframe);
+    }
+
+    this->metrics.UpdateStarted(this->currentKeyframe, type,
+        TransitionMetrics::Clock::now());
+    this->UpdateKeyframe(_backend);
+    this->metrics.UpdateEnded(TransitionMetrics::Clock::now());
+  }
+
+  /////////////////////////////////////////////////
+  template<typename BackendT>
+  void Common::UpdateKeyframe(BackendT &_backend)
+  {
+    // Keyframes picked by the presenter are shown for their whole dwell
+    this->autoplay.Show(this->currentKeyframe,
+        this->Dwell(this->currentKeyframe), Autoplay::Clock::now());
+
+    // Reset presentation
+    if (this->currentKeyframe < 0)
+    {
+      this->trajectory.Stop();
+      _backend.ResetCameraPose();
+      return;
+    }
+
+    // Do nothing
+    if (this->currentKeyframe >= this->keyframes.Size())
+    {
+      return;
+    }
+
+    auto keyframe = this->keyframes[this->currentKeyframe];
+
+    // Set text
+    _backend.SetText(keyframe.Text());
+
+    // Set visibility, only touching visuals which differ from the current
+    // state
+    this->visibility.Diff(this->keyframes, this->visibleKeyframe,
+        this->currentKeyframe, this->visibilityChanges);
+    if (!this->visibilityChanges.empty())
+      _backend.SetVisualsVisible(this->visibilityChanges);
+    this->visibleKeyframe = this->currentKeyframe;
+
+    // Log seek
+    if (keyframe.GetType() == KeyframeType::LOG_SEEK)
+    {
+      this->MoveCamera(_backend, keyframe.CamPose(), keyframe.Transition());
+      _backend.SeekLog(keyframe.LogSeek());
+      return;
+    }
+
+    // Cam pose
+    if (keyframe.GetType() == KeyframeType::CAM_POSE)
+    {
+      this->MoveCamera(_backend, keyframe.CamPose(), keyframe.Transition());
+      return;
+    }
+
+    // Look at
+    if (keyframe.GetType() == KeyframeType::LOOKAT ||
+        keyframe.GetType() == KeyframeType::STACK)
+    {
+      // Reuse the pose from the last visit unless the target moved since
+      ignition::math::Pose3d eyePose;
+      uint64_t stamp;
+      if (this->eyePoses.Find(this->keyframes, this->currentKeyframe, eyePose,
+          stamp))
+      {
+        this->MoveCamera(_backend, eyePose, keyframe.Transition());
+        return;
+      }
+
+      // Target in world frame
+      auto origin = _backend.VisualPose(keyframe.VisualId());
+      eyePose = this->EyePose(origin, keyframe.EyeOffset());
+
+      // Don't cache failed lookups, the visual may show up later
+      if (origin.Pos().IsFinite())
+        this->eyePoses.Store(this->currentKeyframe, stamp, eyePose);
+
+      this->MoveCamera(_backend, eyePose, keyframe.Transition());
+    }
+  }
 }
 
 #endif
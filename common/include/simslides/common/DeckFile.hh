@@ -0,0 +1,75 @@
+/*
+ * Copyright 2017 Louise Poubel
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+#ifndef SIMSLIDES_DECKFILE_HH_
+#define SIMSLIDES_DECKFILE_HH_
+
+#include <cstdint>
+#include <string>
+
+#include "KeyframeTable.hh"
+
+namespace simslides
+{
+  /// \brief Compiled binary deck files.
+  ///
+  /// A deck file holds the same flat arrays as a KeyframeTable, each 8-byte
+  /// aligned, after a fixed header:
+  ///
+  /// * types (uint8), slide numbers (int32), visual IDs (uint32),
+  ///   text IDs (uint32), text file IDs (uint32), label IDs (uint32),
+  ///   eye offsets (7 doubles), camera poses (7 doubles), precomputed eye
+  ///   poses (7 doubles, NaN if unresolved), log seek times (int64
+  ///   nanoseconds), transition durations (double seconds, NaN if
+  ///   automatic), autoplay dwells (double seconds, NaN if default), stack
+  ///   IDs (uint32) per keyframe
+  /// * first and last keyframe (2 uint64) per stack
+  /// * offsets (uint64) into the string blob for each visual name, text,
+  ///   text file path and label, plus a final end offset for each pool
+  /// * the string blob itself
+  ///
+  /// Files are written in the host's byte order. Loading memory-maps the
+  /// file and the table reads the arrays in place. Only the string pools
+  /// are copied, and the visual and label indexes are rebuilt.
+  class DeckFile
+  {
+    /// \brief Deck file magic, "SSDECK" followed by two null bytes.
+    public: static constexpr char kMagic[8] = {
+        'S', 'S', 'D', 'E', 'C', 'K', '\0', '\0'};
+
+    /// \brief Current format version. Increment whenever the layout changes.
+    public: static constexpr uint32_t kVersion{6};
+
+    /// \brief Write a deck to a file.
+    /// \param[in] _keyframes Keyframes to write.
+    /// \param[in] _path Path to the output file.
+    /// \return True on success.
+    public: static bool Save(const KeyframeTable &_keyframes,
+        const std::string &_path);
+
+    /// \brief Memory-map a deck file and use it as a table's storage. The
+    /// table is cleared first. Text files are stored by path, and are only
+    /// read when displayed.
+    /// \param[in] _path Path to the deck file.
+    /// \param[out] _keyframes Table to load into.
+    /// \param[out] _error Why the file couldn't be loaded, only set on
+    /// failure.
+    /// \return True on success. On failure the table is left empty.
+    public: static bool Load(const std::string &_path,
+        KeyframeTable &_keyframes, std::string &_error);
+  };
+}
+
+#endif
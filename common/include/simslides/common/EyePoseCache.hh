@@ -0,0 +1,113 @@
+/*
+ * Copyright 2017 Louise Poubel
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+#ifndef SIMSLIDES_EYEPOSECACHE_HH_
+#define SIMSLIDES_EYEPOSECACHE_HH_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include <ignition/math/Pose3.hh>
+
+#include "KeyframeTable.hh"
+
+namespace simslides
+{
+  /// \brief Camera poses resolved for LOOKAT and STACK keyframes.
+  ///
+  /// Each visual has a stamp which is bumped every time the backend reports
+  /// that it moved. A cached pose is valid as long as its target visual's
+  /// stamp is the same as when the pose was computed, so a static deck only
+  /// computes each keyframe's camera pose once. Visuals which haven't moved
+  /// since the deck was loaded use the pose precomputed by simslides_compile,
+  /// if any, see KeyframeTable::EyePose.
+  ///
+  /// Build, Find and Store must be called from the same thread, while
+  /// Invalidate can be called from any thread, such as a transport callback.
+  class EyePoseCache
+  {
+    /// \brief Stamp of visuals which haven't moved since Build.
+    public: static constexpr uint64_t kInitialStamp{1};
+
+    /// \brief Drop all cached poses and prepare for a new deck. Must be
+    /// called again whenever the deck changes.
+    /// \param[in] _keyframes Deck keyframes.
+    public: void Build(const KeyframeTable &_keyframes);
+
+    /// \brief Get the cached camera pose of a keyframe.
+    /// \param[in] _keyframes Deck keyframes, same as passed to Build.
+    /// \param[in] _index Keyframe index.
+    /// \param[out] _pose Cached camera pose, only set on a hit.
+    /// \param[out] _stamp Current stamp of the keyframe's visual. On a miss,
+    /// pass it to Store together with the newly computed pose.
+    /// \return True if there's a valid pose.
+    public: bool Find(const KeyframeTable &_keyframes, std::size_t _index,
+        ignition::math::Pose3d &_pose, uint64_t &_stamp) const;
+
+    /// \brief Cache the camera pose of a keyframe.
+    /// \param[in] _index Keyframe index.
+    /// \param[in] _stamp Stamp returned by Find before the target's pose was
+    /// queried, so moves which happen meanwhile aren't lost.
+    /// \param[in] _pose Camera pose.
+    public: void Store(std::size_t _index, uint64_t _stamp,
+        const ignition::math::Pose3d &_pose);
+
+    /// \brief Invalidate the poses of all keyframes looking at a visual.
+    /// Does nothing if the visual isn't in the deck.
+    /// \param[in] _name Visual name.
+    public: void Invalidate(const std::string &_name);
+
+    /// \brief Invalidate the poses of all keyframes looking at a visual.
+    /// Does nothing if the ID is out of range.
+    /// \param[in] _id Visual ID, see KeyframeTable::VisualName.
+    public: void Invalidate(uint32_t _id);
+
+    /// \brief Invalidate all cached poses.
+    public: void InvalidateAll();
+
+    /// \brief Number of keyframes in the deck.
+    private: std::size_t size{0};
+
+    /// \brief Stamp of each keyframe's cached pose, 0 if not cached.
+    /// Allocated on the first Store.
+    private: std::unique_ptr<uint64_t[]> stamps;
+
+    /// \brief Cached poses, KeyframeTable::kPoseSize doubles per keyframe.
+    /// Only entries with a non-zero stamp are initialized.
+    private: std::unique_ptr<double[]> poses;
+
+    /// \brief Stamp of each visual, indexed by visual ID. They start at
+    /// kInitialStamp.
+    private: std::unique_ptr<std::atomic<uint64_t>[]> visualStamps;
+
+    /// \brief Number of entries in visualStamps.
+    private: std::size_t visualCount{0};
+
+    /// \brief Map from visual name to ID, so Invalidate doesn't touch the
+    /// keyframe table from other threads.
+    private: std::unordered_map<std::string, uint32_t> visualIds;
+
+    /// \brief Protects visualStamps and visualIds from being replaced while
+    /// they're invalidated.
+    private: std::mutex mutex;
+  };
+}
+
+#endif
@@ -17,14 +17,14 @@
 #define SIMSLIDES_KEYFRAME_HH_
 
 #include <chrono>
-#include <memory>
+#include <cstddef>
+#include <cstdint>
 #include <string>
-#include <sdf/Element.hh>
 #include <ignition/math/Pose3.hh>
 
 namespace simslides
 {
-  class KeyframePrivate;
+  class KeyframeTable;
 
   /// \brief Keyframe types
   enum KeyframeType
@@ -46,14 +46,25 @@ namespace simslides
     CAM_POSE
   };
 
+  /// \brief Get a keyframe type as used in SDF, such as "lookat".
+  /// \param[in] _type Keyframe type.
+  /// \return Type string, empty for NONE.
+  std::string KeyframeTypeToStr(KeyframeType _type);
+
+  /// \brief Get a keyframe type from its SDF string.
+  /// \param[in] _type Type string, such as "lookat".
+  /// \return Keyframe type, NONE if not recognized.
+  KeyframeType StrToKeyframeType(const std::string &_type);
+
+  /// \brief Lightweight view of a single keyframe stored in a KeyframeTable.
+  /// It doesn't own any data, so it's cheap to copy, but it must not outlive
+  /// the table it was taken from.
   class Keyframe
   {
     /// \brief Constructor.
-    /// \param[in] _sdf
-    public: Keyframe(sdf::ElementPtr _sdf);
-
-    /// \brief Destructor.
-    public: ~Keyframe();
+    /// \param[in] _table Table holding the keyframe data.
+    /// \param[in] _index Index of the keyframe within the table.
+    public: Keyframe(const KeyframeTable &_table, std::size_t _index);
 
     /// \brief Get the keyframe type.
     /// \return The type of this keyframe.
@@ -65,7 +76,12 @@ namespace simslides
 
     /// \brief Name of the visual that this keyframe is attached to.
     /// \return Visual name.
-    public: std::string Visual() const;
+    public: const std::string &Visual() const;
+
+    /// \brief ID of the visual that this keyframe is attached to, interned
+    /// when the deck was loaded. Backends can use it to cache visual handles.
+    /// \return Visual ID, 0 if there's no visual.
+    public: uint32_t VisualId() const;
 
     /// \brief For LOG_SEEK and CAM_POSE
     /// \return Camera pose in the world
@@ -75,17 +91,39 @@ namespace simslides
     /// \return Offset from target slide origin.
     public: ignition::math::Pose3d EyeOffset() const;
 
+    /// \brief Time the camera takes to reach this keyframe.
+    /// \return Duration in seconds, NaN to compute it from the distance.
+    public: double Transition() const;
+
+    /// \brief Time this keyframe is shown while autoplaying.
+    /// \return Duration in seconds, NaN to use the default.
+    public: double Dwell() const;
+
     /// \brief Log time to seek to
     /// \return Log time
     public: std::chrono::steady_clock::duration LogSeek() const;
 
-    /// \brief Text to display
+    /// \brief Text to display, read from the text file if there is one.
     /// \return The text.
-    public: std::string Text() const;
+    public: const std::string &Text() const;
+
+    /// \brief Path to the file holding the text to display.
+    /// \return Path, empty if the text is inline.
+    public: const std::string &TextFile() const;
+
+    /// \brief Label to jump to this keyframe by name.
+    /// \return Label, empty if none.
+    public: const std::string &Label() const;
+
+    /// \brief Index of this keyframe within its table.
+    /// \return Keyframe index.
+    public: std::size_t Index() const;
+
+    /// \brief Table holding the keyframe data.
+    private: const KeyframeTable *table;
 
-    /// \internal
-    /// \brief Pointer to private data.
-    private: std::unique_ptr<KeyframePrivate> dataPtr;
+    /// \brief Index of the keyframe within the table.
+    private: std::size_t index;
   };
   /// \}
 }
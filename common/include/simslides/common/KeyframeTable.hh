@@ -0,0 +1,454 @@
+/*
+ * Copyright 2017 Louise Poubel
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+#ifndef SIMSLIDES_KEYFRAMETABLE_HH_
+#define SIMSLIDES_KEYFRAMETABLE_HH_
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <sdf/Element.hh>
+#include <ignition/math/Pose3.hh>
+
+#include "Keyframe.hh"
+
+namespace simslides
+{
+  class DeckFile;
+
+  /// \brief A run of consecutive STACK keyframes.
+  struct StackRange
+  {
+    /// \brief Index of the first keyframe in the stack.
+    uint64_t front;
+
+    /// \brief Index of the last keyframe in the stack.
+    uint64_t back;
+  };
+
+  /// \brief Owning storage for all keyframes in a presentation.
+  ///
+  /// Keyframes are stored by value, one flat array per field, indexed by
+  /// keyframe number. Visual names and texts are interned into their own
+  /// pools, so adding keyframes doesn't allocate per keyframe and walking
+  /// the deck touches contiguous memory.
+  ///
+  /// Keyframes can be looked up by label and by the visual they target in
+  /// constant time, through hash indexes kept up to date as keyframes are
+  /// added.
+  ///
+  /// The arrays are either owned by the table, or point straight into a
+  /// memory-mapped deck file loaded through DeckFile. Adding keyframes to a
+  /// mapped table copies its arrays first.
+  class KeyframeTable
+  {
+    /// \brief Number of doubles used to store each pose: position followed
+    /// by a W, X, Y, Z quaternion.
+    public: static constexpr std::size_t kPoseSize{7};
+
+    /// \brief AddAll doesn't spawn threads for fewer keyframes than this.
+    public: static constexpr std::size_t kMinKeyframesPerThread{512};
+
+    /// \brief Stack ID of keyframes which are not part of a stack.
+    public: static constexpr uint32_t kNoStack{
+        std::numeric_limits<uint32_t>::max()};
+
+    /// \brief Parse a <keyframe> element and append it to the end of the
+    /// table.
+    /// \param[in] _sdf Keyframe element.
+    public: void Add(const sdf::ElementPtr _sdf);
+
+    /// \brief Parse all <keyframe> children of an element and append them to
+    /// the end of the table, in order.
+    ///
+    /// Attribute values are copied out of the SDF tree serially, since
+    /// sdformat doesn't document concurrent reads as safe. They're then
+    /// parsed in parallel, which is much faster than calling Add for each
+    /// keyframe on large decks. Errors are
+    /// collected for all keyframes instead of stopping at the first one.
+    /// Keyframes with errors are still added, same as with Add.
+    /// \param[in] _parent Element holding <keyframe>s, such as a plugin.
+    /// \param[out] _errors One message per invalid keyframe, in deck order.
+    /// \param[in] _threads Maximum number of threads to parse with, 0 to use
+    /// all cores.
+    /// \return True if there were no errors.
+    public: bool AddAll(const sdf::ElementPtr _parent,
+        std::vector<std::string> &_errors, unsigned int _threads = 0);
+
+    /// \brief Remove all keyframes and interned strings.
+    public: void Clear();
+
+    /// \brief Set the directory relative text file paths are resolved
+    /// against, which should be the directory of the world or deck file the
+    /// keyframes were loaded from. Text files already read are read again.
+    /// \param[in] _directory Directory, empty to only look in the working
+    /// directory and the SDF search paths.
+    public: void SetDirectory(const std::string &_directory);
+
+    /// \brief Reserve space for a number of keyframes.
+    /// \param[in] _count Number of keyframes.
+    public: void Reserve(std::size_t _count);
+
+    /// \brief Number of keyframes.
+    /// \return Keyframe count.
+    public: std::size_t Size() const;
+
+    /// \brief Whether there are no keyframes.
+    /// \return True if empty.
+    public: bool Empty() const;
+
+    /// \brief Version of the deck, which changes every time keyframes are
+    /// added or cleared. Backends caching data per visual ID use it to know
+    /// when to drop their caches.
+    /// \return Deck version.
+    public: uint64_t Version() const;
+
+    /// \brief Get a view of a keyframe.
+    /// \param[in] _index Keyframe index, must be smaller than Size().
+    /// \return Keyframe view.
+    public: Keyframe operator[](std::size_t _index) const;
+
+    /// \brief Type of a keyframe.
+    /// \param[in] _index Keyframe index.
+    /// \return Keyframe type.
+    public: KeyframeType Type(std::size_t _index) const;
+
+    /// \brief Slide number of a keyframe.
+    /// \param[in] _index Keyframe index.
+    /// \return Slide number, -1 if not set.
+    public: int SlideNumber(std::size_t _index) const;
+
+    /// \brief Name of the visual a keyframe is attached to.
+    /// \param[in] _index Keyframe index.
+    /// \return Visual name, empty if none.
+    public: const std::string &Visual(std::size_t _index) const;
+
+    /// \brief Label of a keyframe, set with the `label` attribute.
+    /// \param[in] _index Keyframe index.
+    /// \return Label, empty if none.
+    public: const std::string &Label(std::size_t _index) const;
+
+    /// \brief Find a keyframe by label. If more than one keyframe has the
+    /// same label, the first one is returned.
+    /// \param[in] _label Label, non-empty.
+    /// \param[out] _index Keyframe index, only set if found.
+    /// \return True if there's a keyframe with the label.
+    public: bool FindLabel(const std::string &_label,
+        std::size_t &_index) const;
+
+    /// \brief Find the first keyframe attached to a visual.
+    /// \param[in] _visual Visual name, non-empty.
+    /// \param[out] _index Keyframe index, only set if found.
+    /// \return True if there's a keyframe attached to the visual.
+    public: bool FindVisual(const std::string &_visual,
+        std::size_t &_index) const;
+
+    /// \brief All keyframes attached to a visual.
+    /// \param[in] _visual Visual name.
+    /// \return Keyframe indices in deck order, empty if none.
+    public: const std::vector<uint64_t> &VisualKeyframes(
+        const std::string &_visual) const;
+
+    /// \brief ID of the visual a keyframe is attached to.
+    /// \param[in] _index Keyframe index.
+    /// \return Visual ID, 0 if none.
+    public: uint32_t VisualId(std::size_t _index) const;
+
+    /// \brief Number of unique visuals referenced by the deck, including
+    /// the empty visual with ID 0.
+    /// \return Visual count.
+    public: std::size_t VisualCount() const;
+
+    /// \brief Get a visual's name from its ID.
+    /// \param[in] _id Visual ID, must be smaller than VisualCount().
+    /// \return Visual name.
+    public: const std::string &VisualName(uint32_t _id) const;
+
+    /// \brief Camera offset in the target visual's frame.
+    /// \param[in] _index Keyframe index.
+    /// \return Eye offset.
+    public: ignition::math::Pose3d EyeOffset(std::size_t _index) const;
+
+    /// \brief Camera pose in the world frame.
+    /// \param[in] _index Keyframe index.
+    /// \return Camera pose.
+    public: ignition::math::Pose3d CamPose(std::size_t _index) const;
+
+    /// \brief Camera pose in the world frame precomputed for a LOOKAT or
+    /// STACK keyframe by simslides_compile, from the target's pose in the
+    /// world file.
+    /// \param[in] _index Keyframe index.
+    /// \param[out] _pose Camera pose, only set if there is one.
+    /// \return False if the pose must be resolved from the live scene.
+    public: bool EyePose(std::size_t _index,
+        ignition::math::Pose3d &_pose) const;
+
+    /// \brief Set the precomputed camera pose of a keyframe, see EyePose.
+    /// The deck version doesn't change, since visuals are untouched.
+    /// \param[in] _index Keyframe index, must be smaller than Size().
+    /// \param[in] _pose Camera pose in the world frame.
+    public: void SetEyePose(std::size_t _index,
+        const ignition::math::Pose3d &_pose);
+
+    /// \brief Time the camera takes to reach a keyframe, set with the
+    /// `transition` attribute.
+    /// \param[in] _index Keyframe index.
+    /// \return Duration in seconds, 0 to cut straight to the keyframe, NaN
+    /// to compute it from the distance travelled.
+    public: double Transition(std::size_t _index) const;
+
+    /// \brief Time a keyframe is shown before autoplay moves on to the
+    /// next one, set with the `dwell` attribute.
+    /// \param[in] _index Keyframe index.
+    /// \return Duration in seconds, NaN to use the default.
+    public: double Dwell(std::size_t _index) const;
+
+    /// \brief Log time to seek to.
+    /// \param[in] _index Keyframe index.
+    /// \return Log time.
+    public: std::chrono::steady_clock::duration LogSeek(
+        std::size_t _index) const;
+
+    /// \brief Text to display. If the keyframe has a text file, the file is
+    /// read the first time its text is requested, and cached until the deck
+    /// changes.
+    /// \param[in] _index Keyframe index.
+    /// \return Text, empty if none.
+    public: const std::string &Text(std::size_t _index) const;
+
+    /// \brief Path to a file holding the text to display, set with the
+    /// `text_file` attribute. It takes precedence over `text`. Relative
+    /// paths are looked up in the directory given to SetDirectory, then in
+    /// the working directory, then on the SDF search paths.
+    /// \param[in] _index Keyframe index.
+    /// \return Path as given in SDF, empty if none.
+    public: const std::string &TextFile(std::size_t _index) const;
+
+    /// \brief Stack that a keyframe belongs to. The stack index is kept
+    /// up to date as keyframes are added, so this is constant time.
+    /// \param[in] _index Keyframe index.
+    /// \return Stack ID, or kNoStack if the keyframe isn't a STACK.
+    public: uint32_t StackId(std::size_t _index) const;
+
+    /// \brief Number of stacks in the deck.
+    /// \return Stack count.
+    public: std::size_t StackCount() const;
+
+    /// \brief Get the keyframe range of a stack.
+    /// \param[in] _id Stack ID, must be smaller than StackCount().
+    /// \return First and last keyframes of the stack.
+    public: const StackRange &Stack(uint32_t _id) const;
+
+    /// \brief Print keyframe info. Only logged at verbose level.
+    /// \param[in] _index Keyframe index.
+    public: void Print(std::size_t _index) const;
+
+    /// \brief Append a parsed keyframe to the owned arrays and extend the
+    /// stack index. The caller must call UpdateView afterwards.
+    /// \param[in] _type Keyframe type.
+    /// \param[in] _slideNumber Slide number.
+    /// \param[in] _visual Visual name.
+    /// \param[in] _eyeOffset Eye offset.
+    /// \param[in] _camPose Camera pose.
+    /// \param[in] _logSeek Log time.
+    /// \param[in] _text Text.
+    /// \param[in] _textFile Path to text file.
+    /// \param[in] _label Label.
+    /// \param[in] _transition Transition duration in seconds, NaN if not
+    /// set.
+    /// \param[in] _dwell Autoplay dwell in seconds, NaN if not set.
+    /// \return False if another keyframe already has the same label. The
+    /// keyframe is appended anyway, and the label keeps pointing to the
+    /// first one.
+    private: bool Append(KeyframeType _type, int _slideNumber,
+        const std::string &_visual, const ignition::math::Pose3d &_eyeOffset,
+        const ignition::math::Pose3d &_camPose,
+        std::chrono::steady_clock::duration _logSeek,
+        const std::string &_text, const std::string &_textFile,
+        const std::string &_label, double _transition, double _dwell);
+
+    /// \brief Get the contents of a text file, reading it if it isn't
+    /// cached yet.
+    /// \param[in] _id Text file ID, non-zero.
+    /// \return File contents, empty if it couldn't be read.
+    private: const std::string &LoadTextFile(uint32_t _id) const;
+
+    /// \brief Add a string to a pool, reusing an existing entry if there is
+    /// one.
+    /// \param[in] _str String to intern.
+    /// \param[in, out] _pool Pool of unique strings.
+    /// \param[in, out] _ids Map from string to its index in the pool.
+    /// \return Index of the string in the pool.
+    private: static uint32_t Intern(const std::string &_str,
+        std::vector<std::string> &_pool,
+        std::unordered_map<std::string, uint32_t> &_ids);
+
+    /// \brief Append a pose to a flat array of doubles.
+    /// \param[in] _pose Pose to append.
+    /// \param[in, out] _array Array with kPoseSize doubles per pose.
+    private: static void AppendPose(const ignition::math::Pose3d &_pose,
+        std::vector<double> &_array);
+
+    /// \brief Read a pose from a flat array of doubles.
+    /// \param[in] _array Array with kPoseSize doubles per pose.
+    /// \param[in] _index Index of the pose.
+    /// \return The pose.
+    private: static ignition::math::Pose3d ReadPose(const double *_array,
+        std::size_t _index);
+
+    /// \brief Copy the arrays of a memory-mapped deck into owned storage, so
+    /// the table can be modified. Does nothing if the table isn't mapped.
+    private: void Detach();
+
+    /// \brief Rebuild the visual and label indexes from the view and the
+    /// string pools, for decks which weren't built through Append.
+    private: void BuildIndexes();
+
+    /// \brief Point the column views at the owned arrays. Must be called
+    /// after the owned arrays change.
+    private: void UpdateView();
+
+    /// \brief DeckFile reads and writes the columns directly.
+    friend class DeckFile;
+
+    /// \brief Pointers to the start of each column. They point either into
+    /// the owned arrays below or into a mapped deck file.
+    private: struct
+    {
+      const uint8_t *types{nullptr};
+      const int32_t *slideNumbers{nullptr};
+      const uint32_t *visuals{nullptr};
+      const uint32_t *texts{nullptr};
+      const uint32_t *textFiles{nullptr};
+      const uint32_t *labels{nullptr};
+      const double *eyeOffsets{nullptr};
+      const double *camPoses{nullptr};
+      const double *eyePoses{nullptr};
+      const int64_t *logSeeks{nullptr};
+      const double *transitions{nullptr};
+      const double *dwells{nullptr};
+      const uint32_t *stackIds{nullptr};
+      const StackRange *stacks{nullptr};
+      std::size_t size{0};
+      std::size_t stackCount{0};
+    } view;
+
+    /// \brief Memory-mapped deck file backing the view, null if the table
+    /// owns its data.
+    private: std::shared_ptr<const void> mapping;
+
+    /// \brief Deck version, see Version().
+    private: uint64_t version{0};
+
+    /// \brief Type of each keyframe.
+    private: std::vector<uint8_t> types;
+
+    /// \brief Slide model number of each keyframe.
+    private: std::vector<int32_t> slideNumbers;
+
+    /// \brief Index into visualNames for each keyframe.
+    private: std::vector<uint32_t> visuals;
+
+    /// \brief Index into textPool for each keyframe.
+    private: std::vector<uint32_t> texts;
+
+    /// \brief Index into textFileNames for each keyframe.
+    private: std::vector<uint32_t> textFiles;
+
+    /// \brief Index into labelNames for each keyframe.
+    private: std::vector<uint32_t> labels;
+
+    /// \brief Camera offset in LOOKAT slide frame for each keyframe.
+    private: std::vector<double> eyeOffsets;
+
+    /// \brief Camera pose in world frame for each keyframe.
+    private: std::vector<double> camPoses;
+
+    /// \brief Precomputed camera pose in world frame for each keyframe, NaN
+    /// if it must be resolved live.
+    private: std::vector<double> eyePoses;
+
+    /// \brief Log time to seek to for each keyframe, in nanoseconds.
+    private: std::vector<int64_t> logSeeks;
+
+    /// \brief Transition duration of each keyframe in seconds, NaN if it's
+    /// computed from the distance.
+    private: std::vector<double> transitions;
+
+    /// \brief Autoplay dwell of each keyframe in seconds, NaN if it uses
+    /// the default.
+    private: std::vector<double> dwells;
+
+    /// \brief Stack ID of each keyframe, kNoStack if not a STACK.
+    private: std::vector<uint32_t> stackIds;
+
+    /// \brief Keyframe range of each stack, indexed by stack ID.
+    private: std::vector<StackRange> stacks;
+
+    /// \brief Unique visual names. Entry 0 is always the empty string.
+    private: std::vector<std::string> visualNames{std::string()};
+
+    /// \brief Map from visual name to index in visualNames.
+    private: std::unordered_map<std::string, uint32_t> visualIds{{"", 0}};
+
+    /// \brief Keyframes attached to each visual, indexed by visual ID.
+    private: std::vector<std::vector<uint64_t>> visualKeyframes =
+        std::vector<std::vector<uint64_t>>(1);
+
+    /// \brief Unique labels. Entry 0 is always the empty string.
+    private: std::vector<std::string> labelNames{std::string()};
+
+    /// \brief Map from label to index in labelNames.
+    private: std::unordered_map<std::string, uint32_t> labelIds{{"", 0}};
+
+    /// \brief First keyframe with each label, indexed by label ID.
+    private: std::vector<uint64_t> labelKeyframes{0};
+
+    /// \brief Unique texts. Entry 0 is always the empty string.
+    private: std::vector<std::string> textPool{std::string()};
+
+    /// \brief Map from text to index in textPool.
+    private: std::unordered_map<std::string, uint32_t> textIds{{"", 0}};
+
+    /// \brief Unique text file paths. Entry 0 is always the empty string.
+    private: std::vector<std::string> textFileNames{std::string()};
+
+    /// \brief Map from text file path to index in textFileNames.
+    private: std::unordered_map<std::string, uint32_t> textFileIds{{"", 0}};
+
+    /// \brief Contents of text files read so far, indexed by text file ID.
+    private: mutable std::vector<std::unique_ptr<std::string>> textFileCache;
+
+    /// \brief Deck version the text file cache belongs to.
+    private: mutable uint64_t textFileCacheVersion{0};
+
+    /// \brief Directory relative text file paths are resolved against,
+    /// protected by textFileMutex.
+    private: std::string directory;
+
+    /// \brief Protects the text file cache, since text may be requested
+    /// from transport threads.
+    private: mutable std::mutex textFileMutex;
+  };
+}
+
+#endif
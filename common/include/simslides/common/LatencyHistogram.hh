@@ -0,0 +1,90 @@
+/*
+ * Copyright 2017 Louise Poubel
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+#ifndef SIMSLIDES_LATENCYHISTOGRAM_HH_
+#define SIMSLIDES_LATENCYHISTOGRAM_HH_
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace simslides
+{
+  /// \brief Fixed-size histogram of durations, with buckets growing
+  /// geometrically by a factor of sqrt(2) from 1 us to about 12 s, plus an
+  /// overflow bucket. Recording is constant time and never allocates, so it
+  /// can run on every frame.
+  ///
+  /// Upper bounds are inclusive, like Prometheus' "le" bounds: bucket 0
+  /// holds [0, 1 us] and bucket i holds (UpperBound(i - 1), UpperBound(i)].
+  class LatencyHistogram
+  {
+    /// \brief Clock whose durations are recorded.
+    public: using Clock = std::chrono::steady_clock;
+
+    /// \brief Number of buckets, including the overflow bucket.
+    public: static constexpr std::size_t kBucketCount{49};
+
+    /// \brief Add a duration.
+    /// \param[in] _duration Duration, negative values count as zero.
+    public: void Record(Clock::duration _duration);
+
+    /// \brief Remove all durations.
+    public: void Clear();
+
+    /// \brief Number of durations recorded.
+    /// \return Count.
+    public: uint64_t Count() const;
+
+    /// \brief Sum of all durations recorded.
+    /// \return Sum.
+    public: Clock::duration Sum() const;
+
+    /// \brief Longest duration recorded.
+    /// \return Maximum, zero if empty.
+    public: Clock::duration Max() const;
+
+    /// \brief Number of durations in a bucket.
+    /// \param[in] _index Bucket index, smaller than kBucketCount.
+    /// \return Count.
+    public: uint64_t Bucket(std::size_t _index) const;
+
+    /// \brief Inclusive upper bound of a bucket.
+    /// \param[in] _index Bucket index, smaller than kBucketCount.
+    /// \return Upper bound, Clock::duration::max() for the overflow bucket.
+    public: static Clock::duration UpperBound(std::size_t _index);
+
+    /// \brief Estimate a percentile, as the upper bound of the bucket which
+    /// holds it, so it's accurate to within a factor of sqrt(2).
+    /// \param[in] _fraction Percentile as a fraction, such as 0.95.
+    /// \return Estimated duration, never above Max(), zero if empty.
+    public: Clock::duration Percentile(double _fraction) const;
+
+    /// \brief Count of each bucket.
+    private: std::array<uint64_t, kBucketCount> buckets{};
+
+    /// \brief Number of durations recorded.
+    private: uint64_t count{0};
+
+    /// \brief Sum of all durations recorded.
+    private: Clock::duration sum{0};
+
+    /// \brief Longest duration recorded.
+    private: Clock::duration max{0};
+  };
+}
+
+#endif
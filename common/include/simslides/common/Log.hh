@@ -0,0 +1,187 @@
+/*
+ * Copyright 2017 Louise Poubel
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+#ifndef SIMSLIDES_LOG_HH_
+#define SIMSLIDES_LOG_HH_
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+
+/// \brief Log a message at a given level. Nothing after the macro is
+/// evaluated if the level is disabled. It expands to a single-iteration loop
+/// so it's safe to use as the body of an unbraced if / else.
+#define SIMSLIDES_LOG(_level) \
+  for (bool simslidesLogOn = \
+      simslides::Logger::Instance()->Enabled(_level); \
+      simslidesLogOn; simslidesLogOn = false) \
+    simslides::LogStream(_level)
+
+/// \brief Per-keyframe dumps and other output too noisy for debugging.
+#define ssverbose SIMSLIDES_LOG(simslides::LOG_VERBOSE)
+
+/// \brief Debug messages.
+#define ssdbg SIMSLIDES_LOG(simslides::LOG_DEBUG)
+
+/// \brief Informational messages.
+#define ssmsg SIMSLIDES_LOG(simslides::LOG_INFO)
+
+/// \brief Warnings.
+#define sswarn SIMSLIDES_LOG(simslides::LOG_WARNING)
+
+/// \brief Errors.
+#define sserr SIMSLIDES_LOG(simslides::LOG_ERROR)
+
+namespace simslides
+{
+  /// \brief Log levels, from most to least verbose.
+  enum LogLevel
+  {
+    /// \brief Everything, including a dump of each keyframe on load.
+    LOG_VERBOSE,
+
+    /// \brief Debug messages.
+    LOG_DEBUG,
+
+    /// \brief Informational messages, such as keyframe changes.
+    LOG_INFO,
+
+    /// \brief Warnings.
+    LOG_WARNING,
+
+    /// \brief Errors.
+    LOG_ERROR,
+
+    /// \brief Nothing is logged.
+    LOG_NONE
+  };
+
+  /// \brief Get a log level from its name, such as "verbose" or "error".
+  /// \param[in] _name Level name, case sensitive.
+  /// \param[out] _level Parsed level.
+  /// \return False if the name isn't recognized.
+  bool StrToLogLevel(const std::string &_name, LogLevel &_level);
+
+  /// \brief Asynchronous logger.
+  ///
+  /// Messages are queued and written by a background thread, so logging
+  /// from the GUI and render threads never blocks on stdout. Info and below
+  /// go to stdout, warnings and errors to stderr. Messages below the current
+  /// level are dropped before being formatted.
+  ///
+  /// The initial level is INFO, or the value of the SIMSLIDES_LOG_LEVEL
+  /// environment variable if set.
+  class Logger
+  {
+    /// \brief Constructor, starts the sink thread.
+    private: Logger();
+
+    /// \brief Destructor, writes all pending messages and stops the sink
+    /// thread.
+    public: ~Logger();
+
+    /// \brief Access the singleton.
+    /// \return Pointer to logger.
+    public: static Logger *Instance();
+
+    /// \brief Get the current level.
+    /// \return Log level.
+    public: LogLevel Level() const;
+
+    /// \brief Set the minimum level of messages to log.
+    /// \param[in] _level Log level.
+    public: void SetLevel(LogLevel _level);
+
+    /// \brief Whether messages at a level are logged.
+    /// \param[in] _level Log level.
+    /// \return True if enabled.
+    public: bool Enabled(LogLevel _level) const;
+
+    /// \brief Queue a message to be written. Returns immediately.
+    /// \param[in] _level Message level.
+    /// \param[in] _message Message, including any trailing new line.
+    public: void Write(LogLevel _level, std::string _message);
+
+    /// \brief Block until all queued messages have been written.
+    public: void Flush();
+
+    /// \brief Sink thread loop.
+    private: void Run();
+
+    /// \brief Minimum level logged.
+    private: std::atomic<int> level;
+
+    /// \brief Messages waiting to be written.
+    private: std::deque<std::pair<LogLevel, std::string>> queue;
+
+    /// \brief Number of messages taken from the queue but not written yet.
+    private: std::size_t writing{0};
+
+    /// \brief Protects the queue.
+    private: std::mutex mutex;
+
+    /// \brief Notifies the sink of new messages.
+    private: std::condition_variable queued;
+
+    /// \brief Notifies Flush callers once messages are written.
+    private: std::condition_variable written;
+
+    /// \brief Set to stop the sink thread.
+    private: bool stop{false};
+
+    /// \brief Sink thread.
+    private: std::thread thread;
+  };
+
+  /// \brief Accumulates a single message and queues it on destruction. Use
+  /// it through the ssmsg, sserr... macros.
+  class LogStream
+  {
+    /// \brief Constructor.
+    /// \param[in] _level Message level.
+    public: explicit LogStream(LogLevel _level);
+
+    /// \brief Destructor, queues the message.
+    public: ~LogStream();
+
+    /// \brief Append to the message.
+    /// \param[in] _value Value to append.
+    /// \return This stream.
+    public: template<typename T>
+    LogStream &operator<<(const T &_value)
+    {
+      this->stream << _value;
+      return *this;
+    }
+
+    /// \brief Support manipulators such as std::endl.
+    /// \param[in] _manip Manipulator.
+    /// \return This stream.
+    public: LogStream &operator<<(std::ostream &(*_manip)(std::ostream &));
+
+    /// \brief Message level.
+    private: LogLevel level;
+
+    /// \brief Message being built.
+    private: std::ostringstream stream;
+  };
+}
+
+#endif
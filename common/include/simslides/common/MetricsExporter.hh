@@ -0,0 +1,95 @@
+/*
+ * Copyright 2017 Louise Poubel
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+#ifndef SIMSLIDES_METRICSEXPORTER_HH_
+#define SIMSLIDES_METRICSEXPORTER_HH_
+
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "TransitionMetrics.hh"
+
+namespace simslides
+{
+  /// \brief Formats and writes transition metrics on a background thread,
+  /// so the render thread only pays for copying the histograms.
+  ///
+  /// Each snapshot is turned into a summary table, see
+  /// TransitionMetrics::Summary, and written to a file if a path is given.
+  /// Snapshots submitted while the previous one is still being written
+  /// replace each other, so only the latest is written. The thread is
+  /// started on the first submit.
+  class MetricsExporter
+  {
+    /// \brief Destructor, writes the pending snapshot and stops the thread.
+    public: ~MetricsExporter();
+
+    /// \brief Queue a snapshot of the metrics. Returns immediately.
+    /// \param[in] _metrics Metrics to copy.
+    /// \param[in] _path File to write them to, see TransitionMetrics::Write.
+    /// Empty to only summarize them.
+    public: void Submit(const TransitionMetrics &_metrics,
+        const std::string &_path);
+
+    /// \brief Block until the last submitted snapshot has been written.
+    public: void Flush();
+
+    /// \brief Get the summary of the latest snapshot, if it's newer than
+    /// the one returned by the previous call.
+    /// \param[out] _summary Summary table, only set if there's a new one.
+    /// \return True if there's a new summary.
+    public: bool TakeSummary(std::string &_summary);
+
+    /// \brief Thread loop.
+    private: void Run();
+
+    /// \brief Snapshot waiting to be written.
+    private: TransitionMetrics pending;
+
+    /// \brief File to write the pending snapshot to.
+    private: std::string pendingPath;
+
+    /// \brief Whether there's a snapshot waiting to be written.
+    private: bool hasPending{false};
+
+    /// \brief Whether a snapshot is being written.
+    private: bool writing{false};
+
+    /// \brief Summary of the latest snapshot.
+    private: std::string summary;
+
+    /// \brief Whether the summary changed since the last TakeSummary.
+    private: bool hasSummary{false};
+
+    /// \brief Protects all members above.
+    private: std::mutex mutex;
+
+    /// \brief Notifies the thread of new snapshots.
+    private: std::condition_variable submitted;
+
+    /// \brief Notifies Flush callers once snapshots are written.
+    private: std::condition_variable written;
+
+    /// \brief Set to stop the thread.
+    private: bool stop{false};
+
+    /// \brief Writer thread.
+    private: std::thread thread;
+  };
+}
+
+#endif
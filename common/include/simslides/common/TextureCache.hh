@@ -0,0 +1,139 @@
+/*
+ * Copyright 2017 Louise Poubel
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+#ifndef SIMSLIDES_TEXTURECACHE_HH_
+#define SIMSLIDES_TEXTURECACHE_HH_
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+
+namespace simslides
+{
+  /// \brief Slide textures stored by content, shared by all presentations
+  /// imported on the machine.
+  ///
+  /// Each texture is stored once, under a key computed by the caller from
+  /// the page content and the settings it's rendered with, so pages which
+  /// show up in several decks, or several times in one deck, are only
+  /// rendered once. Textures are hard linked into models where possible,
+  /// so identical pages share one file on disk, and copied otherwise.
+  /// Cached files keep the extension of the file they were stored from,
+  /// such as .png or .dds.
+  ///
+  /// The cache is bounded in size. Once it grows past its limit, the least
+  /// recently used textures are removed. Models keep their own links, so
+  /// evicting a texture never breaks a model.
+  class TextureCache
+  {
+    /// \brief Default size limit, in bytes.
+    public: static constexpr uint64_t kDefaultMaxSize{1024ull << 20};
+
+    /// \brief Default cache directory: `simslides/textures` under
+    /// $XDG_CACHE_HOME, or under ~/.cache if that isn't set.
+    /// \return Directory path, empty if there's no home directory.
+    public: static std::filesystem::path DefaultDirectory();
+
+    /// \brief Default size limit: the SIMSLIDES_TEXTURE_CACHE_SIZE
+    /// environment variable in MiB if set, otherwise kDefaultMaxSize. Values
+    /// which aren't numbers or don't fit in 64 bits once in bytes are
+    /// ignored with a warning.
+    /// \return Size in bytes, 0 to disable the cache.
+    public: static uint64_t DefaultMaxSize();
+
+    /// \brief Hard link a file, or copy it if it can't be linked, such as
+    /// across file systems. The destination is replaced atomically.
+    /// \param[in] _from Existing file.
+    /// \param[in] _to Destination, replaced if it exists.
+    /// \return False if the file couldn't be linked nor copied.
+    public: static bool LinkOrCopy(const std::filesystem::path &_from,
+        const std::filesystem::path &_to);
+
+    /// \brief Open a cache directory, creating it if needed, and index the
+    /// textures in it.
+    /// \param[in] _directory Cache directory.
+    /// \param[in] _maxSize Size limit in bytes, 0 to disable the cache.
+    /// \return False if the cache is disabled or the directory can't be
+    /// created.
+    public: bool Open(const std::filesystem::path &_directory,
+        uint64_t _maxSize);
+
+    /// \brief Whether the cache was opened.
+    /// \return True if textures can be looked up and stored.
+    public: bool Enabled() const;
+
+    /// \brief Look up a texture and mark it as recently used.
+    /// \param[in] _key Content key, such as a hex digest.
+    /// \param[out] _path Cached texture, only set on a hit.
+    /// \return True on a hit.
+    public: bool Find(const std::string &_key, std::filesystem::path &_path);
+
+    /// \brief Add a texture, then evict the least recently used ones if the
+    /// cache is over its limit. The new texture is never evicted by its own
+    /// insertion.
+    /// \param[in] _key Content key, such as a hex digest.
+    /// \param[in] _file Texture to add, which is linked or copied. A texture
+    /// stored before under the same key is replaced.
+    /// \param[out] _path Cached texture.
+    /// \return False if the texture couldn't be added.
+    public: bool Store(const std::string &_key,
+        const std::filesystem::path &_file, std::filesystem::path &_path);
+
+    /// \brief Total size of the cached textures.
+    /// \return Size in bytes.
+    public: uint64_t Size() const;
+
+    /// \brief Remove least recently used textures until the cache fits in
+    /// its limit.
+    /// \param[in] _keep Key which must not be removed.
+    private: void Evict(const std::string &_keep);
+
+    /// \brief Path of a texture in the cache. Textures are spread across
+    /// subdirectories by the first two characters of their key.
+    /// \param[in] _key Content key.
+    /// \param[in] _extension File extension, including the dot.
+    /// \return Texture path.
+    private: std::filesystem::path Path(const std::string &_key,
+        const std::string &_extension) const;
+
+    /// \brief A cached texture.
+    private: struct Entry
+    {
+      /// \brief File size in bytes.
+      uint64_t size;
+
+      /// \brief File extension, including the dot.
+      std::string extension;
+
+      /// \brief Last time it was stored or found.
+      std::filesystem::file_time_type used;
+    };
+
+    /// \brief Cached textures, by key.
+    private: std::unordered_map<std::string, Entry> entries;
+
+    /// \brief Cache directory, empty if not open.
+    private: std::filesystem::path directory;
+
+    /// \brief Size limit in bytes.
+    private: uint64_t maxSize{0};
+
+    /// \brief Total size of the entries in bytes.
+    private: uint64_t size{0};
+  };
+}
+
+#endif
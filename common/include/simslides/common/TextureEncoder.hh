@@ -0,0 +1,102 @@
+/*
+ * Copyright 2017 Louise Poubel
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+#ifndef SIMSLIDES_TEXTUREENCODER_HH_
+#define SIMSLIDES_TEXTUREENCODER_HH_
+
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+namespace simslides
+{
+  /// \brief Block compression formats.
+  enum BlockFormat
+  {
+    /// \brief BC1 / DXT1, 8 bytes per 4x4 block, for opaque images.
+    BLOCK_BC1,
+
+    /// \brief BC3 / DXT5, 16 bytes per 4x4 block, with smooth alpha.
+    BLOCK_BC3
+  };
+
+  /// \brief An image with 8-bit RGBA pixels.
+  struct RgbaImage
+  {
+    /// \brief Width in pixels.
+    uint32_t width{0};
+
+    /// \brief Height in pixels.
+    uint32_t height{0};
+
+    /// \brief Pixels row by row from the top, 4 bytes each, with no
+    /// padding between rows.
+    std::vector<uint8_t> pixels;
+  };
+
+  /// \brief Encodes slide textures into DDS files which GPUs can sample
+  /// without decompressing them.
+  ///
+  /// A full mipmap chain is built down to 1x1, averaging in linear light
+  /// and weighting colors by alpha, so text doesn't darken or bleed into
+  /// transparent areas as slides shrink into the distance. Each level is
+  /// then block compressed: BC1 for opaque images, which is 8 times
+  /// smaller than RGBA, and BC3 if any pixel is translucent.
+  ///
+  /// The legacy DDS header is used, which Ogre 1.x, Ogre 2.x and most
+  /// image tools load.
+  class TextureEncoder
+  {
+    /// \brief File extension of encoded textures.
+    public: static constexpr const char *kExtension{".dds"};
+
+    /// \brief Pick the format for an image.
+    /// \param[in] _image Image.
+    /// \return BLOCK_BC3 if any pixel isn't fully opaque, BLOCK_BC1
+    /// otherwise.
+    public: static BlockFormat Format(const RgbaImage &_image);
+
+    /// \brief Halve an image, rounding sizes down, but not below 1 pixel.
+    /// \param[in] _image Image larger than 1x1.
+    /// \return Next mipmap level.
+    public: static RgbaImage Downsample(const RgbaImage &_image);
+
+    /// \brief Block compress one image.
+    /// \param[in] _image Image, of any size. Partial blocks on the edges are
+    /// padded by repeating the last row and column.
+    /// \param[in] _format Block format.
+    /// \param[out] _blocks Compressed blocks are appended, row by row.
+    public: static void Compress(const RgbaImage &_image,
+        BlockFormat _format, std::vector<uint8_t> &_blocks);
+
+    /// \brief Encode an image and its mipmaps into a DDS file in memory.
+    /// \param[in] _image Image, not empty.
+    /// \param[out] _dds DDS file contents.
+    /// \return False if the image is empty.
+    public: static bool Encode(const RgbaImage &_image,
+        std::vector<uint8_t> &_dds);
+
+    /// \brief Encode an image and write it to a DDS file. The file is
+    /// replaced atomically, and never written in place, so hard links to
+    /// an older version are left untouched.
+    /// \param[in] _image Image, not empty.
+    /// \param[in] _path File to write.
+    /// \return False if the image is empty or the file couldn't be written.
+    public: static bool Write(const RgbaImage &_image,
+        const std::filesystem::path &_path);
+  };
+}
+
+#endif
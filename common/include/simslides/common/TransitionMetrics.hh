@@ -0,0 +1,174 @@
+/*
+ * Copyright 2017 Louise Poubel
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+#ifndef SIMSLIDES_TRANSITIONMETRICS_HH_
+#define SIMSLIDES_TRANSITIONMETRICS_HH_
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+#include "Keyframe.hh"
+#include "LatencyHistogram.hh"
+
+namespace simslides
+{
+  /// \brief Stages of a transition which are timed separately.
+  enum TransitionStage
+  {
+    /// \brief From the key press until the update starts, including time
+    /// spent queued and coalescing.
+    STAGE_INPUT,
+
+    /// \brief Time spent in Common::Update.
+    STAGE_UPDATE,
+
+    /// \brief From the camera move being issued until the camera settles
+    /// on the keyframe.
+    STAGE_CAMERA,
+
+    /// \brief From the key press until the camera settles. Updates which
+    /// weren't triggered by a command, such as autoplay, start counting
+    /// when the update starts.
+    STAGE_TOTAL
+  };
+
+  /// \brief Latency of keyframe transitions, kept in one LatencyHistogram
+  /// per keyframe type and stage.
+  ///
+  /// Common reports the timing points of each transition: command received,
+  /// update started and ended, camera move issued and camera settled. A
+  /// transition which is replaced before the camera settles, such as when
+  /// the presenter presses a key mid-flight, only has its input and update
+  /// stages recorded. Moves back to the initial camera pose are recorded
+  /// under KeyframeType::NONE, if the backend moves the camera through
+  /// Common::MoveCamera.
+  ///
+  /// Only the thread which updates may call it.
+  class TransitionMetrics
+  {
+    /// \brief Clock used for all time points.
+    public: using Clock = std::chrono::steady_clock;
+
+    /// \brief Number of stages, see TransitionStage.
+    public: static constexpr std::size_t kStageCount{STAGE_TOTAL + 1};
+
+    /// \brief Number of keyframe types, see KeyframeType.
+    public: static constexpr std::size_t kTypeCount{
+        KeyframeType::CAM_POSE + 1};
+
+    /// \brief Constructor.
+    public: TransitionMetrics();
+
+    /// \brief Remove all measurements, such as when a new deck is loaded.
+    public: void Clear();
+
+    /// \brief A command which changes the keyframe was received. Until the
+    /// next update, only the earliest one is kept, so the latency of a
+    /// coalesced burst counts from its first key press.
+    /// \param[in] _time Time the command was received.
+    public: void Received(Clock::time_point _time);
+
+    /// \brief An update started, beginning a new transition.
+    /// \param[in] _keyframe Keyframe index, -1 for the initial pose.
+    /// \param[in] _type Keyframe type, NONE for the initial pose.
+    /// \param[in] _time Current time.
+    public: void UpdateStarted(int _keyframe, KeyframeType _type,
+        Clock::time_point _time);
+
+    /// \brief The update ended.
+    /// \param[in] _time Current time.
+    public: void UpdateEnded(Clock::time_point _time);
+
+    /// \brief The camera was asked to move for the current transition.
+    /// \param[in] _time Current time.
+    public: void MoveIssued(Clock::time_point _time);
+
+    /// \brief The camera reached the goal of the current transition.
+    /// \param[in] _time Current time.
+    public: void Settled(Clock::time_point _time);
+
+    /// \brief Get a histogram.
+    /// \param[in] _type Keyframe type.
+    /// \param[in] _stage Stage.
+    /// \return Histogram.
+    public: const LatencyHistogram &Histogram(KeyframeType _type,
+        TransitionStage _stage) const;
+
+    /// \brief Keyframe whose transition took the longest in total.
+    /// \param[in] _type Keyframe type.
+    /// \return Keyframe index, -1 if none was recorded.
+    public: int Slowest(KeyframeType _type) const;
+
+    /// \brief Incremented every time a measurement is recorded, so callers
+    /// can tell when to refresh what they show.
+    /// \return Version.
+    public: uint64_t Version() const;
+
+    /// \brief Human readable table of the percentiles of each stage, for
+    /// keyframe types with measurements.
+    /// \return Table, one row per line.
+    public: std::string Summary() const;
+
+    /// \brief Write all histograms in the Prometheus text format. The file
+    /// is written next to the path first and then renamed over it, so
+    /// readers never see a partial file.
+    /// \param[in] _path File path.
+    /// \return True on success.
+    public: bool Write(const std::string &_path) const;
+
+    /// \brief Histograms indexed by type, then stage.
+    private: std::array<std::array<LatencyHistogram, kStageCount>,
+        kTypeCount> histograms;
+
+    /// \brief Slowest keyframe of each type, -1 if none.
+    private: std::array<int, kTypeCount> slowest;
+
+    /// \brief Total duration of the slowest keyframe of each type.
+    private: std::array<Clock::duration, kTypeCount> slowestTotal{};
+
+    /// \brief Earliest command received since the last update, if
+    /// hasReceived.
+    private: Clock::time_point received;
+
+    /// \brief Start of the current transition: the command received time,
+    /// or the update start time.
+    private: Clock::time_point start;
+
+    /// \brief Time the update started.
+    private: Clock::time_point updateStart;
+
+    /// \brief Time the camera move was issued, if moving.
+    private: Clock::time_point moveIssued;
+
+    /// \brief Keyframe of the current transition.
+    private: int keyframe{-1};
+
+    /// \brief Type of the current transition.
+    private: KeyframeType type{KeyframeType::NONE};
+
+    /// \brief Whether a command was received since the last update.
+    private: bool hasReceived{false};
+
+    /// \brief Whether the camera is moving for the current transition.
+    private: bool moving{false};
+
+    /// \brief See Version().
+    private: uint64_t version{0};
+  };
+}
+
+#endif
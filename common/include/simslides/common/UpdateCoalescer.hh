@@ -0,0 +1,77 @@
+/*
+ * Copyright 2017 Louise Poubel
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+#ifndef SIMSLIDES_UPDATECOALESCER_HH_
+#define SIMSLIDES_UPDATECOALESCER_HH_
+
+#include <chrono>
+
+namespace simslides
+{
+  /// \brief Collapses bursts of keyframe changes into as few updates as
+  /// possible.
+  ///
+  /// The first request after a quiet period is applied right away, so single
+  /// key presses aren't delayed. Requests which arrive less than a window
+  /// after the last update are deferred, and all of them are applied as a
+  /// single update once the window is over. Since the update goes straight
+  /// to the latest keyframe, intermediate camera moves and visibility
+  /// changes are skipped.
+  class UpdateCoalescer
+  {
+    /// \brief Clock used for all time points.
+    public: using Clock = std::chrono::steady_clock;
+
+    /// \brief Set the minimum time between updates. Zero disables
+    /// coalescing.
+    /// \param[in] _window Window duration.
+    public: void SetWindow(Clock::duration _window);
+
+    /// \brief Get the minimum time between updates.
+    /// \return Window duration.
+    public: Clock::duration Window() const;
+
+    /// \brief Request an update.
+    /// \param[in] _now Current time.
+    /// \return True if the update should be applied now, false if it was
+    /// deferred until Poll returns true.
+    public: bool Request(Clock::time_point _now);
+
+    /// \brief Check whether a deferred update is due.
+    /// \param[in] _now Current time.
+    /// \return True if the deferred update should be applied now.
+    public: bool Poll(Clock::time_point _now);
+
+    /// \brief Whether an update has been deferred.
+    /// \return True if pending.
+    public: bool Pending() const;
+
+    /// \brief Time left until a deferred update is due.
+    /// \param[in] _now Current time.
+    /// \return Remaining time, zero if due or if nothing is pending.
+    public: Clock::duration Remaining(Clock::time_point _now) const;
+
+    /// \brief Minimum time between updates.
+    private: Clock::duration window{0};
+
+    /// \brief Time of the last update applied.
+    private: Clock::time_point lastUpdate;
+
+    /// \brief Whether an update has been deferred.
+    private: bool pending{false};
+  };
+}
+
+#endif
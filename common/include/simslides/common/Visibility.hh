@@ -0,0 +1,97 @@
+/*
+ * Copyright 2017 Louise Poubel
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+#ifndef SIMSLIDES_VISIBILITY_HH_
+#define SIMSLIDES_VISIBILITY_HH_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "KeyframeTable.hh"
+
+namespace simslides
+{
+  /// \brief A change in a visual's visibility.
+  struct VisibilityChange
+  {
+    /// \brief Visual ID, see KeyframeTable::VisualName.
+    uint32_t visual;
+
+    /// \brief True if the visual should be shown.
+    bool visible;
+  };
+
+  /// \brief Models which visuals are visible at each keyframe of a deck.
+  ///
+  /// All visuals start visible. Visiting a STACK keyframe hides all other
+  /// visuals in its stack, and once a stack has been walked through, its last
+  /// slide is the one left visible. Keyframes before a stack see all of its
+  /// visuals, so going back past a stack shows them again. STACK keyframes
+  /// without a visual are ignored. Visibility is stored as bitsets over the
+  /// deck's visual IDs, checkpointed every few stacks, so the state at any
+  /// keyframe can be rebuilt by replaying at most kStride stacks.
+  class VisibilityIndex
+  {
+    /// \brief Number of stacks between checkpoints.
+    public: static constexpr std::size_t kStride{32};
+
+    /// \brief Build the index for a deck. Must be called again whenever the
+    /// deck changes.
+    /// \param[in] _keyframes Deck keyframes.
+    public: void Build(const KeyframeTable &_keyframes);
+
+    /// \brief Compute which visuals change visibility when going from one
+    /// keyframe to another.
+    /// \param[in] _keyframes Deck keyframes, same as passed to Build.
+    /// \param[in] _from Keyframe index currently shown, -1 for the initial
+    /// state where all visuals are visible.
+    /// \param[in] _to Keyframe index to go to, -1 for the initial state.
+    /// \param[out] _changes Visuals which must change, in increasing ID order.
+    public: void Diff(const KeyframeTable &_keyframes, int _from, int _to,
+        std::vector<VisibilityChange> &_changes);
+
+    /// \brief Fill a bitset with the visibility state at a keyframe.
+    /// \param[in] _keyframes Deck keyframes.
+    /// \param[in] _keyframe Keyframe index, -1 for the initial state.
+    /// \param[out] _bits One bit per visual ID, set if visible.
+    private: void State(const KeyframeTable &_keyframes, int _keyframe,
+        std::vector<uint64_t> &_bits) const;
+
+    /// \brief Apply a stack to a bitset, leaving only one of its visuals
+    /// visible.
+    /// \param[in] _keyframes Deck keyframes.
+    /// \param[in] _stack Stack ID.
+    /// \param[in] _shown Keyframe whose visual is left visible.
+    /// \param[in, out] _bits Bitset to modify.
+    private: static void ApplyStack(const KeyframeTable &_keyframes,
+        uint32_t _stack, std::size_t _shown, std::vector<uint64_t> &_bits);
+
+    /// \brief Number of 64-bit words in each bitset.
+    private: std::size_t words{0};
+
+    /// \brief State before stacks 0, kStride, 2 * kStride... are applied,
+    /// stored back to back.
+    private: std::vector<uint64_t> checkpoints;
+
+    /// \brief Scratch bitset for the state being left.
+    private: std::vector<uint64_t> fromBits;
+
+    /// \brief Scratch bitset for the state being entered.
+    private: std::vector<uint64_t> toBits;
+  };
+}
+
+#endif
@@ -0,0 +1,68 @@
+/*
+ * Copyright 2017 Louise Poubel
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+#ifndef SIMSLIDES_WORLD_HH_
+#define SIMSLIDES_WORLD_HH_
+
+#include <map>
+#include <set>
+#include <string>
+
+#include <sdf/Element.hh>
+#include <ignition/math/Pose3.hh>
+
+namespace simslides
+{
+  /// \brief Find a SimSlides GUI plugin in a world file, for tools which
+  /// run outside of a simulator.
+  /// \param[in] _root Root <sdf> element.
+  /// \param[in] _plugin Name or filename of the plugin to look for, empty to
+  /// take the first plugin with <keyframe>s or a <deck_file>.
+  /// \return Plugin element, null if not found.
+  sdf::ElementPtr FindPlugin(const sdf::ElementPtr _root,
+      const std::string &_plugin);
+
+  /// \brief Get the world pose of every top-level model in a world file,
+  /// including models added with <include>.
+  /// \param[in] _root Root <sdf> element.
+  /// \return Map of model name to pose.
+  std::map<std::string, ignition::math::Pose3d> ModelPoses(
+      const sdf::ElementPtr _root);
+
+  /// \brief Get the world pose of every model in a world file, including
+  /// nested models, and of their links and visuals. Entities are named the
+  /// way visuals are named in the scene, such as "model", "model::link" and
+  /// "model::link::visual". Poses must be relative to the parent entity:
+  /// SDF 1.7 poses relative_to any other frame aren't resolved, and those
+  /// entities are left out, together with their children.
+  /// \param[in] _root Root <sdf> element.
+  /// \param[in] _staticOnly Only include static models and their children,
+  /// which can't move during the presentation.
+  /// \param[out] _unresolved Names of entities left out because of
+  /// relative_to.
+  /// \return Map of entity name to world pose.
+  std::map<std::string, ignition::math::Pose3d> EntityPoses(
+      const sdf::ElementPtr _root, bool _staticOnly,
+      std::set<std::string> &_unresolved);
+
+  /// \brief Get the initial user camera pose from a world's <gui><camera>.
+  /// \param[in] _root Root <sdf> element.
+  /// \param[out] _pose Camera pose.
+  /// \return False if the world doesn't set a camera pose.
+  bool InitialCameraPose(const sdf::ElementPtr _root,
+      ignition::math::Pose3d &_pose);
+}
+
+#endif
@@ -0,0 +1,139 @@
+/*
+ * Copyright 2017 Louise Poubel
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+#include <gtest/gtest.h>
+
+#include <chrono>
+
+#include <simslides/common/Autoplay.hh>
+
+using namespace simslides;
+using namespace std::chrono_literals;
+
+/// \brief Arbitrary start time.
+static const Autoplay::Clock::time_point kStart{std::chrono::hours(1)};
+
+/////////////////////////////////////////////////
+TEST(Autoplay, NothingScheduled)
+{
+  Autoplay autoplay;
+  EXPECT_FALSE(autoplay.Playing());
+
+  autoplay.Play(kStart);
+  EXPECT_TRUE(autoplay.Playing());
+  EXPECT_FALSE(autoplay.Due(kStart + 1h));
+  EXPECT_EQ(Autoplay::Clock::duration::zero(), autoplay.Remaining(kStart));
+}
+
+/////////////////////////////////////////////////
+TEST(Autoplay, Deadline)
+{
+  Autoplay autoplay;
+  autoplay.Show(0, 2s, kStart);
+
+  // Nothing is due while paused
+  EXPECT_FALSE(autoplay.Due(kStart + 1h));
+
+  autoplay.Play(kStart);
+  EXPECT_FALSE(autoplay.Due(kStart + 1999ms));
+  EXPECT_TRUE(autoplay.Due(kStart + 2s));
+  EXPECT_EQ(1500ms, autoplay.Remaining(kStart + 500ms));
+  EXPECT_EQ(Autoplay::Clock::duration::zero(),
+      autoplay.Remaining(kStart + 3s));
+
+  // Showing the scheduled keyframe again keeps its deadline
+  autoplay.Show(0, 2s, kStart + 1s);
+  EXPECT_TRUE(autoplay.Due(kStart + 2s));
+
+  // Other keyframes get their whole dwell from now
+  autoplay.Show(3, 5s, kStart + 1s);
+  EXPECT_FALSE(autoplay.Due(kStart + 5s));
+  EXPECT_TRUE(autoplay.Due(kStart + 6s));
+}
+
+/////////////////////////////////////////////////
+TEST(Autoplay, NoDrift)
+{
+  Autoplay autoplay;
+  autoplay.Play(kStart);
+  autoplay.Show(0, 2s, kStart);
+
+  // Poll at 60 Hz for an hour. Frames never land on deadlines, but each
+  // deadline is counted from the previous one, so lateness doesn't add up.
+  const auto frame = std::chrono::microseconds(16667);
+  int advances{0};
+  auto now = kStart;
+  for (; now < kStart + 1h; now += frame)
+  {
+    if (autoplay.Due(now))
+    {
+      autoplay.Advance(advances % 5, 2s, now);
+      ++advances;
+      ASSERT_EQ(kStart + (advances + 1) * 2s, now + autoplay.Remaining(now));
+    }
+  }
+
+  EXPECT_EQ(1799, advances);
+}
+
+/////////////////////////////////////////////////
+TEST(Autoplay, PauseResume)
+{
+  Autoplay autoplay;
+  autoplay.Play(kStart);
+  autoplay.Show(0, 2s, kStart);
+
+  autoplay.Pause(kStart + 500ms);
+  EXPECT_FALSE(autoplay.Playing());
+  EXPECT_FALSE(autoplay.Due(kStart + 1h));
+  EXPECT_EQ(1500ms, autoplay.Remaining(kStart + 1h));
+
+  // The rest of the dwell is counted from when playing resumes
+  autoplay.Play(kStart + 1h);
+  EXPECT_FALSE(autoplay.Due(kStart + 1h + 1499ms));
+  EXPECT_TRUE(autoplay.Due(kStart + 1h + 1500ms));
+}
+
+/////////////////////////////////////////////////
+TEST(Autoplay, FallBehind)
+{
+  Autoplay autoplay;
+  autoplay.Play(kStart);
+  autoplay.Show(0, 2s, kStart);
+
+  // Polling stopped for much longer than a dwell, such as during sleep.
+  // Instead of rushing through the missed keyframes, start over from now.
+  auto late = kStart + 5min;
+  ASSERT_TRUE(autoplay.Due(late));
+  autoplay.Advance(1, 2s, late);
+  EXPECT_FALSE(autoplay.Due(late));
+  EXPECT_EQ(2s, autoplay.Remaining(late));
+}
+
+/////////////////////////////////////////////////
+TEST(Autoplay, Reset)
+{
+  Autoplay autoplay;
+  autoplay.SetLoop(true);
+  autoplay.SetDefaultDwell(3s);
+  autoplay.Play(kStart);
+  autoplay.Show(0, 2s, kStart);
+
+  autoplay.Reset();
+  EXPECT_FALSE(autoplay.Playing());
+  EXPECT_EQ(Autoplay::Clock::duration::zero(), autoplay.Remaining(kStart));
+  EXPECT_TRUE(autoplay.Loop());
+  EXPECT_EQ(3s, autoplay.DefaultDwell());
+}
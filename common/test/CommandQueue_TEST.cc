@@ -0,0 +1,94 @@
+/*
+ * Copyright 2017 Louise Poubel
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <vector>
+
+#include <simslides/common/CommandQueue.hh>
+
+using namespace simslides;
+
+/////////////////////////////////////////////////
+TEST(CommandQueue, SingleThread)
+{
+  CommandQueue queue;
+  Command command;
+  EXPECT_FALSE(queue.Pop(command));
+
+  queue.Push({CMD_GOTO, 3});
+  queue.Push({CMD_HOME});
+
+  ASSERT_TRUE(queue.Pop(command));
+  EXPECT_EQ(CMD_GOTO, command.type);
+  EXPECT_EQ(3, command.keyframe);
+
+  ASSERT_TRUE(queue.Pop(command));
+  EXPECT_EQ(CMD_HOME, command.type);
+
+  EXPECT_FALSE(queue.Pop(command));
+
+  // Commands which are never popped are freed by the destructor
+  queue.Push({CMD_NEXT});
+}
+
+/////////////////////////////////////////////////
+TEST(CommandQueue, MultipleProducers)
+{
+  CommandQueue queue;
+  const int producers = 4;
+  const int perProducer = 50000;
+
+  // Each producer pushes its own command type, numbered in order
+  std::vector<std::thread> threads;
+  for (int p = 0; p < producers; ++p)
+  {
+    threads.emplace_back([&queue, p]
+    {
+      for (int i = 0; i < perProducer; ++i)
+        queue.Push({static_cast<CommandType>(p), i});
+    });
+  }
+
+  // Nothing is lost or duplicated, and each producer's commands come out
+  // in the order they were pushed
+  std::vector<int> next(producers, 0);
+  int popped{0};
+  while (popped < producers * perProducer)
+  {
+    Command command;
+    if (!queue.Pop(command))
+      continue;
+
+    // Keep popping on failure, so the producers can finish
+    ++popped;
+    if (static_cast<int>(command.type) >= producers)
+    {
+      ADD_FAILURE() << "Unexpected type [" << command.type << "]";
+      continue;
+    }
+    EXPECT_EQ(next[command.type], command.keyframe);
+    next[command.type] = command.keyframe + 1;
+  }
+
+  for (auto &thread : threads)
+    thread.join();
+
+  Command command;
+  EXPECT_FALSE(queue.Pop(command));
+  for (int p = 0; p < producers; ++p)
+    EXPECT_EQ(perProducer, next[p]);
+}
@@ -0,0 +1,87 @@
+/*
+ * Copyright 2017 Louise Poubel
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+#include <gtest/gtest.h>
+#include <gtest/gtest.h>
+
+#include <cstdint>
+
+#include <ignition/math/Pose3.hh>
+
+#include <simslides/common/Common.hh>
+
+#include "TestDeck.hh"
+
+using namespace simslides;
+
+/// \brief Load a deck with two keyframes looking at "a", with poses compiled
+/// for "a" at _target.
+/// \param[in] _target Pose of "a" when the deck was compiled.
+/// \return ID of visual "a".
+static uint32_t LoadCompiled(const ignition::math::Pose3d &_target)
+{
+  auto common = Common::Instance();
+  common->keyframes.Clear();
+  EXPECT_TRUE(test::LoadKeyframes(
+      "<keyframe type='lookat' visual='a'/>"
+      "<keyframe type='stack' visual='a' eye_offset='0 -2 0.5 0 0 0'/>",
+      common->keyframes));
+
+  for (std::size_t i = 0; i < common->keyframes.Size(); ++i)
+  {
+    common->keyframes.SetEyePose(i,
+        common->EyePose(_target, common->keyframes.EyeOffset(i)));
+  }
+  common->eyePoses.Build(common->keyframes);
+
+  return common->keyframes.VisualId(0);
+}
+
+/////////////////////////////////////////////////
+TEST(Common, CompiledPoseSurvivesResolution)
+{
+  ignition::math::Pose3d target(1, 2, 3, 0, 0, 0.5);
+  auto id = LoadCompiled(target);
+
+  auto common = Common::Instance();
+  common->VisualResolved(id, target);
+
+  for (std::size_t i = 0; i < common->keyframes.Size(); ++i)
+  {
+    ignition::math::Pose3d pose;
+    uint64_t stamp;
+    ASSERT_TRUE(common->eyePoses.Find(common->keyframes, i, pose, stamp));
+    EXPECT_EQ(EyePoseCache::kInitialStamp, stamp);
+    EXPECT_EQ(common->EyePose(target, common->keyframes.EyeOffset(i)), pose);
+  }
+}
+
+/////////////////////////////////////////////////
+TEST(Common, MovedVisualInvalidatesCompiledPose)
+{
+  ignition::math::Pose3d target(1, 2, 3, 0, 0, 0.5);
+  auto id = LoadCompiled(target);
+
+  auto common = Common::Instance();
+  common->VisualResolved(id, ignition::math::Pose3d(1, 2, 4, 0, 0, 0.5));
+
+  for (std::size_t i = 0; i < common->keyframes.Size(); ++i)
+  {
+    ignition::math::Pose3d pose;
+    uint64_t stamp;
+    EXPECT_FALSE(common->eyePoses.Find(common->keyframes, i, pose, stamp));
+    EXPECT_NE(EyePoseCache::kInitialStamp, stamp);
+  }
+}
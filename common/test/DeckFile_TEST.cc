@@ -0,0 +1,192 @@
+/*
+ * Copyright 2017 Louise Poubel
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <simslides/common/DeckFile.hh>
+#include <simslides/common/KeyframeTable.hh>
+
+#include "TestDeck.hh"
+
+using namespace simslides;
+
+/// \brief Deck using every keyframe field which is saved.
+static const char *kDeck =
+    "<keyframe type='lookat' visual='a' number='3' label='intro'"
+    "    eye_offset='0 -2 0.5 0 0 0' transition='1.5' dwell='4'/>"
+    "<keyframe type='stack' visual='b' text='<<b>>bold<</b>>'/>"
+    "<keyframe type='stack' visual='c'/>"
+    "<keyframe type='cam_pose' pose='1 2 3 0 0.5 1' label='overview'/>";
+
+/////////////////////////////////////////////////
+/// \brief Test fixture which removes its deck file.
+class DeckFileTest : public ::testing::Test
+{
+  /// \brief Pick a file name.
+  protected: void SetUp() override
+  {
+    this->path = (std::filesystem::temp_directory_path() /
+        ("simslides_" + std::string(::testing::UnitTest::GetInstance()->
+        current_test_info()->name()) + ".deck")).string();
+  }
+
+  /// \brief Remove the file.
+  protected: void TearDown() override
+  {
+    std::error_code ec;
+    std::filesystem::remove(this->path, ec);
+  }
+
+  /// \brief Overwrite bytes of the deck file.
+  /// \param[in] _offset Byte offset.
+  /// \param[in] _bytes New bytes.
+  protected: void Patch(std::size_t _offset,
+      const std::vector<char> &_bytes)
+  {
+    std::fstream file(this->path,
+        std::ios::in | std::ios::out | std::ios::binary);
+    file.seekp(_offset);
+    file.write(_bytes.data(), _bytes.size());
+  }
+
+  /// \brief Deck file path.
+  protected: std::string path;
+};
+
+/////////////////////////////////////////////////
+TEST_F(DeckFileTest, RoundTrip)
+{
+  KeyframeTable saved;
+  ASSERT_TRUE(test::LoadKeyframes(kDeck, saved));
+  ASSERT_TRUE(DeckFile::Save(saved, this->path));
+
+  KeyframeTable loaded;
+  std::string error;
+  ASSERT_TRUE(DeckFile::Load(this->path, loaded, error)) << error;
+  ASSERT_EQ(saved.Size(), loaded.Size());
+
+  for (std::size_t i = 0; i < saved.Size(); ++i)
+  {
+    SCOPED_TRACE("Keyframe [" + std::to_string(i) + "]");
+    EXPECT_EQ(saved.Type(i), loaded.Type(i));
+    EXPECT_EQ(saved.SlideNumber(i), loaded.SlideNumber(i));
+    EXPECT_EQ(saved.Visual(i), loaded.Visual(i));
+    EXPECT_EQ(saved.Label(i), loaded.Label(i));
+    EXPECT_EQ(saved.Text(i), loaded.Text(i));
+    EXPECT_EQ(saved.EyeOffset(i), loaded.EyeOffset(i));
+    EXPECT_EQ(saved.CamPose(i), loaded.CamPose(i));
+    EXPECT_EQ(saved.StackId(i), loaded.StackId(i));
+    EXPECT_EQ(std::isnan(saved.Transition(i)),
+        std::isnan(loaded.Transition(i)));
+    EXPECT_EQ(std::isnan(saved.Dwell(i)), std::isnan(loaded.Dwell(i)));
+  }
+
+  EXPECT_EQ(3, loaded.SlideNumber(0));
+  EXPECT_DOUBLE_EQ(1.5, loaded.Transition(0));
+  EXPECT_DOUBLE_EQ(4.0, loaded.Dwell(0));
+  EXPECT_EQ("&lt;b&gt;bold&lt;/b&gt;", loaded.Text(1));
+
+  // Indexes are rebuilt on load
+  std::size_t index;
+  ASSERT_TRUE(loaded.FindLabel("overview", index));
+  EXPECT_EQ(3u, index);
+  ASSERT_TRUE(loaded.FindVisual("c", index));
+  EXPECT_EQ(2u, index);
+  EXPECT_FALSE(loaded.FindLabel("missing", index));
+
+  ASSERT_EQ(saved.StackCount(), loaded.StackCount());
+  ASSERT_EQ(1u, loaded.StackCount());
+  EXPECT_EQ(1u, loaded.Stack(0).front);
+  EXPECT_EQ(2u, loaded.Stack(0).back);
+}
+
+/////////////////////////////////////////////////
+TEST_F(DeckFileTest, MissingFile)
+{
+  KeyframeTable loaded;
+  std::string error;
+  EXPECT_FALSE(DeckFile::Load(this->path, loaded, error));
+  EXPECT_FALSE(error.empty());
+  EXPECT_TRUE(loaded.Empty());
+}
+
+/////////////////////////////////////////////////
+TEST_F(DeckFileTest, BadMagic)
+{
+  KeyframeTable saved;
+  ASSERT_TRUE(test::LoadKeyframes(kDeck, saved));
+  ASSERT_TRUE(DeckFile::Save(saved, this->path));
+  this->Patch(0, {'X'});
+
+  KeyframeTable loaded;
+  std::string error;
+  EXPECT_FALSE(DeckFile::Load(this->path, loaded, error));
+  EXPECT_NE(std::string::npos, error.find("not a deck file")) << error;
+  EXPECT_TRUE(loaded.Empty());
+}
+
+/////////////////////////////////////////////////
+TEST_F(DeckFileTest, WrongVersion)
+{
+  KeyframeTable saved;
+  ASSERT_TRUE(test::LoadKeyframes(kDeck, saved));
+  ASSERT_TRUE(DeckFile::Save(saved, this->path));
+
+  // The version follows the magic
+  auto version = DeckFile::kVersion + 1;
+  std::vector<char> bytes(sizeof(version));
+  std::memcpy(bytes.data(), &version, sizeof(version));
+  this->Patch(sizeof(DeckFile::kMagic), bytes);
+
+  KeyframeTable loaded;
+  std::string error;
+  EXPECT_FALSE(DeckFile::Load(this->path, loaded, error));
+  EXPECT_NE(std::string::npos, error.find("version")) << error;
+  EXPECT_TRUE(loaded.Empty());
+}
+
+/////////////////////////////////////////////////
+TEST_F(DeckFileTest, Truncated)
+{
+  KeyframeTable saved;
+  ASSERT_TRUE(test::LoadKeyframes(kDeck, saved));
+  ASSERT_TRUE(DeckFile::Save(saved, this->path));
+
+  auto size = std::filesystem::file_size(this->path);
+
+  // Too short for a header
+  std::filesystem::resize_file(this->path, 16);
+  KeyframeTable loaded;
+  std::string error;
+  EXPECT_FALSE(DeckFile::Load(this->path, loaded, error));
+  EXPECT_FALSE(error.empty());
+  EXPECT_TRUE(loaded.Empty());
+
+  // Whole header, but missing data
+  ASSERT_TRUE(DeckFile::Save(saved, this->path));
+  std::filesystem::resize_file(this->path, size - 8);
+  error.clear();
+  EXPECT_FALSE(DeckFile::Load(this->path, loaded, error));
+  EXPECT_NE(std::string::npos, error.find("size")) << error;
+  EXPECT_TRUE(loaded.Empty());
+}
@@ -0,0 +1,170 @@
+/*
+ * Copyright 2017 Louise Poubel
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <simslides/common/KeyframeTable.hh>
+
+#include "TestDeck.hh"
+
+using namespace simslides;
+
+/////////////////////////////////////////////////
+TEST(KeyframeTable, EncodeText)
+{
+  KeyframeTable keyframes;
+  ASSERT_TRUE(test::LoadKeyframes(
+      "<keyframe type='cam_pose' text='plain'/>"
+      "<keyframe type='cam_pose' text='a <<b>> c'/>"
+      "<keyframe type='cam_pose' text='<<<'/>"
+      "<keyframe type='cam_pose' text='>>>>x'/>"
+      "<keyframe type='cam_pose' text='1 &lt; 2 &gt; 0'/>"
+      "<keyframe type='cam_pose' text='<</p>><<p>>'/>"
+      "<keyframe type='cam_pose'/>",
+      keyframes));
+  ASSERT_EQ(7u, keyframes.Size());
+
+  EXPECT_EQ("plain", keyframes.Text(0));
+  EXPECT_EQ("a &lt;b&gt; c", keyframes.Text(1));
+
+  // Pairs are replaced left to right, leaving odd characters
+  EXPECT_EQ("&lt;<", keyframes.Text(2));
+  EXPECT_EQ("&gt;&gt;x", keyframes.Text(3));
+
+  // Single characters are left alone
+  EXPECT_EQ("1 < 2 > 0", keyframes.Text(4));
+
+  EXPECT_EQ("&lt;/p&gt;&lt;p&gt;", keyframes.Text(5));
+  EXPECT_EQ("", keyframes.Text(6));
+}
+
+/////////////////////////////////////////////////
+TEST(KeyframeTable, TextFile)
+{
+  auto path = (std::filesystem::temp_directory_path() /
+      "simslides_KeyframeTable_TextFile.html").string();
+  {
+    std::ofstream file(path);
+    file << "<b>from a file</b>";
+  }
+
+  KeyframeTable keyframes;
+  ASSERT_TRUE(test::LoadKeyframes(
+      "<keyframe type='cam_pose' text='ignored' text_file='" + path + "'/>"
+      "<keyframe type='cam_pose' text_file='" + path + ".missing'/>",
+      keyframes));
+  ASSERT_EQ(2u, keyframes.Size());
+
+  // The file is only read when the text is requested, and takes precedence
+  // over the text attribute. It isn't encoded.
+  EXPECT_EQ(path, keyframes.TextFile(0));
+  {
+    std::ofstream file(path);
+    file << "<b>changed</b>";
+  }
+  EXPECT_EQ("<b>changed</b>", keyframes.Text(0));
+
+  // Then it's cached
+  {
+    std::ofstream file(path);
+    file << "<b>changed again</b>";
+  }
+  EXPECT_EQ("<b>changed</b>", keyframes.Text(0));
+
+  // Missing files have no text
+  EXPECT_EQ("", keyframes.Text(1));
+
+  std::filesystem::remove(path);
+}
+
+/////////////////////////////////////////////////
+TEST(KeyframeTable, AddAll)
+{
+  // Enough keyframes to be parsed on several threads
+  std::string sdf;
+  for (int i = 0; i < 2000; ++i)
+  {
+    auto n = std::to_string(i);
+    switch (i % 4)
+    {
+      case 0:
+        sdf += "<keyframe type='lookat' visual='v" + n + "' number='" + n +
+            "' eye_offset='0 -2 " + n + " 0 0 0' label='l" + n + "'/>";
+        break;
+      case 1:
+        sdf += "<keyframe type='stack' visual='v" + n +
+            "' text='<<" + n + ">>' transition='0.5' dwell='" + n + "'/>";
+        break;
+      case 2:
+        sdf += "<keyframe type='cam_pose' pose='" + n + " 2 3 0 0 1'/>";
+        break;
+      default:
+        sdf += "<keyframe type='log_seek' cam_pose='1 " + n +
+            " 3 0 0 0' time='" + n + " 500'/>";
+    }
+  }
+  sdf += "<keyframe type='stack' visual='bad' transition='slow'/>";
+  sdf += "<keyframe type='lookat'/>";
+
+  auto pluginElem = test::LoadPlugin(sdf);
+  ASSERT_NE(nullptr, pluginElem);
+
+  KeyframeTable serial;
+  ASSERT_TRUE(test::LoadKeyframes(sdf, serial));
+
+  KeyframeTable parallel;
+  std::vector<std::string> errors;
+  EXPECT_FALSE(parallel.AddAll(pluginElem, errors, 4));
+
+  ASSERT_EQ(2u, errors.size());
+  EXPECT_NE(std::string::npos, errors[0].find("Keyframe [2000]")) << errors[0];
+  EXPECT_NE(std::string::npos, errors[0].find("slow")) << errors[0];
+  EXPECT_NE(std::string::npos, errors[1].find("Missing visual")) << errors[1];
+
+  // Same as adding them one by one
+  ASSERT_EQ(serial.Size(), parallel.Size());
+  for (std::size_t i = 0; i < serial.Size(); ++i)
+  {
+    EXPECT_EQ(serial.Type(i), parallel.Type(i));
+    EXPECT_EQ(serial.SlideNumber(i), parallel.SlideNumber(i));
+    EXPECT_EQ(serial.Visual(i), parallel.Visual(i));
+    EXPECT_EQ(serial.Label(i), parallel.Label(i));
+    EXPECT_EQ(serial.Text(i), parallel.Text(i));
+    EXPECT_EQ(serial.EyeOffset(i), parallel.EyeOffset(i));
+    EXPECT_EQ(serial.CamPose(i), parallel.CamPose(i));
+    EXPECT_EQ(serial.LogSeek(i), parallel.LogSeek(i));
+    EXPECT_EQ(std::isnan(serial.Dwell(i)), std::isnan(parallel.Dwell(i)));
+  }
+
+  // Spot check the values
+  EXPECT_EQ(KeyframeType::LOOKAT, parallel.Type(4));
+  EXPECT_EQ(4, parallel.SlideNumber(4));
+  EXPECT_EQ(ignition::math::Pose3d(0, -2, 4, 0, 0, 0),
+      parallel.EyeOffset(4));
+  EXPECT_EQ("&lt;5&gt;", parallel.Text(5));
+  EXPECT_DOUBLE_EQ(0.5, parallel.Transition(5));
+  EXPECT_DOUBLE_EQ(5.0, parallel.Dwell(5));
+  EXPECT_EQ(ignition::math::Pose3d(6, 2, 3, 0, 0, 1), parallel.CamPose(6));
+  EXPECT_EQ(std::chrono::seconds(7) + std::chrono::nanoseconds(500),
+      parallel.LogSeek(7));
+  EXPECT_TRUE(std::isnan(parallel.Transition(2000)));
+}
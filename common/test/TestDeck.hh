@@ -0,0 +1,81 @@
+/*
+ * Copyright 2017 Louise Poubel
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+#ifndef SIMSLIDES_TEST_TESTDECK_HH_
+#define SIMSLIDES_TEST_TESTDECK_HH_
+
+#include <memory>
+#include <string>
+
+#include <sdf/parser.hh>
+#include <sdf/SDFImpl.hh>
+
+#include <simslides/common/KeyframeTable.hh>
+
+namespace simslides
+{
+  namespace test
+  {
+    /// \brief Parse keyframes as if they were given to the SimSlides plugin
+    /// of a world.
+    /// \param[in] _keyframes <keyframe> elements.
+    /// \return Plugin element, null if the SDF couldn't be parsed.
+    inline sdf::ElementPtr LoadPlugin(const std::string &_keyframes)
+    {
+      auto sdfParsed = std::make_shared<sdf::SDF>();
+      sdf::init(sdfParsed);
+      if (!sdf::readString(
+          "<?xml version='1.0' ?>"
+          "<sdf version='1.6'>"
+          "  <world name='test'>"
+          "    <gui>"
+          "      <plugin name='SimSlides' filename='libSimSlidesClassic.so'>"
+          + _keyframes +
+          "      </plugin>"
+          "    </gui>"
+          "  </world>"
+          "</sdf>", sdfParsed))
+      {
+        return nullptr;
+      }
+
+      return sdfParsed->Root()->GetElement("world")->GetElement("gui")->
+          GetElement("plugin");
+    }
+
+    /// \brief Parse keyframes into a table one by one, as if they were given
+    /// to the SimSlides plugin of a world.
+    /// \param[in] _keyframes <keyframe> elements.
+    /// \param[out] _table Table to append to.
+    /// \return False if the SDF couldn't be parsed.
+    inline bool LoadKeyframes(const std::string &_keyframes,
+        KeyframeTable &_table)
+    {
+      auto pluginElem = LoadPlugin(_keyframes);
+      if (!pluginElem || !pluginElem->HasElement("keyframe"))
+        return false;
+
+      auto keyframeElem = pluginElem->GetElement("keyframe");
+      while (keyframeElem)
+      {
+        _table.Add(keyframeElem);
+        keyframeElem = keyframeElem->GetNextElement("keyframe");
+      }
+      return true;
+    }
+  }
+}
+
+#endif
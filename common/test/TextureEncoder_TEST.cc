@@ -0,0 +1,285 @@
+/*
+ * Copyright 2017 Louise Poubel
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include <simslides/common/TextureEncoder.hh>
+
+using namespace simslides;
+
+namespace
+{
+  /// \brief Make a slide-like image: a smooth background with dark strokes,
+  /// like text.
+  /// \param[in] _width Width.
+  /// \param[in] _height Height.
+  /// \param[in] _translucent Whether to fade the alpha across the image.
+  /// \return Image.
+  RgbaImage SlideImage(uint32_t _width, uint32_t _height, bool _translucent)
+  {
+    RgbaImage image;
+    image.width = _width;
+    image.height = _height;
+    image.pixels.resize(4u * _width * _height);
+    for (uint32_t y = 0; y < _height; ++y)
+    {
+      for (uint32_t x = 0; x < _width; ++x)
+      {
+        auto *pixel = &image.pixels[4u * (y * _width + x)];
+        bool stroke = (y / 4) % 3 == 1 && (x / 2) % 5 != 0;
+        pixel[0] = stroke ? 20 : static_cast<uint8_t>(200 + x * 50 / _width);
+        pixel[1] = stroke ? 20 : static_cast<uint8_t>(220 - y * 60 / _height);
+        pixel[2] = stroke ? 60 : 240;
+        pixel[3] = _translucent ?
+            static_cast<uint8_t>(255 - x * 255 / _width) : 255;
+      }
+    }
+    return image;
+  }
+
+  /// \brief Expand a 565 color to 8 bits per channel.
+  /// \param[in] _color 565 color.
+  /// \return RGB.
+  std::array<int, 3> From565(int _color)
+  {
+    int r = _color >> 11;
+    int g = (_color >> 5) & 63;
+    int b = _color & 31;
+    return {(r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2)};
+  }
+
+  /// \brief Decode blocks the way GPUs do.
+  /// \param[in] _blocks Blocks, as written by TextureEncoder::Compress.
+  /// \param[in] _format Block format.
+  /// \param[in] _width Image width.
+  /// \param[in] _height Image height.
+  /// \return Decoded image.
+  RgbaImage Decode(const uint8_t *_blocks, BlockFormat _format,
+      uint32_t _width, uint32_t _height)
+  {
+    RgbaImage image;
+    image.width = _width;
+    image.height = _height;
+    image.pixels.resize(4u * _width * _height);
+
+    std::size_t blockSize = _format == BLOCK_BC1 ? 8 : 16;
+    uint32_t blocksWide = (_width + 3) / 4;
+    for (uint32_t y = 0; y < _height; ++y)
+    {
+      for (uint32_t x = 0; x < _width; ++x)
+      {
+        const auto *block =
+            _blocks + blockSize * ((y / 4) * blocksWide + x / 4);
+        int i = (y % 4) * 4 + x % 4;
+        auto *pixel = &image.pixels[4u * (y * _width + x)];
+
+        pixel[3] = 255;
+        if (_format == BLOCK_BC3)
+        {
+          int a0 = block[0];
+          int a1 = block[1];
+          uint64_t bits{0};
+          for (int k = 0; k < 6; ++k)
+            bits |= static_cast<uint64_t>(block[2 + k]) << (8 * k);
+
+          std::array<int, 8> palette{a0, a1};
+          if (a0 > a1)
+          {
+            for (int k = 1; k < 7; ++k)
+              palette[k + 1] = ((7 - k) * a0 + k * a1) / 7;
+          }
+          else
+          {
+            for (int k = 1; k < 5; ++k)
+              palette[k + 1] = ((5 - k) * a0 + k * a1) / 5;
+            palette[6] = 0;
+            palette[7] = 255;
+          }
+          pixel[3] = static_cast<uint8_t>(palette[(bits >> (3 * i)) & 7]);
+          block += 8;
+        }
+
+        int c0 = block[0] | block[1] << 8;
+        int c1 = block[2] | block[3] << 8;
+        uint32_t bits = block[4] | block[5] << 8 | block[6] << 16 |
+            static_cast<uint32_t>(block[7]) << 24;
+        int index = (bits >> (2 * i)) & 3;
+
+        // BC3 colors always use 4 colors
+        bool fourColors = c0 > c1 || _format == BLOCK_BC3;
+        auto e0 = From565(c0);
+        auto e1 = From565(c1);
+        for (int c = 0; c < 3; ++c)
+        {
+          std::array<int, 4> palette{e0[c], e1[c],
+              fourColors ? (2 * e0[c] + e1[c]) / 3 : (e0[c] + e1[c]) / 2,
+              fourColors ? (e0[c] + 2 * e1[c]) / 3 : 0};
+          pixel[c] = static_cast<uint8_t>(palette[index]);
+        }
+        if (!fourColors && index == 3)
+          pixel[3] = 0;
+      }
+    }
+    return image;
+  }
+
+  /// \brief Peak signal to noise ratio between two images.
+  /// \param[in] _a Image.
+  /// \param[in] _b Image of the same size.
+  /// \param[in] _first First channel to compare.
+  /// \param[in] _count Number of channels to compare.
+  /// \return PSNR in dB, infinite if the images match.
+  double Psnr(const RgbaImage &_a, const RgbaImage &_b, int _first,
+      int _count)
+  {
+    double squared{0};
+    for (std::size_t p = 0; p < _a.pixels.size(); p += 4)
+    {
+      for (int c = _first; c < _first + _count; ++c)
+      {
+        double diff = _a.pixels[p + c] - _b.pixels[p + c];
+        squared += diff * diff;
+      }
+    }
+
+    double mse = squared / (_count * _a.pixels.size() / 4.0);
+    return mse == 0 ? INFINITY : 10 * std::log10(255.0 * 255.0 / mse);
+  }
+}
+
+/////////////////////////////////////////////////
+TEST(TextureEncoder, Format)
+{
+  EXPECT_EQ(BLOCK_BC1, TextureEncoder::Format(SlideImage(8, 8, false)));
+  EXPECT_EQ(BLOCK_BC3, TextureEncoder::Format(SlideImage(8, 8, true)));
+}
+
+/////////////////////////////////////////////////
+TEST(TextureEncoder, SolidBlock)
+{
+  RgbaImage image;
+  image.width = 4;
+  image.height = 4;
+  for (int i = 0; i < 16; ++i)
+    image.pixels.insert(image.pixels.end(), {255, 0, 255, 255});
+
+  std::vector<uint8_t> blocks;
+  TextureEncoder::Compress(image, BLOCK_BC1, blocks);
+  ASSERT_EQ(8u, blocks.size());
+
+  // Colors which are exact in 565 decode exactly
+  auto decoded = Decode(blocks.data(), BLOCK_BC1, 4, 4);
+  EXPECT_EQ(image.pixels, decoded.pixels);
+}
+
+/////////////////////////////////////////////////
+TEST(TextureEncoder, Bc1Psnr)
+{
+  auto image = SlideImage(64, 48, false);
+
+  std::vector<uint8_t> blocks;
+  TextureEncoder::Compress(image, BLOCK_BC1, blocks);
+  ASSERT_EQ(8u * 16 * 12, blocks.size());
+
+  auto decoded = Decode(blocks.data(), BLOCK_BC1, 64, 48);
+  EXPECT_GT(Psnr(image, decoded, 0, 3), 35.0);
+  EXPECT_TRUE(std::isinf(Psnr(image, decoded, 3, 1)));
+}
+
+/////////////////////////////////////////////////
+TEST(TextureEncoder, Bc3Psnr)
+{
+  auto image = SlideImage(64, 48, true);
+
+  std::vector<uint8_t> blocks;
+  TextureEncoder::Compress(image, BLOCK_BC3, blocks);
+  ASSERT_EQ(16u * 16 * 12, blocks.size());
+
+  auto decoded = Decode(blocks.data(), BLOCK_BC3, 64, 48);
+  EXPECT_GT(Psnr(image, decoded, 0, 3), 35.0);
+  EXPECT_GT(Psnr(image, decoded, 3, 1), 45.0);
+}
+
+/////////////////////////////////////////////////
+TEST(TextureEncoder, PartialBlocks)
+{
+  // Edges are padded by repeating the last row and column
+  auto image = SlideImage(6, 5, false);
+
+  std::vector<uint8_t> blocks;
+  TextureEncoder::Compress(image, BLOCK_BC1, blocks);
+  ASSERT_EQ(8u * 2 * 2, blocks.size());
+
+  auto decoded = Decode(blocks.data(), BLOCK_BC1, 6, 5);
+  EXPECT_GT(Psnr(image, decoded, 0, 3), 30.0);
+}
+
+/////////////////////////////////////////////////
+TEST(TextureEncoder, Downsample)
+{
+  auto level = TextureEncoder::Downsample(SlideImage(5, 3, false));
+  EXPECT_EQ(2u, level.width);
+  EXPECT_EQ(1u, level.height);
+  EXPECT_EQ(4u * 2 * 1, level.pixels.size());
+
+  level = TextureEncoder::Downsample(SlideImage(1, 3, false));
+  EXPECT_EQ(1u, level.width);
+  EXPECT_EQ(1u, level.height);
+}
+
+/////////////////////////////////////////////////
+TEST(TextureEncoder, Encode)
+{
+  RgbaImage empty;
+  std::vector<uint8_t> dds;
+  EXPECT_FALSE(TextureEncoder::Encode(empty, dds));
+
+  auto image = SlideImage(64, 48, false);
+  ASSERT_TRUE(TextureEncoder::Encode(image, dds));
+
+  auto read32 = [&dds](std::size_t _offset)
+  {
+    return static_cast<uint32_t>(dds[_offset]) | dds[_offset + 1] << 8 |
+        dds[_offset + 2] << 16 | static_cast<uint32_t>(dds[_offset + 3]) << 24;
+  };
+
+  ASSERT_GE(dds.size(), 128u);
+  EXPECT_EQ(0, std::memcmp(dds.data(), "DDS ", 4));
+  EXPECT_EQ(48u, read32(12));
+  EXPECT_EQ(64u, read32(16));
+  EXPECT_EQ(0, std::memcmp(&dds[84], "DXT1", 4));
+
+  // 64x48 down to 1x1
+  EXPECT_EQ(7u, read32(28));
+  std::size_t size{128};
+  for (uint32_t w = 64, h = 48, i = 0; i < 7; ++i)
+  {
+    size += 8u * ((w + 3) / 4) * ((h + 3) / 4);
+    w = std::max(1u, w / 2);
+    h = std::max(1u, h / 2);
+  }
+  EXPECT_EQ(size, dds.size());
+
+  // The first level follows the header
+  auto decoded = Decode(&dds[128], BLOCK_BC1, 64, 48);
+  EXPECT_GT(Psnr(image, decoded, 0, 3), 35.0);
+}
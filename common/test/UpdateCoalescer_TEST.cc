@@ -0,0 +1,89 @@
+/*
+ * Copyright 2017 Louise Poubel
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+#include <gtest/gtest.h>
+
+#include <chrono>
+
+#include <simslides/common/UpdateCoalescer.hh>
+
+using namespace simslides;
+using namespace std::chrono_literals;
+
+/// \brief Arbitrary start time.
+static const UpdateCoalescer::Clock::time_point kStart{std::chrono::hours(1)};
+
+/////////////////////////////////////////////////
+TEST(UpdateCoalescer, Burst)
+{
+  UpdateCoalescer coalescer;
+  coalescer.SetWindow(100ms);
+  EXPECT_EQ(100ms, coalescer.Window());
+
+  // The first request is applied right away
+  EXPECT_TRUE(coalescer.Request(kStart));
+  EXPECT_FALSE(coalescer.Pending());
+
+  // Requests within the window are collapsed into one
+  EXPECT_FALSE(coalescer.Request(kStart + 10ms));
+  EXPECT_FALSE(coalescer.Request(kStart + 20ms));
+  EXPECT_TRUE(coalescer.Pending());
+  EXPECT_EQ(80ms, coalescer.Remaining(kStart + 20ms));
+
+  EXPECT_FALSE(coalescer.Poll(kStart + 99ms));
+  EXPECT_TRUE(coalescer.Poll(kStart + 100ms));
+  EXPECT_FALSE(coalescer.Pending());
+  EXPECT_EQ(UpdateCoalescer::Clock::duration::zero(),
+      coalescer.Remaining(kStart + 100ms));
+
+  // Only once
+  EXPECT_FALSE(coalescer.Poll(kStart + 300ms));
+}
+
+/////////////////////////////////////////////////
+TEST(UpdateCoalescer, WindowFromLastUpdate)
+{
+  UpdateCoalescer coalescer;
+  coalescer.SetWindow(100ms);
+
+  EXPECT_TRUE(coalescer.Request(kStart));
+  EXPECT_FALSE(coalescer.Request(kStart + 50ms));
+  EXPECT_TRUE(coalescer.Poll(kStart + 120ms));
+
+  // The deferred update starts a new window
+  EXPECT_FALSE(coalescer.Request(kStart + 150ms));
+  EXPECT_EQ(70ms, coalescer.Remaining(kStart + 150ms));
+
+  // A request while one is pending is never applied right away, even after
+  // the window
+  EXPECT_FALSE(coalescer.Request(kStart + 400ms));
+  EXPECT_TRUE(coalescer.Poll(kStart + 400ms));
+
+  // Single requests after a quiet period aren't delayed
+  EXPECT_TRUE(coalescer.Request(kStart + 1s));
+}
+
+/////////////////////////////////////////////////
+TEST(UpdateCoalescer, Disabled)
+{
+  UpdateCoalescer coalescer;
+  EXPECT_EQ(UpdateCoalescer::Clock::duration::zero(), coalescer.Window());
+
+  EXPECT_TRUE(coalescer.Request(kStart));
+  EXPECT_TRUE(coalescer.Request(kStart));
+  EXPECT_TRUE(coalescer.Request(kStart + 1ms));
+  EXPECT_FALSE(coalescer.Pending());
+  EXPECT_FALSE(coalescer.Poll(kStart + 1ms));
+}
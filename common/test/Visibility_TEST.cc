@@ -0,0 +1,163 @@
+/*
+ * Copyright 2017 Louise Poubel
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include <simslides/common/KeyframeTable.hh>
+#include <simslides/common/Visibility.hh>
+
+#include "TestDeck.hh"
+
+using namespace simslides;
+
+/// \brief Deck with two stacks: lookat a, stack b c d, lookat e, stack f g,
+/// cam_pose.
+static const char *kDeck =
+    "<keyframe type='lookat' visual='a'/>"
+    "<keyframe type='stack' visual='b'/>"
+    "<keyframe type='stack' visual='c'/>"
+    "<keyframe type='stack' visual='d'/>"
+    "<keyframe type='lookat' visual='e'/>"
+    "<keyframe type='stack' visual='f'/>"
+    "<keyframe type='stack' visual='g'/>"
+    "<keyframe type='cam_pose' pose='1 2 3 0 0 0'/>";
+
+/////////////////////////////////////////////////
+/// \brief Describe the changes going from one keyframe to another.
+/// \param[in] _keyframes Deck.
+/// \param[in] _index Index built for the deck.
+/// \param[in] _from Keyframe shown.
+/// \param[in] _to Keyframe to go to.
+/// \return Changes such as "b=0 c=1", in visual ID order.
+std::string Diff(const KeyframeTable &_keyframes, VisibilityIndex &_index,
+    int _from, int _to)
+{
+  std::vector<VisibilityChange> changes;
+  _index.Diff(_keyframes, _from, _to, changes);
+
+  std::string result;
+  for (const auto &change : changes)
+  {
+    if (!result.empty())
+      result += " ";
+    result += _keyframes.VisualName(change.visual) +
+        (change.visible ? "=1" : "=0");
+  }
+  return result;
+}
+
+/////////////////////////////////////////////////
+TEST(VisibilityIndex, Forward)
+{
+  KeyframeTable keyframes;
+  ASSERT_TRUE(test::LoadKeyframes(kDeck, keyframes));
+
+  VisibilityIndex index;
+  index.Build(keyframes);
+
+  EXPECT_EQ("", Diff(keyframes, index, -1, 0));
+  EXPECT_EQ("c=0 d=0", Diff(keyframes, index, 0, 1));
+  EXPECT_EQ("b=0 c=1", Diff(keyframes, index, 1, 2));
+  EXPECT_EQ("c=0 d=1", Diff(keyframes, index, 2, 3));
+  EXPECT_EQ("", Diff(keyframes, index, 3, 4));
+  EXPECT_EQ("g=0", Diff(keyframes, index, 4, 5));
+  EXPECT_EQ("f=0 g=1", Diff(keyframes, index, 5, 6));
+  EXPECT_EQ("", Diff(keyframes, index, 6, 7));
+}
+
+/////////////////////////////////////////////////
+TEST(VisibilityIndex, Backward)
+{
+  KeyframeTable keyframes;
+  ASSERT_TRUE(test::LoadKeyframes(kDeck, keyframes));
+
+  VisibilityIndex index;
+  index.Build(keyframes);
+
+  EXPECT_EQ("", Diff(keyframes, index, 7, 6));
+  EXPECT_EQ("f=1 g=0", Diff(keyframes, index, 6, 5));
+  EXPECT_EQ("g=1", Diff(keyframes, index, 5, 4));
+  EXPECT_EQ("", Diff(keyframes, index, 4, 3));
+  EXPECT_EQ("c=1 d=0", Diff(keyframes, index, 3, 2));
+  EXPECT_EQ("b=1 c=0", Diff(keyframes, index, 2, 1));
+  EXPECT_EQ("c=1 d=1", Diff(keyframes, index, 1, 0));
+  EXPECT_EQ("", Diff(keyframes, index, 0, -1));
+}
+
+/////////////////////////////////////////////////
+TEST(VisibilityIndex, Jump)
+{
+  KeyframeTable keyframes;
+  ASSERT_TRUE(test::LoadKeyframes(kDeck, keyframes));
+
+  VisibilityIndex index;
+  index.Build(keyframes);
+
+  // Walked-through stacks leave their last slide visible
+  EXPECT_EQ("b=0 c=0 f=0", Diff(keyframes, index, -1, 7));
+  EXPECT_EQ("c=1 d=0 f=1", Diff(keyframes, index, 7, 2));
+  EXPECT_EQ("b=1 d=1", Diff(keyframes, index, 2, -1));
+  EXPECT_EQ("", Diff(keyframes, index, 3, 3));
+}
+
+/////////////////////////////////////////////////
+TEST(VisibilityIndex, JumpAcrossCheckpoints)
+{
+  // Enough stacks to need several checkpoints
+  std::string deck;
+  const int stacks = VisibilityIndex::kStride * 3 + 5;
+  for (int s = 0; s < stacks; ++s)
+  {
+    deck += "<keyframe type='lookat' visual='l" + std::to_string(s) + "'/>";
+    for (int i = 0; i < 3; ++i)
+    {
+      deck += "<keyframe type='stack' visual='s" + std::to_string(s) + "_" +
+          std::to_string(i) + "'/>";
+    }
+  }
+
+  KeyframeTable keyframes;
+  ASSERT_TRUE(test::LoadKeyframes(deck, keyframes));
+
+  VisibilityIndex index;
+  index.Build(keyframes);
+
+  // Step through the deck one keyframe at a time, and check that jumping
+  // straight from the initial state gives the same visibility
+  std::vector<bool> stepped(keyframes.VisualCount(), true);
+  std::vector<VisibilityChange> changes;
+  for (int k = 0; k < static_cast<int>(keyframes.Size()); ++k)
+  {
+    index.Diff(keyframes, k - 1, k, changes);
+    for (const auto &change : changes)
+      stepped[change.visual] = change.visible;
+
+    std::vector<bool> jumped(keyframes.VisualCount(), true);
+    index.Diff(keyframes, -1, k, changes);
+    for (const auto &change : changes)
+      jumped[change.visual] = change.visible;
+
+    ASSERT_EQ(stepped, jumped) << "Keyframe [" << k << "]";
+  }
+
+  // And back from the end
+  index.Diff(keyframes, static_cast<int>(keyframes.Size()) - 1, -1, changes);
+  for (const auto &change : changes)
+    stepped[change.visual] = change.visible;
+  EXPECT_EQ(std::vector<bool>(keyframes.VisualCount(), true), stepped);
+}
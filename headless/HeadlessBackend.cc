@@ -0,0 +1,303 @@
+/*
+ * Copyright 2017 Louise Poubel
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+#include <limits>
+#include <set>
+#include <sstream>
+#include <unordered_map>
+#include <unordered_set>
+
+#include <sdf/parser.hh>
+#include <sdf/SDFImpl.hh>
+
+#include <simslides/common/Common.hh>
+#include <simslides/common/Log.hh>
+#include <simslides/common/World.hh>
+
+#include "HeadlessBackend.hh"
+
+using namespace simslides;
+
+class simslides::HeadlessBackendPrivate
+{
+  /// \brief Record a call.
+  /// \param[in] _event Call description.
+  public: void Record(const std::string &_event);
+
+  /// \brief World pose of each visual, by name.
+  public: std::unordered_map<std::string, ignition::math::Pose3d> visualPoses;
+
+  /// \brief Names of hidden visuals.
+  public: std::unordered_set<std::string> hidden;
+
+  /// \brief Current camera pose.
+  public: ignition::math::Pose3d cameraPose;
+
+  /// \brief Camera pose the presentation starts at.
+  public: ignition::math::Pose3d initialCameraPose;
+
+  /// \brief Current text.
+  public: std::string text;
+
+  /// \brief Last log time seeked to.
+  public: std::chrono::steady_clock::duration logTime{0};
+
+  /// \brief Calls recorded since the last TakeEvents.
+  public: std::vector<std::string> events;
+
+  /// \brief Whether to record calls.
+  public: bool recordEvents{true};
+};
+
+/////////////////////////////////////////////////
+void HeadlessBackendPrivate::Record(const std::string &_event)
+{
+  if (this->recordEvents)
+    this->events.push_back(_event);
+}
+
+/////////////////////////////////////////////////
+HeadlessBackend::HeadlessBackend() : dataPtr(new HeadlessBackendPrivate)
+{
+  Common::Instance()->SetBackend(this);
+}
+
+/////////////////////////////////////////////////
+HeadlessBackend::~HeadlessBackend()
+{
+  if (Common::Instance()->CurrentBackend() == this)
+    Common::Instance()->SetBackend(nullptr);
+}
+
+/////////////////////////////////////////////////
+bool HeadlessBackend::LoadWorld(const std::string &_worldFile,
+    const std::string &_plugin)
+{
+  auto sdfParsed = std::make_shared<sdf::SDF>();
+  sdf::init(sdfParsed);
+  if (!sdf::readFile(_worldFile, sdfParsed))
+  {
+    sserr << "Failed to parse [" << _worldFile << "]" << std::endl;
+    return false;
+  }
+
+  auto pluginElem = FindPlugin(sdfParsed->Root(), _plugin);
+  if (nullptr == pluginElem)
+  {
+    sserr << "No GUI plugin with keyframes found in [" << _worldFile << "]"
+          << std::endl;
+    return false;
+  }
+
+  std::set<std::string> unresolved;
+  for (const auto &[name, pose] :
+      EntityPoses(sdfParsed->Root(), false, unresolved))
+  {
+    this->dataPtr->visualPoses[name] = pose;
+  }
+
+  for (const auto &name : unresolved)
+  {
+    sswarn << "Pose of [" << name << "] is relative to another frame, "
+           << "which isn't supported, so it's left out." << std::endl;
+  }
+
+  InitialCameraPose(sdfParsed->Root(), this->dataPtr->initialCameraPose);
+  this->dataPtr->cameraPose = this->dataPtr->initialCameraPose;
+
+  Common::Instance()->LoadPluginSDF(pluginElem);
+  Common::Instance()->currentKeyframe = -1;
+
+  return !Common::Instance()->keyframes.Empty();
+}
+
+/////////////////////////////////////////////////
+void HeadlessBackend::SetVisualPose(const std::string &_name,
+    const ignition::math::Pose3d &_pose)
+{
+  this->dataPtr->visualPoses[_name] = _pose;
+  Common::Instance()->VisualMoved(_name);
+}
+
+/////////////////////////////////////////////////
+bool HeadlessBackend::PressKey(int _key)
+{
+  if (!Common::Instance()->HandleKeyPress(_key))
+    return false;
+
+  this->Update();
+  return true;
+}
+
+/////////////////////////////////////////////////
+void HeadlessBackend::GoTo(int _keyframe)
+{
+  Common::Instance()->ChangeKeyframe(_keyframe);
+  this->Update();
+}
+
+/////////////////////////////////////////////////
+bool HeadlessBackend::GoToLabel(const std::string &_label)
+{
+  if (!Common::Instance()->Apply({CMD_GOTO_LABEL, 0, _label}))
+    return false;
+
+  this->Update();
+  return true;
+}
+
+/////////////////////////////////////////////////
+bool HeadlessBackend::GoToVisual(const std::string &_visual)
+{
+  if (!Common::Instance()->Apply({CMD_GOTO_VISUAL, 0, _visual}))
+    return false;
+
+  this->Update();
+  return true;
+}
+
+/////////////////////////////////////////////////
+bool HeadlessBackend::Visible(const std::string &_name) const
+{
+  return this->dataPtr->hidden.find(_name) == this->dataPtr->hidden.end();
+}
+
+/////////////////////////////////////////////////
+std::string HeadlessBackend::Text() const
+{
+  return this->dataPtr->text;
+}
+
+/////////////////////////////////////////////////
+std::chrono::steady_clock::duration HeadlessBackend::LogTime() const
+{
+  return this->dataPtr->logTime;
+}
+
+/////////////////////////////////////////////////
+std::vector<std::string> HeadlessBackend::TakeEvents()
+{
+  std::vector<std::string> events;
+  events.swap(this->dataPtr->events);
+  return events;
+}
+
+/////////////////////////////////////////////////
+void HeadlessBackend::SetRecordEvents(bool _record)
+{
+  this->dataPtr->recordEvents = _record;
+}
+
+/////////////////////////////////////////////////
+void HeadlessBackend::Update()
+{
+  Common::Instance()->Update(*this);
+  Common::Instance()->FinishCamera(*this);
+}
+
+/////////////////////////////////////////////////
+ignition::math::Pose3d HeadlessBackend::CameraPose() const
+{
+  return this->dataPtr->cameraPose;
+}
+
+/////////////////////////////////////////////////
+void HeadlessBackend::SetCameraPose(const ignition::math::Pose3d &_pose)
+{
+  this->dataPtr->cameraPose = _pose;
+
+  if (this->dataPtr->recordEvents)
+  {
+    std::ostringstream event;
+    event << "move_camera " << _pose;
+    this->dataPtr->Record(event.str());
+  }
+}
+
+/////////////////////////////////////////////////
+void HeadlessBackend::SetVisualsVisible(
+    const std::vector<VisibilityChange> &_changes)
+{
+  const auto &keyframes = Common::Instance()->keyframes;
+  for (const auto &change : _changes)
+  {
+    const auto &name = keyframes.VisualName(change.visual);
+    if (change.visible)
+      this->dataPtr->hidden.erase(name);
+    else
+      this->dataPtr->hidden.insert(name);
+
+    if (this->dataPtr->recordEvents)
+    {
+      this->dataPtr->Record("visible " + name + " " +
+          (change.visible ? "1" : "0"));
+    }
+  }
+}
+
+/////////////////////////////////////////////////
+void HeadlessBackend::SeekLog(std::chrono::steady_clock::duration _time)
+{
+  this->dataPtr->logTime = _time;
+
+  if (this->dataPtr->recordEvents)
+  {
+    this->dataPtr->Record("seek_log " + std::to_string(
+        std::chrono::duration<double>(_time).count()));
+  }
+}
+
+/////////////////////////////////////////////////
+void HeadlessBackend::ResetCameraPose()
+{
+  this->dataPtr->cameraPose = this->dataPtr->initialCameraPose;
+  this->dataPtr->Record("reset_camera");
+}
+
+/////////////////////////////////////////////////
+ignition::math::Pose3d HeadlessBackend::VisualPose(uint32_t _id)
+{
+  const auto &name = Common::Instance()->keyframes.VisualName(_id);
+  auto it = this->dataPtr->visualPoses.find(name);
+  if (it == this->dataPtr->visualPoses.end())
+  {
+    sserr << "Couldn't find visual [" << name << "]" << std::endl;
+    return {
+      std::numeric_limits<double>::quiet_NaN(),
+      std::numeric_limits<double>::quiet_NaN(),
+      std::numeric_limits<double>::quiet_NaN(),
+      std::numeric_limits<double>::quiet_NaN(),
+      std::numeric_limits<double>::quiet_NaN(),
+      std::numeric_limits<double>::quiet_NaN()
+    };
+  }
+
+  return it->second;
+}
+
+/////////////////////////////////////////////////
+void HeadlessBackend::SetText(const std::string &_text)
+{
+  this->dataPtr->text = _text;
+
+  if (this->dataPtr->recordEvents)
+  {
+    // Keep one event per line
+    std::string event("text ");
+    for (auto c : _text)
+      event += c == '\n' ? std::string("\\n") : std::string(1, c);
+    this->dataPtr->Record(event);
+  }
+}
@@ -0,0 +1,141 @@
+/*
+ * Copyright 2017 Louise Poubel
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+#ifndef SIMSLIDES_HEADLESS_HEADLESSBACKEND_HH_
+#define SIMSLIDES_HEADLESS_HEADLESSBACKEND_HH_
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <ignition/math/Pose3.hh>
+#include <simslides/common/Backend.hh>
+#include <simslides/common/Visibility.hh>
+
+namespace simslides
+{
+  class HeadlessBackendPrivate;
+
+  /// \brief Backend which keeps the presentation state in memory instead of
+  /// driving a simulator. It's meant for profiling and regression testing
+  /// transitions on machines without a display or GPU.
+  ///
+  /// Every call Common makes into the backend is recorded as a line of
+  /// text, see TakeEvents. There are no frames to animate camera
+  /// transitions, so the camera is moved straight to the end of each one.
+  class HeadlessBackend final : public Backend
+  {
+    /// \brief Constructor. Sets itself as Common's backend.
+    public: HeadlessBackend();
+
+    /// \brief Destructor. Unsets itself as Common's backend.
+    public: ~HeadlessBackend() override;
+
+    /// \brief Load a world file: the SimSlides plugin's keyframes, the
+    /// initial camera pose and the pose of every model, link and visual,
+    /// which are used as visual poses.
+    /// \param[in] _worldFile Path to the world file.
+    /// \param[in] _plugin Name or filename of the plugin to load, empty to
+    /// use the first one with keyframes.
+    /// \return True on success.
+    public: bool LoadWorld(const std::string &_worldFile,
+        const std::string &_plugin = "");
+
+    /// \brief Set the world pose of a visual, as if it had moved in the
+    /// scene. Common is notified so camera poses looking at it are
+    /// recomputed.
+    /// \param[in] _name Visual name.
+    /// \param[in] _pose World pose.
+    public: void SetVisualPose(const std::string &_name,
+        const ignition::math::Pose3d &_pose);
+
+    /// \brief Press a key, updating the presentation if Common handles it.
+    /// \param[in] _key Qt key code.
+    /// \return True if the key was handled.
+    public: bool PressKey(int _key);
+
+    /// \brief Go to a keyframe and update the presentation.
+    /// \param[in] _keyframe Keyframe index, -1 for the initial pose.
+    public: void GoTo(int _keyframe);
+
+    /// \brief Go to the keyframe with a label and update the presentation.
+    /// \param[in] _label Keyframe label.
+    /// \return False if no keyframe has the label.
+    public: bool GoToLabel(const std::string &_label);
+
+    /// \brief Go to the first keyframe attached to a visual and update the
+    /// presentation.
+    /// \param[in] _visual Visual name.
+    /// \return False if no keyframe is attached to the visual.
+    public: bool GoToVisual(const std::string &_visual);
+
+
+    /// \brief Whether a visual is visible.
+    /// \param[in] _name Visual name.
+    /// \return True if visible, which is the case for unknown visuals.
+    public: bool Visible(const std::string &_name) const;
+
+    /// \brief Text currently displayed.
+    /// \return Text.
+    public: std::string Text() const;
+
+    /// \brief Time the log was last seeked to.
+    /// \return Log time.
+    public: std::chrono::steady_clock::duration LogTime() const;
+
+    /// \brief Get and clear the calls recorded since the last call, such as
+    /// "move_camera 1 2 3 0 0 0" or "visible slide-1 0".
+    /// \return Recorded calls, oldest first.
+    public: std::vector<std::string> TakeEvents();
+
+    /// \brief Set whether calls are recorded. Disable it when profiling.
+    /// \param[in] _record True to record.
+    public: void SetRecordEvents(bool _record);
+
+    // Documentation inherited
+    public: ignition::math::Pose3d CameraPose() const override;
+
+    // Documentation inherited
+    public: void SetCameraPose(const ignition::math::Pose3d &_pose)
+        override;
+
+    // Documentation inherited
+    public: void SetVisualsVisible(
+        const std::vector<VisibilityChange> &_changes) override;
+
+    // Documentation inherited
+    public: void SeekLog(std::chrono::steady_clock::duration _time) override;
+
+    // Documentation inherited
+    public: void ResetCameraPose() override;
+
+    // Documentation inherited
+    public: ignition::math::Pose3d VisualPose(uint32_t _id) override;
+
+    // Documentation inherited
+    public: void SetText(const std::string &_text) override;
+
+    /// \brief Update the presentation and move the camera to the end of
+    /// its transition.
+    private: void Update();
+
+    /// \internal
+    /// \brief Pointer to private data.
+    private: std::unique_ptr<HeadlessBackendPrivate> dataPtr;
+  };
+}
+
+#endif
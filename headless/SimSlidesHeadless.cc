@@ -0,0 +1,254 @@
+/*
+ * Copyright 2017 Louise Poubel
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <simslides/common/Common.hh>
+#include <simslides/common/Log.hh>
+
+#include "HeadlessBackend.hh"
+
+using namespace simslides;
+
+/////////////////////////////////////////////////
+void Usage()
+{
+  std::cerr
+      << "Usage: simslides_headless <world file> [options]" << std::endl
+      << std::endl
+      << "Load a world's SimSlides keyframes and replay key presses without a "
+      << "simulator," << std::endl
+      << "printing every call made to the backend." << std::endl
+      << std::endl
+      << "Options:" << std::endl
+      << "  --plugin <name>    Plugin name or filename, defaults to the first "
+      << "with keyframes" << std::endl
+      << "  --script <file>    Read commands from a file, one per line"
+      << std::endl
+      << "  --keys <commands>  Comma-separated commands" << std::endl
+      << "  --repeat <n>       Replay the commands n times" << std::endl
+      << "  --quiet            Only print timing" << std::endl
+      << "  --metrics          Print transition latency per keyframe type"
+      << std::endl
+      << std::endl
+      << "Commands: next, prev, current, home, goto <keyframe>, key <code>,"
+      << std::endl
+      << "          label <label>, visual <visual name>" << std::endl
+      << "Without commands, steps through the whole deck with next."
+      << std::endl;
+}
+
+/////////////////////////////////////////////////
+/// \brief Run a single command.
+/// \param[in] _backend Backend to run on.
+/// \param[in] _command Command, such as "next" or "goto 3".
+/// \return False if the command isn't valid.
+bool Run(HeadlessBackend &_backend, const std::string &_command)
+{
+  std::istringstream stream(_command);
+  std::string name;
+  stream >> name;
+
+  if (name == "next")
+    _backend.PressKey(16777236);
+  else if (name == "prev")
+    _backend.PressKey(16777234);
+  else if (name == "current")
+    _backend.PressKey(16777264);
+  else if (name == "home")
+    _backend.PressKey(16777269);
+  else if (name == "label" || name == "visual")
+  {
+    // Names may contain spaces, so take the rest of the line
+    std::string target;
+    std::getline(stream >> std::ws, target);
+    if (target.empty())
+      return false;
+
+    // Unknown targets are logged and leave the presentation as is
+    if (name == "label")
+      _backend.GoToLabel(target);
+    else
+      _backend.GoToVisual(target);
+  }
+  else if (name == "goto" || name == "key")
+  {
+    int value;
+    if (!(stream >> value))
+      return false;
+
+    if (name == "goto")
+      _backend.GoTo(value);
+    else
+      _backend.PressKey(value);
+  }
+  else
+    return false;
+
+  return true;
+}
+
+/////////////////////////////////////////////////
+int main(int argc, char **argv)
+{
+  if (argc < 2)
+  {
+    Usage();
+    return 1;
+  }
+
+  std::string worldFile(argv[1]);
+  std::string plugin;
+  std::vector<std::string> commands;
+  int repeat{1};
+  bool quiet{false};
+  bool metrics{false};
+
+  for (int i = 2; i < argc; ++i)
+  {
+    std::string arg(argv[i]);
+    bool hasValue = i + 1 < argc;
+
+    if (arg == "--plugin" && hasValue)
+    {
+      plugin = argv[++i];
+    }
+    else if (arg == "--script" && hasValue)
+    {
+      std::ifstream file(argv[++i]);
+      if (!file)
+      {
+        std::cerr << "Failed to open script [" << argv[i] << "]" << std::endl;
+        return 1;
+      }
+
+      std::string line;
+      while (std::getline(file, line))
+      {
+        if (!line.empty() && line[0] != '#')
+          commands.push_back(line);
+      }
+    }
+    else if (arg == "--keys" && hasValue)
+    {
+      std::istringstream keys(argv[++i]);
+      std::string command;
+      while (std::getline(keys, command, ','))
+      {
+        if (!command.empty())
+          commands.push_back(command);
+      }
+    }
+    else if (arg == "--repeat" && hasValue)
+    {
+      char *end{nullptr};
+      errno = 0;
+      auto value = std::strtol(argv[++i], &end, 10);
+      if (end == argv[i] || *end != '\0' || errno == ERANGE || value < 1 ||
+          value > std::numeric_limits<int>::max())
+      {
+        std::cerr << "Invalid --repeat [" << argv[i]
+                  << "], expected a positive integer" << std::endl;
+        Usage();
+        return 1;
+      }
+      repeat = static_cast<int>(value);
+    }
+    else if (arg == "--quiet")
+    {
+      quiet = true;
+    }
+    else if (arg == "--metrics")
+    {
+      metrics = true;
+    }
+    else
+    {
+      Usage();
+      return 1;
+    }
+  }
+
+  if (quiet)
+    Logger::Instance()->SetLevel(LOG_WARNING);
+
+  HeadlessBackend backend;
+  backend.SetRecordEvents(!quiet);
+
+  bool loaded = backend.LoadWorld(worldFile, plugin);
+
+  // Keep load messages ahead of the trace
+  Logger::Instance()->Flush();
+  if (!loaded)
+    return 1;
+
+  if (commands.empty())
+  {
+    commands.assign(Common::Instance()->keyframes.Size(), "next");
+  }
+
+  std::chrono::steady_clock::duration elapsed{0};
+  std::size_t count{0};
+
+  for (int r = 0; r < repeat; ++r)
+  {
+    for (const auto &command : commands)
+    {
+      auto start = std::chrono::steady_clock::now();
+      bool valid = Run(backend, command);
+      elapsed += std::chrono::steady_clock::now() - start;
+
+      if (!valid)
+      {
+        std::cerr << "Invalid command [" << command << "]" << std::endl;
+        return 1;
+      }
+      ++count;
+
+      if (quiet)
+        continue;
+
+      // Print errors logged by this command before its trace
+      Logger::Instance()->Flush();
+
+      std::cout << "> " << command << " ["
+                << Common::Instance()->currentKeyframe << "]" << std::endl;
+      for (const auto &event : backend.TakeEvents())
+        std::cout << "  " << event << std::endl;
+    }
+  }
+
+  Common::Instance()->ExportMetrics(true);
+  Common::Instance()->metricsExporter.Flush();
+
+  // Timing goes to stderr so the trace on stdout can be diffed across runs
+  Logger::Instance()->Flush();
+  if (metrics)
+    std::cerr << Common::Instance()->metrics.Summary();
+  auto us = std::chrono::duration<double, std::micro>(elapsed).count();
+  std::cerr << "Ran [" << count << "] commands in [" << us / 1000.0
+            << "] ms, [" << (count > 0 ? us / count : 0.0)
+            << "] us per command" << std::endl;
+
+  return 0;
+}
@@ -0,0 +1,50 @@
+# Replay a script through simslides_headless and compare the trace it prints
+# with a golden file. Run with cmake -P, setting:
+#
+#   HEADLESS  Path to simslides_headless
+#   WORLD     World file to load
+#   SCRIPT    Commands file, passed to --script
+#   GOLDEN    Expected trace
+#   WORK_DIR  Directory to run in, where the trace is written on failure
+#
+# To replay a compiled deck, also set COMPILE to the path to
+# simslides_compile and DECK_WORLD to the world the deck is compiled from.
+# It's written to WORK_DIR, where WORLD's <deck_file> is looked up.
+
+foreach(var HEADLESS WORLD SCRIPT GOLDEN WORK_DIR)
+  if(NOT DEFINED ${var})
+    message(FATAL_ERROR "${var} isn't set")
+  endif()
+endforeach()
+
+file(MAKE_DIRECTORY ${WORK_DIR})
+
+if(DEFINED COMPILE)
+  execute_process(
+    COMMAND ${COMPILE} ${DECK_WORLD} replay.deck
+    WORKING_DIRECTORY ${WORK_DIR}
+    RESULT_VARIABLE result
+  )
+  if(NOT result EQUAL 0)
+    message(FATAL_ERROR "Failed to compile [${DECK_WORLD}]: ${result}")
+  endif()
+endif()
+
+# Timing and log messages go to stderr, so stdout only holds the trace
+execute_process(
+  COMMAND ${HEADLESS} ${WORLD} --script ${SCRIPT}
+  WORKING_DIRECTORY ${WORK_DIR}
+  OUTPUT_VARIABLE trace
+  RESULT_VARIABLE result
+)
+if(NOT result EQUAL 0)
+  message(FATAL_ERROR "simslides_headless failed: ${result}")
+endif()
+
+file(READ ${GOLDEN} golden)
+if(NOT trace STREQUAL golden)
+  file(WRITE ${WORK_DIR}/replay.trace "${trace}")
+  message(FATAL_ERROR "Trace differs from [${GOLDEN}], see "
+    "[${WORK_DIR}/replay.trace]. If the change is intended, copy it over the "
+    "golden file.")
+endif()
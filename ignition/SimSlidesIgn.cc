@@ -18,8 +18,6 @@
 #include <iostream>
 #include <limits>
 
-#include <ignition/msgs/gui_camera.pb.h>
-#include <ignition/msgs/boolean.pb.h>
 #include <tinyxml2.h>
 
 #include <ignition/common/Console.hh>
@@ -31,6 +29,7 @@
 #include <ignition/rendering/RenderEngine.hh>
 #include <ignition/rendering/RenderingIface.hh>
 #include <simslides/common/Common.hh>
+#include <simslides/common/Log.hh>
 #include <sdf/parser.hh>
 
 #include "SimSlidesIgn.hh"
@@ -46,6 +45,8 @@ SimSlidesIgn::SimSlidesIgn()
 /////////////////////////////////////////////////
 SimSlidesIgn::~SimSlidesIgn()
 {
+  if (Common::Instance()->CurrentBackend() == this)
+    Common::Instance()->SetBackend(nullptr);
 }
 
 /////////////////////////////////////////////////
@@ -79,6 +80,10 @@ void SimSlidesIgn::LoadConfig(const tinyxml2::XMLElement *_pluginXml)
   Common::Instance()->LoadPluginSDF(pluginElem);
 
   this->node.Subscribe("/keyboard/keypress", &SimSlidesIgn::OnKeyPress, this);
+  this->node.Subscribe("/simslides/goto_label", &SimSlidesIgn::OnGoToLabel,
+      this);
+  this->node.Subscribe("/simslides/goto_visual", &SimSlidesIgn::OnGoToVisual,
+      this);
 
 //      this->logPlaybackControlPub = this->node->
 //          Advertise<gazebo::msgs::LogPlaybackControl>("~/playback_control");
@@ -86,31 +91,13 @@ void SimSlidesIgn::LoadConfig(const tinyxml2::XMLElement *_pluginXml)
   ignition::gui::App()->findChild<ignition::gui::MainWindow *>
       ()->installEventFilter(this);
 
-  simslides::Common::Instance()->MoveCamera =
-      std::bind(&SimSlidesIgn::OnMoveCamera, this, std::placeholders::_1);
+  Common::Instance()->SetBackend(this);
 
-  simslides::Common::Instance()->SetVisualVisible =
-      std::bind(&SimSlidesIgn::OnSetVisualVisible, this, std::placeholders::_1,
-      std::placeholders::_2);
-
-  simslides::Common::Instance()->SeekLog =
-      std::bind(&SimSlidesIgn::OnSeekLog, this, std::placeholders::_1);
-
-  simslides::Common::Instance()->ResetCameraPose =
-      std::bind(&SimSlidesIgn::OnResetCameraPose, this);
-
-  simslides::Common::Instance()->VisualPose =
-      std::bind(&SimSlidesIgn::OnVisualPose, this, std::placeholders::_1);
-
-  simslides::Common::Instance()->SetText =
-      std::bind(&SimSlidesIgn::OnSetText, this, std::placeholders::_1);
-
-  ignmsg << "Start presentation. Total of [" << Common::Instance()->keyframes.size()
+  ignmsg << "Start presentation. Total of [" << Common::Instance()->keyframes.Size()
         << "] keyframes" << std::endl;
 
   // Trigger first slide
-  Common::Instance()->currentKeyframe = 0;
-  this->pendingCommand = true;
+  Common::Instance()->commands.Push({CMD_GOTO, 0});
 }
 
 /////////////////////////////////////////////////
@@ -119,7 +106,13 @@ bool SimSlidesIgn::eventFilter(QObject *_obj, QEvent *_event)
   if (_event->type() == ignition::gui::events::Render::kType)
   {
     this->LoadScene();
+    this->CheckVisualPoses();
     this->ProcessCommands();
+    Common::Instance()->StepCamera(*this);
+
+    std::string summary;
+    if (Common::Instance()->metricsExporter.TakeSummary(summary))
+      this->updateMetrics(QString::fromStdString(summary));
   }
   return QObject::eventFilter(_obj, _event);
 }
@@ -141,6 +134,7 @@ void SimSlidesIgn::LoadScene()
     if (nullptr != cam)
     {
       this->camera = cam;
+      this->initialCameraPose = cam->WorldPose();
 
       if (!std::isnan(Common::Instance()->farClip) && !std::isnan(Common::Instance()->nearClip))
       {
@@ -163,70 +157,136 @@ void SimSlidesIgn::LoadScene()
   }
 }
 
+/////////////////////////////////////////////////
+void SimSlidesIgn::CheckVisualPoses()
+{
+  const auto &keyframes = Common::Instance()->keyframes;
+  if (this->visualsVersion != keyframes.Version() ||
+      this->visualPoses.size() != this->visuals.size())
+  {
+    return;
+  }
+
+  for (std::size_t id = 0; id < this->visuals.size(); ++id)
+  {
+    if (!this->visuals[id])
+      continue;
+
+    auto pose = this->visuals[id]->WorldPose();
+    if (pose == this->visualPoses[id])
+      continue;
+
+    this->visualPoses[id] = pose;
+    Common::Instance()->VisualMoved(static_cast<uint32_t>(id));
+  }
+}
+
 /////////////////////////////////////////////////
 void SimSlidesIgn::OnKeyframeChanged(int _keyframe)
 {
-  Common::Instance()->ChangeKeyframe(_keyframe);
-  this->pendingCommand = true;
+  Common::Instance()->commands.Push({CMD_GOTO, _keyframe});
+}
+
+/////////////////////////////////////////////////
+void SimSlidesIgn::OnPlay(bool _play)
+{
+  Common::Instance()->commands.Push({_play ? CMD_PLAY : CMD_PAUSE});
+}
+
+/////////////////////////////////////////////////
+void SimSlidesIgn::OnLoop(bool _loop)
+{
+  Common::Instance()->commands.Push({_loop ? CMD_LOOP : CMD_NO_LOOP});
 }
 
 /////////////////////////////////////////////////
 void SimSlidesIgn::ProcessCommands()
 {
-  if (!this->pendingCommand)
+  // Only the rendering thread changes the presentation state. Commands
+  // arriving in quick succession are applied as a single update once the
+  // burst is over.
+  bool updated{false};
+  bool changed = simslides::Common::Instance()->ProcessCommands();
+  if (simslides::Common::Instance()->PollAutoplay())
+    changed = true;
+
+  if (changed)
+    updated = simslides::Common::Instance()->RequestUpdate(*this);
+  else
+    updated = simslides::Common::Instance()->PollUpdate(*this);
+
+  const auto &autoplay = Common::Instance()->autoplay;
+  if (autoplay.Playing() != this->autoplayPlaying ||
+      autoplay.Loop() != this->autoplayLoop)
+  {
+    this->autoplayPlaying = autoplay.Playing();
+    this->autoplayLoop = autoplay.Loop();
+    this->updateAutoplay(this->autoplayPlaying, this->autoplayLoop);
+  }
+
+  if (!updated)
     return;
 
-  this->pendingCommand = false;
+  ssmsg << "Changed to slide [" << Common::Instance()->currentKeyframe << "]"
+        << std::endl;
 
-  ignmsg << "Changing to slide [" << Common::Instance()->currentKeyframe << "]"
-         << std::endl;
+  this->updateGUI(Common::Instance()->currentKeyframe,
+      Common::Instance()->keyframes.Size() - 1);
+}
 
-  simslides::Common::Instance()->Update();
+/////////////////////////////////////////////////
+void SimSlidesIgn::OnKeyPress(const ignition::msgs::Int32 &_msg)
+{
+  Common::Instance()->PushKey(_msg.data());
+}
 
-  this->updateGUI(Common::Instance()->currentKeyframe, Common::Instance()->keyframes.size() - 1);
+/////////////////////////////////////////////////
+void SimSlidesIgn::OnGoToLabel(const ignition::msgs::StringMsg &_msg)
+{
+  Common::Instance()->commands.Push({CMD_GOTO_LABEL, 0, _msg.data()});
 }
 
 /////////////////////////////////////////////////
-void SimSlidesIgn::OnKeyPress(const ignition::msgs::Int32 &_msg)
+void SimSlidesIgn::OnGoToVisual(const ignition::msgs::StringMsg &_msg)
 {
-  if (Common::Instance()->HandleKeyPress(_msg.data()))
-    this->pendingCommand = true;
+  Common::Instance()->commands.Push({CMD_GOTO_VISUAL, 0, _msg.data()});
 }
 
 /////////////////////////////////////////////////
-void SimSlidesIgn::OnMoveCamera(const ignition::math::Pose3d &_pose)
+ignition::math::Pose3d SimSlidesIgn::CameraPose() const
 {
   if (nullptr == this->camera)
   {
-    ignerr << "No camera, failed to move camera." << std::endl;
-    return;
+    return {
+      std::numeric_limits<double>::quiet_NaN(),
+      std::numeric_limits<double>::quiet_NaN(),
+      std::numeric_limits<double>::quiet_NaN(),
+      std::numeric_limits<double>::quiet_NaN(),
+      std::numeric_limits<double>::quiet_NaN(),
+      std::numeric_limits<double>::quiet_NaN()
+    };
   }
 
-  // Don't bother moving just a mm
-  if ((this->camera->WorldPose().Pos() - _pose.Pos()).Length() < 0.001)
-    return;
-
-  ignition::msgs::GUICamera req;
-  ignition::msgs::Set(req.mutable_pose(), _pose);
+  return this->camera->WorldPose();
+}
 
-  std::function<void(const ignition::msgs::Boolean &, const bool)> cb =
-      [](const ignition::msgs::Boolean &_res, const bool _result)
+/////////////////////////////////////////////////
+void SimSlidesIgn::SetCameraPose(const ignition::math::Pose3d &_pose)
+{
+  if (nullptr == this->camera)
   {
-    if (!_result)
-    {
-      ignerr << "Timed out requesting to move camera" << std::endl;
-    }
-    if (!_res.data())
-    {
-      ignerr << "Failed to move camera" << std::endl;
-    }
-  };
+    ignerr << "No camera, failed to move camera." << std::endl;
+    return;
+  }
 
-  this->node.Request("/gui/move_to/pose", req, cb);
+  // Runs on the rendering thread, so the camera is moved directly instead
+  // of requesting it from the GUI camera controller
+  this->camera->SetWorldPose(_pose);
 }
 
 /////////////////////////////////////////////////
-void SimSlidesIgn::OnSetVisualVisible(const std::string &_name, bool _visible)
+void SimSlidesIgn::SetVisualsVisible(
+    const std::vector<VisibilityChange> &_changes)
 {
   if (nullptr == this->camera)
   {
@@ -234,21 +294,18 @@ void SimSlidesIgn::OnSetVisualVisible(const std::string &_name, bool _visible)
     return;
   }
 
-  auto vis = this->scene->VisualByName(_name);
-
-  if (!vis)
+  for (const auto &change : _changes)
   {
-    ignerr << "Couldn't find visual [" << _name << "]" << std::endl;
-    return;
+    auto vis = this->VisualById(change.visual);
+    if (vis)
+      vis->SetVisible(change.visible);
   }
-
-  vis->SetVisible(_visible);
 }
 
 /////////////////////////////////////////////////
-void SimSlidesIgn::OnSeekLog(std::chrono::steady_clock::duration _time)
+void SimSlidesIgn::SeekLog(std::chrono::steady_clock::duration _time)
 {
-  std::cout << "Log seek not supported yet" << std::endl;
+  sswarn << "Log seek not supported yet" << std::endl;
   // if (!this->logPlaybackControlPub)
   // {
   //   this->logPlaybackControlPub = this->node->
@@ -269,28 +326,21 @@ void SimSlidesIgn::OnSeekLog(std::chrono::steady_clock::duration _time)
 }
 
 /////////////////////////////////////////////////
-void SimSlidesIgn::OnResetCameraPose()
+void SimSlidesIgn::ResetCameraPose()
 {
-  ignition::msgs::Vector3d req;
-
-  std::function<void(const ignition::msgs::Boolean &, const bool)> cb =
-      [](const ignition::msgs::Boolean &_res, const bool _result)
+  if (nullptr == this->camera)
   {
-    if (!_result)
-    {
-      ignerr << "Timed out requesting to reset camera" << std::endl;
-    }
-    if (!_res.data())
-    {
-      ignerr << "Failed to reset camera" << std::endl;
-    }
-  };
+    ignerr << "No camera, failed to reset camera pose." << std::endl;
+    return;
+  }
 
-  this->node.Request("/gui/view_angle", req, cb);
+  // Fly home through Common instead of requesting /gui/view_angle, so the
+  // transition is animated and measured like any other
+  Common::Instance()->MoveCamera(*this, this->initialCameraPose);
 }
 
 /////////////////////////////////////////////////
-ignition::math::Pose3d SimSlidesIgn::OnVisualPose(const std::string &_name)
+ignition::math::Pose3d SimSlidesIgn::VisualPose(uint32_t _id)
 {
   if (nullptr == this->camera)
   {
@@ -305,10 +355,9 @@ ignition::math::Pose3d SimSlidesIgn::OnVisualPose(const std::string &_name)
     };
   }
 
-  auto vis = this->camera->Scene()->VisualByName(_name);
+  auto vis = this->VisualById(_id);
   if (!vis)
   {
-    ignerr << "Failed to find visual [" << _name << "]" << std::endl;
     return {
       std::numeric_limits<double>::quiet_NaN(),
       std::numeric_limits<double>::quiet_NaN(),
@@ -324,7 +373,42 @@ ignition::math::Pose3d SimSlidesIgn::OnVisualPose(const std::string &_name)
 }
 
 /////////////////////////////////////////////////
-void SimSlidesIgn::OnSetText(const std::string &_name)
+ignition::rendering::VisualPtr SimSlidesIgn::VisualById(uint32_t _id)
+{
+  const auto &keyframes = Common::Instance()->keyframes;
+  if (this->visualsVersion != keyframes.Version() ||
+      this->visuals.size() != keyframes.VisualCount())
+  {
+    this->visuals.assign(keyframes.VisualCount(), nullptr);
+    this->visualPoses.assign(keyframes.VisualCount(),
+        ignition::math::Pose3d::Zero);
+    this->visualsVersion = keyframes.Version();
+  }
+
+  if (_id >= this->visuals.size() || nullptr == this->scene)
+    return nullptr;
+
+  auto &vis = this->visuals[_id];
+  if (!vis)
+  {
+    vis = this->scene->VisualByName(keyframes.VisualName(_id));
+    if (vis)
+    {
+      this->visualPoses[_id] = vis->WorldPose();
+      Common::Instance()->VisualResolved(_id, this->visualPoses[_id]);
+    }
+    else
+    {
+      sserr << "Couldn't find visual [" << keyframes.VisualName(_id) << "]"
+            << std::endl;
+    }
+  }
+
+  return vis;
+}
+
+/////////////////////////////////////////////////
+void SimSlidesIgn::SetText(const std::string &_name)
 {
   // TODO(louise) Support setting text
 }
@@ -20,23 +20,48 @@
 
 #include <ignition/gui/qt.h>
 #include <ignition/msgs/int64.pb.h>
+#include <ignition/msgs/stringmsg.pb.h>
 #include <ignition/gui/Plugin.hh>
 #include <ignition/rendering/Camera.hh>
 #include <ignition/rendering/Scene.hh>
 #include <ignition/transport/Node.hh>
+#include <simslides/common/Backend.hh>
+#include <simslides/common/Visibility.hh>
 
 namespace simslides
 {
-class SimSlidesIgn : public ignition::gui::Plugin
+class SimSlidesIgn final : public ignition::gui::Plugin, public Backend
 {
   Q_OBJECT
 
   /// \brief Constructor
   public: SimSlidesIgn();
 
-  /// \brief Destructor
+  /// \brief Destructor. Unsets itself as Common's backend.
   public: virtual ~SimSlidesIgn();
 
+  // Documentation inherited
+  public: ignition::math::Pose3d CameraPose() const override;
+
+  // Documentation inherited
+  public: void SetCameraPose(const ignition::math::Pose3d &_pose) override;
+
+  // Documentation inherited
+  public: void SetVisualsVisible(
+      const std::vector<VisibilityChange> &_changes) override;
+
+  // Documentation inherited
+  public: void SeekLog(std::chrono::steady_clock::duration _time) override;
+
+  // Documentation inherited
+  public: void ResetCameraPose() override;
+
+  // Documentation inherited
+  public: ignition::math::Pose3d VisualPose(uint32_t _id) override;
+
+  // Documentation inherited
+  public: void SetText(const std::string &_text) override;
+
   // Documentation inherited
   public: void LoadConfig(const tinyxml2::XMLElement *_pluginElem) override;
 
@@ -47,7 +72,16 @@ class SimSlidesIgn : public ignition::gui::Plugin
   /// \param[in] _keyframe Number of keyframe to change to
   protected slots: void OnKeyframeChanged(int _keyframe);
 
-  /// \brief Process pending commands on the rendering thread.
+  /// \brief Callback when the user plays or pauses autoplay.
+  /// \param[in] _play True to play, false to pause.
+  protected slots: void OnPlay(bool _play);
+
+  /// \brief Callback when the user turns looping on or off.
+  /// \param[in] _loop True to loop.
+  protected slots: void OnLoop(bool _loop);
+
+  /// \brief Process pending commands on the rendering thread, and updates
+  /// deferred while coalescing commands.
   private slots: void ProcessCommands();
 
   /// \brief Notifies that the keyframe index has changed,
@@ -55,40 +89,46 @@ class SimSlidesIgn : public ignition::gui::Plugin
   /// \param[in] _keyframeCount Total number of keyframes.
   signals: void updateGUI(int _currentKeyframe, int _keyframeCount);
 
+  /// \brief Notifies that autoplay was paused, resumed or its loop
+  /// changed, including when it pauses on the last keyframe.
+  /// \param[in] _playing Whether autoplay is playing.
+  /// \param[in] _loop Whether autoplay loops.
+  signals: void updateAutoplay(bool _playing, bool _loop);
+
+  /// \brief Notifies that transition metrics changed.
+  /// \param[in] _summary Summary table, see TransitionMetrics::Summary.
+  signals: void updateMetrics(QString _summary);
+
   /// \brief Get the scene and user camera
   private: void LoadScene();
 
-  /// \brief Callback when user presses a key.
+  /// \brief Notify Common of resolved visuals which moved since the last
+  /// frame. The GUI doesn't get pose updates from the server, so they're
+  /// detected on the rendering thread instead.
+  private: void CheckVisualPoses();
+
+  /// \brief Callback when user presses a key. It runs on a transport
+  /// thread, so it only queues the command for the rendering thread.
   /// \param[in] _msg Message containing key.
   private: void OnKeyPress(const ignition::msgs::Int32 &_msg);
 
-  /// \brief Callback to move camera.
-  /// \param[in] _pose Pose to move to.
-  private: void OnMoveCamera(const ignition::math::Pose3d &_pose);
-
-  /// \brief Callback to show / hide a visual
-  /// \param[in] _name Visual's scoped name
-  /// \param[in] _visible True to show
-  private: void OnSetVisualVisible(const std::string &_name, bool _visible);
-
-  /// \brief Callback to seek a log file.
-  /// \param[in] _time Time to seek to.
-  private: void OnSeekLog(std::chrono::steady_clock::duration _time);
-
-  /// \brief Callback to reset the camera pose.
-  private: void OnResetCameraPose();
+  /// \brief Callback when a keyframe is requested by label. It runs on a
+  /// transport thread, so it only queues the command.
+  /// \param[in] _msg Message containing the label.
+  private: void OnGoToLabel(const ignition::msgs::StringMsg &_msg);
 
-  /// \brief Callback to get a visual's pose
-  /// \param[in] _name Visual's scoped name
-  /// \return Visual's pose in world frame
-  private: ignition::math::Pose3d OnVisualPose(const std::string &_name);
+  /// \brief Callback when the first keyframe attached to a visual is
+  /// requested. It runs on a transport thread, so it only queues the
+  /// command.
+  /// \param[in] _msg Message containing the visual name.
+  private: void OnGoToVisual(const ignition::msgs::StringMsg &_msg);
 
-  /// \brief Callback to set the text on the dialog.
-  /// \param[in] _text Text to set.
-  private: void OnSetText(const std::string &_text);
-
-  /// \brief True when there's a pending command.
-  private: bool pendingCommand;
+  /// \brief Get a visual from its ID, looking it up by name in the scene
+  /// only the first time it's requested. Its compiled camera poses are
+  /// dropped then if it isn't where the deck expects it.
+  /// \param[in] _id Visual ID, see KeyframeTable::VisualName.
+  /// \return The visual, or null if it isn't in the scene.
+  private: ignition::rendering::VisualPtr VisualById(uint32_t _id);
 
   /// \brief Node used for communication.
   private: ignition::transport::Node node;
@@ -96,9 +136,29 @@ class SimSlidesIgn : public ignition::gui::Plugin
   /// \brief Keep pointer to camera so we can move it.
   private: ignition::rendering::CameraPtr camera;
 
+  /// \brief Camera pose when it was attached, which is where the scene
+  /// placed it, restored by ResetCameraPose.
+  private: ignition::math::Pose3d initialCameraPose;
+
   /// \brief Keep pointer to scene so we can get visuals.
   private: ignition::rendering::ScenePtr scene;
 
+  /// \brief Visuals resolved so far, indexed by visual ID.
+  private: std::vector<ignition::rendering::VisualPtr> visuals;
+
+  /// \brief World pose of each resolved visual on the last frame, indexed
+  /// by visual ID.
+  private: std::vector<ignition::math::Pose3d> visualPoses;
+
+  /// \brief Deck version the cached visuals belong to.
+  private: uint64_t visualsVersion{0};
+
+  /// \brief Autoplay state last sent to the GUI.
+  private: bool autoplayPlaying{false};
+
+  /// \brief Autoplay loop last sent to the GUI.
+  private: bool autoplayLoop{false};
+
 //  /// \brief Used to start, stop, and step simulation.
 //  private: ignition::transport::Publisher logPlaybackControlPub;
 };
@@ -32,6 +32,13 @@ RowLayout {
       keyframeSpin.value = _currentKeyframe;
       simSlides.lastKeyframe = _keyframeCount;
     }
+    onUpdateAutoplay: {
+      playButton.checked = _playing;
+      loopButton.checked = _loop;
+    }
+    onUpdateMetrics: {
+      metricsText.text = _summary;
+    }
   }
 
   SpinBox {
@@ -46,4 +53,50 @@ RowLayout {
       SimSlidesIgn.OnKeyframeChanged(keyframeSpin.value);
     }
   }
+
+  ToolButton {
+    id: playButton
+    text: "\u23EF"
+    checkable: true
+    ToolTip.text: "Play / pause autoplay"
+    ToolTip.visible: hovered
+    ToolTip.delay: Qt.styleHints.mousePressAndHoldInterval
+    onClicked: {
+      SimSlidesIgn.OnPlay(playButton.checked);
+    }
+  }
+
+  ToolButton {
+    id: loopButton
+    text: "\u21BB"
+    checkable: true
+    ToolTip.text: "Loop autoplay"
+    ToolTip.visible: hovered
+    ToolTip.delay: Qt.styleHints.mousePressAndHoldInterval
+    onClicked: {
+      SimSlidesIgn.OnLoop(loopButton.checked);
+    }
+  }
+
+  ToolButton {
+    id: metricsButton
+    text: "\u23F1"
+    ToolTip.text: "Transition latency"
+    ToolTip.visible: hovered
+    ToolTip.delay: Qt.styleHints.mousePressAndHoldInterval
+    onClicked: {
+      metricsPopup.open();
+    }
+  }
+
+  Popup {
+    id: metricsPopup
+    y: metricsButton.height
+
+    Label {
+      id: metricsText
+      text: "No transitions yet"
+      font.family: "monospace"
+    }
+  }
 }